@@ -0,0 +1,71 @@
+#pragma once
+#include "definitions.hpp"
+#include <cstddef>           // For std::size_t, std::byte
+#include <cstdint>           // For std::uint32_t
+#include <linux/videodev2.h> // For v4l2_buffer
+#include <memory>            // For std::unique_ptr
+#include <string>            // For std::string
+#include <sys/types.h>       // For off_t
+
+namespace v4l2
+{
+    /*
+     * What V4L2Camera talks to: a V4L2 capture node, or something that acts like one.
+     * Calls follow the V4L2 driver contract (ioctl returns -1 and sets errno, DQBUF fails with EAGAIN
+     * when nothing is ready, fd() polls POLLIN once a buffer is done), so the camera code is the same
+     * for every backend. QBUF may come from any thread while another one is in DQBUF.
+     */
+    class CaptureBackend
+    {
+    public:
+        virtual ~CaptureBackend() = default;
+
+        // Pollable fd, POLLIN when DQBUF has something
+        [[nodiscard]] virtual int fd() const noexcept = 0;
+
+        // ioctl(2) semantics
+        [[nodiscard]] virtual int ioctl(unsigned long request, void *arg) noexcept = 0;
+
+        // mmap(2) of the MMAP buffer at `offset` (v4l2_buffer.m.offset, or v4l2_plane.m.mem_offset, from QUERYBUF), MAP_FAILED on error; munmap() undoes it
+        [[nodiscard]] virtual void *map(std::size_t length, int prot, off_t offset) noexcept = 0;
+
+        // Where the bytes of memory plane `plane` of a dequeued buffer are, `mapped` is buffer buf.index as map() returned it
+        [[nodiscard]] virtual const std::byte *frame_data(const v4l2_buffer &buf, const MappedBuffer &mapped,
+                                                          std::uint32_t plane) const noexcept
+        {
+            static_cast<void>(buf);
+            return mapped.plane(plane).data;
+        }
+    };
+
+    // The real thing: a /dev/video* node opened O_RDWR | O_NONBLOCK
+    class DeviceBackend final : public CaptureBackend
+    {
+    public:
+        /*
+         * Open `device_path`. Throws std::runtime_error on failure.
+         */
+        explicit DeviceBackend(const std::string &device_path);
+        ~DeviceBackend() noexcept override;
+
+        // No copy or move semantics, owns the fd
+        DeviceBackend(const DeviceBackend &) = delete;
+        DeviceBackend &operator=(const DeviceBackend &) = delete;
+        DeviceBackend(DeviceBackend &&) = delete;
+        DeviceBackend &operator=(DeviceBackend &&) = delete;
+
+        [[nodiscard]] int fd() const noexcept override { return fd_; }
+        [[nodiscard]] int ioctl(unsigned long request, void *arg) noexcept override;
+        [[nodiscard]] void *map(std::size_t length, int prot, off_t offset) noexcept override;
+
+    private:
+        int fd_ = -1;
+    };
+
+    /*
+     * Backend for a V4l2Config::device_path_: "replay://<file>[?options]" replays a recording
+     * (see ReplayBackend), anything else opens a device node.
+     * Throws std::runtime_error if it cannot be opened, std::invalid_argument for a bad replay URI.
+     */
+    [[nodiscard]] std::unique_ptr<CaptureBackend> open_backend(const std::string &device_path);
+} // namespace v4l2
@@ -0,0 +1,93 @@
+#pragma once
+#include "usb_bandwidth.hpp"
+#include "v4l2.hpp"
+#include <cstddef>    // For std::size_t
+#include <exception>  // For std::exception
+#include <functional> // For std::function
+#include <memory>     // For std::unique_ptr
+#include <optional>   // For std::optional
+#include <thread>     // For std::jthread
+#include <vector>     // For std::vector
+
+namespace v4l2
+{
+    struct CameraGroupConfig
+    {
+        std::optional<unsigned> loop_cpu_ = std::nullopt; // pin the epoll loop thread to this CPU
+        // 🚌 set: open_all() first fits every camera's mode into its USB bus, see plan_usb_bandwidth();
+        // each V4l2Config is then the most a camera may get, no longer the mode it is given
+        std::optional<UsbBandwidthModel> bandwidth_ = std::nullopt;
+    };
+
+    /*
+     * Several cameras served by one epoll loop thread.
+     * Each frame is handed to the callback as soon as its camera has it,
+     * a slow camera never delays the others.
+     */
+    class [[nodiscard]] CameraGroup final
+    {
+    public:
+        // Runs on the loop thread: keep it short, move the lease elsewhere to hold the frame.
+        using FrameCallback = std::function<void(std::size_t camera_index, FrameLease &&frame)>;
+        // Runs on the loop thread when a camera fails; the camera is dropped from the loop.
+        using ErrorCallback = std::function<void(std::size_t camera_index, const std::exception &error)>;
+
+        explicit CameraGroup(const CameraGroupConfig &config = {});
+        ~CameraGroup() noexcept;
+
+        // No copy or move semantics, the loop thread points at us
+        CameraGroup(const CameraGroup &) = delete;
+        CameraGroup &operator=(const CameraGroup &) = delete;
+        CameraGroup(CameraGroup &&) = delete;
+        CameraGroup &operator=(CameraGroup &&) = delete;
+
+        /*
+         * Add a camera, returns its index. Only before start().
+         */
+        std::size_t add_camera(const V4l2Config &config);
+
+        /*
+         * Open and configure every camera, all at once on a thread each, planning their USB bandwidth first
+         * when CameraGroupConfig::bandwidth_ is set. Throws the failure of the first camera (by index) that failed,
+         * std::runtime_error when the cameras cannot fit their buses.
+         */
+        void open_all();
+
+        /*
+         * Start streaming on every camera (opening them first if needed) and run the loop.
+         * Throws std::runtime_error on failure, already started cameras are stopped again.
+         */
+        void start(FrameCallback on_frame, ErrorCallback on_error = {});
+
+        /*
+         * Stop the loop and streaming. Safe to call more than once.
+         */
+        void stop() noexcept;
+
+        [[nodiscard]] V4L2Camera &camera(std::size_t index);
+        [[nodiscard]] std::size_t size() const noexcept;
+        [[nodiscard]] bool running() const noexcept;
+
+        // What open_all() planned, one entry per camera; empty without CameraGroupConfig::bandwidth_
+        [[nodiscard]] const std::vector<BandwidthPlan> &bandwidth_plan() const noexcept;
+
+    private:
+        void run(std::stop_token stop) noexcept;
+        void watch(std::size_t index, bool armed) noexcept; // EPOLL_CTL_MOD of a camera fd, events 0 when disarmed
+        void unwatch(std::size_t index) noexcept;           // both registrations of a camera gone
+        void stop_streaming(std::size_t count) noexcept;
+        void plan_bandwidth();
+
+    private:
+        CameraGroupConfig config_;
+        std::vector<std::unique_ptr<V4L2Camera>> cameras_;
+        std::vector<V4l2Config> requested_; // add_camera() configs, the planner's upper bounds
+        std::vector<BandwidthPlan> plan_;
+        FrameCallback on_frame_;
+        ErrorCallback on_error_;
+        int epoll_fd_;
+        int wake_fd_; // eventfd, wakes the loop on stop()
+        bool opened_;
+        std::jthread loop_;
+    };
+} // namespace v4l2
@@ -0,0 +1,81 @@
+#pragma once
+#include "spsc_ring.hpp"
+#include "v4l2.hpp"
+#include <atomic>   // For std::atomic
+#include <chrono>   // For std::chrono::microseconds
+#include <cstdint>  // For std::uint64_t
+#include <optional> // For std::optional
+#include <string>   // For std::string
+#include <thread>   // For std::jthread
+
+namespace v4l2
+{
+    struct CaptureThreadConfig
+    {
+        std::optional<unsigned> cpu_ = std::nullopt; // pin the capture thread to this CPU
+        int fifo_priority_ = 0;                      // 1..99: run it SCHED_FIFO at this priority, 0: leave it SCHED_OTHER
+        bool mlock_all_ = false;                     // mlockall(MCL_CURRENT | MCL_FUTURE) before capturing, no page faults
+    };
+
+    /*
+     * Dedicated thread doing the DQBUF for one camera.
+     * Leases go into a bounded SPSC ring holding up to buffer_count_ frames,
+     * one consumer thread pops them. Capture timing no longer depends on what
+     * the consumer does between pops.
+     * The camera must stay streaming and outlive the thread, and nobody else
+     * may capture from it or call its interrupt() meanwhile.
+     */
+    class [[nodiscard]] CaptureThread final
+    {
+    public:
+        CaptureThread(V4L2Camera &camera, const CaptureThreadConfig &config = {});
+        ~CaptureThread() noexcept;
+
+        // No copy or move semantics, the thread points at us
+        CaptureThread(const CaptureThread &) = delete;
+        CaptureThread &operator=(const CaptureThread &) = delete;
+        CaptureThread(CaptureThread &&) = delete;
+        CaptureThread &operator=(CaptureThread &&) = delete;
+
+        /*
+         * Start the thread. Realtime settings that fail (usually EPERM) only warn.
+         * Throws std::runtime_error if the camera is not configured.
+         */
+        void start();
+
+        /*
+         * Stop the thread and re-queue every frame still in the ring. Safe to call more than once.
+         */
+        void stop() noexcept;
+
+        /*
+         * Consumer side: the oldest captured frame, waiting at most `timeout` (negative: forever).
+         * Returns std::nullopt on timeout or when interrupt() was called.
+         * Throws std::runtime_error once the capture thread has failed, e.g. the device is gone.
+         */
+        [[nodiscard]] std::optional<FrameLease> pop(std::chrono::microseconds timeout);
+
+        /*
+         * Wake up a pending pop() from any thread, stays signalled until clear_interrupt().
+         * The capture thread keeps running.
+         */
+        void interrupt() noexcept;
+        void clear_interrupt() noexcept;
+
+        [[nodiscard]] bool running() const noexcept;
+
+    private:
+        void run(std::stop_token stop) noexcept;
+        void apply_realtime() const noexcept;
+
+    private:
+        V4L2Camera &camera_;
+        CaptureThreadConfig config_;
+        SpscRing<FrameLease> ring_;
+        int ready_fd_; // eventfd, one count per pushed frame
+        int wake_fd_;  // eventfd, signalled by interrupt()
+        std::atomic<bool> failed_;
+        std::string error_; // written by the capture thread before failed_ is set
+        std::jthread thread_;
+    };
+} // namespace v4l2
@@ -0,0 +1,60 @@
+#pragma once
+#include "definitions.hpp"
+#include <cstddef>     // For std::size_t, std::byte
+#include <cstdint>     // For std::uint32_t
+#include <span>        // For std::span
+#include <string_view> // For std::string_view
+
+namespace v4l2
+{
+    // Targets of the YUYV conversion kernels, planes tightly packed one after another.
+    enum class ConvertFormat : std::uint32_t
+    {
+        NV12 = 0,  // Y plane, then interleaved UV at half height
+        I420 = 1,  // Y plane, U plane, V plane, chroma at half width and height
+        GRAY8 = 2, // Y plane only
+        RGB = 3,   // packed 24-bit, BT.601 limited range
+        BGR = 4,   // packed 24-bit, BT.601 limited range
+    };
+
+    // Which implementation runs the conversion.
+    enum class ConvertKernel : std::uint32_t
+    {
+        BEST = 0,   // AVX2 or NEON when the CPU has it, scalar otherwise
+        SCALAR = 1, // portable reference
+    };
+
+    /*
+     * Bytes needed for a `format` image of width x height, a constant for fixed modes (see typed.hpp).
+     */
+    [[nodiscard]] constexpr std::size_t converted_size(ConvertFormat format, std::uint32_t width, std::uint32_t height) noexcept
+    {
+        const std::size_t luma = std::size_t{width} * height;
+        const std::size_t chroma_rows = (std::size_t{height} + 1) / 2;
+        switch (format)
+        {
+        case ConvertFormat::NV12:
+        case ConvertFormat::I420:
+            return luma + std::size_t{width} * chroma_rows; // two half-width planes or one interleaved
+        case ConvertFormat::GRAY8:
+            return luma;
+        case ConvertFormat::RGB:
+        case ConvertFormat::BGR:
+            return luma * 3;
+        }
+        return 0;
+    }
+
+    /*
+     * Convert a PixelFormat::YUYV frame into `dst`, which the caller owns (a pool slot, a mapped GstBuffer, ...).
+     * 4:2:0 chroma averages each pair of rows.
+     * Throws std::invalid_argument if the frame is not YUYV, has an odd width, or `dst` is too small.
+     */
+    void convert_yuyv(const FrameView &frame, ConvertFormat format, std::span<std::byte> dst,
+                      ConvertKernel kernel = ConvertKernel::BEST);
+
+    /*
+     * Name of the kernel ConvertKernel::BEST resolves to on this CPU: "avx2", "neon" or "scalar".
+     */
+    [[nodiscard]] std::string_view best_convert_kernel() noexcept;
+} // namespace v4l2
@@ -1,11 +1,17 @@
+#pragma once
 
-#include <chrono>  // For std::chrono::time_point
-#include <cstdint> // For uint32_t
-#include <span>    // For std::span
-#include <string>  // For std::string
-#include <utility> // For std::pair
+#include <array>    // For std::array
+#include <chrono>   // For std::chrono::time_point
+#include <cstddef>  // For std::size_t, std::byte
+#include <cstdint>  // For uint32_t
+#include <optional> // For std::optional
+#include <span>     // For std::span
+#include <string>   // For std::string
+#include <utility>  // For std::pair
+#include <vector>   // For std::vector
 namespace v4l2
 {
+    // Named rates for convenience, any other rate converts too: static_cast<FPS>(25)
     enum class FPS : uint32_t
     {
         FPS_15 = 15,
@@ -27,6 +33,7 @@ namespace v4l2
     {
         return dimensions.first * dimensions.second;
     }
+    // Named sizes for convenience, any other size converts too: to_dimension(640, 480)
     enum class PixelDimension : uint32_t
     {
         DIM_HD = dimensions_compress(1280, 720),
@@ -39,6 +46,12 @@ namespace v4l2
     static_assert(dimensions_decompress(static_cast<uint32_t>(PixelDimension::DIM_2K)) == std::pair<uint32_t, uint32_t>{2048, 1080});
     static_assert(dimensions_decompress(static_cast<uint32_t>(PixelDimension::DIM_4K)) == std::pair<uint32_t, uint32_t>{3840, 2160});
 
+    [[nodiscard]] constexpr PixelDimension to_dimension(uint32_t width, uint32_t height) noexcept
+    {
+        return static_cast<PixelDimension>(((width & 0xFFFF) << 16) | (height & 0xFFFF));
+    }
+    static_assert(to_dimension(640, 480) == static_cast<PixelDimension>(dimensions_compress(640, 480)));
+
     [[nodiscard]] consteval std::uint32_t make_fourcc(char a, char b, char c, char d) noexcept
     {
         return static_cast<std::uint32_t>(a) |
@@ -50,25 +63,171 @@ namespace v4l2
     enum class PixelFormat : std::uint32_t
     {
         MJPG = make_fourcc('M', 'J', 'P', 'G'),
-        YUYV = make_fourcc('Y', 'U', 'Y', 'V')
+        YUYV = make_fourcc('Y', 'U', 'Y', 'V'),
+        NV12 = make_fourcc('N', 'V', '1', '2'),  // Y plane, then interleaved CbCr at half height, in one buffer
+        NV16 = make_fourcc('N', 'V', '1', '6'),  // same with CbCr at full height
+        NV12M = make_fourcc('N', 'M', '1', '2'), // NV12 with Y and CbCr in separate buffers, multi-planar API only
+        NV16M = make_fourcc('N', 'M', '1', '6'), // NV16 the same way
     };
 
     static_assert(static_cast<std::uint32_t>(PixelFormat::MJPG) == 0x47504A4D);
     static_assert(static_cast<std::uint32_t>(PixelFormat::YUYV) == 0x56595559);
 
+    // Most color planes a format V4L2Camera takes has: Y and CbCr
+    inline constexpr std::size_t MAX_PLANES = 2;
+
+    // Y and CbCr for the NV formats, one plane otherwise
+    [[nodiscard]] constexpr std::uint32_t color_planes(PixelFormat format) noexcept
+    {
+        switch (format)
+        {
+        case PixelFormat::NV12:
+        case PixelFormat::NV16:
+        case PixelFormat::NV12M:
+        case PixelFormat::NV16M:
+            return 2;
+        default:
+            return 1;
+        }
+    }
+
+    // Buffers per frame the driver hands out (v4l2_pix_format_mplane::num_planes), 2 for the NV..M formats
+    [[nodiscard]] constexpr std::uint32_t memory_planes(PixelFormat format) noexcept
+    {
+        return format == PixelFormat::NV12M || format == PixelFormat::NV16M ? 2 : 1;
+    }
+
+    // Where color plane `plane` of a frame lives, see V4L2Camera::plane_layout()
+    struct PlaneLayout
+    {
+        std::uint32_t memory_plane{};   // index of the driver buffer plane holding it
+        std::size_t offset{};           // bytes into that memory plane
+        std::uint32_t bytes_per_line{}; // row stride
+        std::uint32_t height{};         // rows, half the frame for the CbCr plane of 4:2:0 formats
+    };
+
+    // How driver buffers are allocated and shared.
+    enum class MemoryMode : std::uint32_t
+    {
+        MMAP = 0,          // driver buffers, mmap'd into the process
+        DMABUF_EXPORT = 1, // driver buffers, additionally exported as dmabuf fds (VIDIOC_EXPBUF)
+        DMABUF_IMPORT = 2, // caller-provided dmabuf fds, captured into directly (V4L2_MEMORY_DMABUF)
+    };
+
+    // Which queued frame a capture hands out.
+    enum class CapturePolicy : std::uint32_t
+    {
+        ALL = 0,    // oldest first, every frame is delivered
+        LATEST = 1, // drain everything ready, deliver the newest and re-queue the rest
+    };
+
+    // v4l2_rect: on the sensor for a crop, in the buffer for a compose
+    struct Rect
+    {
+        std::int32_t left{};
+        std::int32_t top{};
+        std::uint32_t width{};
+        std::uint32_t height{};
+
+        [[nodiscard]] constexpr bool empty() const noexcept { return width == 0 || height == 0; }
+        friend constexpr bool operator==(const Rect &, const Rect &) = default;
+    };
+
     struct V4l2Config
     {
         std::string device_path_ = "/dev/video0";
         PixelDimension dimension_ = PixelDimension::DIM_4K;
         PixelFormat format_ = PixelFormat::MJPG;
         FPS fps_num_ = FPS::FPS_30;
+        uint32_t fps_den_ = 1; // the rate is fps_num_ / fps_den_ frames per second, e.g. 30000/1001
         uint32_t buffer_count_ = 4;
+        MemoryMode memory_ = MemoryMode::MMAP;
+        std::vector<int> dmabuf_fds_{}; // DMABUF_IMPORT only: one caller-owned fd per buffer
+        CapturePolicy capture_policy_ = CapturePolicy::ALL;
+        // ✂️ sensor region to read out (VIDIOC_S_SELECTION, VIDIOC_S_CROP on older drivers), only this band crosses the bus;
+        // dimension_ is the size it is delivered at, smaller than the crop bins or scales where the driver can
+        std::optional<Rect> crop_{};
+        std::optional<Rect> compose_{}; // where the crop lands in the buffer, for drivers with a compose target
+        // 💾 directory keeping each camera's last negotiation (see negotiation_cache.hpp): the same request on the same
+        // camera skips the G_FMT check and mode enumeration on the next start. Empty: no disk cache
+        std::string cache_dir_{};
+    };
+
+    // Frames per second as a fraction
+    struct FrameRate
+    {
+        std::uint32_t numerator{};
+        std::uint32_t denominator = 1;
+
+        friend constexpr bool operator==(const FrameRate &, const FrameRate &) = default;
+    };
+
+    // One format/size the device offers, with every frame rate it offers for it
+    struct CaptureMode
+    {
+        PixelFormat format{}; // any FourCC the driver lists, not only the named ones
+        std::uint32_t width{};
+        std::uint32_t height{};
+        std::vector<FrameRate> frame_rates; // fastest first
+
+        [[nodiscard]] PixelDimension dimension() const noexcept { return to_dimension(width, height); }
+    };
+
+    // One control the driver offers (VIDIOC_QUERY_EXT_CTRL), scalar types only
+    struct ControlInfo
+    {
+        std::uint32_t id{};   // V4L2_CID_*
+        std::string name;     // as the driver names it, "Exposure Time, Absolute"
+        std::uint32_t type{}; // V4L2_CTRL_TYPE_INTEGER, _BOOLEAN, _MENU, _INTEGER64, ...
+        std::int64_t minimum{};
+        std::int64_t maximum{};
+        std::uint64_t step{};
+        std::int64_t default_value{};
+        std::uint32_t flags{}; // V4L2_CTRL_FLAG_*, READ_ONLY and INACTIVE as of open_device()
+    };
+
+    struct ControlValue
+    {
+        std::uint32_t id{};
+        std::int64_t value{};
+    };
+
+    // Outcome of the MJPEG marker scan, see scan_jpeg() in jpeg.hpp
+    enum class JpegStatus : std::uint32_t
+    {
+        OK = 0,
+        NO_SOI = 1,     // does not start with FF D8
+        NO_EOI = 2,     // no FF D9 at the end, usually a frame cut short on the USB link
+        NO_SOF = 3,     // no frame header, or zero width/height in it
+        TRUNCATED = 4,  // a segment runs past the end, or no SOS before the end
+        BAD_MARKER = 5, // garbage where a marker should be
+    };
+
+    // What the marker scan found in an MJPEG frame, headers only, the entropy data is not decoded
+    struct JpegInfo
+    {
+        JpegStatus status = JpegStatus::NO_SOI;
+        std::uint16_t width{};  // from the SOF segment
+        std::uint16_t height{};
+        bool has_dht = false;        // false: the frame relies on the standard tables (common with UVC cameras)
+        std::uint32_t sos_offset{};  // where the SOS marker starts, DHT insertion point
+        std::uint32_t size{};        // bytes up to and including EOI, trailing padding excluded
+
+        [[nodiscard]] constexpr bool ok() const noexcept { return status == JpegStatus::OK; }
+    };
+
+    // One color plane of a frame
+    struct FramePlane
+    {
+        std::span<std::byte const> data; // from its first byte to the end of what the driver filled
+        std::uint32_t bytes_per_line{};
     };
 
     struct V4lCaps
     {
         std::string driver;
         std::string card;
+        std::string bus_info; // "usb-0000:00:14.0-1.2" for a UVC camera: host controller and port
     };
 
     struct FrameView
@@ -79,13 +238,73 @@ namespace v4l2
         std::uint32_t width{};
         std::uint32_t height{};
         PixelFormat format{};
+        std::uint32_t bytes_per_line{}; // row stride, may exceed width * bytes per pixel
+        int dmabuf_fd = -1; // valid in the DMABUF memory modes, owned by the camera or the caller
+        std::uint32_t sequence{}; // driver frame counter (v4l2_buffer.sequence), gaps mean lost frames
+        std::uint32_t flags{};    // raw V4L2_BUF_FLAG_* incl. timestamp type and source
+        bool error = false;       // V4L2_BUF_FLAG_ERROR: the driver says the data may be corrupted
+        std::optional<JpegInfo> jpeg{}; // marker scan of PixelFormat::MJPG frames, std::nullopt otherwise
+        Rect crop{}; // sensor region the image was read from, as the driver set V4l2Config::crop_; empty when not cropped
+        std::uint64_t frame_sync_us{}; // monotonic time the sensor started this frame (V4L2_EVENT_FRAME_SYNC), 0 without one
+        // 🧅 color planes as V4L2Camera delivers them, planes[0] starts where image does; image only covers the
+        // first buffer of a multi-planar format, planes[1] is in the second one for NV12M and NV16M
+        std::array<FramePlane, MAX_PLANES> planes{};
+        std::uint32_t plane_count = 1;
     };
 
-    struct MappedBuffer
+    enum class CameraEventType : std::uint32_t
+    {
+        FRAME_SYNC,    // V4L2_EVENT_FRAME_SYNC: the sensor started a frame, long before its buffer is done
+        SOURCE_CHANGE, // V4L2_EVENT_SOURCE_CHANGE: the input changed its resolution or went away
+        CTRL,          // V4L2_EVENT_CTRL: a control changed its value, range or flags
+        EOS,           // V4L2_EVENT_EOS: the last buffer is on its way
+    };
+
+    // One dequeued V4L2 event (VIDIOC_DQEVENT)
+    struct CameraEvent
+    {
+        CameraEventType type{};
+        std::uint64_t timestamp_monotonic_us{}; // when the driver queued it
+        std::uint32_t sequence{};               // event counter of the file handle, gaps mean dropped events
+        std::uint32_t frame_sequence{};         // FRAME_SYNC: sequence its buffer will have
+        std::uint32_t id{};                     // CTRL: the control id
+        std::int64_t value{};                   // CTRL: its new value
+        std::uint32_t changes{};                // SOURCE_CHANGE: V4L2_EVENT_SRC_CH_*, CTRL: V4L2_EVENT_CTRL_CH_*
+    };
+
+    // Counters since configure(), a snapshot.
+    struct CaptureStats
+    {
+        std::uint64_t dropped_frames{};  // stale frames re-queued unseen by CapturePolicy::LATEST
+        std::uint64_t sequence_gaps{};   // times the driver sequence jumped
+        std::uint64_t lost_frames{};     // frames missing from those jumps, never dequeued
+        std::uint64_t errored_buffers{}; // buffers dequeued with V4L2_BUF_FLAG_ERROR
+        std::uint64_t corrupt_frames{};  // MJPEG frames whose marker scan failed
+        std::uint64_t time_to_first_frame_us{}; // open_device() to the first DQBUF, 0 until a frame came
+        std::uint64_t reconnects{};             // times V4L2Camera::reconnect() brought the device back
+        std::uint64_t renegotiations{};         // times V4L2Camera::renegotiate() followed a source change
+    };
+
+    // One mmap'd plane of a driver buffer
+    struct MappedPlane
     {
         std::byte *data{};
         std::size_t size{};
+        int dmabuf_fd = -1;
+    };
+
+    struct MappedBuffer
+    {
+        std::byte *data{}; // memory plane 0, the whole buffer for the single-planar API
+        std::size_t size{};
+        int dmabuf_fd = -1;
+        std::uint32_t plane_count = 1;                         // memory planes, see memory_planes()
+        std::array<MappedPlane, MAX_PLANES - 1> more_planes{}; // memory planes 1.. of the multi-planar API
 
+        [[nodiscard]] MappedPlane plane(std::uint32_t index) const noexcept
+        {
+            return index == 0 ? MappedPlane{.data = data, .size = size, .dmabuf_fd = dmabuf_fd} : more_planes[index - 1];
+        }
         FrameView to_frame(std::uint32_t width, std::uint32_t height, std::uint32_t bytes_per_line, PixelFormat format) noexcept;
         [[nodiscard]] bool is_valid() const noexcept;
     };
@@ -0,0 +1,121 @@
+#pragma once
+#include "v4l2.hpp"
+#include <atomic>     // For std::atomic
+#include <chrono>     // For std::chrono::microseconds, std::chrono::steady_clock
+#include <coroutine>  // For std::coroutine_handle
+#include <cstddef>    // For std::size_t
+#include <cstdint>    // For std::uint64_t
+#include <exception>  // For std::exception_ptr
+#include <optional>   // For std::optional
+#include <stop_token> // For std::stop_token, std::stop_callback
+#include <vector>     // For std::vector
+
+namespace v4l2
+{
+    /*
+     * Epoll reactor for coroutines waiting on cameras: `auto frame = co_await reactor.next_frame(camera);`
+     * No thread of its own. run_once() waits on every camera someone is waiting for and resumes the
+     * coroutines whose frame came, on the calling thread, the one that owns the cameras.
+     * For an outer event loop, register fd() (e.g. as an asio posix::stream_descriptor) and call run_once(0us)
+     * whenever it is readable or next_timeout() ran out.
+     * The cameras must be streaming; do not interrupt() them, that is what the stop token is for.
+     */
+    class [[nodiscard]] FrameReactor final
+    {
+    public:
+        class NextFrame;
+
+        FrameReactor();
+        ~FrameReactor() noexcept;
+
+        // No copy or move semantics, waiting coroutines point at us
+        FrameReactor(const FrameReactor &) = delete;
+        FrameReactor &operator=(const FrameReactor &) = delete;
+        FrameReactor(FrameReactor &&) = delete;
+        FrameReactor &operator=(FrameReactor &&) = delete;
+
+        /*
+         * Awaitable for the next frame of `camera`, co_await gives an std::optional<FrameLease>:
+         * std::nullopt once `timeout` passed (negative: no timeout) or `stop` was requested, from any thread.
+         * A frame that is already queued is taken without suspending. Capture failures are rethrown by the co_await,
+         * std::invalid_argument when another coroutine is already waiting on the same camera.
+         */
+        [[nodiscard]] NextFrame next_frame(V4L2Camera &camera,
+                                           std::chrono::microseconds timeout = std::chrono::microseconds{-1},
+                                           std::stop_token stop = {});
+
+        /*
+         * Wait at most `timeout` (negative: until something happens) for frames, timeouts and stop requests,
+         * then resume every coroutine they complete. Coroutines that start waiting meanwhile are left for the next call.
+         * Returns how many were resumed. Throws std::runtime_error if epoll fails.
+         */
+        std::size_t run_once(std::chrono::microseconds timeout);
+
+        /*
+         * The epoll fd, readable when run_once(0us) has work. Owned by the reactor.
+         */
+        [[nodiscard]] int fd() const noexcept;
+
+        /*
+         * Until the earliest timeout of a waiting coroutine, 0 if one is due, negative if none has a timeout.
+         */
+        [[nodiscard]] std::chrono::microseconds next_timeout() const noexcept;
+
+        // Coroutines suspended in a next_frame()
+        [[nodiscard]] std::size_t pending() const noexcept;
+
+    private:
+        void add(NextFrame &waiter);
+        void remove(NextFrame &waiter) noexcept;
+        void wake() noexcept;
+
+    private:
+        int epoll_fd_;
+        int wake_fd_; // eventfd, a stop request from another thread
+        std::vector<NextFrame *> waiters_;
+        std::uint64_t round_; // run_once() calls so far
+    };
+
+    class [[nodiscard]] FrameReactor::NextFrame final
+    {
+    public:
+        ~NextFrame() noexcept;
+
+        // No copy or move semantics, the reactor points at us while we wait
+        NextFrame(const NextFrame &) = delete;
+        NextFrame &operator=(const NextFrame &) = delete;
+        NextFrame(NextFrame &&) = delete;
+        NextFrame &operator=(NextFrame &&) = delete;
+
+        [[nodiscard]] bool await_ready();
+        [[nodiscard]] bool await_suspend(std::coroutine_handle<> handle);
+        [[nodiscard]] std::optional<FrameLease> await_resume();
+
+    private:
+        friend class FrameReactor;
+        NextFrame(FrameReactor &reactor, V4L2Camera &camera, std::chrono::microseconds timeout, std::stop_token stop) noexcept;
+
+        // true once there is a frame, an error, a timeout or a stop request to resume with
+        [[nodiscard]] bool settle(std::chrono::steady_clock::time_point now) noexcept;
+
+        struct Cancel
+        {
+            NextFrame *self;
+            void operator()() const noexcept;
+        };
+
+        FrameReactor &reactor_;
+        V4L2Camera &camera_;
+        std::chrono::microseconds timeout_;
+        std::chrono::steady_clock::time_point deadline_{};
+        std::stop_token stop_;
+        std::optional<std::stop_callback<Cancel>> on_stop_;
+        std::coroutine_handle<> handle_;
+        std::optional<FrameLease> frame_;
+        std::exception_ptr error_;
+        std::atomic<bool> cancelled_{false};
+        bool readable_ = false;   // epoll reported the camera fd this round
+        bool registered_ = false; // in the reactor's waiters
+        std::uint64_t round_{};   // reactor round it started waiting in
+    };
+} // namespace v4l2
@@ -0,0 +1,138 @@
+#pragma once
+#include "camera_group.hpp"
+#include "v4l2.hpp"
+#include <chrono>             // For std::chrono::microseconds
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>            // For std::size_t
+#include <cstdint>            // For std::uint64_t
+#include <deque>              // For std::deque
+#include <memory>             // For std::shared_ptr
+#include <mutex>              // For std::mutex
+#include <optional>           // For std::optional
+#include <string>             // For std::string
+#include <vector>             // For std::vector
+
+namespace v4l2
+{
+    // What a set without a frame from every camera becomes
+    enum class MissingFramePolicy
+    {
+        DROP,        // nothing, the frames it has go back to their drivers
+        REPEAT_LAST, // the set anyway, with the camera's previous frame in the gap (FrameSet::repeated)
+    };
+
+    struct FrameSyncConfig
+    {
+        std::chrono::microseconds tolerance_{5'000}; // frames of one set are at most this far apart (v4l2_timestamp_us)
+        std::chrono::microseconds max_wait_{100'000}; // a camera this far behind the newest frame is missing from the set
+        MissingFramePolicy missing_ = MissingFramePolicy::DROP;
+        std::size_t max_pending_ = 2; // frames held per camera while waiting for the others, also the sets held for pop()
+    };
+
+    struct FrameSyncStats
+    {
+        std::uint64_t sets{};            // handed to pop()
+        std::uint64_t incomplete_sets{}; // a camera had no frame for them: dropped, or sent with repeats
+        std::uint64_t repeated_frames{}; // gaps REPEAT_LAST filled
+        std::uint64_t dropped_frames{};  // went back to the driver without being in a set
+        std::uint64_t dropped_sets{};    // complete but never popped, pop() fell max_pending_ sets behind
+    };
+
+    /*
+     * One frame of every camera, taken at the same moment.
+     * Members are shared: REPEAT_LAST may put the same frame in consecutive sets. Each buffer is re-queued
+     * once the last set holding it is gone.
+     */
+    struct FrameSet
+    {
+        std::uint64_t number{};       // sets built so far, unbroken unless some were dropped
+        std::uint64_t timestamp_us{}; // v4l2_timestamp_us of its earliest new member
+        std::uint64_t spread_us{};    // from the earliest to the latest new member, at most FrameSyncConfig::tolerance_
+        std::vector<std::shared_ptr<FrameLease>> frames; // indexed like the cameras
+        std::vector<bool> repeated;                      // frames[i] already was in an earlier set
+    };
+
+    /*
+     * Matches the frames of N cameras by driver timestamp into FrameSets. The cameras must stamp on the same
+     * clock (V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) and run at about the same rate; a frame no other camera has a
+     * partner for within tolerance_ is dropped, or repeated around under REPEAT_LAST.
+     * push() and pop() may be on different threads; held frames keep driver buffers, each camera needs
+     * max_pending_ + 2 of them (one more under REPEAT_LAST) to keep streaming while sets are out.
+     */
+    class [[nodiscard]] FrameSynchronizer final
+    {
+    public:
+        /*
+         * Throws std::invalid_argument without cameras or with max_pending_ == 0.
+         */
+        FrameSynchronizer(std::size_t cameras, const FrameSyncConfig &config = {});
+        ~FrameSynchronizer() noexcept;
+
+        // No copy or move semantics, a CameraGroup callback may point at us
+        FrameSynchronizer(const FrameSynchronizer &) = delete;
+        FrameSynchronizer &operator=(const FrameSynchronizer &) = delete;
+        FrameSynchronizer(FrameSynchronizer &&) = delete;
+        FrameSynchronizer &operator=(FrameSynchronizer &&) = delete;
+
+        /*
+         * Hand over the next frame of camera `camera`, in capture order. Throws std::out_of_range for a bad index.
+         */
+        void push(std::size_t camera, FrameLease &&frame);
+
+        /*
+         * The oldest finished set, waiting at most `timeout` (negative: forever).
+         * Returns std::nullopt on timeout or after interrupt(). Throws std::runtime_error once fail() was called.
+         */
+        [[nodiscard]] std::optional<FrameSet> pop(std::chrono::microseconds timeout);
+
+        /*
+         * Start `group` with push() as its frame callback and fail() as its error callback.
+         * The group must have one camera per synchronizer slot and be stopped before we are destroyed.
+         * Throws what CameraGroup::start() throws, std::invalid_argument when the sizes differ.
+         */
+        void start(CameraGroup &group);
+
+        /*
+         * pop() throws `error` from now on, e.g. a camera of the group failed.
+         */
+        void fail(const std::string &error);
+
+        /*
+         * Wake up a pending pop() from any thread, stays signalled until clear_interrupt().
+         */
+        void interrupt() noexcept;
+        void clear_interrupt() noexcept;
+
+        /*
+         * Let every held frame and finished set go, error and interrupt included. For restarting a group.
+         */
+        void clear() noexcept;
+
+        [[nodiscard]] FrameSyncStats stats() const;
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        struct Pending
+        {
+            std::shared_ptr<FrameLease> frame;
+            std::uint64_t timestamp_us;
+        };
+
+        // Both under mutex_: leases they give up go to `released`, destroyed (QBUF) by the caller once it unlocked
+        void match(std::vector<std::shared_ptr<FrameLease>> &released);
+        [[nodiscard]] bool build(std::uint64_t earliest_us, std::vector<std::shared_ptr<FrameLease>> &released);
+
+    private:
+        FrameSyncConfig config_;
+        mutable std::mutex mutex_;
+        std::condition_variable ready_cv_;
+        std::vector<std::deque<Pending>> pending_;       // per camera, oldest first
+        std::vector<std::shared_ptr<FrameLease>> last_; // per camera, the latest frame a set had (REPEAT_LAST)
+        std::deque<FrameSet> ready_;
+        std::uint64_t newest_us_{};  // latest timestamp pushed by any camera
+        std::uint64_t next_number_{};
+        FrameSyncStats stats_;
+        std::string error_;
+        bool interrupted_ = false;
+    };
+} // namespace v4l2
@@ -0,0 +1,28 @@
+#pragma once
+#include "definitions.hpp"
+#include <cstddef> // For std::size_t, std::byte
+#include <span>    // For std::span
+
+namespace v4l2
+{
+    /*
+     * Walk the marker segments of an MJPEG frame in place: SOI, SOF dimensions, DHT presence, SOS, EOI.
+     * Only the headers and the tail are touched, never the entropy-coded data, so the cost does not grow
+     * with the frame size. No allocation, safe on any bytes.
+     */
+    [[nodiscard]] JpegInfo scan_jpeg(std::span<std::byte const> data) noexcept;
+
+    /*
+     * The JPEG Annex K Huffman tables as one DHT segment (marker included),
+     * the ones MJPEG streams without DHT assume.
+     */
+    [[nodiscard]] std::span<std::byte const> standard_dht_segment() noexcept;
+
+    /*
+     * Copy `jpeg` into `dst` with standard_dht_segment() inserted before SOS, trailing padding dropped.
+     * `info` must come from scan_jpeg(jpeg), be ok() and have no DHT.
+     * Returns the bytes written, info.size + standard_dht_segment().size().
+     * Throws std::invalid_argument otherwise or if `dst` is too small.
+     */
+    std::size_t insert_standard_dht(std::span<std::byte const> jpeg, const JpegInfo &info, std::span<std::byte> dst);
+} // namespace v4l2
@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm> // For std::min
+#include <array>     // For std::array
+#include <atomic>    // For std::atomic
+#include <bit>       // For std::countl_zero
+#include <cstddef>   // For std::size_t
+#include <cstdint>   // For std::uint64_t
+
+namespace v4l2
+{
+    // Percentiles of one stage, microseconds. Bucket upper bounds: at most 12.5% above the true value.
+    struct LatencySummary
+    {
+        std::uint64_t count{};
+        std::uint64_t p50_us{};
+        std::uint64_t p99_us{};
+        std::uint64_t p999_us{};
+        std::uint64_t max_us{};
+    };
+
+    // Per-frame stage latencies of a V4L2Camera, see V4L2Camera::latency()
+    struct LatencyStats
+    {
+        LatencySummary driver_to_dqbuf{};  // driver timestamp to DQBUF return, monotonic driver clocks only
+        LatencySummary dqbuf_to_handoff{}; // DQBUF to record_handoff(), e.g. the push out of v4l2-src
+        LatencySummary dqbuf_to_qbuf{};    // DQBUF to QBUF, how long the consumer held the buffer
+    };
+
+    /*
+     * Fixed-bucket latency histogram: record() from any number of threads, summary() from any other,
+     * no locks and no allocation. Log-linear buckets, 8 per power of two, values above ~71 minutes
+     * land in the last bucket.
+     */
+    class LatencyHistogram final
+    {
+    public:
+        static constexpr std::size_t SUB_BUCKETS = 8;
+        static constexpr std::size_t BUCKETS = 240;
+
+        LatencyHistogram() noexcept = default;
+
+        // No copy or move semantics, the counters are shared between threads
+        LatencyHistogram(const LatencyHistogram &) = delete;
+        LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+        LatencyHistogram(LatencyHistogram &&) = delete;
+        LatencyHistogram &operator=(LatencyHistogram &&) = delete;
+
+        void record(std::uint64_t us) noexcept
+        {
+            buckets_[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+            auto max = max_.load(std::memory_order_relaxed);
+            while (us > max && !max_.compare_exchange_weak(max, us, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        // Not atomic with concurrent record() calls, a frame recorded meanwhile may survive
+        void reset() noexcept
+        {
+            for (auto &bucket : buckets_)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            max_.store(0, std::memory_order_relaxed);
+        }
+
+        /*
+         * Percentiles over everything recorded since the last reset().
+         * A snapshot taken during record() calls may be off by those frames, never torn.
+         */
+        [[nodiscard]] LatencySummary summary() const noexcept
+        {
+            std::array<std::uint64_t, BUCKETS> counts{};
+            LatencySummary summary{};
+            for (std::size_t i = 0; i < BUCKETS; ++i)
+            {
+                counts[i] = buckets_[i].load(std::memory_order_relaxed);
+                summary.count += counts[i];
+            }
+            summary.max_us = max_.load(std::memory_order_relaxed);
+            if (summary.count == 0)
+            {
+                return summary;
+            }
+
+            // rank of the per-mille percentile, rounded up so p99.9 of few samples is the max
+            auto const percentile = [&](std::uint64_t per_mille)
+            {
+                const std::uint64_t rank = (summary.count * per_mille + 999) / 1000;
+                std::uint64_t seen = 0;
+                for (std::size_t i = 0; i < BUCKETS; ++i)
+                {
+                    seen += counts[i];
+                    if (seen >= rank)
+                    {
+                        return std::min(upper_bound(i), summary.max_us);
+                    }
+                }
+                return summary.max_us;
+            };
+            summary.p50_us = percentile(500);
+            summary.p99_us = percentile(990);
+            summary.p999_us = percentile(999);
+            return summary;
+        }
+
+        // 📐 exact below 8 us, then 8 buckets for every power of two
+        [[nodiscard]] static constexpr std::size_t bucket_of(std::uint64_t us) noexcept
+        {
+            if (us < SUB_BUCKETS)
+            {
+                return us;
+            }
+            const auto msb = static_cast<std::uint64_t>(63 - std::countl_zero(us));
+            if (msb > 31)
+            {
+                return BUCKETS - 1;
+            }
+            const std::uint64_t shift = msb - 3;
+            return (msb - 2) * SUB_BUCKETS + ((us >> shift) & (SUB_BUCKETS - 1));
+        }
+
+        // Largest value that lands in `bucket`
+        [[nodiscard]] static constexpr std::uint64_t upper_bound(std::size_t bucket) noexcept
+        {
+            if (bucket < SUB_BUCKETS)
+            {
+                return bucket;
+            }
+            const std::size_t shift = bucket / SUB_BUCKETS - 1;
+            const std::uint64_t lower = std::uint64_t{SUB_BUCKETS + bucket % SUB_BUCKETS} << shift;
+            return lower + (std::uint64_t{1} << shift) - 1;
+        }
+
+    private:
+        std::array<std::atomic<std::uint64_t>, BUCKETS> buckets_{};
+        std::atomic<std::uint64_t> max_{};
+    };
+
+    static_assert(LatencyHistogram::bucket_of(std::uint64_t{0xFFFF'FFFF}) == LatencyHistogram::BUCKETS - 1);
+    static_assert(LatencyHistogram::upper_bound(LatencyHistogram::bucket_of(1000)) >= 1000);
+} // namespace v4l2
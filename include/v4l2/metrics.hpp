@@ -0,0 +1,201 @@
+#pragma once
+#include "latency_histogram.hpp"
+#include <atomic>  // For std::atomic
+#include <cstdint> // For std::uint64_t, std::uint32_t
+#include <memory>  // For std::shared_ptr, std::weak_ptr
+#include <mutex>   // For std::mutex
+#include <span>    // For std::span
+#include <string>  // For std::string
+#include <thread>  // For std::jthread
+#include <utility> // For std::move
+#include <vector>  // For std::vector
+
+namespace v4l2
+{
+    // What a CameraMetrics holds at one moment, see CameraMetrics::snapshot()
+    struct CameraMetricsSnapshot
+    {
+        std::string camera;            // name it was registered under
+        std::string device;            // V4l2Config::device_path_
+        std::uint64_t frames{};        // counters, never reset: take their rate()
+        std::uint64_t bytes{};
+        std::uint64_t sequence_gaps{};
+        std::uint64_t lost_frames{};
+        std::uint64_t errored_buffers{};
+        std::uint64_t dropped_frames{};
+        std::uint64_t corrupt_frames{};
+        std::uint32_t buffers{};       // gauges: driver buffers of the last configure()
+        std::uint32_t leased{};        // held by consumers as FrameLease
+        std::uint32_t queued{};        // buffers - leased, with the driver to fill
+        double nominal_fps{};          // the rate configure() got, to compare rate(frames) against
+        std::uint64_t last_frame_us{}; // monotonic time of the last DQBUF, 0 before
+        LatencySummary requeue{};      // the VIDIOC_QBUF call
+        std::uint64_t requeue_sum_us{};
+        LatencySummary lease_hold{};   // DQBUF to QBUF, how long a consumer held the buffer
+        std::uint64_t lease_hold_sum_us{};
+    };
+
+    /*
+     * Live counters and gauges of one V4L2Camera, updated on the capture path with relaxed atomics only.
+     * Unlike V4L2Camera::stats() nothing is reset by configure() or reconnect(): a Prometheus counter only grows.
+     * Cameras share theirs through V4L2Camera::metrics(); read it from any thread.
+     */
+    class CameraMetrics final
+    {
+    public:
+        explicit CameraMetrics(std::string device) : device_(std::move(device)) {}
+
+        // No copy or move semantics, the camera and the registry point at us
+        CameraMetrics(const CameraMetrics &) = delete;
+        CameraMetrics &operator=(const CameraMetrics &) = delete;
+        CameraMetrics(CameraMetrics &&) = delete;
+        CameraMetrics &operator=(CameraMetrics &&) = delete;
+
+        void record_frame(std::uint64_t bytes, std::uint64_t now_us) noexcept
+        {
+            frames_.fetch_add(1, std::memory_order_relaxed);
+            bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            last_frame_us_.store(now_us, std::memory_order_relaxed);
+            leased_.fetch_add(1, std::memory_order_relaxed);
+        }
+        void record_gap(std::uint64_t missing) noexcept
+        {
+            sequence_gaps_.fetch_add(1, std::memory_order_relaxed);
+            lost_frames_.fetch_add(missing, std::memory_order_relaxed);
+        }
+        void record_errored() noexcept { errored_buffers_.fetch_add(1, std::memory_order_relaxed); }
+        void record_dropped() noexcept { dropped_frames_.fetch_add(1, std::memory_order_relaxed); }
+        void record_corrupt() noexcept { corrupt_frames_.fetch_add(1, std::memory_order_relaxed); }
+        // Before QBUF, so a failing one still gives the lease back
+        void record_release(std::uint64_t hold_us) noexcept
+        {
+            leased_.fetch_sub(1, std::memory_order_relaxed);
+            lease_hold_.record(hold_us);
+            lease_hold_sum_us_.fetch_add(hold_us, std::memory_order_relaxed);
+        }
+        void record_requeue(std::uint64_t requeue_us) noexcept
+        {
+            requeue_.record(requeue_us);
+            requeue_sum_us_.fetch_add(requeue_us, std::memory_order_relaxed);
+        }
+        void set_buffers(std::uint32_t buffers, double nominal_fps) noexcept
+        {
+            buffers_.store(buffers, std::memory_order_relaxed);
+            nominal_fps_.store(nominal_fps, std::memory_order_relaxed);
+        }
+
+        // Every field read on its own, a frame recorded meanwhile may be in some and not yet in others
+        [[nodiscard]] CameraMetricsSnapshot snapshot() const;
+
+    private:
+        std::string device_;
+        std::atomic<std::uint64_t> frames_{};
+        std::atomic<std::uint64_t> bytes_{};
+        std::atomic<std::uint64_t> sequence_gaps_{};
+        std::atomic<std::uint64_t> lost_frames_{};
+        std::atomic<std::uint64_t> errored_buffers_{};
+        std::atomic<std::uint64_t> dropped_frames_{};
+        std::atomic<std::uint64_t> corrupt_frames_{};
+        std::atomic<std::uint64_t> last_frame_us_{};
+        std::atomic<std::uint32_t> buffers_{};
+        std::atomic<std::uint32_t> leased_{};
+        std::atomic<double> nominal_fps_{};
+        LatencyHistogram requeue_;
+        std::atomic<std::uint64_t> requeue_sum_us_{};
+        LatencyHistogram lease_hold_;
+        std::atomic<std::uint64_t> lease_hold_sum_us_{};
+    };
+
+    /*
+     * The cameras a process exports, by name. Holds them weakly: a camera that is destroyed
+     * drops out of the next snapshot() by itself. Thread-safe, never touched by the capture path.
+     */
+    class MetricsRegistry final
+    {
+    public:
+        MetricsRegistry() = default;
+
+        // No copy or move semantics, exporters point at us
+        MetricsRegistry(const MetricsRegistry &) = delete;
+        MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+        MetricsRegistry(MetricsRegistry &&) = delete;
+        MetricsRegistry &operator=(MetricsRegistry &&) = delete;
+
+        // Process-wide registry, the one v4l2-src registers its camera with
+        [[nodiscard]] static MetricsRegistry &global();
+
+        /*
+         * Export `metrics` as `name`, replacing whatever had that name before (a restarted element).
+         * Throws std::invalid_argument for an empty name or null metrics.
+         */
+        void add(const std::string &name, std::shared_ptr<const CameraMetrics> metrics);
+        void remove(const std::string &name);
+
+        // Every live camera, in the order they were added
+        [[nodiscard]] std::vector<CameraMetricsSnapshot> snapshot();
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            std::weak_ptr<const CameraMetrics> metrics;
+        };
+        std::mutex mutex_;
+        std::vector<Entry> entries_;
+    };
+
+    /*
+     * Prometheus text exposition format (version 0.0.4) of `cameras`, one `camera` and `device` label each:
+     * v4l2_frames_total, v4l2_bytes_total, ..., v4l2_queued_buffers, v4l2_nominal_fps,
+     * v4l2_last_frame_age_seconds and the requeue and lease-hold latencies as summaries in seconds.
+     */
+    [[nodiscard]] std::string to_prometheus(std::span<const CameraMetricsSnapshot> cameras);
+
+    struct MetricsExporterConfig
+    {
+        std::string listen_ = "127.0.0.1:9101"; // "host:port" (port 0: any free one) or "unix:/run/v4l2-metrics.sock"
+        MetricsRegistry *registry_ = nullptr;   // nullptr: MetricsRegistry::global(), must outlive the exporter
+    };
+
+    /*
+     * Minimal HTTP/1.0 endpoint answering every GET with to_prometheus() of the registry, for Prometheus
+     * to scrape (`curl --unix-socket` for the Unix socket). One thread of its own, one request per connection.
+     */
+    class [[nodiscard]] MetricsExporter final
+    {
+    public:
+        /*
+         * Bind and start serving. A Unix socket path left over from an earlier run is replaced.
+         * Throws std::invalid_argument for an unparsable listen_, std::runtime_error if the socket cannot be bound.
+         */
+        explicit MetricsExporter(const MetricsExporterConfig &config = {});
+        ~MetricsExporter() noexcept;
+
+        // No copy or move semantics, the thread points at us
+        MetricsExporter(const MetricsExporter &) = delete;
+        MetricsExporter &operator=(const MetricsExporter &) = delete;
+        MetricsExporter(MetricsExporter &&) = delete;
+        MetricsExporter &operator=(MetricsExporter &&) = delete;
+
+        /*
+         * The exporter serving `listen` for the global registry, created on first use and shared
+         * while anyone holds it, so several elements can ask for the same address.
+         */
+        [[nodiscard]] static std::shared_ptr<MetricsExporter> shared(const std::string &listen);
+
+        // Where it listens, with the port picked for port 0
+        [[nodiscard]] const std::string &address() const noexcept { return address_; }
+
+    private:
+        void run(std::stop_token stop) noexcept;
+        void serve(int client) noexcept;
+
+    private:
+        MetricsRegistry &registry_;
+        std::string address_;
+        std::string unix_path_; // unlinked on destruction, unix: only
+        int listen_fd_;
+        int wake_fd_; // eventfd, signalled on destruction
+        std::jthread thread_;
+    };
+} // namespace v4l2
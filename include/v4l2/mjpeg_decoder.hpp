@@ -0,0 +1,161 @@
+#pragma once
+#include "v4l2.hpp"
+#include <array>              // For std::array
+#include <chrono>             // For std::chrono::microseconds
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>            // For std::size_t, std::byte
+#include <cstdint>            // For std::uint32_t, std::uint64_t
+#include <deque>              // For std::deque
+#include <map>                // For std::map
+#include <mutex>              // For std::mutex
+#include <optional>           // For std::optional
+#include <thread>             // For std::jthread
+#include <utility>            // For std::pair
+#include <vector>             // For std::vector
+
+namespace v4l2
+{
+    struct MjpegDecoderConfig
+    {
+        unsigned threads_ = 2;           // decoder worker threads
+        unsigned scale_denom_ = 1;       // 1, 2, 4 or 8: decode at 1/scale_denom_ size via DCT scaling
+        std::size_t output_buffers_ = 0; // pooled output images, 0: threads_ + 2
+    };
+
+    /*
+     * One decoded image in GStreamer's default I420 layout: rows padded to 4 bytes,
+     * Y plane, then U and V at half width and height (rounded up).
+     */
+    struct DecodedView
+    {
+        std::span<std::byte const> image{}; // whole I420 image, empty if the decode failed
+        std::uint32_t width{};
+        std::uint32_t height{};
+        std::array<std::size_t, 3> offset{};  // Y, U, V
+        std::array<std::uint32_t, 3> stride{}; // Y, U, V
+        std::uint32_t sequence{};              // of the source frame
+        std::uint64_t timestamp_monotonic_us{};
+        std::uint64_t v4l2_timestamp_us{};
+        std::uint32_t flags{}; // V4L2_BUF_FLAG_* of the source frame, says which clock v4l2_timestamp_us is on
+        bool error = false; // decode failed, or libjpeg warned about corrupt data in a picture it still produced
+    };
+
+    class MjpegDecoder;
+
+    /*
+     * Move-only handle to one pooled output image, the buffer returns to the pool on destruction.
+     * Must not outlive the decoder that issued it.
+     */
+    class [[nodiscard]] DecodedFrame final
+    {
+    public:
+        DecodedFrame() noexcept = default;
+        ~DecodedFrame() noexcept;
+
+        // No copy semantics
+        DecodedFrame(const DecodedFrame &) = delete;
+        DecodedFrame &operator=(const DecodedFrame &) = delete;
+        // Move semantics
+        DecodedFrame(DecodedFrame &&other) noexcept;
+        DecodedFrame &operator=(DecodedFrame &&other) noexcept;
+
+        [[nodiscard]] const DecodedView &view() const noexcept { return view_; }
+        [[nodiscard]] const DecodedView *operator->() const noexcept { return &view_; }
+        [[nodiscard]] bool valid() const noexcept { return decoder_ != nullptr; }
+        explicit operator bool() const noexcept { return valid(); }
+
+        void release() noexcept;
+
+    private:
+        friend class MjpegDecoder;
+        DecodedFrame(MjpegDecoder *decoder, std::size_t slot, const DecodedView &view) noexcept;
+
+        MjpegDecoder *decoder_{};
+        std::size_t slot_{};
+        DecodedView view_{};
+    };
+
+    /*
+     * MJPEG to I420 on a small pool of libjpeg(-turbo) worker threads.
+     * submit() from one producer thread, pop() from one consumer thread; frames come out
+     * in submission order whatever order the workers finish them in.
+     * Frames without DHT decode with the standard tables (libjpeg-turbo).
+     */
+    class [[nodiscard]] MjpegDecoder final
+    {
+    public:
+        /*
+         * Start the workers.
+         * Throws std::invalid_argument for zero threads or a scale other than 1, 2, 4, 8.
+         */
+        explicit MjpegDecoder(const MjpegDecoderConfig &config = {});
+        ~MjpegDecoder() noexcept;
+
+        // No copy or move semantics, the workers point at us
+        MjpegDecoder(const MjpegDecoder &) = delete;
+        MjpegDecoder &operator=(const MjpegDecoder &) = delete;
+        MjpegDecoder(MjpegDecoder &&) = delete;
+        MjpegDecoder &operator=(MjpegDecoder &&) = delete;
+
+        /*
+         * Queue a frame, the JPEG bytes are copied so the driver buffer can go back right away.
+         */
+        void submit(const FrameView &frame);
+
+        /*
+         * Queue a frame without copying, the lease (and so the driver buffer) is held until its decode is done.
+         */
+        void submit(FrameLease &&lease);
+
+        /*
+         * The next frame in submission order, waiting at most `timeout` (negative: forever).
+         * Returns std::nullopt on timeout.
+         */
+        [[nodiscard]] std::optional<DecodedFrame> pop(std::chrono::microseconds timeout);
+
+        // Frames submitted and not popped yet
+        [[nodiscard]] std::size_t pending() const;
+
+        [[nodiscard]] const MjpegDecoderConfig &config() const noexcept { return config_; }
+
+        // Output size for a width x height JPEG at 1/scale_denom, rounded up like libjpeg
+        [[nodiscard]] static std::pair<std::uint32_t, std::uint32_t> scaled_size(std::uint32_t width, std::uint32_t height,
+                                                                                 unsigned scale_denom) noexcept;
+        // Bytes of a width x height image in the I420 layout of DecodedView
+        [[nodiscard]] static std::size_t i420_size(std::uint32_t width, std::uint32_t height) noexcept;
+
+    private:
+        friend class DecodedFrame;
+
+        struct Job
+        {
+            std::uint64_t ticket{};
+            FrameView frame{};                // image points into bytes or into the lease
+            std::vector<std::byte> bytes;     // copied JPEG, empty for leases
+            std::optional<FrameLease> lease;
+        };
+
+        struct Result
+        {
+            std::size_t slot{};
+            DecodedView view{};
+        };
+
+        void enqueue(Job &&job);
+        void run(std::stop_token stop) noexcept;
+        void release_slot(std::size_t slot) noexcept;
+
+    private:
+        MjpegDecoderConfig config_;
+        mutable std::mutex mutex_;
+        std::condition_variable_any work_cv_; // jobs or free slots
+        std::condition_variable done_cv_;     // results
+        std::deque<Job> jobs_;
+        std::map<std::uint64_t, Result> done_; // finished out of order, keyed by ticket
+        std::vector<std::vector<std::byte>> slots_;
+        std::vector<std::size_t> free_slots_;
+        std::uint64_t next_ticket_{}; // next submit()
+        std::uint64_t next_out_{};    // next pop()
+        std::vector<std::jthread> workers_;
+    };
+} // namespace v4l2
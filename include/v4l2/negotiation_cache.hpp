@@ -0,0 +1,39 @@
+#pragma once
+#include "definitions.hpp"
+#include <filesystem> // For std::filesystem::path
+#include <optional>   // For std::optional
+#include <string>     // For std::string
+#include <vector>     // For std::vector
+
+namespace v4l2
+{
+    // What a camera settled on for one request last time, and the modes it listed
+    struct NegotiationRecord
+    {
+        PixelFormat requested_format{};
+        PixelDimension requested_dimension{};
+        FrameRate requested_rate{};
+        PixelFormat format{}; // what S_FMT and S_PARM gave back
+        PixelDimension dimension{};
+        std::uint32_t bytes_per_line{};
+        FrameRate rate{};
+        std::vector<CaptureMode> modes; // empty until enumerate_modes() ran once
+    };
+
+    /*
+     * Cache file name for a camera: driver, card and USB serial number, bus_info for cameras without one.
+     * The serial follows a camera to another port, bus_info keeps two identical serial-less cameras apart.
+     */
+    [[nodiscard]] std::string negotiation_key(const V4lCaps &caps, const std::string &device_path);
+
+    /*
+     * The record for `key` in `dir`, std::nullopt when there is none or it does not parse (older format, cut short).
+     */
+    [[nodiscard]] std::optional<NegotiationRecord> load_negotiation(const std::filesystem::path &dir, const std::string &key);
+
+    /*
+     * Replace the record for `key`, written next to it and renamed over it so readers never see half a file.
+     * Best effort: a cache that cannot be written costs the next start its shortcut, nothing else.
+     */
+    void store_negotiation(const std::filesystem::path &dir, const std::string &key, const NegotiationRecord &record) noexcept;
+} // namespace v4l2
@@ -0,0 +1,236 @@
+#pragma once
+#include "v4l2.hpp"
+#include <array>              // For std::array
+#include <chrono>             // For std::chrono::seconds
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>            // For std::size_t, std::byte
+#include <cstdint>            // For std::uint32_t, std::uint64_t
+#include <cstdlib>            // For std::free
+#include <deque>              // For std::deque
+#include <memory>             // For std::unique_ptr
+#include <mutex>              // For std::mutex
+#include <optional>           // For std::optional
+#include <string>             // For std::string
+#include <sys/uio.h>          // For iovec
+#include <thread>             // For std::jthread
+#include <utility>            // For std::pair
+#include <vector>             // For std::vector
+
+namespace v4l2
+{
+    constexpr std::uint64_t RECORDING_MAGIC = 0x3143'4552'3250'3456; // "V4L2REC1", first bytes of the file
+    constexpr std::uint32_t RECORD_MAGIC = 0x4D41'5246;              // "FRAM"
+    constexpr std::uint64_t TRAILER_MAGIC = 0x3158'4449'3250'3456;   // "V4L2IDX1"
+
+    /*
+     * Recording file layout, little endian, every record starting on an `alignment` boundary:
+     *   RecordingHeader, padded to alignment
+     *   per frame: RecordHeader padded to alignment, then the frame bytes padded to alignment
+     *   (both buffers of NV12M and NV16M frames, the CbCr one after the Y one)
+     *   index: RecordIndexEntry per frame, then RecordTrailer as the last bytes of the file
+     * A file without trailer (crash, power loss) is still readable, RecordingReader scans the records.
+     */
+    struct RecordingHeader
+    {
+        std::uint64_t magic{}; // RECORDING_MAGIC
+        std::uint32_t version{};
+        std::uint32_t alignment{}; // record alignment, 4096 written with O_DIRECT
+        PixelFormat format{};
+        std::uint32_t width{};
+        std::uint32_t height{};
+        std::uint32_t bytes_per_line{};
+    };
+
+    struct RecordHeader
+    {
+        std::uint32_t magic{};       // RECORD_MAGIC
+        std::uint32_t sequence{};    // driver sequence
+        std::uint64_t timestamp_monotonic_us{};
+        std::uint64_t v4l2_timestamp_us{};
+        std::uint64_t size{};        // frame bytes, padding excluded
+        std::uint32_t flags{};       // V4L2_BUF_FLAG_*
+        std::uint32_t error{};       // 1: V4L2_BUF_FLAG_ERROR
+    };
+
+    struct RecordIndexEntry
+    {
+        std::uint64_t offset{}; // of the RecordHeader
+        std::uint64_t timestamp_monotonic_us{};
+        std::uint64_t size{};
+        std::uint32_t sequence{};
+        std::uint32_t reserved{};
+    };
+
+    struct RecordTrailer
+    {
+        std::uint64_t index_offset{};
+        std::uint64_t frames{};
+        std::uint64_t magic{}; // TRAILER_MAGIC
+    };
+
+    struct RecorderConfig
+    {
+        std::string path_;                         // file, or segment prefix in ring mode: path_.000001.v4lr, ...
+        bool direct_ = true;                       // O_DIRECT when the filesystem takes it
+        unsigned queue_depth_ = 32;                // writes in flight, each may hold a lease (keep below buffer_count_)
+        bool io_uring_ = true;                     // false, or io_uring unavailable: pwritev on a writer thread
+        std::chrono::seconds ring_duration_{0};    // > 0: keep only the last this many seconds, in segments
+        std::chrono::seconds segment_duration_{10}; // ring mode segment length
+    };
+
+    struct RecorderStats
+    {
+        std::uint64_t frames{};   // written and completed
+        std::uint64_t bytes{};    // frame bytes, headers and padding excluded
+        std::uint64_t bounced{};  // leases copied first because their memory could not be the write source
+        std::uint64_t segments{}; // files started
+    };
+
+    /*
+     * Writes frames to disk in the layout above without copying leases: the driver buffer itself is
+     * the source of an io_uring write, O_DIRECT where the page alignment allows, and the lease is
+     * released (re-queued) by the completion thread once the write is done. Driver memory the kernel
+     * refuses as a write source (EFAULT, e.g. VM_PFNMAP or dma-contig buffers) is written again from a
+     * copy, and every later frame is copied first.
+     * record() from one thread; the completion thread only touches the writes it completes.
+     */
+    class [[nodiscard]] Recorder final
+    {
+    public:
+        /*
+         * Start the completion thread, the first record() creates the file.
+         * Throws std::invalid_argument for an empty path or zero queue depth.
+         */
+        explicit Recorder(const RecorderConfig &config);
+        ~Recorder() noexcept;
+
+        // No copy or move semantics, the completion thread points at us
+        Recorder(const Recorder &) = delete;
+        Recorder &operator=(const Recorder &) = delete;
+        Recorder(Recorder &&) = delete;
+        Recorder &operator=(Recorder &&) = delete;
+
+        /*
+         * Queue the frame behind the lease, the buffer goes back to the driver when its write completes.
+         * Waits while queue_depth_ writes are in flight.
+         * Throws std::runtime_error if the file cannot be created, after close(), or once a write has failed
+         * (e.g. the disk is full).
+         */
+        void record(FrameLease &&lease);
+
+        /*
+         * Queue a copy of `frame`, for frames that do not come from a lease. Same waits and errors.
+         */
+        void record(const FrameView &frame);
+
+        /*
+         * Wait for the writes in flight, write the index and close the file. Safe to call more than once,
+         * the destructor calls it. Throws std::runtime_error if a write failed.
+         */
+        void close();
+
+        [[nodiscard]] RecorderStats stats() const;
+
+        // The file record() currently writes to
+        [[nodiscard]] std::string current_path() const;
+
+        [[nodiscard]] bool uses_io_uring() const noexcept;
+        [[nodiscard]] bool uses_direct_io() const noexcept { return direct_; }
+
+    private:
+        struct Uring;
+        struct Write
+        {
+            std::optional<FrameLease> lease;
+            std::unique_ptr<std::byte, void (*)(void *)> bounce{nullptr, std::free}; // aligned frame copy, if not in place
+            std::size_t bounce_capacity{};
+            std::array<iovec, 2> iov{};    // header block, frame
+            std::byte *header{};           // one alignment-sized block inside headers_
+            std::size_t size{};            // frame bytes, for the stats
+            std::size_t length{};          // bytes the write must return
+            std::uint64_t offset{};
+            int fd = -1;
+        };
+
+        void enqueue(const FrameView &frame, std::optional<FrameLease> &&lease);
+        void open_segment(const FrameView &frame);
+        void finish_segment(std::uint64_t end_us);
+        void drain();
+        void submit(std::size_t slot);
+        void complete(std::size_t slot, long result) noexcept;
+        long rewrite_bounced(Write &write) noexcept;
+        void run(std::stop_token stop) noexcept;
+        void throw_if_failed() const;
+
+    private:
+        RecorderConfig config_;
+        std::size_t alignment_{};
+        bool direct_{};
+        std::unique_ptr<Uring> uring_; // nullptr: pwritev fallback
+
+        // recording thread only
+        int fd_ = -1;
+        std::string path_;
+        std::uint64_t offset_{};
+        std::uint64_t segment_start_us_{};
+        std::uint64_t segment_number_{};
+        std::vector<RecordIndexEntry> index_;
+        std::deque<std::pair<std::string, std::uint64_t>> segments_; // ring mode: closed files and their last frame time
+        bool closed_{};
+
+        // shared with the completion thread
+        mutable std::mutex mutex_;
+        std::condition_variable slot_cv_;      // free slots, errors
+        std::condition_variable_any work_cv_;  // fallback only: pending writes
+        std::unique_ptr<std::byte, void (*)(void *)> headers_{nullptr, std::free}; // queue_depth_ aligned header blocks
+        std::vector<Write> writes_;
+        std::vector<std::size_t> free_;
+        std::deque<std::size_t> pending_; // fallback only: waiting for the writer thread
+        std::string error_;
+        bool in_place_ = true; // leases as write sources, until the kernel refuses one
+        RecorderStats stats_{};
+        std::jthread thread_;
+    };
+
+    /*
+     * Reads a recording back, index from the trailer or, without one, from a scan of the records.
+     */
+    class [[nodiscard]] RecordingReader final
+    {
+    public:
+        struct Frame
+        {
+            RecordHeader header{};
+            std::vector<std::byte> data;
+        };
+
+        /*
+         * Throws std::runtime_error if the file cannot be opened or is not a recording.
+         */
+        explicit RecordingReader(const std::string &path);
+        ~RecordingReader() noexcept;
+
+        // No copy or move semantics
+        RecordingReader(const RecordingReader &) = delete;
+        RecordingReader &operator=(const RecordingReader &) = delete;
+        RecordingReader(RecordingReader &&) = delete;
+        RecordingReader &operator=(RecordingReader &&) = delete;
+
+        [[nodiscard]] const std::vector<RecordIndexEntry> &index() const noexcept { return index_; }
+        [[nodiscard]] const RecordingHeader &header() const noexcept { return header_; }
+        [[nodiscard]] PixelFormat format() const noexcept { return header_.format; }
+        [[nodiscard]] bool complete() const noexcept { return complete_; } // trailer found
+
+        /*
+         * Frame `i` of index(). Throws std::out_of_range or std::runtime_error on a short read.
+         */
+        [[nodiscard]] Frame read(std::size_t i) const;
+
+    private:
+        int fd_ = -1;
+        RecordingHeader header_{};
+        std::size_t alignment_{};
+        bool complete_{};
+        std::vector<RecordIndexEntry> index_;
+    };
+} // namespace v4l2
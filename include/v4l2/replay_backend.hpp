@@ -0,0 +1,139 @@
+#pragma once
+#include "backend.hpp"
+#include "recorder.hpp"
+#include <cstddef>  // For std::size_t, std::byte
+#include <cstdint>  // For std::uint32_t, std::uint64_t
+#include <deque>    // For std::deque
+#include <mutex>    // For std::mutex
+#include <string>   // For std::string
+#include <vector>   // For std::vector
+
+namespace v4l2
+{
+    enum class ReplayRate
+    {
+        RECORDED, // the recorded frame intervals
+        FIXED,    // fps_num_ / fps_den_ of ReplayConfig
+        MAX,      // as fast as buffers come back, for throughput tests
+    };
+
+    struct ReplayConfig
+    {
+        std::string path_; // a Recorder file
+        ReplayRate rate_ = ReplayRate::RECORDED;
+        std::uint32_t fps_num_ = 30; // ReplayRate::FIXED
+        std::uint32_t fps_den_ = 1;
+        bool loop_ = true; // false: DQBUF fails with EPIPE after the last frame, like an unplugged camera
+        bool mplane_ = false; // act as a multi-planar-only node (V4L2_CAP_VIDEO_CAPTURE_MPLANE), always for NV12M and NV16M
+    };
+
+    /*
+     * Parse "replay:///path/file.v4lr?rate=recorded|max|30|30000/1001&loop=0|1&mplane=0|1".
+     * Throws std::invalid_argument for anything else.
+     */
+    [[nodiscard]] ReplayConfig parse_replay_uri(const std::string &uri);
+
+    /*
+     * A capture node played back from a recording: one format and size, MMAP buffers only.
+     * The file is mapped once and DQBUF points the frame at it, nothing is copied; a buffer
+     * that is not queued when its frame is due loses that frame, like a driver would.
+     * Timestamps are taken on CLOCK_MONOTONIC when the frame becomes due, sequence counts from 0 at STREAMON.
+     * V4L2_EVENT_FRAME_SYNC (one frame interval before the frame is due, lost frames included), V4L2_EVENT_EOS
+     * (a non-looping replay ran out) and V4L2_EVENT_CTRL can be subscribed to; the fd is a timer, it never reports
+     * POLLPRI for them. The controls are those of a typical UVC camera (exposure, gain, white balance): they keep
+     * their values for VIDIOC_G_EXT_CTRLS and change nothing in the frames.
+     */
+    class ReplayBackend final : public CaptureBackend
+    {
+    public:
+        /*
+         * Map the recording. Throws std::runtime_error if it cannot be read or holds no frames.
+         */
+        explicit ReplayBackend(const ReplayConfig &config);
+        ~ReplayBackend() noexcept override;
+
+        // No copy or move semantics, owns the mapping and fds
+        ReplayBackend(const ReplayBackend &) = delete;
+        ReplayBackend &operator=(const ReplayBackend &) = delete;
+        ReplayBackend(ReplayBackend &&) = delete;
+        ReplayBackend &operator=(ReplayBackend &&) = delete;
+
+        [[nodiscard]] int fd() const noexcept override { return fd_; }
+        [[nodiscard]] int ioctl(unsigned long request, void *arg) noexcept override;
+        [[nodiscard]] void *map(std::size_t length, int prot, off_t offset) noexcept override;
+        [[nodiscard]] const std::byte *frame_data(const v4l2_buffer &buf, const MappedBuffer &mapped,
+                                                  std::uint32_t plane) const noexcept override;
+
+        [[nodiscard]] std::size_t frame_count() const noexcept { return frames_.size(); }
+
+    private:
+        struct Frame
+        {
+            std::uint64_t data_offset{}; // into the mapping
+            std::uint32_t size{};
+            std::uint64_t recorded_us{};
+            bool error{};
+        };
+
+        struct Control
+        {
+            std::uint32_t id{};
+            const char *name{};
+            std::uint32_t type{};
+            std::int32_t minimum{};
+            std::int32_t maximum{};
+            std::int32_t step{};
+            std::int32_t default_value{};
+            std::int32_t value{};
+        };
+
+        struct Ready
+        {
+            std::uint32_t index{};
+            std::size_t frame{};
+            std::uint32_t sequence{};
+            std::uint64_t timestamp_us{};
+        };
+
+        void produce(std::uint64_t now_us);
+        bool take_frame(std::uint64_t timestamp_us);
+        void push_event(v4l2_event event);
+        [[nodiscard]] Control *find_control(std::uint32_t id) noexcept;
+        [[nodiscard]] int query_control(v4l2_query_ext_ctrl &query) noexcept;
+        [[nodiscard]] int ext_controls(unsigned long request, v4l2_ext_controls &ext) noexcept;
+        [[nodiscard]] std::uint64_t interval_after(std::size_t frame) const noexcept;
+        void arm() noexcept;
+        [[nodiscard]] v4l2_fract time_per_frame() const noexcept;
+        void fill_format(v4l2_format &format) const noexcept;
+        // bytes of `frame` in memory plane `plane`, the Y rows first for NV12M and NV16M
+        [[nodiscard]] std::uint32_t plane_bytes(const Frame &frame, std::uint32_t plane) const noexcept;
+
+    private:
+        ReplayConfig config_;
+        RecordingHeader header_{};
+        std::byte *base_{};
+        std::size_t mapped_size_{};
+        std::vector<Frame> frames_;
+        std::uint64_t mean_interval_us_{};
+        std::size_t buffer_size_{};
+        std::uint32_t memory_planes_ = 1; // per buffer, with config_.mplane_
+        int fd_ = -1; // timerfd when paced, eventfd kept readable for ReplayRate::MAX
+
+        mutable std::mutex mutex_; // QBUF and DQBUF come from different threads
+        std::uint32_t buffer_count_{};
+        std::vector<std::size_t> buffer_frame_; // frame each buffer holds since its DQBUF
+        std::deque<std::uint32_t> queued_;
+        std::deque<Ready> ready_;
+        bool streaming_{};
+        std::size_t next_frame_{};
+        std::uint32_t sequence_{};
+        std::uint64_t next_due_us_{};
+        bool finished_{}; // no loop and every frame produced
+        bool frame_sync_subscribed_{};
+        bool eos_subscribed_{};
+        std::uint32_t event_sequence_{};
+        std::deque<v4l2_event> events_; // oldest dropped past a few, like the per-subscription kernel queue
+        std::vector<Control> controls_;        // by id
+        std::vector<std::uint32_t> ctrl_events_; // control ids subscribed to V4L2_EVENT_CTRL
+    };
+} // namespace v4l2
@@ -0,0 +1,118 @@
+#pragma once
+#include "definitions.hpp"
+#include <atomic>   // For std::atomic
+#include <chrono>   // For std::chrono::microseconds
+#include <cstddef>  // For std::size_t, std::byte
+#include <cstdint>  // For std::uint64_t
+#include <optional> // For std::optional
+#include <string>   // For std::string
+#include <vector>   // For std::vector
+
+namespace v4l2
+{
+    struct SharedFrameRingConfig
+    {
+        std::string name_;          // POSIX shared memory name, e.g. "/v4l2-cam0"
+        std::size_t slots_ = 4;     // frames kept for slow readers
+        std::size_t slot_size_ = 0; // largest frame in bytes, e.g. the biggest MappedBuffer::size
+    };
+
+    /*
+     * Publisher side: a ring of frames in POSIX shared memory that any number of processes can read.
+     * publish() copies the frame in once and never waits for a reader; that copy is the only one, a subscriber can read
+     * the slot in place. Driver buffers cannot live in the segment themselves: V4L2 MMAP buffers are the driver's memory
+     * and another process cannot map them without dmabuf fd passing. A reader that falls more than
+     * slots_ frames behind loses the oldest ones and notices. New frames are signalled with a futex,
+     * woken only when someone is waiting.
+     * One publishing thread. The shared memory is unlinked on destruction, mapped readers keep theirs.
+     */
+    class [[nodiscard]] SharedFrameRing final
+    {
+    public:
+        /*
+         * Create the shared memory segment. One left behind by a publisher that died is replaced, its readers keep
+         * the old mapping.
+         * Throws std::invalid_argument for an empty name, zero slots or zero slot size,
+         * std::runtime_error if another publisher with this name is still running or shm_open/ftruncate/mmap fails.
+         */
+        explicit SharedFrameRing(const SharedFrameRingConfig &config);
+        ~SharedFrameRing() noexcept;
+
+        // No copy or move semantics, the mapping is shared with other processes
+        SharedFrameRing(const SharedFrameRing &) = delete;
+        SharedFrameRing &operator=(const SharedFrameRing &) = delete;
+        SharedFrameRing(SharedFrameRing &&) = delete;
+        SharedFrameRing &operator=(SharedFrameRing &&) = delete;
+
+        /*
+         * Copy `frame` into the next slot and wake waiting readers. A color plane outside `image` (NV12M, NV16M)
+         * is copied right after it, subscribers find it in `planes` as usual.
+         * Returns false, without publishing, if the frame and its planes do not fit a slot. Never blocks.
+         */
+        bool publish(const FrameView &frame) noexcept;
+
+        // Frames published so far
+        [[nodiscard]] std::uint64_t published() const noexcept;
+
+        [[nodiscard]] const SharedFrameRingConfig &config() const noexcept { return config_; }
+
+    private:
+        SharedFrameRingConfig config_;
+        int fd_{-1}; // kept open for the flock that marks the segment as taken
+        std::byte *base_{};
+        std::size_t mapped_size_{};
+        std::uint64_t next_{}; // next frame index, publisher only
+    };
+
+    /*
+     * Reader side, in any process: frames in publication order from the moment it attached.
+     * next_view() hands out the frame where it lies in shared memory, next() copies it out first.
+     * One thread per subscriber, open several subscribers for several threads.
+     */
+    class [[nodiscard]] SharedFrameSubscriber final
+    {
+    public:
+        /*
+         * Attach to a ring created by SharedFrameRing.
+         * Throws std::runtime_error if it does not exist or is not a frame ring of this version.
+         */
+        explicit SharedFrameSubscriber(const std::string &name);
+        ~SharedFrameSubscriber() noexcept;
+
+        // No copy or move semantics
+        SharedFrameSubscriber(const SharedFrameSubscriber &) = delete;
+        SharedFrameSubscriber &operator=(const SharedFrameSubscriber &) = delete;
+        SharedFrameSubscriber(SharedFrameSubscriber &&) = delete;
+        SharedFrameSubscriber &operator=(SharedFrameSubscriber &&) = delete;
+
+        /*
+         * The next frame, waiting at most `timeout` (negative: forever) for the publisher.
+         * After falling behind, skips to the oldest frame still intact.
+         * Returns std::nullopt on timeout. dmabuf_fd is always -1.
+         */
+        [[nodiscard]] std::optional<FrameView> next(std::chrono::microseconds timeout);
+
+        /*
+         * Same as next() without the copy: `image` points straight into the ring slot, valid until the next call.
+         * The publisher may overwrite the slot at any moment, so read what you need, then ask still_valid():
+         * false means the pixels you read may be torn and must be dropped. The metadata is always intact.
+         */
+        [[nodiscard]] std::optional<FrameView> next_view(std::chrono::microseconds timeout);
+
+        // True while the slot behind the last next_view() still holds that frame, see next_view()
+        [[nodiscard]] bool still_valid() const noexcept;
+
+        // Frames overwritten before this subscriber could read them
+        [[nodiscard]] std::uint64_t skipped() const noexcept { return skipped_; }
+
+    private:
+        std::byte *base_{};
+        std::size_t mapped_size_{};
+        std::uint64_t next_{}; // next frame index to read
+        std::uint64_t skipped_{};
+        const std::atomic<std::uint64_t> *view_seq_{}; // seqlock of the slot behind the last next_view()
+        std::uint64_t view_stamp_{};                   // its value when the frame was handed out
+        std::uint64_t view_used_{};                    // bytes of that slot the frame and its planes take
+        std::vector<std::byte> copy_;                  // next() only
+    };
+} // namespace v4l2
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>      // For std::atomic
+#include <bit>         // For std::bit_ceil
+#include <cstddef>     // For std::size_t
+#include <optional>    // For std::optional
+#include <type_traits> // For std::is_nothrow_move_assignable_v
+#include <utility>     // For std::move
+#include <vector>      // For std::vector
+
+namespace v4l2
+{
+    /*
+     * Bounded lock-free single-producer single-consumer ring.
+     * push() from exactly one thread, pop() from exactly one other thread.
+     * Capacity is rounded up to a power of two, slots are allocated once.
+     */
+    template <typename T>
+    class SpscRing final
+    {
+        static_assert(std::is_nothrow_move_assignable_v<T>, "SpscRing moves elements in and out of its slots");
+
+    public:
+        explicit SpscRing(std::size_t capacity)
+            : slots_(std::bit_ceil(capacity < 1 ? std::size_t{1} : capacity)),
+              mask_(slots_.size() - 1)
+        {
+        }
+
+        // No copy or move semantics, the indices are shared between two threads
+        SpscRing(const SpscRing &) = delete;
+        SpscRing &operator=(const SpscRing &) = delete;
+        SpscRing(SpscRing &&) = delete;
+        SpscRing &operator=(SpscRing &&) = delete;
+
+        /*
+         * Producer side. Returns false (and leaves `value` untouched) when full.
+         */
+        [[nodiscard]] bool push(T &value) noexcept
+        {
+            const auto head = head_.load(std::memory_order_relaxed);
+            if (head - tail_cache_ == slots_.size())
+            {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+                if (head - tail_cache_ == slots_.size())
+                {
+                    return false;
+                }
+            }
+            slots_[head & mask_] = std::move(value);
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /*
+         * Consumer side. Returns std::nullopt when empty.
+         */
+        [[nodiscard]] std::optional<T> pop() noexcept
+        {
+            const auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_cache_)
+            {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail == head_cache_)
+                {
+                    return std::nullopt;
+                }
+            }
+            std::optional<T> value{std::move(slots_[tail & mask_])};
+            tail_.store(tail + 1, std::memory_order_release);
+            return value;
+        }
+
+        [[nodiscard]] std::size_t capacity() const noexcept { return slots_.size(); }
+
+        // Approximate from any thread, exact from either side while the other is idle
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+        }
+
+    private:
+        static constexpr std::size_t cache_line = 64; // hardware_destructive_interference_size is not ABI-stable
+
+        std::vector<T> slots_;
+        const std::size_t mask_;
+        alignas(cache_line) std::atomic<std::size_t> head_{0}; // written by the producer
+        std::size_t tail_cache_{0};                            // producer's view of tail_
+        alignas(cache_line) std::atomic<std::size_t> tail_{0}; // written by the consumer
+        std::size_t head_cache_{0};                            // consumer's view of head_
+    };
+} // namespace v4l2
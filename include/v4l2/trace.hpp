@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>     // For std::uint8_t
+#include <fmt/core.h>  // For fmt::format
+#include <string_view> // For std::string_view
+
+/*
+ * Library tracing, two gates:
+ *  - compile time: V4L2_TRACE_LEVEL, anything above it is not even compiled.
+ *    Defaults to INFO in release (NDEBUG) builds and TRACE otherwise, so per-frame traces vanish from Release.
+ *  - run time: set_trace_level() or the V4L2_TRACE environment variable (off, warn, info, debug, trace),
+ *    WARN by default. A disabled level costs one relaxed load, no formatting and no syscall.
+ */
+#ifndef V4L2_TRACE_LEVEL
+#ifdef NDEBUG
+#define V4L2_TRACE_LEVEL 2
+#else
+#define V4L2_TRACE_LEVEL 4
+#endif
+#endif
+
+namespace v4l2
+{
+    enum class TraceLevel : std::uint8_t
+    {
+        OFF = 0,
+        WARN = 1,
+        INFO = 2,
+        DEBUG = 3,
+        TRACE = 4, // per frame
+    };
+
+    [[nodiscard]] TraceLevel trace_level() noexcept;
+    void set_trace_level(TraceLevel level) noexcept;
+
+    // One line to stderr, "<LEVEL>: <message>"
+    void trace_write(TraceLevel level, std::string_view message) noexcept;
+
+    [[nodiscard]] inline bool trace_enabled(TraceLevel level) noexcept
+    {
+        return static_cast<std::uint8_t>(level) <= static_cast<std::uint8_t>(trace_level());
+    }
+} // namespace v4l2
+
+// V4L2_TRACE(WARN, "format {}", args...): level is a TraceLevel enumerator name
+#define V4L2_TRACE(level, ...)                                                                          \
+    do                                                                                                  \
+    {                                                                                                   \
+        if constexpr (static_cast<int>(::v4l2::TraceLevel::level) <= V4L2_TRACE_LEVEL)                  \
+        {                                                                                               \
+            if (::v4l2::trace_enabled(::v4l2::TraceLevel::level))                                       \
+            {                                                                                           \
+                ::v4l2::trace_write(::v4l2::TraceLevel::level, ::fmt::format(__VA_ARGS__));             \
+            }                                                                                           \
+        }                                                                                               \
+    } while (false)
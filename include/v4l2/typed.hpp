@@ -0,0 +1,231 @@
+#pragma once
+#include "convert.hpp"
+#include "definitions.hpp"
+#include "v4l2.hpp"
+#include <chrono>   // For std::chrono::microseconds
+#include <cstddef>  // For std::size_t, std::byte
+#include <cstdint>  // For std::uint8_t, std::uint32_t
+#include <optional> // For std::optional
+#include <span>     // For std::span
+#include <utility>  // For std::move
+
+namespace v4l2
+{
+    // One YUYV macropixel: two pixels sharing their chroma
+    struct Yuyv
+    {
+        std::uint8_t y0{};
+        std::uint8_t u{};
+        std::uint8_t y1{};
+        std::uint8_t v{};
+    };
+    static_assert(sizeof(Yuyv) == 4 && alignof(Yuyv) == 1, "a macropixel is the 4 bytes the driver writes");
+
+    /*
+     * A capture mode fixed at compile time, for cameras that only ever run in one.
+     * Width, height, stride and frame size are constants, so loops over a frame have known trip counts
+     * and buffer sizes are checked by the compiler. Compressed formats only have the dimensions.
+     */
+    template <PixelFormat Format, PixelDimension Dimension>
+    struct StaticMode final
+    {
+        static constexpr PixelFormat format = Format;
+        static constexpr PixelDimension dimension = Dimension;
+        static constexpr std::uint32_t width = dimensions_decompress(static_cast<std::uint32_t>(Dimension)).first;
+        static constexpr std::uint32_t height = dimensions_decompress(static_cast<std::uint32_t>(Dimension)).second;
+        static constexpr bool raw = Format == PixelFormat::YUYV;              // false: MJPG, the size varies per frame
+        static constexpr std::uint32_t stride = raw ? width * 2 : 0;          // tight rows, configure() insists on it
+        static constexpr std::size_t frame_size = std::size_t{stride} * height; // 0 for compressed formats
+
+        static_assert(width > 0 && height > 0, "a mode needs a size");
+        static_assert(!raw || width % 2 == 0, "YUYV pairs pixels, the width must be even");
+    };
+
+    /*
+     * Check that a configured camera delivers exactly this mode: format, size, a stride of `stride`
+     * (0: compressed, not checked) and every buffer mapped with at least `frame_size` bytes.
+     * Throws std::runtime_error naming what the driver picked instead.
+     */
+    void check_static_mode(const V4L2Camera &camera, PixelFormat format, std::uint32_t width, std::uint32_t height,
+                           std::uint32_t stride, std::size_t frame_size);
+
+    template <class Mode>
+    void check_static_mode(const V4L2Camera &camera)
+    {
+        check_static_mode(camera, Mode::format, Mode::width, Mode::height, Mode::stride, Mode::frame_size);
+    }
+
+    /*
+     * Check that `frame_size` bytes can be read from where the lease's image starts: inside a driver buffer
+     * check_static_mode() vouched for the mapping, anywhere else (a replayed record) only the image itself counts.
+     * Throws std::runtime_error for a short frame outside the driver buffers.
+     */
+    void check_static_frame(const V4L2Camera &camera, const FrameLease &lease, std::size_t frame_size);
+
+    template <class Mode>
+    class TypedLease;
+
+    /*
+     * A frame of a StaticMode camera, valid as long as the lease it came from.
+     * The spans have static extents: the mode was checked once in configure(), not on every frame.
+     * They cover the full frame even when the driver filled less of it, see FrameView::error; a short frame
+     * that is not in a driver buffer never becomes a TypedFrame, see check_static_frame().
+     */
+    template <class Mode>
+    class [[nodiscard]] TypedFrame final
+    {
+    public:
+        static constexpr std::uint32_t width() noexcept { return Mode::width; }
+        static constexpr std::uint32_t height() noexcept { return Mode::height; }
+        static constexpr std::uint32_t stride() noexcept { return Mode::stride; }
+        static constexpr std::size_t size() noexcept { return Mode::frame_size; }
+
+        // timestamps, sequence, flags, ... as captured
+        [[nodiscard]] const FrameView &view() const noexcept { return *view_; }
+
+        [[nodiscard]] std::span<const std::byte, Mode::frame_size> bytes() const noexcept
+            requires(Mode::raw)
+        {
+            return std::span<const std::byte, Mode::frame_size>(view_->image.data(), Mode::frame_size);
+        }
+
+        // 🧩 row `y` as width / 2 macropixels
+        [[nodiscard]] std::span<const Yuyv, Mode::width / 2> row(std::uint32_t y) const noexcept
+            requires(Mode::format == PixelFormat::YUYV)
+        {
+            return std::span<const Yuyv, Mode::width / 2>(data() + std::size_t{Mode::width / 2} * y, Mode::width / 2);
+        }
+
+        [[nodiscard]] std::span<const Yuyv, Mode::width / 2 * Mode::height> macropixels() const noexcept
+            requires(Mode::format == PixelFormat::YUYV)
+        {
+            return std::span<const Yuyv, Mode::width / 2 * Mode::height>(data(), Mode::width / 2 * Mode::height);
+        }
+
+    private:
+        friend class TypedLease<Mode>;
+        explicit TypedFrame(const FrameView &view) noexcept : view_(&view) {}
+
+        [[nodiscard]] const Yuyv *data() const noexcept { return reinterpret_cast<const Yuyv *>(view_->image.data()); }
+
+        const FrameView *view_;
+    };
+
+    /*
+     * FrameLease of a StaticMode camera, re-queues the buffer the same way.
+     */
+    template <class Mode>
+    class [[nodiscard]] TypedLease final
+    {
+    public:
+        TypedLease() noexcept = default;
+
+        [[nodiscard]] TypedFrame<Mode> frame() const noexcept { return TypedFrame<Mode>(lease_.view()); }
+        [[nodiscard]] const FrameView *operator->() const noexcept { return &lease_.view(); }
+        [[nodiscard]] std::uint32_t index() const noexcept { return lease_.index(); }
+        [[nodiscard]] bool valid() const noexcept { return lease_.valid(); }
+        explicit operator bool() const noexcept { return valid(); }
+
+        /*
+         * Re-queue the buffer now instead of on destruction.
+         * Throws std::runtime_error on failure.
+         */
+        void release() { lease_.release(); }
+
+    private:
+        template <PixelFormat, PixelDimension>
+        friend class TypedCamera;
+        explicit TypedLease(FrameLease lease) noexcept : lease_(std::move(lease)) {}
+
+        FrameLease lease_;
+    };
+
+    /*
+     * V4L2Camera fixed to one mode at compile time, frames come as TypedFrame<Mode>.
+     * configure() fails unless the driver takes the mode as is, so nothing downstream has to check
+     * format, size or stride again. The camera underneath stays reachable for everything else;
+     * after a renegotiate() on it call configure() here again.
+     */
+    template <PixelFormat Format, PixelDimension Dimension>
+    class [[nodiscard]] TypedCamera final
+    {
+    public:
+        using Mode = StaticMode<Format, Dimension>;
+        using Frame = TypedFrame<Mode>;
+        using Lease = TypedLease<Mode>;
+
+        // format_ and dimension_ of `config` come from the mode
+        explicit TypedCamera(V4l2Config config) : camera_(with_mode(std::move(config))) {}
+
+        /*
+         * Open the device.
+         * Throws std::runtime_error on failure.
+         */
+        void open_device() { camera_.open_device(); }
+
+        /*
+         * Configure the device, then check it runs in Mode.
+         * Throws std::runtime_error on failure or when the driver picked another size, format or stride.
+         */
+        void configure()
+        {
+            camera_.configure();
+            check_static_mode<Mode>(camera_);
+        }
+
+        void start_streaming() { camera_.start_streaming(); }
+        void stop_streaming() { camera_.stop_streaming(); }
+
+        // See V4L2Camera::capture_frame(), and check_static_frame() for one more std::runtime_error
+        [[nodiscard]] Lease capture_frame() { return checked(camera_.capture_frame()); }
+
+        // See V4L2Camera::try_capture_frame(), and check_static_frame() for one more std::runtime_error
+        [[nodiscard]] std::optional<Lease> try_capture_frame(std::chrono::microseconds timeout)
+        {
+            auto lease = camera_.try_capture_frame(timeout);
+            if (!lease)
+            {
+                return std::nullopt;
+            }
+            return checked(std::move(*lease));
+        }
+
+        [[nodiscard]] V4L2Camera &camera() noexcept { return camera_; }
+        [[nodiscard]] const V4L2Camera &camera() const noexcept { return camera_; }
+
+    private:
+        // a frame that fails the check goes back to the driver as the lease unwinds
+        [[nodiscard]] Lease checked(FrameLease lease) const
+        {
+            if constexpr (Mode::raw)
+            {
+                check_static_frame(camera_, lease, Mode::frame_size);
+            }
+            return Lease(std::move(lease));
+        }
+
+        [[nodiscard]] static V4l2Config with_mode(V4l2Config config) noexcept
+        {
+            config.format_ = Format;
+            config.dimension_ = Dimension;
+            return config;
+        }
+
+        V4L2Camera camera_;
+    };
+
+    // Bytes a `Target` image of a mode takes, a constant
+    template <ConvertFormat Target, class Mode>
+    inline constexpr std::size_t converted_size_v = converted_size(Target, Mode::width, Mode::height);
+
+    /*
+     * convert_yuyv() into an output sized at compile time, a buffer of the wrong size does not compile.
+     */
+    template <ConvertFormat Target, class Mode>
+        requires(Mode::format == PixelFormat::YUYV)
+    void convert(const TypedFrame<Mode> &frame, std::span<std::byte, converted_size_v<Target, Mode>> dst,
+                 ConvertKernel kernel = ConvertKernel::BEST)
+    {
+        convert_yuyv(frame.view(), Target, dst, kernel);
+    }
+} // namespace v4l2
@@ -0,0 +1,84 @@
+#pragma once
+#include "definitions.hpp"
+#include <cstdint>    // For std::uint32_t, std::uint64_t
+#include <filesystem> // For std::filesystem::path
+#include <optional>   // For std::optional
+#include <string>     // For std::string
+#include <vector>     // For std::vector
+
+namespace v4l2
+{
+    enum class UsbSpeed
+    {
+        UNKNOWN,
+        LOW,        // 1.5 Mbit/s, no isochronous transfers
+        FULL,       // 12 Mbit/s
+        HIGH,       // 480 Mbit/s, USB 2
+        SUPER,      // 5 Gbit/s
+        SUPER_PLUS, // 10 Gbit/s and up
+    };
+
+    // Where a camera sits on the USB tree
+    struct UsbTopology
+    {
+        std::uint32_t bus{};    // root hub bus number, the unit bandwidth is shared in; the USB 2 and SuperSpeed halves of an xHCI are two buses
+        std::string port;       // "3-1.2": the device on that bus, hub ports joined by dots
+        std::string controller; // host controller, "0000:00:14.0"
+        UsbSpeed speed = UsbSpeed::UNKNOWN;
+        std::string serial;     // iSerialNumber, empty when the camera has none (or without sysfs)
+    };
+
+    /*
+     * USB placement of a V4L2 device, from /sys/class/video4linux/<node>/device.
+     * Without sysfs, `bus_info` ("usb-0000:00:14.0-1.2", V4lCaps::bus_info) still gives controller and port:
+     * the bus is then keyed on the controller and the speed assumed HIGH, the smaller budget.
+     * std::nullopt for devices that are not on USB (CSI, replay://).
+     */
+    [[nodiscard]] std::optional<UsbTopology> usb_topology(const std::string &device_path, const std::string &bus_info = {},
+                                                          const std::filesystem::path &sysfs = "/sys");
+
+    struct UsbBandwidthModel
+    {
+        // 🗜 compressed frames: what UVC cameras typically reserve, the alternate setting is picked
+        // for the largest frame they might send, not for the average one
+        double mjpeg_bytes_per_pixel_ = 0.5;
+        double overhead_ = 0.05; // payload headers and rounding to whole packets
+        double headroom_ = 0.9;  // share of each bus' periodic budget the plan may fill, other devices need some
+    };
+
+    /*
+     * Isochronous bytes per second a mode reserves on the bus.
+     */
+    [[nodiscard]] std::uint64_t predict_usb_bandwidth(PixelFormat format, std::uint32_t width, std::uint32_t height,
+                                                      const FrameRate &rate, const UsbBandwidthModel &model = {}) noexcept;
+
+    // Periodic (isochronous + interrupt) bytes per second a bus of this speed can schedule: 80 % of a high-speed microframe, 90 % otherwise
+    [[nodiscard]] std::uint64_t usb_periodic_budget(UsbSpeed speed) noexcept;
+
+    // Most one isochronous endpoint can move: 3 x 1024 bytes per microframe on USB 2, 48 KiB per interval on SuperSpeed
+    [[nodiscard]] std::uint64_t usb_endpoint_limit(UsbSpeed speed) noexcept;
+
+    struct BandwidthRequest
+    {
+        V4l2Config config;               // what the camera asks for, the upper bound of the plan
+        std::vector<CaptureMode> modes;  // what it offers, V4L2Camera::enumerate_modes()
+        std::optional<UsbTopology> topology;
+    };
+
+    struct BandwidthPlan
+    {
+        V4l2Config config;                // format_, dimension_, fps_num_ and fps_den_ picked
+        std::uint64_t bytes_per_second{}; // predicted, 0 off USB
+        bool downgraded = false;          // lowered to fit the bus, below the best mode within the request
+    };
+
+    /*
+     * Pick one mode per camera so that every bus stays inside its budget.
+     * Each camera starts at its best mode within the request: the largest pixel rate that its endpoint can carry,
+     * the requested format when there is a tie. While a bus is over budget the camera using the most of it steps
+     * down to its next cheaper mode. Cameras off USB keep the mode they asked for.
+     * Throws std::runtime_error when a bus cannot fit even with every camera on it at its cheapest mode.
+     */
+    [[nodiscard]] std::vector<BandwidthPlan> plan_usb_bandwidth(const std::vector<BandwidthRequest> &requests,
+                                                                const UsbBandwidthModel &model = {});
+} // namespace v4l2
@@ -0,0 +1,100 @@
+#pragma once
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wconversion"
+#include <gst/base/gstpushsrc.h>
+#pragma GCC diagnostic pop
+#include "camera_group.hpp"
+#include "frame_sync.hpp"
+#include "v4l2-src.hpp"
+#include <atomic> // For std::atomic
+#include <memory> // For std::shared_ptr, std::unique_ptr
+
+G_BEGIN_DECLS
+
+// Enumerations for GObject properties
+using BatchMissingEnum = v4l2::MissingFramePolicy;
+
+// Default values for properties
+constexpr auto DEFAULT_BATCH_DEVICES = "/dev/video0,/dev/video2";
+constexpr auto DEFAULT_BATCH_PIXEL_FORMAT = PixelFormatEnum::YUYV;
+constexpr guint DEFAULT_BATCH_WIDTH = 1280u;
+constexpr guint DEFAULT_BATCH_HEIGHT = 720u;
+constexpr gint DEFAULT_BATCH_FRAMERATE_N = 30;
+constexpr gint DEFAULT_BATCH_FRAMERATE_D = 1;
+constexpr guint DEFAULT_BATCH_BUFFER_COUNT = 6u; // FrameSynchronizer holds up to 3 per camera, downstream the rest
+constexpr guint DEFAULT_BATCH_TOLERANCE_US = 5000u;
+constexpr guint DEFAULT_BATCH_MAX_WAIT_MS = 100u;
+constexpr auto DEFAULT_BATCH_MISSING = BatchMissingEnum::DROP;
+constexpr gint DEFAULT_BATCH_LOOP_CPU = -1;              // -1 = no affinity
+constexpr guint DEFAULT_BATCH_CAPTURE_TIMEOUT_MS = 2000u; // 0 = wait forever
+
+// GObject type and casting macros
+#define GST_TYPE_V4L2_BATCH_SRC (v4l2_batch_src_get_type())
+#define GST_V4L2_BATCH_SRC(obj) \
+    (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_V4L2_BATCH_SRC, V4L2BatchSrc))
+#define GST_IS_V4L2_BATCH_SRC(obj) \
+    (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_V4L2_BATCH_SRC))
+
+typedef struct _V4L2BatchSrc V4L2BatchSrc;
+typedef struct _V4L2BatchSrcClass V4L2BatchSrcClass;
+
+/*
+ * N cameras on one CameraGroup loop, pushed as one GstBufferList per FrameSet:
+ * buffer i is camera i of `devices`, every buffer of a list has the same PTS and a V4L2BatchMeta.
+ * All cameras must stream the same mode, the caps are those of each buffer.
+ */
+struct _V4L2BatchSrc
+{
+    GstPushSrc parent;
+    gchar *devices; // comma-separated device paths or replay:// URIs
+    PixelFormatEnum pixel_format;
+    guint width;
+    guint height;
+    gint framerate_n;
+    gint framerate_d;
+    guint buffer_count;
+    guint tolerance_us;
+    guint max_wait_ms;
+    BatchMissingEnum missing;
+    gint loop_cpu;
+    guint capture_timeout_ms;
+    std::shared_ptr<v4l2::CameraGroup> group;         // shared with the buffers downstream, their leases point at its cameras
+    std::unique_ptr<v4l2::FrameSynchronizer> sync;    // fed by the group's loop thread, popped in create()
+    std::atomic<bool> flushing;                       // unlock() interrupted the pop
+    std::uint64_t next_set;                           // FrameSet::number expected next, a jump marks the list DISCONT
+};
+
+struct _V4L2BatchSrcClass
+{
+    GstPushSrcClass parent_class;
+};
+
+GType v4l2_batch_src_get_type(void);
+
+/*
+ * Per-buffer meta of v4l2-batch-src: where in the set the buffer came from.
+ */
+typedef struct _V4L2BatchMeta V4L2BatchMeta;
+
+struct _V4L2BatchMeta
+{
+    GstMeta meta;
+    guint source;              // index into the devices list
+    guint64 batch;             // FrameSet::number, the same for every buffer of a list
+    guint32 sequence;          // driver sequence of the frame
+    guint64 v4l2_timestamp_us; // driver timestamp of the frame (CLOCK_MONOTONIC)
+    gboolean repeated;         // missing=repeat filled the gap with this camera's previous frame
+};
+
+GType v4l2_batch_meta_api_get_type(void);
+const GstMetaInfo *v4l2_batch_meta_get_info(void);
+#define V4L2_BATCH_META_API_TYPE (v4l2_batch_meta_api_get_type())
+#define V4L2_BATCH_META_INFO (v4l2_batch_meta_get_info())
+
+V4L2BatchMeta *gst_buffer_add_v4l2_batch_meta(GstBuffer *buffer);
+#define gst_buffer_get_v4l2_batch_meta(b) \
+    (reinterpret_cast<V4L2BatchMeta *>(gst_buffer_get_meta((b), V4L2_BATCH_META_API_TYPE)))
+
+G_END_DECLS
@@ -0,0 +1,90 @@
+#pragma once
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wconversion"
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#pragma GCC diagnostic pop
+#include "capture_thread.hpp"
+#include "v4l2.hpp"
+#include <memory> // For std::shared_ptr, std::unique_ptr
+#include <vector> // For std::vector
+
+G_BEGIN_DECLS
+
+// GObject type and casting macros
+#define GST_TYPE_V4L2_BUFFER_POOL (v4l2_buffer_pool_get_type())
+#define GST_V4L2_BUFFER_POOL(obj) \
+    (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_V4L2_BUFFER_POOL, V4L2BufferPool))
+#define GST_IS_V4L2_BUFFER_POOL(obj) \
+    (G_TYPE_CHECK_INSTANCE_TYPE((obj), GST_TYPE_V4L2_BUFFER_POOL))
+
+typedef struct _V4L2BufferPool V4L2BufferPool;
+typedef struct _V4L2BufferPoolClass V4L2BufferPoolClass;
+
+/*
+ * Buffer pool with one pre-built GstBuffer per driver buffer.
+ * acquire() dequeues a frame and hands out the GstBuffer wrapping that
+ * buffer index, release() re-queues it. Video meta is attached once at start.
+ * Setting the pool flushing interrupts a pending capture right away.
+ * With a capture thread, acquire() pops from its ring instead of dequeuing itself.
+ */
+struct _V4L2BufferPool
+{
+    GstBufferPool parent;
+    std::shared_ptr<v4l2::V4L2Camera> camera; // keeps the mappings alive while buffers are downstream
+    std::unique_ptr<v4l2::CaptureThread> capture; // optional, owns the DQBUF when set
+    GstAllocator *dmabuf_allocator;           // non-null: wrap exported dmabufs instead of mmap pointers
+    GstVideoFormat video_format;              // GST_VIDEO_FORMAT_UNKNOWN: no video meta (MJPEG)
+    guint width;
+    guint height;
+    gint64 timeout_us;                        // capture wait per acquire, negative: forever
+    std::vector<GstBuffer *> buffers;       // indexed like v4l2::FrameLease::index()
+    std::vector<v4l2::FrameLease> leases;   // lease held while buffers[i] is out of the pool
+};
+
+struct _V4L2BufferPoolClass
+{
+    GstBufferPoolClass parent_class;
+};
+
+GType v4l2_buffer_pool_get_type(void);
+
+/*
+ * Create a pool over an open, configured camera.
+ */
+GstBufferPool *v4l2_buffer_pool_new(std::shared_ptr<v4l2::V4L2Camera> camera,
+                                    GstAllocator *dmabuf_allocator,
+                                    GstVideoFormat video_format,
+                                    guint width,
+                                    guint height);
+
+/*
+ * Frame metadata for a buffer acquired from this pool, nullptr if unknown.
+ */
+const v4l2::FrameView *v4l2_buffer_pool_get_frame(V4L2BufferPool *pool, GstBuffer *buffer);
+
+/*
+ * Bytes the driver buffer behind `buffer` holds, all memory planes together; 0 if it is not one of ours.
+ */
+gsize v4l2_buffer_pool_get_capacity(V4L2BufferPool *pool, GstBuffer *buffer);
+
+/*
+ * True when the driver lays the frame out the way `info` does by default: offsets and strides downstream can
+ * assume without reading the GstVideoMeta. Compressed formats have no layout and are always default.
+ */
+gboolean v4l2_buffer_pool_has_default_layout(V4L2BufferPool *pool, const GstVideoInfo *info);
+
+/*
+ * Point the pre-built GstBuffers at the camera's buffers again, after V4L2Camera::reconnect() mapped them anew.
+ * Only with every buffer back in the pool, which reconnect() needs anyway.
+ */
+void v4l2_buffer_pool_remap(V4L2BufferPool *pool);
+
+/*
+ * Same after V4L2Camera::renegotiate(), with the video meta following the new format and size.
+ */
+void v4l2_buffer_pool_resize(V4L2BufferPool *pool, GstVideoFormat video_format, guint width, guint height);
+
+G_END_DECLS
@@ -3,11 +3,18 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wuseless-cast"
 #pragma GCC diagnostic ignored "-Wconversion"
+#include <gst/allocators/gstdmabuf.h>
 #include <gst/base/gstpushsrc.h>
+#include <gst/video/video.h>
 #include <linux/videodev2.h> // For fourcc constants
 #include <memory>
 #pragma GCC diagnostic pop
+#include "convert.hpp"
+#include "metrics.hpp"
+#include "mjpeg_decoder.hpp"
+#include "shared_frame_ring.hpp"
 #include "v4l2.hpp"
+#include <atomic> // For std::atomic
 
 G_BEGIN_DECLS
 
@@ -20,16 +27,74 @@ static_assert(static_cast<std::uint32_t>(v4l2::PixelFormat::MJPG) == V4L2_PIX_FM
 using PixelFormatEnum = v4l2::PixelFormat;
 using ResolutionEnum = v4l2::PixelDimension;
 using FPSEnum = v4l2::FPS;
+using IoModeEnum = v4l2::MemoryMode;
+using LeakyEnum = v4l2::CapturePolicy;
+
+// What create() pushes: the driver buffer itself or a converted copy of a YUYV frame
+enum class OutputFormatEnum : gint
+{
+    NATIVE = 0,
+    NV12 = 1,
+    I420 = 2,
+    GRAY8 = 3,
+    RGB = 4,
+    BGR = 5,
+};
+
+// What create() does with MJPEG frames the marker scan flags
+enum class JpegPolicyEnum : gint
+{
+    PASS = 0, // push everything, as before
+    DROP = 1, // re-queue corrupt frames unseen, the next pushed buffer is DISCONT
+    FIX = 2,  // DROP, and insert the standard Huffman tables into frames without DHT
+};
+
+// decode=true output size, the values are the libjpeg DCT scaling denominators
+enum class DecodeScaleEnum : gint
+{
+    FULL = 1,
+    HALF = 2,
+    QUARTER = 4,
+    EIGHTH = 8,
+};
 
 // Default values for properties
 constexpr auto DEFAULT_DEVICE_PATH = "/dev/video0";
 constexpr char PAD_CAPS[] =
-    "video/x-raw,format=(string)YUY2,width=(int)[1,MAX],height=(int)[1,MAX],framerate=(fraction)[0/1,MAX];"
+    "video/x-raw,format=(string){YUY2,NV12,NV16,I420,GRAY8,RGB,BGR},width=(int)[1,MAX],height=(int)[1,MAX],framerate=(fraction)[0/1,MAX];"
     "image/jpeg,width=(int)[1,MAX],height=(int)[1,MAX],framerate=(fraction)[0/1,MAX]";
 constexpr auto DEFAULT_PIXEL_FORMAT = PixelFormatEnum::MJPG;
 constexpr auto DEFAULT_RESOLUTION = ResolutionEnum::DIM_HD;
 constexpr auto DEFAULT_FPS = FPSEnum::FPS_30;
 constexpr guint DEFAULT_BUFFER_COUNT = 2u;
+constexpr auto DEFAULT_IO_MODE = IoModeEnum::MMAP;
+constexpr guint DEFAULT_CAPTURE_TIMEOUT_MS = 2000u; // 0 = wait forever
+constexpr auto DEFAULT_LEAKY = LeakyEnum::ALL;
+constexpr gboolean DEFAULT_CAPTURE_THREAD = FALSE;
+constexpr gint DEFAULT_CAPTURE_CPU = -1;     // -1 = no affinity
+constexpr gint DEFAULT_CAPTURE_PRIORITY = 0; // 0 = SCHED_OTHER, 1..99 = SCHED_FIFO
+constexpr gboolean DEFAULT_MLOCK = FALSE;
+constexpr guint DEFAULT_WIDTH = 0u;  // 0 = take it from resolution
+constexpr guint DEFAULT_HEIGHT = 0u; // 0 = take it from resolution
+constexpr gint DEFAULT_FRAMERATE_N = 0; // 0/1 = take it from fps
+constexpr gint DEFAULT_FRAMERATE_D = 1;
+constexpr auto DEFAULT_OUTPUT_FORMAT = OutputFormatEnum::NATIVE;
+constexpr auto DEFAULT_JPEG_POLICY = JpegPolicyEnum::DROP;
+constexpr gboolean DEFAULT_DECODE = FALSE;
+constexpr guint DEFAULT_DECODE_THREADS = 2u;
+constexpr auto DEFAULT_DECODE_SCALE = DecodeScaleEnum::FULL;
+constexpr guint DEFAULT_STATS_INTERVAL_MS = 0u; // 0 = no periodic stats messages
+constexpr const gchar *DEFAULT_SHM_NAME = nullptr; // nullptr = no shared memory fan-out
+constexpr guint DEFAULT_SHM_SLOTS = 4u;
+constexpr const gchar *DEFAULT_CROP = nullptr; // nullptr = the full sensor
+constexpr gboolean DEFAULT_RECONNECT = FALSE;
+constexpr guint DEFAULT_RECONNECT_TIMEOUT_MS = 0u; // 0 = wait forever
+constexpr gboolean DEFAULT_RECONNECT_GAPS = FALSE;
+constexpr gboolean DEFAULT_FRAME_SYNC = FALSE;
+constexpr gint DEFAULT_EXPOSURE = -1;      // -1 = the camera's own exposure
+constexpr gint DEFAULT_GAIN = -1;          // -1 = the camera's own gain
+constexpr gint DEFAULT_WHITE_BALANCE = -1; // -1 = the camera's own white balance
+constexpr const gchar *DEFAULT_METRICS_ADDRESS = nullptr; // nullptr = registered, not served
 
 // GObject type and casting macros
 #define GST_TYPE_V4L2SRC (v4l2src_get_type())
@@ -55,8 +120,53 @@ struct _V4L2Src
     ResolutionEnum resolution;
     FPSEnum fps;
     guint buffer_count;
-    std::unique_ptr<v4l2::V4L2Camera> camera;
-    std::uint64_t frame_number;
+    IoModeEnum io_mode;
+    guint capture_timeout_ms;
+    LeakyEnum leaky;
+    gboolean capture_thread; // DQBUF on a dedicated thread, create() pops from its ring
+    gint capture_cpu;
+    gint capture_priority;
+    gboolean mlock;
+    guint width;      // overrides resolution when both width and height are set
+    guint height;
+    gint framerate_n; // overrides fps when non-zero, fractional rates allowed
+    gint framerate_d;
+    OutputFormatEnum output_format; // anything but NATIVE converts YUYV in create()
+    JpegPolicyEnum jpeg_policy;
+    gboolean decode; // MJPEG decoded to I420 in the source, no decoder element downstream
+    guint decode_threads;
+    DecodeScaleEnum decode_scale;
+    guint stats_interval_ms;    // post the stats structure as an element message this often
+    std::uint64_t last_stats_us; // monotonic time of the last stats message
+    gchar *shm_name;             // publish every captured frame to this SharedFrameRing
+    guint shm_slots;
+    gchar *crop;                 // "left,top,width,height" sensor region, V4l2Config::crop_
+    gboolean reconnect;          // a lost device is waited for, not an error
+    guint reconnect_timeout_ms;
+    gboolean reconnect_gaps;     // GAP events downstream while waiting
+    gboolean frame_sync;         // start-of-frame times from V4L2_EVENT_FRAME_SYNC as reference timestamp meta
+    gint exposure;               // V4L2_CID_EXPOSURE_ABSOLUTE in 100 us units, auto exposure off; -1 = untouched
+    gint gain;                   // V4L2_CID_GAIN, auto gain off; -1 = untouched
+    gint white_balance;          // V4L2_CID_WHITE_BALANCE_TEMPERATURE in K, auto white balance off; -1 = untouched
+    GstStructure *extra_controls; // any control by its name in lower case, '_' for the rest ("sharpness=3")
+    std::atomic<bool> controls_pending; // the four above changed, create() sets them before the next frame
+    gchar *metrics_address;             // serve every registered camera's metrics here, MetricsExporterConfig::listen_
+    GstAllocator *dmabuf_allocator;
+    GstBufferPool *pool;                      // V4L2BufferPool over the camera's driver buffers
+    gboolean copy_frames;                     // downstream cannot take `pool` as is, create() copies into a plain pool
+    GstVideoInfo copy_info;                   // default layout of the copies, raw formats only
+    std::shared_ptr<v4l2::V4L2Camera> camera; // shared with the pool, outlives buffers still downstream
+    std::shared_ptr<v4l2::MjpegDecoder> decoder; // decode=true only, shared with the decoded buffers downstream
+    std::unique_ptr<v4l2::SharedFrameRing> shm_ring; // shm-name set only, streaming thread publishes
+    std::shared_ptr<v4l2::MetricsExporter> metrics_exporter; // metrics-address set only, shared by elements with the same one
+    gchar *metrics_name;          // what the camera is registered as in MetricsRegistry::global(), see metrics_key()
+    std::uint64_t frame_number;   // driver sequence of the last pushed frame, unwrapped to 64 bits
+    std::uint32_t last_sequence;  // raw driver sequence of the last pushed frame
+    bool have_sequence;           // false until the first frame after start()
+    std::uint64_t pushed_frames;  // processed count for QoS messages
+    bool discont;                 // the next pushed buffer follows a reconnect or a source change
+    GstClockTime latency_min;     // what the LATENCY query answers, under the object lock: the streaming
+    GstClockTime latency_max;     // thread changes the camera config, GST_CLOCK_TIME_NONE while unknown
 };
 
 struct _V4L2SrcClass
@@ -66,6 +176,14 @@ struct _V4L2SrcClass
 
 GType v4l2src_get_type(void);
 
+// Shared with v4l2-batch-src
+GType v4l2src_pixel_format_get_type(void);
+GstVideoFormat to_gst_video_format(PixelFormatEnum fmt);
+// PTS of a frame: its driver timestamp as running time of `element`, GST_CLOCK_TIME_NONE without a clock
+GstClockTime running_time_pts(GstElement *element, const v4l2::FrameView &view);
+// "<object path>@<address>", what a camera is registered as in MetricsRegistry::global(); g_free() it
+gchar *metrics_key(GstObject *object);
+
 // Plugin entry point
 gboolean plugin_init(GstPlugin *plugin);
 
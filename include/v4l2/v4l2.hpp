@@ -1,19 +1,72 @@
 #pragma once
+#include "backend.hpp"
 #include "definitions.hpp"
 #include "exception-rt/exception.hpp" // For exception
+#include "latency_histogram.hpp"
+#include "metrics.hpp"
+#include "negotiation_cache.hpp"
+#include <array>                      // For std::array
+#include <atomic>                     // For std::atomic
+#include <chrono>                     // For std::chrono::microseconds
 #include <cstdint>                    // For uint64_t, uint32_t, uint8_t
+#include <functional>                 // For std::function
 #include <memory>                     // For std::unique_ptr
 #include <optional>                   // For std::optional
 #include <span>                       // For std::span
 #include <string>                     // For std::string
+#include <utility>                    // For std::pair
 #include <vector>                     // For std::vector
 
 namespace v4l2
 {
+    class V4L2Camera;
+
+    /*
+     * Move-only handle to one dequeued driver buffer.
+     * The buffer is re-queued (VIDIOC_QBUF) when the lease is released or destroyed,
+     * so several leases can be held at once, up to the configured buffer count.
+     * A lease must not outlive the camera that issued it.
+     */
+    class [[nodiscard]] FrameLease final
+    {
+    public:
+        FrameLease() noexcept = default;
+        ~FrameLease() noexcept;
+
+        // No copy semantics
+        FrameLease(const FrameLease &) = delete;
+        FrameLease &operator=(const FrameLease &) = delete;
+        // Move semantics
+        FrameLease(FrameLease &&other) noexcept;
+        FrameLease &operator=(FrameLease &&other) noexcept;
+
+        [[nodiscard]] const FrameView &view() const noexcept { return view_; }
+        [[nodiscard]] const FrameView *operator->() const noexcept { return &view_; }
+        [[nodiscard]] std::uint32_t index() const noexcept { return index_; }
+        [[nodiscard]] bool valid() const noexcept { return camera_ != nullptr; }
+        explicit operator bool() const noexcept { return valid(); }
+
+        /*
+         * Re-queue the buffer now instead of on destruction.
+         * Throws std::runtime_error on failure.
+         */
+        void release();
+
+    private:
+        friend class V4L2Camera;
+        FrameLease(V4L2Camera *camera, std::uint32_t index, const FrameView &view) noexcept;
+
+        V4L2Camera *camera_{};
+        std::uint32_t index_{};
+        FrameView view_{};
+    };
+
     class [[nodiscard]] V4L2Camera final
     {
     public:
         using Buffer = std::span<uint8_t>;
+        // Runs on the thread that captures, from inside try_capture_frame(): keep it short, do not throw
+        using EventCallback = std::function<void(const CameraEvent &event)>;
 
         explicit V4L2Camera(const V4l2Config &config);
         ~V4L2Camera() noexcept;
@@ -21,7 +74,7 @@ namespace v4l2
         // No copy semantics
         V4L2Camera(const V4L2Camera &) = delete;
         V4L2Camera &operator=(const V4L2Camera &) = delete;
-        // Move semantics
+        // Move semantics, only with no frame leased out: a FrameLease keeps a pointer to its camera (asserted)
         V4L2Camera(V4L2Camera &&) noexcept;
         V4L2Camera &operator=(V4L2Camera &&) noexcept;
 
@@ -35,8 +88,12 @@ namespace v4l2
          * Throws std::runtime_error on failure.
          */
 
-        [[nodiscard]] bool try_soe() noexcept;
         void configure();
+        /*
+         * Ask the driver to timestamp at start of exposure instead of end of frame, call after open_device().
+         * Returns false if the driver has no V4L2_CID_TIMESTAMP_SOURCE control or refuses SOE.
+         */
+        [[nodiscard]] bool try_soe() noexcept;
         /*
          * Start streaming.
          * Throws std::runtime_error on failure.
@@ -45,30 +102,273 @@ namespace v4l2
 
         /*
          * Capture a frame.
-         * Returns a FrameView that holds a span into the internal buffer.
+         * Returns a FrameLease whose view holds a span into the internal buffer;
+         * the buffer goes back to the driver when the lease is destroyed.
+         * Throws std::runtime_error on failure or when every buffer is already leased.
+         */
+        [[nodiscard]] FrameLease capture_frame();
+
+        /*
+         * Capture a frame, waiting at most `timeout` (negative: forever) in poll().
+         * Returns std::nullopt on timeout or when interrupt() was called.
+         * With CapturePolicy::LATEST every ready frame is dequeued and only the newest is returned.
+         * Throws std::runtime_error on failure, e.g. when the device is unplugged.
+         */
+        [[nodiscard]] std::optional<FrameLease> try_capture_frame(std::chrono::microseconds timeout);
+
+        /*
+         * Wait until at least one buffer is not leased, at most `timeout` (negative: forever).
+         * Returns false on timeout or when interrupt() was called.
          * Throws std::runtime_error on failure.
          */
-        [[nodiscard]] FrameView capture_frame();
+        [[nodiscard]] bool wait_for_free_buffer(std::chrono::microseconds timeout);
 
         /*
-         * Release the frame back to the driver.
+         * Wait until no buffer is leased any more, at most `timeout` (negative: forever), e.g. before the buffers are
+         * reallocated. Returns false on timeout or when interrupt() was called.
          * Throws std::runtime_error on failure.
          */
-        void release_frame();
+        [[nodiscard]] bool wait_for_all_released(std::chrono::microseconds timeout);
+
+        /*
+         * Wake up a pending try_capture_frame(), wait_for_free_buffer() or wait_for_all_released() from any thread.
+         * Stays signalled, every capture returns early, until clear_interrupt().
+         */
+        void interrupt() noexcept;
+        void clear_interrupt() noexcept;
+
+        /*
+         * True once the device went away under us: poll() reported POLLERR/POLLHUP or DQBUF/QBUF failed with ENODEV.
+         * Cleared by reconnect(). Safe to read from any thread.
+         */
+        [[nodiscard]] bool device_lost() const noexcept;
+
+        /*
+         * Wait for the device to come back, at most `timeout` (negative: forever), then open, configure and start it
+         * again in the mode it had. The wait is an inotify watch on the directory of the device path, so a
+         * /dev/v4l/by-id link is picked up as soon as udev creates it; /dev/videoN may come back under another number.
+         * Returns false on timeout or when interrupt() was called, call again to keep waiting.
+         * Every lease must be back first: the buffers are mapped anew, earlier FrameViews and buffers() are gone.
+         * Capture counters carry on, the driver sequence starts over.
+         * Throws std::runtime_error while frames are leased, or when the device comes back in another mode.
+         */
+        [[nodiscard]] bool reconnect(std::chrono::microseconds timeout);
+
+        /*
+         * Subscribe to a V4L2 event (VIDIOC_SUBSCRIBE_EVENT), `id` is the control for CameraEventType::CTRL.
+         * Events come in through the same poll() as the frames (POLLPRI) and go to the event callback;
+         * a FRAME_SYNC also stamps FrameView::frame_sync_us of the buffer with its sequence.
+         * A SOURCE_CHANGE of the resolution makes try_capture_frame() throw with source_changed() set, see renegotiate().
+         * Subscriptions are kept across reconnect(). Call after open_device().
+         * Returns false if the driver does not offer the event. Throws std::runtime_error if the device is not open.
+         */
+        [[nodiscard]] bool subscribe_event(CameraEventType type, std::uint32_t id = 0);
+        void set_event_callback(EventCallback callback);
+
+        /*
+         * True once the driver reported a new resolution (V4L2_EVENT_SOURCE_CHANGE), cleared by renegotiate().
+         * Safe to read from any thread.
+         */
+        [[nodiscard]] bool source_changed() const noexcept;
+
+        /*
+         * Follow a source change without closing the device: stop streaming, release the buffers, take the
+         * new DV timings and the format the driver reports now, then configure and start again in it.
+         * config().dimension_ is the new size afterwards. Faster than a reconnect(), the fd and subscriptions stay.
+         * Every lease must be back first: the buffers are mapped anew. Capture counters carry on.
+         * Throws std::runtime_error while frames are leased or when the new mode cannot be configured.
+         */
+        void renegotiate();
+
+        /*
+         * The device fd, opened O_NONBLOCK. Poll it for POLLIN in your own event loop,
+         * then call try_capture_frame(0us).
+         */
+        [[nodiscard]] int fd() const noexcept;
+
+        /*
+         * Eventfd that turns readable when a release leaves the all-leased state, and when the last lease comes back
+         * during wait_for_all_released(). Poll it, instead of fd(), while every buffer is leased; read it empty before
+         * checking outstanding_frames() again.
+         */
+        [[nodiscard]] int free_fd() const noexcept;
 
         void stop_streaming();
         V4lCaps get_caps() const noexcept;
 
-        [[nodiscard]] bool has_valid_frame() const noexcept;
+        /*
+         * Every format, frame size and frame rate the device offers
+         * (VIDIOC_ENUM_FMT / ENUM_FRAMESIZES / ENUM_FRAMEINTERVALS).
+         * Cached per device path, `refresh` re-queries the driver.
+         * Stepwise and continuous ranges are reported by their end points.
+         * Throws std::runtime_error if the device is not open.
+         */
+        [[nodiscard]] std::vector<CaptureMode> enumerate_modes(bool refresh = false);
+
+        /*
+         * What enumerate_modes() found for `device_path` so far, without touching the device.
+         */
+        [[nodiscard]] static std::optional<std::vector<CaptureMode>> cached_modes(const std::string &device_path);
+
+        /*
+         * The controls the device offers, by id, enumerated once by open_device(). Disabled, class and compound
+         * controls are left out.
+         */
+        [[nodiscard]] const std::vector<ControlInfo> &controls() const noexcept;
+        [[nodiscard]] const ControlInfo *find_control(std::uint32_t id) const noexcept;
+
+        /*
+         * Set every control in `values` with one VIDIOC_S_EXT_CTRLS, all or none as far as the driver allows.
+         * Values are clamped to the control's range and rounded to its step first, from the cached map, no query.
+         * Any thread, also while streaming: the driver applies them to the next frame it starts.
+         * Throws std::invalid_argument for a control the device does not have or cannot set,
+         * std::runtime_error when the driver refuses (the message names the control).
+         */
+        void set_controls(std::span<const ControlValue> values);
+
+        /*
+         * Current values of `ids`, one VIDIOC_G_EXT_CTRLS. Throws like set_controls().
+         */
+        [[nodiscard]] std::vector<ControlValue> get_controls(std::span<const std::uint32_t> ids);
+
+        /*
+         * Number of leases currently held by callers.
+         */
+        [[nodiscard]] std::uint32_t outstanding_frames() const noexcept;
+
+        /*
+         * Capture counters, safe to read from any thread.
+         * Sequence gaps are tracked on every dequeue, frames skipped on purpose
+         * by CapturePolicy::LATEST count as dropped, not lost.
+         */
+        [[nodiscard]] CaptureStats stats() const noexcept;
+
+        /*
+         * Per-stage latency percentiles since configure(), lock-free and safe to read from any thread.
+         */
+        [[nodiscard]] LatencyStats latency() const noexcept;
+
+        /*
+         * Live counters for export, never reset, shared so a MetricsRegistry can outlive the camera's interest.
+         * Null on a moved-from camera.
+         */
+        [[nodiscard]] std::shared_ptr<const CameraMetrics> metrics() const noexcept;
+
+        /*
+         * Mark `frame` as handed to its consumer (v4l2-src calls this when it pushes the buffer),
+         * feeds LatencyStats::dqbuf_to_handoff. Any thread.
+         */
+        void record_handoff(const FrameView &frame) noexcept;
+
+        /*
+         * The mapped driver buffers, indexed like FrameLease::index().
+         * Valid after configure().
+         */
+        [[nodiscard]] std::span<const MappedBuffer> buffers() const noexcept;
+
+        /*
+         * The active configuration, updated with what the driver accepted in configure().
+         */
+        [[nodiscard]] const V4l2Config &config() const noexcept;
+
+        /*
+         * Row stride the driver picked in configure(), 0 for compressed formats.
+         */
+        [[nodiscard]] std::uint32_t bytes_per_line() const noexcept;
+
+        /*
+         * Where each color plane of a frame lives: 1 entry for MJPG and YUYV, Y and CbCr for the NV formats.
+         * Valid after configure().
+         */
+        [[nodiscard]] std::span<const PlaneLayout> plane_layout() const noexcept;
+
+        /*
+         * True when open_device() found only the multi-planar API (V4L2_CAP_VIDEO_CAPTURE_MPLANE),
+         * as MIPI CSI receivers and ISPs have it. The camera works the same either way.
+         */
+        [[nodiscard]] bool multiplanar() const noexcept;
 
     private:
+        friend class FrameLease;
+
+        // what S_FMT or G_FMT said, from pix or pix_mp
+        struct FormatInfo
+        {
+            std::uint32_t width = 0;
+            std::uint32_t height = 0;
+            std::uint32_t fourcc = 0;
+            std::uint32_t memory_planes = 1;
+            std::array<std::uint32_t, MAX_PLANES> bytes_per_line{};
+        };
+
+        /*
+         * Re-queue buffer `index` to the driver, `dequeued_us` (its DQBUF time) feeds the hold-time histogram.
+         * Throws std::runtime_error on failure.
+         */
+        void release_frame(std::uint32_t index, std::uint64_t dequeued_us);
+        // wait_for_free_buffer() and wait_for_all_released(): until fewer than `limit` buffers are leased
+        [[nodiscard]] bool wait_for_leases_below(std::uint32_t limit, std::chrono::microseconds timeout);
+        void queue_buffer(std::uint32_t index);
+        [[nodiscard]] std::optional<FrameLease> dequeue_frame();
+        [[nodiscard]] FrameLease keep_latest(FrameLease lease);
         void cleanup() noexcept;
+        void unmap_buffers() noexcept;
+        void restore_counters(const CaptureStats &kept) noexcept;
+        void drain_events();
+        [[nodiscard]] bool subscribe(CameraEventType type, std::uint32_t id) noexcept;
+        void enumerate_controls();
+        void store_cache() noexcept;
+        [[nodiscard]] bool try_reopen(const V4l2Config &before);
+        [[nodiscard]] FormatInfo format_info(const v4l2_format &fmt) const noexcept;
+        // fills layout_ for the negotiated format, throws std::runtime_error if the driver split it unexpectedly
+        void set_layout(const FormatInfo &format);
+        // v4l2_buffer of buf_type_, pointing at `planes` with the multi-planar API
+        [[nodiscard]] v4l2_buffer make_buffer(std::array<v4l2_plane, VIDEO_MAX_PLANES> &planes) const noexcept;
 
     private:
         V4l2Config config_;
-        int fd_;
+        std::unique_ptr<CaptureBackend> backend_; // the device node, or a recording played back
+        int wake_fd_; // eventfd, signalled by interrupt()
+        int free_fd_; // eventfd, signalled when a release leaves the all-leased state or returns the last lease to a waiter
         bool configured_;
-        std::optional<uint32_t> last_buf_index_;
+        std::uint32_t bytes_per_line_; // row stride the driver picked, 0 for compressed formats
+        std::uint32_t buf_type_;       // V4L2_BUF_TYPE_VIDEO_CAPTURE, or _MPLANE when that is all the device has
+        std::uint32_t memory_planes_;  // v4l2_plane entries per buffer with the multi-planar API
+        std::array<PlaneLayout, MAX_PLANES> layout_{};
+        std::uint32_t plane_count_; // color planes in layout_
+        std::atomic<std::uint32_t> outstanding_;
+        std::atomic<std::uint64_t> dropped_frames_;
+        std::atomic<std::uint64_t> sequence_gaps_;
+        std::atomic<std::uint64_t> lost_frames_;
+        std::atomic<std::uint64_t> errored_buffers_;
+        std::atomic<std::uint64_t> corrupt_frames_;
+        std::atomic<std::uint64_t> reconnects_;
+        std::atomic<std::uint64_t> renegotiations_;
+        std::atomic<bool> lost_;           // see device_lost()
+        std::atomic<bool> source_changed_; // see source_changed()
+        std::atomic<bool> draining_;       // wait_for_all_released() is waiting, the last release signals free_fd_
+        std::vector<std::pair<CameraEventType, std::uint32_t>> subscriptions_; // re-applied by open_device()
+        EventCallback on_event_;
+        struct FrameSync
+        {
+            std::uint32_t sequence{};
+            std::uint64_t timestamp_us{}; // 0: no event for this slot yet
+        };
+        std::array<FrameSync, 8> frame_syncs_{}; // by sequence modulo size, a few frames of slack between event and DQBUF
+        std::optional<std::uint32_t> last_sequence_; // last dequeued driver sequence, capture thread only
+        std::atomic<std::uint64_t> opened_us_;       // monotonic time open_device() started
+        std::atomic<std::uint64_t> first_frame_us_;  // monotonic time of the first DQBUF, 0 before
+        std::string cache_key_;                      // negotiation_key(), V4l2Config::cache_dir_ set only
+        std::optional<NegotiationRecord> cached_;    // what the disk cache had for this camera
+        struct LatencyHistograms
+        {
+            LatencyHistogram driver_to_dqbuf;
+            LatencyHistogram dqbuf_to_handoff;
+            LatencyHistogram dqbuf_to_qbuf;
+        };
+        std::unique_ptr<LatencyHistograms> latency_; // on the heap so the camera stays movable
+        std::shared_ptr<CameraMetrics> metrics_;      // see metrics()
+        std::vector<ControlInfo> controls_; // sorted by id, see controls()
         std::vector<MappedBuffer> buffers_;
         V4lCaps caps_;
     };
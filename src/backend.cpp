@@ -0,0 +1,57 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "v4l2/backend.hpp"
+#include "v4l2/replay_backend.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    DeviceBackend::DeviceBackend(const std::string &device_path)
+    {
+        // non-blocking: DQBUF never parks the caller, waiting is done in poll()
+        fd_ = open(device_path.c_str(), O_RDWR | O_NONBLOCK);
+        if (fd_ < 0)
+        {
+            if (errno == EBUSY)
+            {
+                V4L2_TRACE(WARN, "device already in use: {}", device_path);
+            }
+            auto const msg = fmt::format("Failed to open device: {}\n", strerror(errno));
+            throw std::runtime_error(msg);
+        }
+    }
+
+    DeviceBackend::~DeviceBackend() noexcept
+    {
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+    }
+
+    int DeviceBackend::ioctl(unsigned long request, void *arg) noexcept
+    {
+        return ::ioctl(fd_, request, arg);
+    }
+
+    void *DeviceBackend::map(std::size_t length, int prot, off_t offset) noexcept
+    {
+        return mmap(nullptr, length, prot, MAP_SHARED, fd_, offset);
+    }
+
+    std::unique_ptr<CaptureBackend> open_backend(const std::string &device_path)
+    {
+        if (device_path.starts_with("replay://"))
+        {
+            return std::make_unique<ReplayBackend>(parse_replay_uri(device_path));
+        }
+        return std::make_unique<DeviceBackend>(device_path);
+    }
+} // namespace v4l2
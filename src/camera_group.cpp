@@ -0,0 +1,364 @@
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <fmt/core.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "v4l2/camera_group.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    // 🚀 one thread per camera: the open() and configure ioctls of one device never wait for another's;
+    // every camera runs to the end, the first failure by index is rethrown
+    template <typename Fn>
+    static void for_each_parallel(std::vector<std::unique_ptr<V4L2Camera>> &cameras, Fn &&fn)
+    {
+        std::vector<std::exception_ptr> errors(cameras.size());
+        auto run = [&](std::size_t i)
+        {
+            try
+            {
+                fn(i, *cameras[i]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        };
+        if (cameras.size() == 1)
+        {
+            run(0);
+        }
+        else
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(cameras.size());
+            for (std::size_t i = 0; i < cameras.size(); ++i)
+            {
+                workers.emplace_back(run, i);
+            }
+        } // joined here
+        for (auto const &error : errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    CameraGroup::CameraGroup(const CameraGroupConfig &config)
+        : config_(config),
+          epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+          wake_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+          opened_(false)
+    {
+        if (epoll_fd_ < 0 || wake_fd_ < 0)
+        {
+            auto const msg = fmt::format("CameraGroup: epoll/eventfd setup failed: {}", strerror(errno));
+            if (epoll_fd_ >= 0)
+            {
+                close(epoll_fd_);
+            }
+            if (wake_fd_ >= 0)
+            {
+                close(wake_fd_);
+            }
+            throw std::runtime_error(msg);
+        }
+    }
+
+    CameraGroup::~CameraGroup() noexcept
+    {
+        stop();
+        close(epoll_fd_);
+        close(wake_fd_);
+    }
+
+    std::size_t CameraGroup::add_camera(const V4l2Config &config)
+    {
+        if (running())
+        {
+            throw std::logic_error("CameraGroup: cannot add cameras while running");
+        }
+        cameras_.push_back(std::make_unique<V4L2Camera>(config));
+        requested_.push_back(config);
+        plan_.clear();
+        opened_ = false;
+        return cameras_.size() - 1;
+    }
+
+    void CameraGroup::plan_bandwidth()
+    {
+        std::vector<BandwidthRequest> requests(cameras_.size());
+        for_each_parallel(cameras_, [&](std::size_t i, V4L2Camera &cam)
+                          {
+                              if (cam.fd() < 0)
+                              {
+                                  cam.open_device();
+                              }
+                              requests[i] = BandwidthRequest{.config = requested_[i],
+                                                             .modes = cam.enumerate_modes(),
+                                                             .topology = usb_topology(requested_[i].device_path_, cam.get_caps().bus_info)}; });
+        plan_ = plan_usb_bandwidth(requests, *config_.bandwidth_);
+
+        for (std::size_t i = 0; i < cameras_.size(); ++i)
+        {
+            auto const &plan = plan_[i];
+            auto const [w, h] = dimensions_decompress(static_cast<std::uint32_t>(plan.config.dimension_));
+            V4L2_TRACE(INFO, "camera {} ({}): {}x{} {:08X} at {}/{} fps, {:.1f} MB/s{}", i, plan.config.device_path_, w, h,
+                       static_cast<std::uint32_t>(plan.config.format_), static_cast<std::uint32_t>(plan.config.fps_num_),
+                       plan.config.fps_den_, static_cast<double>(plan.bytes_per_second) / 1e6, plan.downgraded ? ", lowered to fit its bus" : "");
+
+            // reopened with the planned mode by open_all(), modes are cached so this costs one open()
+            auto const &current = cameras_[i]->config();
+            if (current.format_ != plan.config.format_ || current.dimension_ != plan.config.dimension_ ||
+                current.fps_num_ != plan.config.fps_num_ || current.fps_den_ != plan.config.fps_den_)
+            {
+                *cameras_[i] = V4L2Camera(plan.config);
+            }
+        }
+    }
+
+    void CameraGroup::open_all()
+    {
+        if (config_.bandwidth_ && plan_.size() != cameras_.size())
+        {
+            plan_bandwidth(); // once, a second open_all() keeps the modes the drivers settled on
+        }
+        for_each_parallel(cameras_, [](std::size_t, V4L2Camera &cam)
+                          {
+                              if (cam.fd() < 0)
+                              {
+                                  cam.open_device();
+                              }
+                              cam.configure(); });
+        opened_ = true;
+    }
+
+    void CameraGroup::start(FrameCallback on_frame, ErrorCallback on_error)
+    {
+        if (running())
+        {
+            return;
+        }
+        if (!opened_)
+        {
+            open_all();
+        }
+
+        std::size_t started = 0;
+        try
+        {
+            for (; started < cameras_.size(); ++started)
+            {
+                cameras_[started]->start_streaming();
+            }
+        }
+        catch (...)
+        {
+            stop_streaming(started);
+            throw;
+        }
+
+        // two level-triggered registrations per camera: its fd as data.u64 = i, and its free_fd() as
+        // data.u64 = size + 1 + i, which re-arms the fd once a lease comes back; size is the wake fd
+        for (std::size_t i = 0; i < cameras_.size(); ++i)
+        {
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLPRI; // POLLPRI: a subscribed V4L2 event, try_capture_frame() takes it
+            ev.data.u64 = i;
+            epoll_event free{};
+            free.events = EPOLLIN;
+            free.data.u64 = cameras_.size() + 1 + i;
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, cameras_[i]->fd(), &ev) < 0 ||
+                epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, cameras_[i]->free_fd(), &free) < 0)
+            {
+                auto const msg = fmt::format("CameraGroup: epoll_ctl failed for camera {}: {}", i, strerror(errno));
+                for (std::size_t j = 0; j <= i; ++j)
+                {
+                    unwatch(j);
+                }
+                stop_streaming(cameras_.size());
+                throw std::runtime_error(msg);
+            }
+        }
+        epoll_event wake{};
+        wake.events = EPOLLIN;
+        wake.data.u64 = cameras_.size();
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake);
+
+        on_frame_ = std::move(on_frame);
+        on_error_ = std::move(on_error);
+        loop_ = std::jthread([this](std::stop_token stop)
+                             { run(stop); });
+    }
+
+    void CameraGroup::stop() noexcept
+    {
+        if (!loop_.joinable())
+        {
+            return;
+        }
+
+        loop_.request_stop();
+        const std::uint64_t one = 1;
+        [[maybe_unused]] auto const written = write(wake_fd_, &one, sizeof(one));
+        loop_.join();
+
+        std::uint64_t count = 0;
+        [[maybe_unused]] auto const consumed = read(wake_fd_, &count, sizeof(count));
+        for (std::size_t i = 0; i < cameras_.size(); ++i)
+        {
+            unwatch(i);
+        }
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, wake_fd_, nullptr);
+
+        stop_streaming(cameras_.size());
+    }
+
+    void CameraGroup::stop_streaming(std::size_t count) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            try
+            {
+                cameras_[i]->stop_streaming();
+            }
+            catch (const std::exception &e)
+            {
+                V4L2_TRACE(WARN, "CameraGroup: stop_streaming failed for camera {}: {}", i, e.what());
+            }
+        }
+    }
+
+    void CameraGroup::watch(std::size_t index, bool armed) noexcept
+    {
+        epoll_event ev{};
+        ev.events = armed ? (EPOLLIN | EPOLLPRI) : 0;
+        ev.data.u64 = index;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, cameras_[index]->fd(), &ev);
+    }
+
+    void CameraGroup::unwatch(std::size_t index) noexcept
+    {
+        // ENOENT for a camera that was never added or already dropped, nothing to undo
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, cameras_[index]->fd(), nullptr);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, cameras_[index]->free_fd(), nullptr);
+    }
+
+    void CameraGroup::run(std::stop_token stop) noexcept
+    {
+        if (config_.loop_cpu_)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(*config_.loop_cpu_, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            {
+                V4L2_TRACE(WARN, "CameraGroup: cannot pin loop to CPU {}", *config_.loop_cpu_);
+            }
+        }
+
+        std::array<epoll_event, 16> events{};
+        while (!stop.stop_requested())
+        {
+            const int ready = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), -1);
+            if (ready < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                V4L2_TRACE(WARN, "CameraGroup: epoll_wait failed: {}", strerror(errno));
+                return;
+            }
+
+            for (int e = 0; e < ready; ++e)
+            {
+                const std::size_t index = events[static_cast<std::size_t>(e)].data.u64;
+                if (index == cameras_.size())
+                {
+                    continue; // wake_fd_, the loop condition decides
+                }
+                if (index > cameras_.size())
+                {
+                    // a lease came back: take the camera's fd in again
+                    auto const owner = index - cameras_.size() - 1;
+                    auto &cam = *cameras_[owner];
+                    std::uint64_t count = 0;
+                    [[maybe_unused]] auto const consumed = read(cam.free_fd(), &count, sizeof(count));
+                    if (cam.outstanding_frames() < cam.buffers().size())
+                    {
+                        watch(owner, true);
+                    }
+                    continue;
+                }
+
+                auto &cam = *cameras_[index];
+                try
+                {
+                    // drain what the driver had queued when epoll woke us, no more: a callback that hands the
+                    // lease straight back refills the queue as fast as we drain it, and level-triggered epoll
+                    // brings us back for the rest after the other cameras had their turn
+                    const std::size_t queued = cam.buffers().size() - cam.outstanding_frames();
+                    for (std::size_t taken = 0; taken < queued && cam.outstanding_frames() < cam.buffers().size(); ++taken)
+                    {
+                        auto lease = cam.try_capture_frame(std::chrono::microseconds{0});
+                        if (!lease)
+                        {
+                            break;
+                        }
+                        on_frame_(index, std::move(*lease));
+                    }
+                    if (cam.outstanding_frames() >= cam.buffers().size())
+                    {
+                        // 💤 every buffer is leased: a level-triggered fd that stays readable (a replay at max
+                        // rate, a pending V4L2 event) would spin us, so wait for free_fd() to re-arm it.
+                        // A release racing this signals free_fd() after our check and re-arms it right away
+                        watch(index, false);
+                    }
+                }
+                catch (const std::exception &error)
+                {
+                    unwatch(index);
+                    if (on_error_)
+                    {
+                        on_error_(index, error);
+                    }
+                    else
+                    {
+                        V4L2_TRACE(WARN, "CameraGroup: camera {} dropped: {}", index, error.what());
+                    }
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] const std::vector<BandwidthPlan> &CameraGroup::bandwidth_plan() const noexcept
+    {
+        return plan_;
+    }
+
+    [[nodiscard]] V4L2Camera &CameraGroup::camera(std::size_t index)
+    {
+        return *cameras_.at(index);
+    }
+
+    [[nodiscard]] std::size_t CameraGroup::size() const noexcept
+    {
+        return cameras_.size();
+    }
+
+    [[nodiscard]] bool CameraGroup::running() const noexcept
+    {
+        return loop_.joinable();
+    }
+} // namespace v4l2
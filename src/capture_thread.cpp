@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fmt/core.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "v4l2/capture_thread.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    CaptureThread::CaptureThread(V4L2Camera &camera, const CaptureThreadConfig &config)
+        : camera_(camera),
+          config_(config),
+          ring_(camera.config().buffer_count_), // never more leases than driver buffers
+          ready_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+          wake_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+          failed_(false)
+    {
+        if (ready_fd_ < 0 || wake_fd_ < 0)
+        {
+            auto const msg = fmt::format("CaptureThread: eventfd failed: {}", strerror(errno));
+            if (ready_fd_ >= 0)
+            {
+                close(ready_fd_);
+            }
+            if (wake_fd_ >= 0)
+            {
+                close(wake_fd_);
+            }
+            throw std::runtime_error(msg);
+        }
+    }
+
+    CaptureThread::~CaptureThread() noexcept
+    {
+        stop();
+        close(ready_fd_);
+        close(wake_fd_);
+    }
+
+    void CaptureThread::start()
+    {
+        if (running())
+        {
+            return;
+        }
+        if (camera_.buffers().empty())
+        {
+            throw std::runtime_error("CaptureThread: camera is not configured");
+        }
+
+        if (config_.mlock_all_ && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            V4L2_TRACE(WARN, "CaptureThread: mlockall failed: {}", strerror(errno));
+        }
+
+        failed_.store(false, std::memory_order_relaxed);
+        thread_ = std::jthread([this](std::stop_token stop)
+                               { run(stop); });
+    }
+
+    void CaptureThread::stop() noexcept
+    {
+        if (!thread_.joinable())
+        {
+            return;
+        }
+
+        thread_.request_stop();
+        camera_.interrupt(); // wakes the capture thread out of poll()
+        thread_.join();
+        camera_.clear_interrupt();
+
+        // 🧹 frames nobody popped go back to the driver
+        while (auto lease = ring_.pop())
+        {
+        }
+        std::uint64_t count = 0;
+        [[maybe_unused]] auto const consumed = read(ready_fd_, &count, sizeof(count));
+    }
+
+    [[nodiscard]] std::optional<FrameLease> CaptureThread::pop(std::chrono::microseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true)
+        {
+            if (auto lease = ring_.pop())
+            {
+                return lease;
+            }
+            if (failed_.load(std::memory_order_acquire))
+            {
+                throw std::runtime_error(fmt::format("capture thread failed: {}", error_));
+            }
+
+            // drain, then look again: a push after the drain signals again, so the poll cannot miss it
+            std::uint64_t count = 0;
+            [[maybe_unused]] auto const consumed = read(ready_fd_, &count, sizeof(count));
+            if (auto lease = ring_.pop())
+            {
+                return lease;
+            }
+
+            std::array<pollfd, 2> fds{{{.fd = ready_fd_, .events = POLLIN, .revents = 0},
+                                       {.fd = wake_fd_, .events = POLLIN, .revents = 0}}};
+            timespec ts{};
+            timespec *ts_ptr = nullptr;
+            if (timeout.count() >= 0)
+            {
+                auto const left = std::max(std::chrono::nanoseconds{0}, deadline - std::chrono::steady_clock::now());
+                ts.tv_sec = left.count() / 1'000'000'000;
+                ts.tv_nsec = left.count() % 1'000'000'000;
+                ts_ptr = &ts;
+            }
+
+            const int ready = ppoll(fds.data(), fds.size(), ts_ptr, nullptr);
+            if (ready < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error(fmt::format("CaptureThread: poll failed: {}", strerror(errno)));
+            }
+            if (ready == 0 || (fds[1].revents & POLLIN))
+            {
+                return std::nullopt; // ⏱ timed out or 🛑 interrupt()
+            }
+        }
+    }
+
+    void CaptureThread::interrupt() noexcept
+    {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] auto const written = write(wake_fd_, &one, sizeof(one));
+    }
+
+    void CaptureThread::clear_interrupt() noexcept
+    {
+        std::uint64_t count = 0;
+        [[maybe_unused]] auto const consumed = read(wake_fd_, &count, sizeof(count));
+    }
+
+    [[nodiscard]] bool CaptureThread::running() const noexcept
+    {
+        return thread_.joinable();
+    }
+
+    void CaptureThread::apply_realtime() const noexcept
+    {
+        if (config_.cpu_)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(*config_.cpu_, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            {
+                V4L2_TRACE(WARN, "CaptureThread: cannot pin capture thread to CPU {}", *config_.cpu_);
+            }
+        }
+        if (config_.fifo_priority_ > 0)
+        {
+            sched_param param{};
+            param.sched_priority = config_.fifo_priority_;
+            if (const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0)
+            {
+                V4L2_TRACE(WARN, "CaptureThread: SCHED_FIFO priority {} refused: {} (needs CAP_SYS_NICE or rtprio limits)",
+                           config_.fifo_priority_, strerror(err));
+            }
+        }
+    }
+
+    void CaptureThread::run(std::stop_token stop) noexcept
+    {
+        apply_realtime();
+
+        const std::uint64_t one = 1;
+        while (!stop.stop_requested())
+        {
+            try
+            {
+                // every buffer may sit in the ring or with the consumer, wait for one to come back
+                if (!camera_.wait_for_free_buffer(std::chrono::microseconds{-1}))
+                {
+                    continue; // interrupted, the loop condition decides
+                }
+                auto lease = camera_.try_capture_frame(std::chrono::microseconds{-1});
+                if (!lease)
+                {
+                    continue;
+                }
+                // cannot be full: the ring holds buffer_count_ leases, a full ring means no free buffer
+                if (ring_.push(*lease))
+                {
+                    [[maybe_unused]] auto const written = write(ready_fd_, &one, sizeof(one));
+                }
+            }
+            catch (const std::exception &e)
+            {
+                error_ = e.what();
+                failed_.store(true, std::memory_order_release);
+                [[maybe_unused]] auto const written = write(ready_fd_, &one, sizeof(one));
+                return;
+            }
+        }
+    }
+} // namespace v4l2
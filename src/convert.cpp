@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <array>
+#include <fmt/core.h>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define V4L2_CONVERT_AVX2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define V4L2_CONVERT_NEON 1
+#endif
+
+#include "v4l2/convert.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        // 🎨 BT.601 limited range in Q6 fixed point, sized so every product fits int16
+        constexpr int COEF_Y = 75;   // 1.164
+        constexpr int COEF_RV = 102; // 1.596
+        constexpr int COEF_GV = 52;  // 0.813
+        constexpr int COEF_GU = 25;  // 0.391
+        constexpr int COEF_BU = 129; // 2.018
+
+        // One row of YUYV in, one row (or a chroma row from two rows) out.
+        struct RowKernels
+        {
+            void (*luma)(const std::uint8_t *src, std::uint8_t *y, std::uint32_t width);
+            void (*chroma_nv12)(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv, std::uint32_t width);
+            void (*chroma_i420)(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, std::uint32_t width);
+            void (*rgb)(const std::uint8_t *src, std::uint8_t *dst, std::uint32_t width, bool bgr);
+        };
+
+        // ─── scalar reference, also the tail of the SIMD kernels ───
+
+        [[nodiscard]] constexpr std::uint8_t clamp_q6(int value) noexcept
+        {
+            return static_cast<std::uint8_t>(std::clamp((value + 32) >> 6, 0, 255));
+        }
+
+        void luma_scalar(const std::uint8_t *src, std::uint8_t *y, std::uint32_t width)
+        {
+            for (std::uint32_t x = 0; x < width; ++x)
+            {
+                y[x] = src[2 * x];
+            }
+        }
+
+        void chroma_nv12_scalar(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv, std::uint32_t width)
+        {
+            // the odd bytes of YUYV already are U V U V ..., NV12 only wants them averaged over two rows
+            for (std::uint32_t x = 0; x < width; ++x)
+            {
+                uv[x] = static_cast<std::uint8_t>((row0[2 * x + 1] + row1[2 * x + 1] + 1) >> 1);
+            }
+        }
+
+        void chroma_i420_scalar(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, std::uint32_t width)
+        {
+            for (std::uint32_t x = 0; x < width / 2; ++x)
+            {
+                u[x] = static_cast<std::uint8_t>((row0[4 * x + 1] + row1[4 * x + 1] + 1) >> 1);
+                v[x] = static_cast<std::uint8_t>((row0[4 * x + 3] + row1[4 * x + 3] + 1) >> 1);
+            }
+        }
+
+        void rgb_scalar(const std::uint8_t *src, std::uint8_t *dst, std::uint32_t width, bool bgr)
+        {
+            const std::size_t r_at = bgr ? 2 : 0;
+            const std::size_t b_at = bgr ? 0 : 2;
+            for (std::uint32_t x = 0; x < width; x += 2)
+            {
+                const int u = src[2 * x + 1] - 128;
+                const int v = src[2 * x + 3] - 128;
+                for (std::uint32_t i = 0; i < 2; ++i)
+                {
+                    const int y = (src[2 * (x + i)] - 16) * COEF_Y;
+                    std::uint8_t *px = dst + 3 * static_cast<std::size_t>(x + i);
+                    px[r_at] = clamp_q6(y + COEF_RV * v);
+                    px[1] = clamp_q6(y - COEF_GV * v - COEF_GU * u);
+                    px[b_at] = clamp_q6(y + COEF_BU * u);
+                }
+            }
+        }
+
+        constexpr RowKernels scalar_kernels{luma_scalar, chroma_nv12_scalar, chroma_i420_scalar, rgb_scalar};
+
+#if V4L2_CONVERT_AVX2
+        // ─── AVX2: 32 pixels (64 bytes of YUYV) per step ───
+
+        __attribute__((target("avx2"))) void luma_avx2(const std::uint8_t *src, std::uint8_t *y, std::uint32_t width)
+        {
+            const __m256i mask = _mm256_set1_epi16(0x00FF);
+            std::uint32_t x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                const __m256i a = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 2 * x)), mask);
+                const __m256i b = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 2 * x + 32)), mask);
+                // packus works per 128-bit lane, the permute puts the quarters back in pixel order
+                const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(y + x), packed);
+            }
+            luma_scalar(src + 2 * x, y + x, width - x);
+        }
+
+        // chroma bytes of 16 pixels widened to 16 bits
+        __attribute__((target("avx2"))) inline __m256i load_chroma_avx2(const std::uint8_t *p)
+        {
+            return _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), 8);
+        }
+
+        // averaged chroma of 32 pixels as bytes U0 V0 U1 V1 ... U15 V15
+        __attribute__((target("avx2"))) inline __m256i chroma_avg_avx2(const std::uint8_t *row0, const std::uint8_t *row1)
+        {
+            const __m256i lo = _mm256_avg_epu16(load_chroma_avx2(row0), load_chroma_avx2(row1));
+            const __m256i hi = _mm256_avg_epu16(load_chroma_avx2(row0 + 32), load_chroma_avx2(row1 + 32));
+            return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        }
+
+        __attribute__((target("avx2"))) void chroma_nv12_avx2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv, std::uint32_t width)
+        {
+            std::uint32_t x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(uv + x), chroma_avg_avx2(row0 + 2 * x, row1 + 2 * x));
+            }
+            chroma_nv12_scalar(row0 + 2 * x, row1 + 2 * x, uv + x, width - x);
+        }
+
+        __attribute__((target("avx2"))) void chroma_i420_avx2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, std::uint32_t width)
+        {
+            // even bytes to the low half of each lane, odd bytes to the high half
+            const __m256i split = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+                                                   0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+            std::uint32_t x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                const __m256i uv = _mm256_shuffle_epi8(chroma_avg_avx2(row0 + 2 * x, row1 + 2 * x), split);
+                const __m256i planar = _mm256_permute4x64_epi64(uv, 0xD8); // U0..U15 | V0..V15
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x / 2), _mm256_castsi256_si128(planar));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x / 2), _mm256_extracti128_si256(planar, 1));
+            }
+            chroma_i420_scalar(row0 + 2 * x, row1 + 2 * x, u + x / 2, v + x / 2, width - x);
+        }
+
+        // pshufb masks interleaving three 16-byte planes into 48 bytes of packed pixels
+        struct InterleaveMasks
+        {
+            std::array<std::array<std::int8_t, 16>, 3> block[3]; // [output block][channel]
+        };
+
+        [[nodiscard]] consteval InterleaveMasks make_interleave_masks()
+        {
+            InterleaveMasks masks{};
+            for (int out = 0; out < 48; ++out)
+            {
+                for (int channel = 0; channel < 3; ++channel)
+                {
+                    masks.block[out / 16][static_cast<std::size_t>(channel)][static_cast<std::size_t>(out % 16)] =
+                        static_cast<std::int8_t>(out % 3 == channel ? out / 3 : -1);
+                }
+            }
+            return masks;
+        }
+        constexpr InterleaveMasks interleave_masks = make_interleave_masks();
+
+        __attribute__((target("avx2"))) void rgb_avx2(const std::uint8_t *src, std::uint8_t *dst, std::uint32_t width, bool bgr)
+        {
+            const __m256i mask = _mm256_set1_epi16(0x00FF);
+            const __m256i c16 = _mm256_set1_epi16(16);
+            const __m256i c128 = _mm256_set1_epi16(128);
+            const __m256i round = _mm256_set1_epi16(32);
+
+            std::uint32_t x = 0;
+            for (; x + 16 <= width; x += 16)
+            {
+                const __m256i yuyv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 2 * x));
+                const __m256i y = _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_and_si256(yuyv, mask), c16), _mm256_set1_epi16(COEF_Y));
+                const __m256i c = _mm256_sub_epi16(_mm256_srli_epi16(yuyv, 8), c128);
+                // every 16-bit lane gets the U (V) of its pixel pair
+                const __m256i u = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, 0xA0), 0xA0);
+                const __m256i v = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, 0xF5), 0xF5);
+
+                // saturating adds only clip values that clamp to 255 anyway, same result as the scalar path
+                __m256i r = _mm256_adds_epi16(y, _mm256_mullo_epi16(v, _mm256_set1_epi16(COEF_RV)));
+                __m256i g = _mm256_subs_epi16(_mm256_subs_epi16(y, _mm256_mullo_epi16(v, _mm256_set1_epi16(COEF_GV))),
+                                              _mm256_mullo_epi16(u, _mm256_set1_epi16(COEF_GU)));
+                __m256i b = _mm256_adds_epi16(y, _mm256_mullo_epi16(u, _mm256_set1_epi16(COEF_BU)));
+                r = _mm256_srai_epi16(_mm256_adds_epi16(r, round), 6);
+                g = _mm256_srai_epi16(_mm256_adds_epi16(g, round), 6);
+                b = _mm256_srai_epi16(_mm256_adds_epi16(b, round), 6);
+
+                const __m256i rg = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, g), 0xD8); // R0..15 | G0..15
+                const __m256i bb = _mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0xD8);
+                __m128i planes[3] = {_mm256_castsi256_si128(rg), _mm256_extracti128_si256(rg, 1), _mm256_castsi256_si128(bb)};
+                if (bgr)
+                {
+                    std::swap(planes[0], planes[2]);
+                }
+
+                for (std::size_t block = 0; block < 3; ++block)
+                {
+                    __m128i out = _mm_setzero_si128();
+                    for (std::size_t channel = 0; channel < 3; ++channel)
+                    {
+                        const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(interleave_masks.block[block][channel].data()));
+                        out = _mm_or_si128(out, _mm_shuffle_epi8(planes[channel], m));
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * static_cast<std::size_t>(x) + 16 * block), out);
+                }
+            }
+            rgb_scalar(src + 2 * x, dst + 3 * static_cast<std::size_t>(x), width - x, bgr);
+        }
+
+        constexpr RowKernels avx2_kernels{luma_avx2, chroma_nv12_avx2, chroma_i420_avx2, rgb_avx2};
+#endif
+
+#if V4L2_CONVERT_NEON
+        // ─── NEON: 32 pixels (64 bytes of YUYV) per step, 16 for RGB ───
+
+        void luma_neon(const std::uint8_t *src, std::uint8_t *y, std::uint32_t width)
+        {
+            std::uint32_t x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                vst1q_u8(y + x, vld2q_u8(src + 2 * x).val[0]);
+                vst1q_u8(y + x + 16, vld2q_u8(src + 2 * x + 32).val[0]);
+            }
+            luma_scalar(src + 2 * x, y + x, width - x);
+        }
+
+        void chroma_nv12_neon(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv, std::uint32_t width)
+        {
+            std::uint32_t x = 0;
+            for (; x + 16 <= width; x += 16)
+            {
+                vst1q_u8(uv + x, vrhaddq_u8(vld2q_u8(row0 + 2 * x).val[1], vld2q_u8(row1 + 2 * x).val[1]));
+            }
+            chroma_nv12_scalar(row0 + 2 * x, row1 + 2 * x, uv + x, width - x);
+        }
+
+        void chroma_i420_neon(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, std::uint32_t width)
+        {
+            std::uint32_t x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                const uint8x16x4_t a = vld4q_u8(row0 + 2 * x); // Y0 U Y1 V
+                const uint8x16x4_t b = vld4q_u8(row1 + 2 * x);
+                vst1q_u8(u + x / 2, vrhaddq_u8(a.val[1], b.val[1]));
+                vst1q_u8(v + x / 2, vrhaddq_u8(a.val[3], b.val[3]));
+            }
+            chroma_i420_scalar(row0 + 2 * x, row1 + 2 * x, u + x / 2, v + x / 2, width - x);
+        }
+
+        // Q6 values for 8 pixels narrowed with rounding and saturation, (x + 32) >> 6 like the scalar path
+        [[nodiscard]] inline uint8x8_t narrow_q6(int16x8_t value)
+        {
+            return vqrshrun_n_s16(value, 6);
+        }
+
+        void rgb_neon(const std::uint8_t *src, std::uint8_t *dst, std::uint32_t width, bool bgr)
+        {
+            std::uint32_t x = 0;
+            for (; x + 16 <= width; x += 16)
+            {
+                const uint8x8x4_t yuyv = vld4_u8(src + 2 * x); // Y0 U Y1 V for 8 pixel pairs
+                const int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[1])), vdupq_n_s16(128));
+                const int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[3])), vdupq_n_s16(128));
+                const int16x8_t rv = vmulq_n_s16(v, COEF_RV);
+                const int16x8_t guv = vaddq_s16(vmulq_n_s16(v, COEF_GV), vmulq_n_s16(u, COEF_GU));
+                const int16x8_t bu = vmulq_n_s16(u, COEF_BU);
+
+                uint8x8_t r[2], g[2], b[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    const uint8x8_t luma = i == 0 ? yuyv.val[0] : yuyv.val[2];
+                    const int16x8_t y = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(luma)), vdupq_n_s16(16)), COEF_Y);
+                    r[i] = narrow_q6(vqaddq_s16(y, rv));
+                    g[i] = narrow_q6(vqsubq_s16(y, guv));
+                    b[i] = narrow_q6(vqaddq_s16(y, bu));
+                }
+
+                // even and odd pixels back into order
+                const uint8x8x2_t rz = vzip_u8(r[0], r[1]);
+                const uint8x8x2_t gz = vzip_u8(g[0], g[1]);
+                const uint8x8x2_t bz = vzip_u8(b[0], b[1]);
+                uint8x16x3_t out;
+                out.val[bgr ? 2 : 0] = vcombine_u8(rz.val[0], rz.val[1]);
+                out.val[1] = vcombine_u8(gz.val[0], gz.val[1]);
+                out.val[bgr ? 0 : 2] = vcombine_u8(bz.val[0], bz.val[1]);
+                vst3q_u8(dst + 3 * static_cast<std::size_t>(x), out);
+            }
+            rgb_scalar(src + 2 * x, dst + 3 * static_cast<std::size_t>(x), width - x, bgr);
+        }
+
+        constexpr RowKernels neon_kernels{luma_neon, chroma_nv12_neon, chroma_i420_neon, rgb_neon};
+#endif
+
+        [[nodiscard]] const RowKernels &best_kernels() noexcept
+        {
+#if V4L2_CONVERT_AVX2
+            static const bool has_avx2 = __builtin_cpu_supports("avx2");
+            return has_avx2 ? avx2_kernels : scalar_kernels;
+#elif V4L2_CONVERT_NEON
+            return neon_kernels;
+#else
+            return scalar_kernels;
+#endif
+        }
+    } // namespace
+
+    void convert_yuyv(const FrameView &frame, ConvertFormat format, std::span<std::byte> dst, ConvertKernel kernel)
+    {
+        if (frame.format != PixelFormat::YUYV)
+        {
+            throw std::invalid_argument("convert_yuyv: frame is not YUYV");
+        }
+        const std::uint32_t width = frame.width;
+        const std::uint32_t height = frame.height;
+        if (width % 2 != 0)
+        {
+            throw std::invalid_argument(fmt::format("convert_yuyv: odd width {} cannot be YUYV", width));
+        }
+        const std::size_t stride = frame.bytes_per_line != 0 ? frame.bytes_per_line : std::size_t{width} * 2;
+        if (height > 0 && frame.image.size() < stride * (height - 1) + std::size_t{width} * 2)
+        {
+            throw std::invalid_argument(fmt::format("convert_yuyv: {} bytes is short for {}x{}", frame.image.size(), width, height));
+        }
+        if (dst.size() < converted_size(format, width, height))
+        {
+            throw std::invalid_argument(fmt::format("convert_yuyv: output holds {} bytes, needs {}",
+                                                    dst.size(), converted_size(format, width, height)));
+        }
+
+        const RowKernels &k = kernel == ConvertKernel::SCALAR ? scalar_kernels : best_kernels();
+        const auto *src = reinterpret_cast<const std::uint8_t *>(frame.image.data());
+        auto *out = reinterpret_cast<std::uint8_t *>(dst.data());
+        auto const row = [&](std::uint32_t y)
+        { return src + stride * y; };
+
+        if (format == ConvertFormat::RGB || format == ConvertFormat::BGR)
+        {
+            for (std::uint32_t y = 0; y < height; ++y)
+            {
+                k.rgb(row(y), out + std::size_t{width} * 3 * y, width, format == ConvertFormat::BGR);
+            }
+            return;
+        }
+
+        for (std::uint32_t y = 0; y < height; ++y)
+        {
+            k.luma(row(y), out + std::size_t{width} * y, width);
+        }
+        if (format == ConvertFormat::GRAY8)
+        {
+            return;
+        }
+
+        std::uint8_t *chroma = out + std::size_t{width} * height;
+        const std::uint32_t chroma_rows = (height + 1) / 2;
+        const std::size_t half = width / 2;
+        for (std::uint32_t cy = 0; cy < chroma_rows; ++cy)
+        {
+            const std::uint32_t y0 = 2 * cy;
+            const std::uint32_t y1 = std::min(y0 + 1, height - 1); // odd height: the last row pairs with itself
+            if (format == ConvertFormat::NV12)
+            {
+                k.chroma_nv12(row(y0), row(y1), chroma + std::size_t{width} * cy, width);
+            }
+            else
+            {
+                k.chroma_i420(row(y0), row(y1), chroma + half * cy, chroma + half * chroma_rows + half * cy, width);
+            }
+        }
+    }
+
+    [[nodiscard]] std::string_view best_convert_kernel() noexcept
+    {
+#if V4L2_CONVERT_AVX2
+        return &best_kernels() == &avx2_kernels ? "avx2" : "scalar";
+#elif V4L2_CONVERT_NEON
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+} // namespace v4l2
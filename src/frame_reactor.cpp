@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "v4l2/frame_reactor.hpp"
+
+namespace v4l2
+{
+    FrameReactor::FrameReactor()
+        : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+          wake_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+          round_(0)
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // the waiters are the only other entries
+        if (epoll_fd_ < 0 || wake_fd_ < 0 || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev) < 0)
+        {
+            auto const msg = fmt::format("FrameReactor: epoll/eventfd setup failed: {}", strerror(errno));
+            if (epoll_fd_ >= 0)
+            {
+                close(epoll_fd_);
+            }
+            if (wake_fd_ >= 0)
+            {
+                close(wake_fd_);
+            }
+            throw std::runtime_error(msg);
+        }
+    }
+
+    FrameReactor::~FrameReactor() noexcept
+    {
+        // coroutines still waiting are not resumed, they only stop pointing at us
+        while (!waiters_.empty())
+        {
+            remove(*waiters_.back());
+        }
+        close(wake_fd_);
+        close(epoll_fd_);
+    }
+
+    [[nodiscard]] FrameReactor::NextFrame FrameReactor::next_frame(V4L2Camera &camera, std::chrono::microseconds timeout,
+                                                                   std::stop_token stop)
+    {
+        return NextFrame(*this, camera, timeout, std::move(stop));
+    }
+
+    std::size_t FrameReactor::run_once(std::chrono::microseconds timeout)
+    {
+        const std::uint64_t round = ++round_;
+
+        // the nearest deadline caps the wait, rounded up: waking a little late beats spinning until it is due
+        auto wait = next_timeout();
+        if (timeout.count() >= 0 && (wait.count() < 0 || timeout < wait))
+        {
+            wait = timeout;
+        }
+        const int wait_ms = wait.count() < 0 ? -1 : static_cast<int>((wait.count() + 999) / 1000);
+
+        std::array<epoll_event, 16> events{};
+        int ready = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), wait_ms);
+        if (ready < 0)
+        {
+            if (errno != EINTR)
+            {
+                throw std::runtime_error(fmt::format("FrameReactor: epoll_wait failed: {}", strerror(errno)));
+            }
+            ready = 0;
+        }
+        // 📬 only mark them here: resuming one coroutine may end another waiter these events point at
+        for (int e = 0; e < ready; ++e)
+        {
+            auto *waiter = static_cast<NextFrame *>(events[static_cast<std::size_t>(e)].data.ptr);
+            if (waiter)
+            {
+                waiter->readable_ = true;
+            }
+            else
+            {
+                std::uint64_t count = 0;
+                [[maybe_unused]] auto const n = read(wake_fd_, &count, sizeof(count));
+            }
+        }
+
+        std::size_t resumed = 0;
+        const auto now = std::chrono::steady_clock::now();
+        while (true)
+        {
+            // 🔁 looked up again after each resume, which may have added or destroyed waiters
+            auto const it = std::find_if(waiters_.begin(), waiters_.end(), [&](NextFrame *waiter)
+                                         { return waiter->round_ < round && waiter->settle(now); });
+            if (it == waiters_.end())
+            {
+                return resumed;
+            }
+            auto &waiter = **it;
+            remove(waiter);
+            ++resumed;
+            waiter.handle_.resume();
+        }
+    }
+
+    [[nodiscard]] int FrameReactor::fd() const noexcept
+    {
+        return epoll_fd_;
+    }
+
+    [[nodiscard]] std::chrono::microseconds FrameReactor::next_timeout() const noexcept
+    {
+        std::optional<std::chrono::steady_clock::time_point> earliest;
+        for (auto const *waiter : waiters_)
+        {
+            if (waiter->timeout_.count() >= 0 && (!earliest || waiter->deadline_ < *earliest))
+            {
+                earliest = waiter->deadline_;
+            }
+        }
+        if (!earliest)
+        {
+            return std::chrono::microseconds{-1};
+        }
+        auto const left = std::chrono::ceil<std::chrono::microseconds>(*earliest - std::chrono::steady_clock::now());
+        return std::max(left, std::chrono::microseconds{0});
+    }
+
+    [[nodiscard]] std::size_t FrameReactor::pending() const noexcept
+    {
+        return waiters_.size();
+    }
+
+    void FrameReactor::add(NextFrame &waiter)
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLPRI; // PRI: events, the capture drains them
+        ev.data.ptr = &waiter;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, waiter.camera_.fd(), &ev) < 0)
+        {
+            if (errno == EEXIST)
+            {
+                throw std::invalid_argument(
+                    fmt::format("FrameReactor: a coroutine already waits for {}", waiter.camera_.config().device_path_));
+            }
+            throw std::runtime_error(fmt::format("FrameReactor: cannot watch {}: {}", waiter.camera_.config().device_path_,
+                                                 strerror(errno)));
+        }
+        waiters_.push_back(&waiter);
+        waiter.round_ = round_;
+        waiter.readable_ = false;
+        waiter.registered_ = true;
+    }
+
+    void FrameReactor::remove(NextFrame &waiter) noexcept
+    {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, waiter.camera_.fd(), nullptr);
+        std::erase(waiters_, &waiter);
+        waiter.registered_ = false;
+        waiter.on_stop_.reset(); // waits for a stop callback running on another thread
+    }
+
+    void FrameReactor::wake() noexcept
+    {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] auto const n = write(wake_fd_, &one, sizeof(one));
+    }
+
+    FrameReactor::NextFrame::NextFrame(FrameReactor &reactor, V4L2Camera &camera, std::chrono::microseconds timeout,
+                                       std::stop_token stop) noexcept
+        : reactor_(reactor),
+          camera_(camera),
+          timeout_(timeout),
+          deadline_(std::chrono::steady_clock::now() + std::max(timeout, std::chrono::microseconds{0})),
+          stop_(std::move(stop))
+    {
+    }
+
+    FrameReactor::NextFrame::~NextFrame() noexcept
+    {
+        // a coroutine destroyed while it waits
+        if (registered_)
+        {
+            reactor_.remove(*this);
+        }
+    }
+
+    [[nodiscard]] bool FrameReactor::NextFrame::await_ready()
+    {
+        if (stop_.stop_requested())
+        {
+            return true;
+        }
+        // 🏃 a frame may already be queued: no suspension, no epoll round trip
+        try
+        {
+            frame_ = camera_.try_capture_frame(std::chrono::microseconds{0});
+        }
+        catch (...)
+        {
+            error_ = std::current_exception();
+        }
+        return frame_ || error_ || timeout_.count() == 0;
+    }
+
+    [[nodiscard]] bool FrameReactor::NextFrame::await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        try
+        {
+            reactor_.add(*this);
+        }
+        catch (...)
+        {
+            error_ = std::current_exception();
+            return false; // resume right away, await_resume() throws it
+        }
+        if (stop_.stop_possible())
+        {
+            on_stop_.emplace(stop_, Cancel{this}); // runs at once, here, if stop was requested meanwhile
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::optional<FrameLease> FrameReactor::NextFrame::await_resume()
+    {
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+        return std::move(frame_);
+    }
+
+    [[nodiscard]] bool FrameReactor::NextFrame::settle(std::chrono::steady_clock::time_point now) noexcept
+    {
+        if (cancelled_.load(std::memory_order_acquire))
+        {
+            return true;
+        }
+        if (readable_)
+        {
+            readable_ = false;
+            try
+            {
+                // nothing after all is fine: an event only, or a frame CapturePolicy::LATEST dropped
+                frame_ = camera_.try_capture_frame(std::chrono::microseconds{0});
+            }
+            catch (...)
+            {
+                error_ = std::current_exception();
+            }
+            if (frame_ || error_)
+            {
+                return true;
+            }
+        }
+        return timeout_.count() >= 0 && now >= deadline_;
+    }
+
+    void FrameReactor::NextFrame::Cancel::operator()() const noexcept
+    {
+        self->cancelled_.store(true, std::memory_order_release);
+        self->reactor_.wake();
+    }
+} // namespace v4l2
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <exception>
+#include <fmt/core.h>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "v4l2/frame_sync.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    FrameSynchronizer::FrameSynchronizer(std::size_t cameras, const FrameSyncConfig &config)
+        : config_(config),
+          pending_(cameras),
+          last_(cameras)
+    {
+        if (cameras == 0 || config_.max_pending_ == 0)
+        {
+            throw std::invalid_argument(fmt::format("FrameSynchronizer needs cameras and max_pending_ > 0, got {} and {}",
+                                                    cameras, config_.max_pending_));
+        }
+    }
+
+    FrameSynchronizer::~FrameSynchronizer() noexcept = default;
+
+    void FrameSynchronizer::push(std::size_t camera, FrameLease &&frame)
+    {
+        if (camera >= pending_.size())
+        {
+            throw std::out_of_range(fmt::format("FrameSynchronizer: camera {} of {}", camera, pending_.size()));
+        }
+        const std::uint64_t timestamp_us = frame->v4l2_timestamp_us;
+        auto shared = std::make_shared<FrameLease>(std::move(frame));
+
+        std::vector<std::shared_ptr<FrameLease>> released; // outlives the lock, see clear()
+        std::lock_guard lock(mutex_);
+        pending_[camera].push_back(Pending{.frame = std::move(shared), .timestamp_us = timestamp_us});
+        newest_us_ = std::max(newest_us_, timestamp_us);
+        match(released);
+    }
+
+    // Build sets while the oldest pending frame can be decided on
+    void FrameSynchronizer::match(std::vector<std::shared_ptr<FrameLease>> &released)
+    {
+        while (true)
+        {
+            std::optional<std::uint64_t> earliest_us;
+            for (auto const &queue : pending_)
+            {
+                if (!queue.empty() && (!earliest_us || queue.front().timestamp_us < *earliest_us))
+                {
+                    earliest_us = queue.front().timestamp_us;
+                }
+            }
+            if (!earliest_us || !build(*earliest_us, released))
+            {
+                return;
+            }
+        }
+    }
+
+    // ⚖️ the set around the oldest pending frame, false while a camera may still deliver its member
+    bool FrameSynchronizer::build(std::uint64_t earliest_us, std::vector<std::shared_ptr<FrameLease>> &released)
+    {
+        const auto tolerance_us = static_cast<std::uint64_t>(config_.tolerance_.count());
+        const auto max_wait_us = static_cast<std::uint64_t>(config_.max_wait_.count());
+        const bool overflow = std::any_of(pending_.begin(), pending_.end(), [&](auto const &queue)
+                                          { return queue.size() > config_.max_pending_; });
+        const bool waited_out = newest_us_ - earliest_us > max_wait_us;
+
+        std::vector<bool> member(pending_.size());
+        bool complete = true;
+        for (std::size_t c = 0; c < pending_.size(); ++c)
+        {
+            auto const &queue = pending_[c];
+            if (!queue.empty() && queue.front().timestamp_us <= earliest_us + tolerance_us)
+            {
+                member[c] = true;
+                continue;
+            }
+            // a later frame already here means there is none for this moment, an empty queue gets max_wait_ to fill
+            if (queue.empty() && !waited_out && !overflow)
+            {
+                return false;
+            }
+            complete = false;
+        }
+
+        FrameSet set{.number = 0,
+                     .timestamp_us = earliest_us,
+                     .spread_us = 0,
+                     .frames = std::vector<std::shared_ptr<FrameLease>>(pending_.size()),
+                     .repeated = std::vector<bool>(pending_.size())};
+        std::size_t members = 0;
+        for (std::size_t c = 0; c < pending_.size(); ++c)
+        {
+            if (member[c])
+            {
+                set.spread_us = std::max(set.spread_us, pending_[c].front().timestamp_us - earliest_us);
+                set.frames[c] = std::move(pending_[c].front().frame);
+                pending_[c].pop_front();
+                ++members;
+            }
+        }
+
+        if (!complete)
+        {
+            ++stats_.incomplete_sets;
+            const bool fillable = config_.missing_ == MissingFramePolicy::REPEAT_LAST &&
+                                  std::all_of(member.begin(), member.end(), [&, c = std::size_t{0}](bool in) mutable
+                                              { return in || last_[c++] != nullptr; });
+            if (!fillable)
+            {
+                stats_.dropped_frames += members; // 🗑 the leases go back to their drivers with `released`
+                std::move(set.frames.begin(), set.frames.end(), std::back_inserter(released));
+                return true;
+            }
+            for (std::size_t c = 0; c < pending_.size(); ++c)
+            {
+                if (!member[c])
+                {
+                    set.frames[c] = last_[c];
+                    set.repeated[c] = true;
+                    ++stats_.repeated_frames;
+                }
+            }
+        }
+        if (config_.missing_ == MissingFramePolicy::REPEAT_LAST)
+        {
+            for (std::size_t c = 0; c < pending_.size(); ++c)
+            {
+                if (member[c])
+                {
+                    released.push_back(std::exchange(last_[c], set.frames[c]));
+                }
+            }
+        }
+
+        set.number = next_number_++;
+        ready_.push_back(std::move(set));
+        if (ready_.size() > config_.max_pending_)
+        {
+            auto &oldest = ready_.front().frames; // nobody pops, the newest sets are worth more
+            std::move(oldest.begin(), oldest.end(), std::back_inserter(released));
+            ready_.pop_front();
+            ++stats_.dropped_sets;
+        }
+        ready_cv_.notify_one();
+        return true;
+    }
+
+    [[nodiscard]] std::optional<FrameSet> FrameSynchronizer::pop(std::chrono::microseconds timeout)
+    {
+        std::unique_lock lock(mutex_);
+        auto const ready = [&]
+        { return !ready_.empty() || interrupted_ || !error_.empty(); };
+        if (timeout.count() < 0)
+        {
+            ready_cv_.wait(lock, ready);
+        }
+        else if (!ready_cv_.wait_for(lock, timeout, ready))
+        {
+            return std::nullopt;
+        }
+
+        if (!error_.empty())
+        {
+            throw std::runtime_error(error_);
+        }
+        if (interrupted_ || ready_.empty())
+        {
+            return std::nullopt;
+        }
+        auto set = std::move(ready_.front());
+        ready_.pop_front();
+        ++stats_.sets;
+        return set;
+    }
+
+    void FrameSynchronizer::start(CameraGroup &group)
+    {
+        if (group.size() != pending_.size())
+        {
+            throw std::invalid_argument(
+                fmt::format("FrameSynchronizer for {} cameras cannot take a group of {}", pending_.size(), group.size()));
+        }
+        group.start([this](std::size_t camera, FrameLease &&frame)
+                    { push(camera, std::move(frame)); },
+                    [this](std::size_t camera, const std::exception &error)
+                    { fail(fmt::format("camera {} failed: {}", camera, error.what())); });
+    }
+
+    void FrameSynchronizer::fail(const std::string &error)
+    {
+        V4L2_TRACE(WARN, "FrameSynchronizer: {}", error);
+        {
+            std::lock_guard lock(mutex_);
+            if (error_.empty())
+            {
+                error_ = error; // the first failure is what pop() reports
+            }
+        }
+        ready_cv_.notify_all();
+    }
+
+    void FrameSynchronizer::interrupt() noexcept
+    {
+        {
+            std::lock_guard lock(mutex_);
+            interrupted_ = true;
+        }
+        ready_cv_.notify_all();
+    }
+
+    void FrameSynchronizer::clear_interrupt() noexcept
+    {
+        std::lock_guard lock(mutex_);
+        interrupted_ = false;
+    }
+
+    void FrameSynchronizer::clear() noexcept
+    {
+        // 🧹 moved out first: the leases are re-queued (QBUF) after the lock is gone
+        std::vector<std::deque<Pending>> pending(pending_.size());
+        std::vector<std::shared_ptr<FrameLease>> last(last_.size());
+        std::deque<FrameSet> ready;
+        {
+            std::lock_guard lock(mutex_);
+            std::swap(pending, pending_);
+            std::swap(last, last_);
+            std::swap(ready, ready_);
+            newest_us_ = 0;
+            error_.clear();
+            interrupted_ = false;
+        }
+    }
+
+    [[nodiscard]] FrameSyncStats FrameSynchronizer::stats() const
+    {
+        std::lock_guard lock(mutex_);
+        return stats_;
+    }
+
+    [[nodiscard]] std::size_t FrameSynchronizer::size() const noexcept
+    {
+        return pending_.size();
+    }
+} // namespace v4l2
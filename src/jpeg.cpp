@@ -0,0 +1,236 @@
+#include <array>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+
+#include "v4l2/jpeg.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        constexpr std::uint8_t MARKER = 0xFF;
+        constexpr std::uint8_t SOI = 0xD8;
+        constexpr std::uint8_t EOI = 0xD9;
+        constexpr std::uint8_t SOS = 0xDA;
+        constexpr std::uint8_t DHT = 0xC4;
+        constexpr std::uint8_t TEM = 0x01;
+        constexpr std::uint8_t RST0 = 0xD0;
+        constexpr std::uint8_t RST7 = 0xD7;
+
+        // SOF0..SOF15 minus DHT (C4), JPG (C8) and DAC (CC), which share the range
+        [[nodiscard]] constexpr bool is_sof(std::uint8_t marker) noexcept
+        {
+            return marker >= 0xC0 && marker <= 0xCF && marker != DHT && marker != 0xC8 && marker != 0xCC;
+        }
+
+        [[nodiscard]] constexpr std::uint16_t be16(const std::uint8_t *p) noexcept
+        {
+            return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+        }
+
+        // 📚 ITU T.81 Annex K.3, the tables libjpeg calls std_huff_tables
+        struct HuffTable
+        {
+            std::uint8_t table_class_id; // 0x00 DC luma, 0x10 AC luma, 0x01 DC chroma, 0x11 AC chroma
+            std::array<std::uint8_t, 16> counts;
+            std::span<const std::uint8_t> values;
+        };
+
+        constexpr std::uint8_t dc_values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+        constexpr std::uint8_t ac_luma_values[] = {
+            0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+            0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+            0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+            0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+            0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+            0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+            0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+            0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+            0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+            0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+            0xf9, 0xfa};
+
+        constexpr std::uint8_t ac_chroma_values[] = {
+            0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+            0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+            0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+            0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+            0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+            0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+            0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+            0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+            0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+            0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+            0xf9, 0xfa};
+
+        constexpr HuffTable standard_tables[] = {
+            {0x00, {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0}, dc_values},
+            {0x10, {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d}, ac_luma_values},
+            {0x01, {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0}, dc_values},
+            {0x11, {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77}, ac_chroma_values},
+        };
+
+        [[nodiscard]] consteval std::size_t dht_segment_size()
+        {
+            std::size_t size = 4; // marker + length
+            for (auto const &table : standard_tables)
+            {
+                std::size_t count = 0;
+                for (auto const c : table.counts)
+                {
+                    count += c;
+                }
+                if (count != table.values.size())
+                {
+                    throw "Huffman table counts do not match its values";
+                }
+                size += 1 + table.counts.size() + table.values.size();
+            }
+            return size;
+        }
+
+        constexpr std::size_t DHT_SEGMENT_SIZE = dht_segment_size();
+        static_assert(DHT_SEGMENT_SIZE == 420);
+
+        [[nodiscard]] consteval std::array<std::uint8_t, DHT_SEGMENT_SIZE> make_dht_segment()
+        {
+            std::array<std::uint8_t, DHT_SEGMENT_SIZE> segment{};
+            std::size_t at = 0;
+            segment[at++] = MARKER;
+            segment[at++] = DHT;
+            segment[at++] = static_cast<std::uint8_t>((DHT_SEGMENT_SIZE - 2) >> 8); // length counts itself, not the marker
+            segment[at++] = static_cast<std::uint8_t>((DHT_SEGMENT_SIZE - 2) & 0xFF);
+            for (auto const &table : standard_tables)
+            {
+                segment[at++] = table.table_class_id;
+                for (auto const c : table.counts)
+                {
+                    segment[at++] = c;
+                }
+                for (auto const v : table.values)
+                {
+                    segment[at++] = v;
+                }
+            }
+            return segment;
+        }
+
+        constexpr std::array<std::uint8_t, DHT_SEGMENT_SIZE> dht_segment = make_dht_segment();
+    } // namespace
+
+    [[nodiscard]] JpegInfo scan_jpeg(std::span<std::byte const> data) noexcept
+    {
+        JpegInfo info{};
+        const auto *p = reinterpret_cast<const std::uint8_t *>(data.data());
+        const std::size_t n = data.size();
+        if (n < 4 || p[0] != MARKER || p[1] != SOI)
+        {
+            info.status = JpegStatus::NO_SOI;
+            return info;
+        }
+
+        // 🔎 header segments up to SOS, a few hundred bytes whatever the resolution
+        bool have_sof = false;
+        bool have_sos = false;
+        std::size_t pos = 2;
+        while (pos + 4 <= n)
+        {
+            if (p[pos] != MARKER)
+            {
+                info.status = JpegStatus::BAD_MARKER;
+                return info;
+            }
+            const std::uint8_t marker = p[pos + 1];
+            if (marker == MARKER)
+            {
+                ++pos; // fill byte
+                continue;
+            }
+            if (marker == TEM || (marker >= RST0 && marker <= RST7) || marker == SOI)
+            {
+                pos += 2; // no length field
+                continue;
+            }
+            if (marker == EOI)
+            {
+                break; // EOI before SOS: no image in here
+            }
+
+            const std::uint16_t length = be16(p + pos + 2);
+            if (length < 2 || pos + 2 + length > n)
+            {
+                info.status = JpegStatus::TRUNCATED;
+                return info;
+            }
+            if (is_sof(marker) && length >= 8)
+            {
+                info.height = be16(p + pos + 5);
+                info.width = be16(p + pos + 7);
+                have_sof = true;
+            }
+            else if (marker == DHT)
+            {
+                info.has_dht = true;
+            }
+            else if (marker == SOS)
+            {
+                info.sos_offset = static_cast<std::uint32_t>(pos);
+                have_sos = true;
+                break;
+            }
+            pos += 2u + length;
+        }
+
+        if (!have_sof || info.width == 0 || info.height == 0)
+        {
+            info.status = have_sos || have_sof ? JpegStatus::NO_SOF : JpegStatus::TRUNCATED;
+            return info;
+        }
+        if (!have_sos)
+        {
+            info.status = JpegStatus::TRUNCATED;
+            return info;
+        }
+
+        // 🧻 UVC drivers report bytesused rounded up and zero-fill the rest, EOI sits before the padding
+        std::size_t end = n;
+        while (end > info.sos_offset + 2u && p[end - 1] == 0x00)
+        {
+            --end;
+        }
+        if (end < info.sos_offset + 4u || p[end - 2] != MARKER || p[end - 1] != EOI)
+        {
+            info.status = JpegStatus::NO_EOI;
+            return info;
+        }
+
+        info.size = static_cast<std::uint32_t>(end);
+        info.status = JpegStatus::OK;
+        return info;
+    }
+
+    [[nodiscard]] std::span<std::byte const> standard_dht_segment() noexcept
+    {
+        return std::as_bytes(std::span{dht_segment});
+    }
+
+    std::size_t insert_standard_dht(std::span<std::byte const> jpeg, const JpegInfo &info, std::span<std::byte> dst)
+    {
+        if (!info.ok() || info.has_dht || info.size > jpeg.size() || info.sos_offset >= info.size)
+        {
+            throw std::invalid_argument("insert_standard_dht: needs a valid JPEG scan without DHT");
+        }
+        const std::size_t total = info.size + DHT_SEGMENT_SIZE;
+        if (dst.size() < total)
+        {
+            throw std::invalid_argument(fmt::format("insert_standard_dht: output holds {} bytes, needs {}", dst.size(), total));
+        }
+
+        std::memcpy(dst.data(), jpeg.data(), info.sos_offset);
+        std::memcpy(dst.data() + info.sos_offset, dht_segment.data(), DHT_SEGMENT_SIZE);
+        std::memcpy(dst.data() + info.sos_offset + DHT_SEGMENT_SIZE, jpeg.data() + info.sos_offset, info.size - info.sos_offset);
+        return total;
+    }
+} // namespace v4l2
@@ -0,0 +1,450 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <fmt/core.h>
+#include <map>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "v4l2/metrics.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        constexpr std::size_t MAX_REQUEST = 8192;
+        constexpr int CLIENT_TIMEOUT_MS = 1000;
+
+        [[nodiscard]] std::uint64_t monotonic_now_us() noexcept
+        {
+            timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<std::uint64_t>(ts.tv_sec) * 1'000'000ULL + static_cast<std::uint64_t>(ts.tv_nsec) / 1000ULL;
+        }
+
+        // Label values escape backslash, double quote and newline
+        [[nodiscard]] std::string escape_label(const std::string &value)
+        {
+            std::string out;
+            out.reserve(value.size());
+            for (const char c : value)
+            {
+                switch (c)
+                {
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                default:
+                    out += c;
+                }
+            }
+            return out;
+        }
+
+        [[nodiscard]] double seconds(std::uint64_t us) noexcept
+        {
+            return static_cast<double>(us) / 1e6;
+        }
+
+        // Writes everything or gives up, the client may be gone or stalled past SO_SNDTIMEO; MSG_NOSIGNAL keeps SIGPIPE away
+        void send_all(int fd, std::string_view data) noexcept
+        {
+            while (!data.empty())
+            {
+                auto const sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (sent <= 0)
+                {
+                    return;
+                }
+                data.remove_prefix(static_cast<std::size_t>(sent));
+            }
+        }
+
+        // "unix:/path" or "host:port", bound and listening; `address` gets what it really bound
+        [[nodiscard]] int listen_on(const std::string &listen, std::string &address, std::string &unix_path)
+        {
+            if (listen.starts_with("unix:"))
+            {
+                sockaddr_un addr{};
+                addr.sun_family = AF_UNIX;
+                const std::string path = listen.substr(5);
+                if (path.empty() || path.size() >= sizeof(addr.sun_path))
+                {
+                    throw std::invalid_argument(fmt::format("MetricsExporter: bad unix socket path '{}'", path));
+                }
+                std::copy(path.begin(), path.end(), addr.sun_path);
+                const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (fd < 0)
+                {
+                    throw std::runtime_error(fmt::format("MetricsExporter: socket failed: {}", strerror(errno)));
+                }
+                unlink(path.c_str()); // 🧹 left over by a process that did not get to clean up
+                if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd, 16) != 0)
+                {
+                    auto const msg = fmt::format("MetricsExporter: cannot listen on {}: {}", path, strerror(errno));
+                    close(fd);
+                    throw std::runtime_error(msg);
+                }
+                address = listen;
+                unix_path = path;
+                return fd;
+            }
+
+            auto const colon = listen.rfind(':');
+            std::uint16_t port = 0;
+            auto const port_text = colon == std::string::npos ? std::string_view{} : std::string_view(listen).substr(colon + 1);
+            if (colon == std::string::npos ||
+                std::from_chars(port_text.data(), port_text.data() + port_text.size(), port).ec != std::errc{})
+            {
+                throw std::invalid_argument(fmt::format("MetricsExporter: expected host:port or unix:/path, got '{}'", listen));
+            }
+            std::string host = listen.substr(0, colon);
+            if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+            {
+                host = host.substr(1, host.size() - 2); // [::1]:9101
+            }
+
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+            addrinfo *found = nullptr;
+            const std::string service = std::to_string(port);
+            if (auto const rc = getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &found); rc != 0)
+            {
+                throw std::runtime_error(fmt::format("MetricsExporter: cannot resolve '{}': {}", host, gai_strerror(rc)));
+            }
+            std::string error = "no address";
+            int fd = -1;
+            for (auto *ai = found; ai && fd < 0; ai = ai->ai_next)
+            {
+                fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+                if (fd < 0)
+                {
+                    error = strerror(errno);
+                    continue;
+                }
+                const int one = 1;
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || ::listen(fd, 16) != 0)
+                {
+                    error = strerror(errno);
+                    close(fd);
+                    fd = -1;
+                }
+            }
+            freeaddrinfo(found);
+            if (fd < 0)
+            {
+                throw std::runtime_error(fmt::format("MetricsExporter: cannot listen on {}: {}", listen, error));
+            }
+
+            // 🔌 port 0 picked one, tell which
+            sockaddr_storage bound{};
+            socklen_t length = sizeof(bound);
+            getsockname(fd, reinterpret_cast<sockaddr *>(&bound), &length);
+            std::array<char, INET6_ADDRSTRLEN> text{};
+            if (bound.ss_family == AF_INET6)
+            {
+                auto const &in6 = reinterpret_cast<const sockaddr_in6 &>(bound);
+                inet_ntop(AF_INET6, &in6.sin6_addr, text.data(), text.size());
+                address = fmt::format("[{}]:{}", text.data(), ntohs(in6.sin6_port));
+            }
+            else
+            {
+                auto const &in4 = reinterpret_cast<const sockaddr_in &>(bound);
+                inet_ntop(AF_INET, &in4.sin_addr, text.data(), text.size());
+                address = fmt::format("{}:{}", text.data(), ntohs(in4.sin_port));
+            }
+            return fd;
+        }
+    } // namespace
+
+    [[nodiscard]] CameraMetricsSnapshot CameraMetrics::snapshot() const
+    {
+        CameraMetricsSnapshot snapshot{
+            .camera = {},
+            .device = device_,
+            .frames = frames_.load(std::memory_order_relaxed),
+            .bytes = bytes_.load(std::memory_order_relaxed),
+            .sequence_gaps = sequence_gaps_.load(std::memory_order_relaxed),
+            .lost_frames = lost_frames_.load(std::memory_order_relaxed),
+            .errored_buffers = errored_buffers_.load(std::memory_order_relaxed),
+            .dropped_frames = dropped_frames_.load(std::memory_order_relaxed),
+            .corrupt_frames = corrupt_frames_.load(std::memory_order_relaxed),
+            .buffers = buffers_.load(std::memory_order_relaxed),
+            .leased = leased_.load(std::memory_order_relaxed),
+            .queued = 0,
+            .nominal_fps = nominal_fps_.load(std::memory_order_relaxed),
+            .last_frame_us = last_frame_us_.load(std::memory_order_relaxed),
+            .requeue = requeue_.summary(),
+            .requeue_sum_us = requeue_sum_us_.load(std::memory_order_relaxed),
+            .lease_hold = lease_hold_.summary(),
+            .lease_hold_sum_us = lease_hold_sum_us_.load(std::memory_order_relaxed),
+        };
+        snapshot.leased = std::min(snapshot.leased, snapshot.buffers); // a release racing the load
+        snapshot.queued = snapshot.buffers - snapshot.leased;
+        return snapshot;
+    }
+
+    [[nodiscard]] MetricsRegistry &MetricsRegistry::global()
+    {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    void MetricsRegistry::add(const std::string &name, std::shared_ptr<const CameraMetrics> metrics)
+    {
+        if (name.empty() || !metrics)
+        {
+            throw std::invalid_argument("MetricsRegistry: a camera needs a name and metrics");
+        }
+        std::lock_guard lock(mutex_);
+        auto const it = std::find_if(entries_.begin(), entries_.end(), [&](auto const &entry)
+                                     { return entry.name == name; });
+        if (it != entries_.end())
+        {
+            it->metrics = std::move(metrics);
+            return;
+        }
+        entries_.push_back(Entry{.name = name, .metrics = std::move(metrics)});
+    }
+
+    void MetricsRegistry::remove(const std::string &name)
+    {
+        std::lock_guard lock(mutex_);
+        std::erase_if(entries_, [&](auto const &entry)
+                      { return entry.name == name; });
+    }
+
+    [[nodiscard]] std::vector<CameraMetricsSnapshot> MetricsRegistry::snapshot()
+    {
+        std::lock_guard lock(mutex_);
+        std::vector<CameraMetricsSnapshot> cameras;
+        cameras.reserve(entries_.size());
+        std::erase_if(entries_, [&](auto const &entry)
+                      {
+                          auto const metrics = entry.metrics.lock();
+                          if (!metrics)
+                          {
+                              return true; // 🪦 the camera is gone
+                          }
+                          cameras.push_back(metrics->snapshot());
+                          cameras.back().camera = entry.name;
+                          return false; });
+        return cameras;
+    }
+
+    [[nodiscard]] std::string to_prometheus(std::span<const CameraMetricsSnapshot> cameras)
+    {
+        std::vector<std::string> labels;
+        labels.reserve(cameras.size());
+        for (auto const &camera : cameras)
+        {
+            labels.push_back(fmt::format("camera=\"{}\",device=\"{}\"", escape_label(camera.camera), escape_label(camera.device)));
+        }
+
+        // 📜 one HELP/TYPE block per metric, then a line per camera
+        std::string out;
+        auto const metric = [&](const char *name, const char *type, const char *help, auto const &value)
+        {
+            out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+            for (std::size_t i = 0; i < cameras.size(); ++i)
+            {
+                out += fmt::format("{}{{{}}} {}\n", name, labels[i], value(cameras[i]));
+            }
+        };
+        auto const summary = [&](const char *name, const char *help, auto const &latency, auto const &sum_us)
+        {
+            out += fmt::format("# HELP {} {}\n# TYPE {} summary\n", name, help, name);
+            for (std::size_t i = 0; i < cameras.size(); ++i)
+            {
+                const LatencySummary &s = latency(cameras[i]);
+                out += fmt::format("{}{{{},quantile=\"0.5\"}} {}\n", name, labels[i], seconds(s.p50_us));
+                out += fmt::format("{}{{{},quantile=\"0.99\"}} {}\n", name, labels[i], seconds(s.p99_us));
+                out += fmt::format("{}{{{},quantile=\"0.999\"}} {}\n", name, labels[i], seconds(s.p999_us));
+                out += fmt::format("{}_sum{{{}}} {}\n", name, labels[i], seconds(sum_us(cameras[i])));
+                out += fmt::format("{}_count{{{}}} {}\n", name, labels[i], s.count);
+            }
+        };
+        using S = CameraMetricsSnapshot;
+
+        metric("v4l2_frames_total", "counter", "Frames dequeued", [](const S &s)
+               { return s.frames; });
+        metric("v4l2_bytes_total", "counter", "Bytes the driver filled in dequeued frames", [](const S &s)
+               { return s.bytes; });
+        metric("v4l2_sequence_gaps_total", "counter", "Jumps in the driver sequence", [](const S &s)
+               { return s.sequence_gaps; });
+        metric("v4l2_lost_frames_total", "counter", "Frames the driver sequence skipped", [](const S &s)
+               { return s.lost_frames; });
+        metric("v4l2_errored_buffers_total", "counter", "Buffers dequeued with V4L2_BUF_FLAG_ERROR", [](const S &s)
+               { return s.errored_buffers; });
+        metric("v4l2_dropped_frames_total", "counter", "Stale frames skipped on purpose by the latest-frame policy", [](const S &s)
+               { return s.dropped_frames; });
+        metric("v4l2_corrupt_frames_total", "counter", "MJPEG frames failing the marker scan", [](const S &s)
+               { return s.corrupt_frames; });
+        metric("v4l2_buffers", "gauge", "Driver buffers", [](const S &s)
+               { return s.buffers; });
+        metric("v4l2_leased_buffers", "gauge", "Buffers held by consumers", [](const S &s)
+               { return s.leased; });
+        metric("v4l2_queued_buffers", "gauge", "Buffers queued to the driver to fill", [](const S &s)
+               { return s.queued; });
+        metric("v4l2_nominal_fps", "gauge", "Frame rate the driver accepted", [](const S &s)
+               { return s.nominal_fps; });
+        const std::uint64_t now_us = monotonic_now_us();
+        metric("v4l2_last_frame_age_seconds", "gauge", "Time since the last frame, NaN before the first", [&](const S &s)
+               { return s.last_frame_us == 0 ? std::string("NaN") : fmt::format("{}", seconds(now_us > s.last_frame_us ? now_us - s.last_frame_us : 0)); });
+        summary("v4l2_requeue_latency_seconds", "Duration of VIDIOC_QBUF", [](const S &s) -> const LatencySummary &
+                { return s.requeue; }, [](const S &s)
+                { return s.requeue_sum_us; });
+        summary("v4l2_lease_hold_seconds", "DQBUF to QBUF, how long a consumer held a buffer", [](const S &s) -> const LatencySummary &
+                { return s.lease_hold; }, [](const S &s)
+                { return s.lease_hold_sum_us; });
+        return out;
+    }
+
+    MetricsExporter::MetricsExporter(const MetricsExporterConfig &config)
+        : registry_(config.registry_ ? *config.registry_ : MetricsRegistry::global()),
+          listen_fd_(listen_on(config.listen_, address_, unix_path_)),
+          wake_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    {
+        if (wake_fd_ < 0)
+        {
+            auto const msg = fmt::format("MetricsExporter: eventfd failed: {}", strerror(errno));
+            close(listen_fd_);
+            throw std::runtime_error(msg);
+        }
+        thread_ = std::jthread([this](std::stop_token stop)
+                               { run(stop); });
+        V4L2_TRACE(INFO, "MetricsExporter: serving on {}", address_);
+    }
+
+    MetricsExporter::~MetricsExporter() noexcept
+    {
+        thread_.request_stop();
+        const std::uint64_t one = 1;
+        [[maybe_unused]] auto const written = write(wake_fd_, &one, sizeof(one));
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        close(listen_fd_);
+        close(wake_fd_);
+        if (!unix_path_.empty())
+        {
+            unlink(unix_path_.c_str());
+        }
+    }
+
+    [[nodiscard]] std::shared_ptr<MetricsExporter> MetricsExporter::shared(const std::string &listen)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::weak_ptr<MetricsExporter>> exporters;
+        std::lock_guard lock(mutex);
+        auto &slot = exporters[listen];
+        if (auto exporter = slot.lock())
+        {
+            return exporter;
+        }
+        auto exporter = std::make_shared<MetricsExporter>(MetricsExporterConfig{.listen_ = listen});
+        slot = exporter;
+        return exporter;
+    }
+
+    void MetricsExporter::run(std::stop_token stop) noexcept
+    {
+        while (!stop.stop_requested())
+        {
+            std::array<pollfd, 2> fds{{{.fd = listen_fd_, .events = POLLIN, .revents = 0},
+                                       {.fd = wake_fd_, .events = POLLIN, .revents = 0}}};
+            if (poll(fds.data(), fds.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                V4L2_TRACE(WARN, "MetricsExporter: poll failed: {}", strerror(errno));
+                return;
+            }
+            if (fds[1].revents != 0)
+            {
+                return;
+            }
+            const int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0)
+            {
+                continue; // the client gave up already, or EMFILE: try again on the next one
+            }
+            // ⏱ a scraper that stops reading must not keep send() and so the destructor's join() waiting
+            const timeval timeout{.tv_sec = CLIENT_TIMEOUT_MS / 1000, .tv_usec = (CLIENT_TIMEOUT_MS % 1000) * 1000};
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            serve(client);
+            close(client);
+        }
+    }
+
+    // 🌐 one request, one answer, then the connection closes; a client that does not send in time is dropped
+    void MetricsExporter::serve(int client) noexcept
+    {
+        std::string request;
+        std::array<char, 1024> chunk{};
+        while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos &&
+               request.size() < MAX_REQUEST)
+        {
+            pollfd pfd{.fd = client, .events = POLLIN, .revents = 0};
+            if (poll(&pfd, 1, CLIENT_TIMEOUT_MS) <= 0)
+            {
+                return;
+            }
+            auto const received = recv(client, chunk.data(), chunk.size(), 0);
+            if (received <= 0)
+            {
+                return;
+            }
+            request.append(chunk.data(), static_cast<std::size_t>(received));
+        }
+
+        if (!request.starts_with("GET "))
+        {
+            send_all(client, "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            return;
+        }
+        try
+        {
+            auto const cameras = registry_.snapshot();
+            auto const body = to_prometheus(cameras);
+            send_all(client, fmt::format("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                         "Content-Length: {}\r\nConnection: close\r\n\r\n",
+                                         body.size()));
+            send_all(client, body);
+        }
+        catch (const std::exception &e)
+        {
+            V4L2_TRACE(WARN, "MetricsExporter: {}", e.what());
+            send_all(client, "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        }
+    }
+} // namespace v4l2
@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio> // jpeglib.h needs FILE
+#include <cstring>
+#include <fmt/core.h>
+#include <jpeglib.h>
+#include <stdexcept>
+
+#include "v4l2/mjpeg_decoder.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        [[nodiscard]] constexpr std::size_t round_up(std::size_t value, std::size_t multiple) noexcept
+        {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        // 🧯 libjpeg reports fatal errors through error_exit and expects it never to return
+        struct ErrorManager
+        {
+            jpeg_error_mgr pub;
+            std::jmp_buf jump;
+        };
+
+        [[noreturn]] void on_error(j_common_ptr cinfo)
+        {
+            std::longjmp(reinterpret_cast<ErrorManager *>(cinfo->err)->jump, 1);
+        }
+
+        void on_message(j_common_ptr) {} // corrupt-data warnings are counted in num_warnings, not printed
+
+        // Geometry of one decoded component plane before the I420 repack
+        struct Plane
+        {
+            std::vector<std::uint8_t> data;
+            std::vector<JSAMPROW> rows; // one iMCU row of pointers into data
+            std::size_t stride{};
+            std::uint32_t width{};
+            std::uint32_t height{};
+            int h_samp{};
+            int v_samp{};
+        };
+
+        /*
+         * One decompressor per worker thread, reused for every frame.
+         * Raw (planar, still subsampled) output, so libjpeg skips upsampling and colour conversion.
+         */
+        class JpegWorker final
+        {
+        public:
+            JpegWorker()
+            {
+                cinfo_.err = jpeg_std_error(&err_.pub);
+                err_.pub.error_exit = on_error;
+                err_.pub.output_message = on_message;
+                jpeg_create_decompress(&cinfo_);
+            }
+            ~JpegWorker() { jpeg_destroy_decompress(&cinfo_); }
+
+            JpegWorker(const JpegWorker &) = delete;
+            JpegWorker &operator=(const JpegWorker &) = delete;
+
+            // Decode into `out` (grown as needed) and fill the geometry of `view`, false on failure
+            [[nodiscard]] bool decode(std::span<std::byte const> jpeg, unsigned scale_denom, std::vector<std::byte> &out,
+                                      DecodedView &view)
+            {
+                bool corrupt = false;
+                if (!read_planes(jpeg, scale_denom, corrupt))
+                {
+                    return false;
+                }
+                to_i420(out, view);
+                view.error = corrupt;
+                return true;
+            }
+
+        private:
+            // Only libjpeg frames sit between setjmp and longjmp, no destructor is ever skipped
+            [[nodiscard]] bool read_planes(std::span<std::byte const> jpeg, unsigned scale_denom, bool &corrupt)
+            {
+                if (setjmp(err_.jump))
+                {
+                    jpeg_abort_decompress(&cinfo_);
+                    return false;
+                }
+
+                cinfo_.err->num_warnings = 0;
+                jpeg_mem_src(&cinfo_, reinterpret_cast<const unsigned char *>(jpeg.data()), jpeg.size());
+                jpeg_read_header(&cinfo_, TRUE);
+
+                const bool ycbcr = cinfo_.num_components == 3 && cinfo_.jpeg_color_space == JCS_YCbCr;
+                const bool gray = cinfo_.num_components == 1 && cinfo_.jpeg_color_space == JCS_GRAYSCALE;
+                if (!ycbcr && !gray)
+                {
+                    jpeg_abort_decompress(&cinfo_);
+                    return false; // RGB or CMYK JPEGs do not come out of cameras
+                }
+
+                cinfo_.out_color_space = cinfo_.jpeg_color_space;
+                cinfo_.raw_data_out = TRUE;
+                cinfo_.scale_num = 1;
+                cinfo_.scale_denom = scale_denom;
+                cinfo_.dct_method = JDCT_ISLOW;
+                jpeg_start_decompress(&cinfo_);
+
+                components_ = cinfo_.num_components;
+                out_width_ = cinfo_.output_width;
+                out_height_ = cinfo_.output_height;
+                max_h_samp_ = cinfo_.max_h_samp_factor;
+                max_v_samp_ = cinfo_.max_v_samp_factor;
+                for (int ci = 0; ci < components_; ++ci)
+                {
+                    auto const &comp = cinfo_.comp_info[ci];
+                    auto &plane = planes_[static_cast<std::size_t>(ci)];
+                    const auto block = static_cast<std::size_t>(comp.DCT_scaled_size);
+                    const auto rows_per_imcu = static_cast<std::size_t>(comp.v_samp_factor) * block;
+                    // libjpeg writes whole blocks, padded out to the MCU
+                    plane.stride = (comp.width_in_blocks + static_cast<std::size_t>(cinfo_.max_h_samp_factor)) * block;
+                    plane.data.resize(plane.stride * rows_per_imcu * cinfo_.total_iMCU_rows);
+                    plane.rows.resize(rows_per_imcu);
+                    plane.width = comp.downsampled_width;
+                    plane.height = comp.downsampled_height;
+                    plane.h_samp = comp.h_samp_factor;
+                    plane.v_samp = comp.v_samp_factor;
+                }
+
+                const auto lines_per_imcu = static_cast<JDIMENSION>(cinfo_.max_v_samp_factor * cinfo_.min_DCT_scaled_size);
+                std::array<JSAMPARRAY, 3> arrays{};
+                for (JDIMENSION imcu = 0; imcu < cinfo_.total_iMCU_rows; ++imcu)
+                {
+                    for (int ci = 0; ci < components_; ++ci)
+                    {
+                        auto &plane = planes_[static_cast<std::size_t>(ci)];
+                        const std::size_t first_row = imcu * plane.rows.size();
+                        for (std::size_t r = 0; r < plane.rows.size(); ++r)
+                        {
+                            plane.rows[r] = plane.data.data() + (first_row + r) * plane.stride;
+                        }
+                        arrays[static_cast<std::size_t>(ci)] = plane.rows.data();
+                    }
+                    if (jpeg_read_raw_data(&cinfo_, arrays.data(), lines_per_imcu) == 0)
+                    {
+                        break;
+                    }
+                }
+
+                corrupt = cinfo_.err->num_warnings > 0;
+                jpeg_finish_decompress(&cinfo_);
+                return true;
+            }
+
+            // Repack the component planes as I420, averaging chroma down to 4:2:0 when the JPEG has more
+            void to_i420(std::vector<std::byte> &out, DecodedView &view) const
+            {
+                const std::uint32_t w = out_width_;
+                const std::uint32_t h = out_height_;
+                const std::size_t y_stride = round_up(w, 4);
+                const std::size_t c_width = (std::size_t{w} + 1) / 2;
+                const std::size_t c_height = (std::size_t{h} + 1) / 2;
+                const std::size_t c_stride = round_up(c_width, 4);
+
+                view.width = w;
+                view.height = h;
+                view.stride = {static_cast<std::uint32_t>(y_stride), static_cast<std::uint32_t>(c_stride),
+                               static_cast<std::uint32_t>(c_stride)};
+                view.offset = {0, y_stride * round_up(h, 2), y_stride * round_up(h, 2) + c_stride * c_height};
+                const std::size_t size = MjpegDecoder::i420_size(w, h);
+                if (out.size() < size)
+                {
+                    out.resize(size);
+                }
+                auto *dst = reinterpret_cast<std::uint8_t *>(out.data());
+
+                auto const &luma = planes_[0];
+                for (std::uint32_t y = 0; y < h; ++y)
+                {
+                    std::memcpy(dst + y * y_stride, luma.data.data() + y * luma.stride, w);
+                }
+
+                for (std::size_t ci = 1; ci < 3; ++ci)
+                {
+                    std::uint8_t *cdst = dst + view.offset[ci];
+                    if (components_ == 1)
+                    {
+                        std::memset(cdst, 128, c_stride * c_height); // grey JPEG
+                        continue;
+                    }
+                    auto const &plane = planes_[ci];
+                    // one I420 chroma sample spans 2x2 luma samples, one source sample spans
+                    // (max_h / h_samp) x (max_v / v_samp) of them
+                    const auto hs = static_cast<std::size_t>(max_h_samp_ / plane.h_samp);
+                    const auto vs = static_cast<std::size_t>(max_v_samp_ / plane.v_samp);
+                    if (hs == 2 && vs == 2)
+                    {
+                        for (std::size_t y = 0; y < c_height; ++y)
+                        {
+                            std::memcpy(cdst + y * c_stride, plane.data.data() + y * plane.stride, std::min<std::size_t>(c_width, plane.width));
+                        }
+                        continue;
+                    }
+                    for (std::size_t y = 0; y < c_height; ++y)
+                    {
+                        const std::size_t y0 = std::min<std::size_t>(2 * y / vs, plane.height - 1);
+                        const std::size_t y1 = std::min<std::size_t>(std::max(y0 + 1, (2 * y + 2 + vs - 1) / vs), plane.height);
+                        for (std::size_t x = 0; x < c_width; ++x)
+                        {
+                            const std::size_t x0 = std::min<std::size_t>(2 * x / hs, plane.width - 1);
+                            const std::size_t x1 = std::min<std::size_t>(std::max(x0 + 1, (2 * x + 2 + hs - 1) / hs), plane.width);
+                            unsigned sum = 0;
+                            for (std::size_t sy = y0; sy < y1; ++sy)
+                            {
+                                for (std::size_t sx = x0; sx < x1; ++sx)
+                                {
+                                    sum += plane.data[sy * plane.stride + sx];
+                                }
+                            }
+                            const auto count = static_cast<unsigned>((y1 - y0) * (x1 - x0));
+                            cdst[y * c_stride + x] = static_cast<std::uint8_t>((sum + count / 2) / count);
+                        }
+                    }
+                }
+            }
+
+            jpeg_decompress_struct cinfo_{};
+            ErrorManager err_{};
+            std::array<Plane, 3> planes_;
+            int components_{};
+            int max_h_samp_{};
+            int max_v_samp_{};
+            std::uint32_t out_width_{};
+            std::uint32_t out_height_{};
+        };
+    } // namespace
+
+    DecodedFrame::DecodedFrame(MjpegDecoder *decoder, std::size_t slot, const DecodedView &view) noexcept
+        : decoder_(decoder),
+          slot_(slot),
+          view_(view)
+    {
+    }
+
+    DecodedFrame::~DecodedFrame() noexcept
+    {
+        release();
+    }
+
+    DecodedFrame::DecodedFrame(DecodedFrame &&other) noexcept
+        : decoder_(std::exchange(other.decoder_, nullptr)),
+          slot_(other.slot_),
+          view_(other.view_)
+    {
+    }
+
+    DecodedFrame &DecodedFrame::operator=(DecodedFrame &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            decoder_ = std::exchange(other.decoder_, nullptr);
+            slot_ = other.slot_;
+            view_ = other.view_;
+        }
+        return *this;
+    }
+
+    void DecodedFrame::release() noexcept
+    {
+        if (auto *decoder = std::exchange(decoder_, nullptr))
+        {
+            decoder->release_slot(slot_);
+        }
+    }
+
+    MjpegDecoder::MjpegDecoder(const MjpegDecoderConfig &config)
+        : config_(config)
+    {
+        if (config_.threads_ == 0)
+        {
+            throw std::invalid_argument("MjpegDecoder: needs at least one thread");
+        }
+        if (config_.scale_denom_ != 1 && config_.scale_denom_ != 2 && config_.scale_denom_ != 4 && config_.scale_denom_ != 8)
+        {
+            throw std::invalid_argument(fmt::format("MjpegDecoder: scale 1/{} is not 1, 1/2, 1/4 or 1/8", config_.scale_denom_));
+        }
+        if (config_.output_buffers_ == 0)
+        {
+            config_.output_buffers_ = config_.threads_ + 2;
+        }
+
+        // output images are sized on first use, a resolution change just grows them
+        slots_.resize(config_.output_buffers_);
+        for (std::size_t slot = slots_.size(); slot > 0; --slot)
+        {
+            free_slots_.push_back(slot - 1);
+        }
+
+        workers_.reserve(config_.threads_);
+        for (unsigned i = 0; i < config_.threads_; ++i)
+        {
+            workers_.emplace_back([this](std::stop_token stop)
+                                  { run(stop); });
+        }
+    }
+
+    MjpegDecoder::~MjpegDecoder() noexcept
+    {
+        for (auto &worker : workers_)
+        {
+            worker.request_stop(); // wakes work_cv_ waits through the stop token
+        }
+        workers_.clear(); // joins
+    }
+
+    void MjpegDecoder::submit(const FrameView &frame)
+    {
+        // the scan already found EOI, the zero padding UVC drivers add after it is not worth copying
+        auto const jpeg = frame.jpeg && frame.jpeg->ok() ? frame.image.first(frame.jpeg->size) : frame.image;
+        Job job;
+        job.bytes.assign(jpeg.begin(), jpeg.end());
+        job.frame = frame;
+        job.frame.image = job.bytes;
+        enqueue(std::move(job));
+    }
+
+    void MjpegDecoder::submit(FrameLease &&lease)
+    {
+        Job job;
+        job.frame = lease.view();
+        job.lease.emplace(std::move(lease));
+        enqueue(std::move(job));
+    }
+
+    void MjpegDecoder::enqueue(Job &&job)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            job.ticket = next_ticket_++;
+            jobs_.push_back(std::move(job));
+        }
+        work_cv_.notify_one();
+    }
+
+    [[nodiscard]] std::optional<DecodedFrame> MjpegDecoder::pop(std::chrono::microseconds timeout)
+    {
+        std::unique_lock lock(mutex_);
+        auto const ready = [this]
+        { return done_.contains(next_out_); };
+        if (timeout.count() < 0)
+        {
+            done_cv_.wait(lock, ready);
+        }
+        else if (!done_cv_.wait_for(lock, timeout, ready))
+        {
+            return std::nullopt;
+        }
+
+        auto node = done_.extract(next_out_++);
+        return DecodedFrame{this, node.mapped().slot, node.mapped().view};
+    }
+
+    [[nodiscard]] std::size_t MjpegDecoder::pending() const
+    {
+        std::lock_guard lock(mutex_);
+        return next_ticket_ - next_out_;
+    }
+
+    [[nodiscard]] std::pair<std::uint32_t, std::uint32_t> MjpegDecoder::scaled_size(std::uint32_t width, std::uint32_t height,
+                                                                                    unsigned scale_denom) noexcept
+    {
+        const unsigned d = scale_denom == 0 ? 1 : scale_denom;
+        return {(width + d - 1) / d, (height + d - 1) / d};
+    }
+
+    [[nodiscard]] std::size_t MjpegDecoder::i420_size(std::uint32_t width, std::uint32_t height) noexcept
+    {
+        const std::size_t c_stride = round_up((std::size_t{width} + 1) / 2, 4);
+        const std::size_t c_height = (std::size_t{height} + 1) / 2;
+        return round_up(width, 4) * round_up(height, 2) + 2 * c_stride * c_height;
+    }
+
+    void MjpegDecoder::release_slot(std::size_t slot) noexcept
+    {
+        {
+            std::lock_guard lock(mutex_);
+            free_slots_.push_back(slot);
+        }
+        work_cv_.notify_one();
+    }
+
+    void MjpegDecoder::run(std::stop_token stop) noexcept
+    {
+        JpegWorker worker;
+        while (true)
+        {
+            Job job;
+            std::size_t slot = 0;
+            {
+                std::unique_lock lock(mutex_);
+                // job and slot taken together, in ticket order: a later frame never holds the slot an earlier one waits for
+                if (!work_cv_.wait(lock, stop, [this]
+                                   { return !jobs_.empty() && !free_slots_.empty(); }))
+                {
+                    return; // stop requested
+                }
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+                slot = free_slots_.back();
+                free_slots_.pop_back();
+            }
+
+            DecodedView view{
+                .sequence = job.frame.sequence,
+                .timestamp_monotonic_us = job.frame.timestamp_monotonic_us,
+                .v4l2_timestamp_us = job.frame.v4l2_timestamp_us,
+                .flags = job.frame.flags,
+            };
+            auto &out = slots_[slot]; // ours until the result is popped and released
+            bool decoded = false;
+            try
+            {
+                decoded = worker.decode(job.frame.image, config_.scale_denom_, out, view);
+            }
+            catch (const std::exception &e)
+            {
+                V4L2_TRACE(WARN, "MjpegDecoder: frame {} failed: {}", view.sequence, e.what());
+            }
+            if (decoded)
+            {
+                view.image = std::span<std::byte const>(out.data(), i420_size(view.width, view.height));
+            }
+            else
+            {
+                view.error = true;
+            }
+            job.lease.reset(); // 🔁 driver buffer back before the result is published
+
+            {
+                std::lock_guard lock(mutex_);
+                done_.emplace(job.ticket, Result{slot, view});
+            }
+            done_cv_.notify_one();
+        }
+    }
+} // namespace v4l2
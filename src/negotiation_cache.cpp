@@ -0,0 +1,144 @@
+#include <fmt/core.h>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <unistd.h>
+
+#include "v4l2/negotiation_cache.hpp"
+#include "v4l2/trace.hpp"
+#include "v4l2/usb_bandwidth.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        constexpr std::string_view MAGIC = "v4l2-negotiation";
+        constexpr int VERSION = 1;
+
+        [[nodiscard]] std::filesystem::path file_for(const std::filesystem::path &dir, const std::string &key)
+        {
+            return dir / (key + ".cache");
+        }
+    } // namespace
+
+    std::string negotiation_key(const V4lCaps &caps, const std::string &device_path)
+    {
+        auto const topology = usb_topology(device_path, caps.bus_info);
+        auto const &where = topology && !topology->serial.empty() ? topology->serial : caps.bus_info;
+        std::string key = fmt::format("{}-{}-{}", caps.driver, caps.card, where);
+        // a file name: whatever is not plain goes
+        for (auto &c : key)
+        {
+            const bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+            c = plain ? c : '_';
+        }
+        return key;
+    }
+
+    std::optional<NegotiationRecord> load_negotiation(const std::filesystem::path &dir, const std::string &key)
+    {
+        std::ifstream in(file_for(dir, key));
+        if (!in)
+        {
+            return std::nullopt;
+        }
+
+        // v4l2-negotiation 1
+        // request <fourcc> <width> <height> <fps num> <fps den>
+        // result <fourcc> <width> <height> <bytes per line> <fps num> <fps den>
+        // mode <fourcc> <width> <height> <num>/<den>...    (one line per mode, fastest rate first)
+        std::string magic;
+        int version = 0;
+        if (!(in >> magic >> version) || magic != MAGIC || version != VERSION)
+        {
+            return std::nullopt;
+        }
+
+        NegotiationRecord record{};
+        bool have_request = false;
+        bool have_result = false;
+        std::string line;
+        std::getline(in, line);
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            std::string tag;
+            std::uint32_t fourcc = 0;
+            std::uint32_t width = 0;
+            std::uint32_t height = 0;
+            fields >> tag >> std::hex >> fourcc >> std::dec >> width >> height;
+            if (tag == "request")
+            {
+                have_request = static_cast<bool>(fields >> record.requested_rate.numerator >> record.requested_rate.denominator);
+                record.requested_format = static_cast<PixelFormat>(fourcc);
+                record.requested_dimension = to_dimension(width, height);
+            }
+            else if (tag == "result")
+            {
+                have_result = static_cast<bool>(fields >> record.bytes_per_line >> record.rate.numerator >> record.rate.denominator);
+                record.format = static_cast<PixelFormat>(fourcc);
+                record.dimension = to_dimension(width, height);
+            }
+            else if (tag == "mode" && fields)
+            {
+                CaptureMode mode{.format = static_cast<PixelFormat>(fourcc), .width = width, .height = height, .frame_rates = {}};
+                FrameRate rate{};
+                char slash = 0;
+                while (fields >> rate.numerator >> slash >> rate.denominator && slash == '/')
+                {
+                    mode.frame_rates.push_back(rate);
+                }
+                record.modes.push_back(std::move(mode));
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+        if (!have_request || !have_result)
+        {
+            return std::nullopt;
+        }
+        return record;
+    }
+
+    void store_negotiation(const std::filesystem::path &dir, const std::string &key, const NegotiationRecord &record) noexcept
+    {
+        try
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(dir, ec);
+            auto const path = file_for(dir, key);
+            auto const temp = std::filesystem::path(path).concat(fmt::format(".{}.tmp", getpid()));
+            {
+                auto const [rw, rh] = dimensions_decompress(static_cast<std::uint32_t>(record.requested_dimension));
+                auto const [w, h] = dimensions_decompress(static_cast<std::uint32_t>(record.dimension));
+                std::ofstream out(temp, std::ios::trunc);
+                out << fmt::format("{} {}\n", MAGIC, VERSION);
+                out << fmt::format("request {:08x} {} {} {} {}\n", static_cast<std::uint32_t>(record.requested_format), rw, rh,
+                                   record.requested_rate.numerator, record.requested_rate.denominator);
+                out << fmt::format("result {:08x} {} {} {} {} {}\n", static_cast<std::uint32_t>(record.format), w, h,
+                                   record.bytes_per_line, record.rate.numerator, record.rate.denominator);
+                for (auto const &mode : record.modes)
+                {
+                    out << fmt::format("mode {:08x} {} {}", static_cast<std::uint32_t>(mode.format), mode.width, mode.height);
+                    for (auto const &rate : mode.frame_rates)
+                    {
+                        out << fmt::format(" {}/{}", rate.numerator, rate.denominator);
+                    }
+                    out << '\n';
+                }
+                out.flush();
+                if (!out)
+                {
+                    throw std::runtime_error(fmt::format("cannot write {}", temp.string()));
+                }
+            }
+            std::filesystem::rename(temp, path);
+        }
+        catch (const std::exception &e)
+        {
+            V4L2_TRACE(WARN, "negotiation cache not written: {}", e.what());
+        }
+    }
+} // namespace v4l2
@@ -0,0 +1,829 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <linux/io_uring.h>
+#include <new>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "v4l2/recorder.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        constexpr std::uint32_t RECORDING_VERSION = 1;
+        constexpr std::size_t DIRECT_ALIGNMENT = 4096; // covers 512 and 4K logical blocks
+        constexpr std::size_t BUFFERED_ALIGNMENT = 64;
+        constexpr std::uint64_t STOP_TOKEN = ~std::uint64_t{0}; // user_data of the NOP that ends the completion thread
+
+        static_assert(sizeof(RecordingHeader) <= BUFFERED_ALIGNMENT && sizeof(RecordHeader) <= BUFFERED_ALIGNMENT);
+
+        [[nodiscard]] constexpr std::size_t round_up(std::size_t value, std::size_t multiple) noexcept
+        {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        [[nodiscard]] std::size_t page_size() noexcept
+        {
+            static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        [[nodiscard]] std::byte *aligned_bytes(std::size_t size)
+        {
+            void *memory = std::aligned_alloc(DIRECT_ALIGNMENT, round_up(size, DIRECT_ALIGNMENT));
+            if (memory == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<std::byte *>(memory);
+        }
+
+        // Whole-buffer synchronous write, segment headers and the index only
+        void write_fully(int fd, const std::byte *data, std::size_t size, std::uint64_t offset, const std::string &path)
+        {
+            while (size > 0)
+            {
+                const ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+                if (written < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (written <= 0)
+                {
+                    throw std::runtime_error(fmt::format("write to {} failed: {}", path, written < 0 ? strerror(errno) : "short write"));
+                }
+                data += written;
+                size -= static_cast<std::size_t>(written);
+                offset += static_cast<std::uint64_t>(written);
+            }
+        }
+
+        void read_fully(int fd, void *data, std::size_t size, std::uint64_t offset)
+        {
+            auto *out = static_cast<std::byte *>(data);
+            while (size > 0)
+            {
+                const ssize_t got = pread(fd, out, size, static_cast<off_t>(offset));
+                if (got < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (got <= 0)
+                {
+                    throw std::runtime_error(fmt::format("recording read failed: {}", got < 0 ? strerror(errno) : "unexpected end of file"));
+                }
+                out += got;
+                size -= static_cast<std::size_t>(got);
+                offset += static_cast<std::uint64_t>(got);
+            }
+        }
+    } // namespace
+
+    /*
+     * 💍 Just enough io_uring for one submitter and one reaper thread, straight on the syscalls
+     * so liburing is not a dependency. No SQPOLL: io_uring_enter() consumes the entry right away.
+     */
+    struct Recorder::Uring
+    {
+        int fd = -1;
+        void *sq_ring = MAP_FAILED;
+        std::size_t sq_ring_size{};
+        void *cq_ring = MAP_FAILED;
+        std::size_t cq_ring_size{};
+        void *sqe_memory = MAP_FAILED;
+        std::size_t sqe_size{};
+        unsigned *sq_tail{};
+        unsigned *sq_mask{};
+        unsigned *sq_array{};
+        unsigned *cq_head{};
+        unsigned *cq_tail{};
+        unsigned *cq_mask{};
+        io_uring_cqe *cqes{};
+        int wake_fd = -1; // eventfd, cuts wait() short when the stop NOP cannot be queued
+
+        Uring() noexcept = default;
+        Uring(const Uring &) = delete;
+        Uring &operator=(const Uring &) = delete;
+
+        ~Uring() noexcept
+        {
+            if (sqe_memory != MAP_FAILED)
+            {
+                munmap(sqe_memory, sqe_size);
+            }
+            if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+            {
+                munmap(cq_ring, cq_ring_size);
+            }
+            if (sq_ring != MAP_FAILED)
+            {
+                munmap(sq_ring, sq_ring_size);
+            }
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            if (wake_fd >= 0)
+            {
+                ::close(wake_fd);
+            }
+        }
+
+        // nullptr when the kernel (or a seccomp filter) says no
+        [[nodiscard]] static std::unique_ptr<Uring> create(unsigned entries) noexcept
+        {
+            auto ring = std::make_unique<Uring>();
+            io_uring_params params{};
+            ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (ring->fd < 0)
+            {
+                V4L2_TRACE(INFO, "Recorder: io_uring unavailable ({}), writing with pwritev", strerror(errno));
+                return nullptr;
+            }
+
+            ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap)
+            {
+                ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+            }
+            ring->sq_ring = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                                 IORING_OFF_SQ_RING);
+            if (ring->sq_ring == MAP_FAILED)
+            {
+                return nullptr;
+            }
+            ring->cq_ring = single_mmap ? ring->sq_ring
+                                        : mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                               ring->fd, IORING_OFF_CQ_RING);
+            ring->sqe_size = params.sq_entries * sizeof(io_uring_sqe);
+            ring->sqe_memory = mmap(nullptr, ring->sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                                    IORING_OFF_SQES);
+            if (ring->cq_ring == MAP_FAILED || ring->sqe_memory == MAP_FAILED)
+            {
+                return nullptr;
+            }
+
+            auto *sq = static_cast<std::byte *>(ring->sq_ring);
+            auto *cq = static_cast<std::byte *>(ring->cq_ring);
+            ring->sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            ring->sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            ring->sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            ring->cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            ring->cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            ring->cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            ring->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+            ring->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (ring->wake_fd < 0)
+            {
+                return nullptr;
+            }
+            return ring;
+        }
+
+        // Submitter thread only. Returns 0 or -errno.
+        [[nodiscard]] int push(const io_uring_sqe &entry) noexcept
+        {
+            const unsigned tail = *sq_tail;
+            const unsigned index = tail & *sq_mask;
+            static_cast<io_uring_sqe *>(sqe_memory)[index] = entry;
+            sq_array[index] = index;
+            std::atomic_ref<unsigned>(*sq_tail).store(tail + 1, std::memory_order_release);
+            while (true)
+            {
+                const long submitted = syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0);
+                if (submitted > 0)
+                {
+                    return 0;
+                }
+                if (submitted == 0)
+                {
+                    continue;
+                }
+                if (errno != EINTR && errno != EAGAIN)
+                {
+                    return -errno;
+                }
+            }
+        }
+
+        // Reaper thread only: hand every completion to `handle`, then sleep until the next one
+        template <typename Handler>
+        void reap(Handler &&handle) noexcept
+        {
+            unsigned head = *cq_head;
+            const unsigned tail = std::atomic_ref<unsigned>(*cq_tail).load(std::memory_order_acquire);
+            for (; head != tail; ++head)
+            {
+                const io_uring_cqe &cqe = cqes[head & *cq_mask];
+                handle(cqe.user_data, cqe.res);
+            }
+            std::atomic_ref<unsigned>(*cq_head).store(head, std::memory_order_release);
+        }
+
+        // Until a completion is there or wake() was called: the ring fd polls readable with a CQE waiting
+        void wait() noexcept
+        {
+            std::array<pollfd, 2> fds{{{.fd = fd, .events = POLLIN, .revents = 0},
+                                       {.fd = wake_fd, .events = POLLIN, .revents = 0}}};
+            if (poll(fds.data(), fds.size(), -1) > 0 && fds[1].revents != 0)
+            {
+                std::uint64_t count = 0;
+                [[maybe_unused]] auto const consumed = read(wake_fd, &count, sizeof(count));
+            }
+        }
+
+        void wake() noexcept
+        {
+            const std::uint64_t one = 1;
+            [[maybe_unused]] auto const written = write(wake_fd, &one, sizeof(one));
+        }
+    };
+
+    Recorder::Recorder(const RecorderConfig &config) : config_(config)
+    {
+        if (config_.path_.empty() || config_.queue_depth_ == 0)
+        {
+            throw std::invalid_argument("Recorder needs a path and a queue depth of at least 1");
+        }
+        if (config_.ring_duration_.count() > 0 && config_.segment_duration_.count() <= 0)
+        {
+            throw std::invalid_argument("Recorder ring mode needs a positive segment_duration_");
+        }
+
+        headers_.reset(aligned_bytes(config_.queue_depth_ * DIRECT_ALIGNMENT));
+        writes_.resize(config_.queue_depth_);
+        for (std::size_t slot = 0; slot < writes_.size(); ++slot)
+        {
+            writes_[slot].header = headers_.get() + slot * DIRECT_ALIGNMENT;
+            free_.push_back(slot);
+        }
+
+        if (config_.io_uring_)
+        {
+            // one spare entry for the NOP that stops the completion thread
+            uring_ = Uring::create(config_.queue_depth_ + 1);
+        }
+        thread_ = std::jthread([this](std::stop_token stop) { run(stop); });
+    }
+
+    Recorder::~Recorder() noexcept
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::exception &ex)
+        {
+            V4L2_TRACE(WARN, "Recorder: {}", ex.what());
+        }
+
+        if (uring_)
+        {
+            // the spare entry guarantees room for it
+            io_uring_sqe nop{};
+            nop.opcode = IORING_OP_NOP;
+            nop.user_data = STOP_TOKEN;
+            if (const int err = uring_->push(nop); err < 0)
+            {
+                // 🛑 without the NOP the thread would sleep in the ring for good: stop it by hand
+                V4L2_TRACE(WARN, "Recorder: cannot queue the stop NOP: {}, waking the completion thread", strerror(-err));
+                thread_.request_stop();
+                uring_->wake();
+            }
+            thread_.join();
+        }
+        else
+        {
+            thread_.request_stop();
+            thread_.join();
+        }
+    }
+
+    void Recorder::record(FrameLease &&lease)
+    {
+        const FrameView frame = lease.view();
+        enqueue(frame, std::optional<FrameLease>(std::move(lease)));
+    }
+
+    void Recorder::record(const FrameView &frame)
+    {
+        enqueue(frame, std::nullopt);
+    }
+
+    void Recorder::enqueue(const FrameView &frame, std::optional<FrameLease> &&lease)
+    {
+        throw_if_failed();
+        if (closed_)
+        {
+            throw std::runtime_error(fmt::format("Recorder for {} is closed", config_.path_));
+        }
+
+        // 🔄 ring mode: a new segment every segment_duration_, the old ones go once they fall out of the window
+        if (fd_ < 0)
+        {
+            open_segment(frame);
+        }
+        else if (config_.ring_duration_.count() > 0)
+        {
+            // a stamp before the segment start (a looped replay, a clock that was set back) starts a new one
+            // as well, the elapsed time would wrap
+            const bool backwards = frame.timestamp_monotonic_us < segment_start_us_;
+            if (backwards || frame.timestamp_monotonic_us - segment_start_us_ >=
+                                 static_cast<std::uint64_t>(std::chrono::microseconds(config_.segment_duration_).count()))
+            {
+                drain();
+                finish_segment(backwards ? (index_.empty() ? segment_start_us_ : index_.back().timestamp_monotonic_us)
+                                         : frame.timestamp_monotonic_us);
+                throw_if_failed();
+                open_segment(frame);
+            }
+        }
+
+        std::size_t slot = 0;
+        bool in_place_allowed = false;
+        {
+            std::unique_lock lock(mutex_);
+            slot_cv_.wait(lock, [&] { return !free_.empty() || !error_.empty(); });
+            if (!error_.empty())
+            {
+                throw std::runtime_error(error_);
+            }
+            slot = free_.back();
+            free_.pop_back();
+            in_place_allowed = in_place_;
+        }
+
+        Write &write = writes_[slot];
+        // 🧅 NV12M, NV16M: the CbCr buffer is written right after the Y one, the record holds the frame as NV12 would
+        auto const image_end = frame.image.data() + frame.image.size();
+        const bool split = frame.plane_count > 1 && !frame.planes[1].data.empty() &&
+                           (frame.planes[1].data.data() < frame.image.data() || frame.planes[1].data.data() >= image_end);
+        const std::span<std::byte const> second = split ? frame.planes[1].data : std::span<std::byte const>{};
+        const std::size_t size = frame.image.size() + second.size();
+        const std::size_t padded = round_up(size, alignment_);
+
+        const RecordHeader header{
+            .magic = RECORD_MAGIC,
+            .sequence = frame.sequence,
+            .timestamp_monotonic_us = frame.timestamp_monotonic_us,
+            .v4l2_timestamp_us = frame.v4l2_timestamp_us,
+            .size = size,
+            .flags = frame.flags,
+            .error = frame.error ? 1u : 0u,
+        };
+        std::memset(write.header, 0, alignment_);
+        std::memcpy(write.header, &header, sizeof(header));
+
+        // 🎯 in place when the padded write cannot leave the pages the frame is on
+        const auto address = reinterpret_cast<std::uintptr_t>(frame.image.data());
+        const bool in_place = lease.has_value() && in_place_allowed && !split && address % alignment_ == 0 &&
+                              alignment_ <= page_size();
+        const std::byte *source = frame.image.data();
+        if (!in_place && size > 0)
+        {
+            if (write.bounce_capacity < padded)
+            {
+                write.bounce.reset(aligned_bytes(padded));
+                write.bounce_capacity = padded;
+            }
+            std::memcpy(write.bounce.get(), frame.image.data(), frame.image.size());
+            if (split)
+            {
+                std::memcpy(write.bounce.get() + frame.image.size(), second.data(), second.size());
+            }
+            std::memset(write.bounce.get() + size, 0, padded - size);
+            source = write.bounce.get();
+            if (lease.has_value())
+            {
+                lease.reset(); // copied, the driver can have it back
+                std::lock_guard lock(mutex_);
+                stats_.bounced++;
+            }
+        }
+
+        write.iov[0] = iovec{write.header, alignment_};
+        write.iov[1] = iovec{const_cast<std::byte *>(source), padded};
+        write.size = size;
+        write.length = alignment_ + (size > 0 ? padded : 0);
+        write.offset = offset_;
+        write.fd = fd_;
+        write.lease = std::move(lease);
+
+        index_.push_back(RecordIndexEntry{
+            .offset = offset_,
+            .timestamp_monotonic_us = frame.timestamp_monotonic_us,
+            .size = size,
+            .sequence = frame.sequence,
+        });
+        offset_ += write.length;
+        submit(slot);
+    }
+
+    void Recorder::open_segment(const FrameView &frame)
+    {
+        ++segment_number_;
+        path_ = config_.ring_duration_.count() > 0 ? fmt::format("{}.{:06}.v4lr", config_.path_, segment_number_) : config_.path_;
+
+        // O_DIRECT decided on the first file, tmpfs and some FUSE mounts refuse it with EINVAL
+        const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        const bool try_direct = config_.direct_ && (segment_number_ == 1 || direct_);
+        int fd = try_direct ? open(path_.c_str(), flags | O_DIRECT, 0644) : -1;
+        if (fd < 0 && try_direct && errno != EINVAL)
+        {
+            throw std::runtime_error(fmt::format("cannot create recording {}: {}", path_, strerror(errno)));
+        }
+        if (fd < 0)
+        {
+            if (try_direct)
+            {
+                V4L2_TRACE(INFO, "Recorder: {} refuses O_DIRECT, writing through the page cache", path_);
+            }
+            fd = open(path_.c_str(), flags, 0644);
+        }
+        if (fd < 0)
+        {
+            throw std::runtime_error(fmt::format("cannot create recording {}: {}", path_, strerror(errno)));
+        }
+        if (segment_number_ == 1)
+        {
+            direct_ = try_direct && (fcntl(fd, F_GETFL) & O_DIRECT) != 0;
+            alignment_ = direct_ ? DIRECT_ALIGNMENT : BUFFERED_ALIGNMENT;
+        }
+
+        const RecordingHeader header{
+            .magic = RECORDING_MAGIC,
+            .version = RECORDING_VERSION,
+            .alignment = static_cast<std::uint32_t>(alignment_),
+            .format = frame.format,
+            .width = frame.width,
+            .height = frame.height,
+            .bytes_per_line = frame.bytes_per_line,
+        };
+        const std::unique_ptr<std::byte, void (*)(void *)> block(aligned_bytes(alignment_), std::free);
+        std::memset(block.get(), 0, alignment_);
+        std::memcpy(block.get(), &header, sizeof(header));
+        try
+        {
+            write_fully(fd, block.get(), alignment_, 0, path_);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+
+        fd_ = fd;
+        offset_ = alignment_;
+        segment_start_us_ = frame.timestamp_monotonic_us;
+        index_.clear();
+        std::lock_guard lock(mutex_);
+        stats_.segments++;
+    }
+
+    void Recorder::finish_segment(std::uint64_t end_us)
+    {
+        // 📇 index and trailer in one aligned block run, the trailer ends exactly at the end of the file
+        const std::size_t index_bytes = index_.size() * sizeof(RecordIndexEntry);
+        const std::size_t total = round_up(index_bytes + sizeof(RecordTrailer), alignment_);
+        const std::unique_ptr<std::byte, void (*)(void *)> block(aligned_bytes(total), std::free);
+        std::memset(block.get(), 0, total);
+        if (index_bytes > 0)
+        {
+            std::memcpy(block.get(), index_.data(), index_bytes);
+        }
+        const RecordTrailer trailer{.index_offset = offset_, .frames = index_.size(), .magic = TRAILER_MAGIC};
+        std::memcpy(block.get() + total - sizeof(trailer), &trailer, sizeof(trailer));
+
+        const int fd = fd_;
+        fd_ = -1;
+        try
+        {
+            write_fully(fd, block.get(), total, offset_, path_);
+            if (fdatasync(fd) < 0)
+            {
+                throw std::runtime_error(fmt::format("fdatasync({}) failed: {}", path_, strerror(errno)));
+            }
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        V4L2_TRACE(DEBUG, "Recorder: closed {} with {} frames", path_, index_.size());
+
+        if (config_.ring_duration_.count() > 0)
+        {
+            segments_.emplace_back(path_, end_us);
+            const auto window = static_cast<std::uint64_t>(std::chrono::microseconds(config_.ring_duration_).count());
+            while (!segments_.empty() && segments_.front().second + window < end_us)
+            {
+                if (unlink(segments_.front().first.c_str()) < 0)
+                {
+                    V4L2_TRACE(WARN, "Recorder: cannot remove old segment {}: {}", segments_.front().first, strerror(errno));
+                }
+                segments_.pop_front();
+            }
+        }
+    }
+
+    void Recorder::close()
+    {
+        if (closed_)
+        {
+            return;
+        }
+        closed_ = true;
+        drain();
+        if (fd_ >= 0)
+        {
+            finish_segment(index_.empty() ? segment_start_us_ : index_.back().timestamp_monotonic_us);
+        }
+        throw_if_failed();
+    }
+
+    void Recorder::drain()
+    {
+        std::unique_lock lock(mutex_);
+        slot_cv_.wait(lock, [&] { return free_.size() == writes_.size(); });
+    }
+
+    void Recorder::submit(std::size_t slot)
+    {
+        Write &write = writes_[slot];
+        if (uring_)
+        {
+            io_uring_sqe entry{};
+            entry.opcode = IORING_OP_WRITEV;
+            entry.fd = write.fd;
+            entry.off = write.offset;
+            entry.addr = reinterpret_cast<std::uint64_t>(write.iov.data());
+            entry.len = write.size > 0 ? 2 : 1;
+            entry.user_data = slot;
+            if (const int err = uring_->push(entry); err < 0)
+            {
+                complete(slot, err);
+            }
+            return;
+        }
+        {
+            std::lock_guard lock(mutex_);
+            pending_.push_back(slot);
+        }
+        work_cv_.notify_one();
+    }
+
+    long Recorder::rewrite_bounced(Write &write) noexcept
+    {
+        {
+            std::lock_guard lock(mutex_);
+            if (in_place_)
+            {
+                in_place_ = false;
+                V4L2_TRACE(WARN, "Recorder: the driver buffers cannot be the source of a direct write, copying every frame from now on");
+            }
+            stats_.bounced++;
+        }
+
+        const std::size_t padded = write.iov[1].iov_len;
+        if (write.bounce_capacity < padded)
+        {
+            try
+            {
+                write.bounce.reset(aligned_bytes(padded));
+            }
+            catch (const std::bad_alloc &)
+            {
+                return -ENOMEM;
+            }
+            write.bounce_capacity = padded;
+        }
+        // the lease is still held, so the driver memory holds this frame; userspace may read it, only the kernel's
+        // page pinning for O_DIRECT refused it
+        std::memcpy(write.bounce.get(), write.iov[1].iov_base, write.size);
+        std::memset(write.bounce.get() + write.size, 0, padded - write.size);
+        write.iov[1].iov_base = write.bounce.get();
+
+        ssize_t written = 0;
+        do
+        {
+            written = pwritev(write.fd, write.iov.data(), 2, static_cast<off_t>(write.offset));
+        } while (written < 0 && errno == EINTR);
+        return written < 0 ? -errno : written;
+    }
+
+    void Recorder::complete(std::size_t slot, long result) noexcept
+    {
+        // 🩹 VM_PFNMAP and dma-contig buffers cannot be pinned for O_DIRECT: write this one again from a copy, here
+        // and synchronously since it happens once per write already in flight, and copy every frame from now on
+        // (a write still holding its lease is an in-place one, the copying path gives the lease back first)
+        if (result == -EFAULT && writes_[slot].lease.has_value() && writes_[slot].size > 0)
+        {
+            result = rewrite_bounced(writes_[slot]);
+        }
+
+        std::optional<FrameLease> lease;
+        {
+            std::lock_guard lock(mutex_);
+            Write &write = writes_[slot];
+            if (result < 0 || static_cast<std::size_t>(result) != write.length)
+            {
+                if (error_.empty())
+                {
+                    error_ = fmt::format("recording write at offset {} failed: {}", write.offset,
+                                         result < 0 ? strerror(static_cast<int>(-result)) : "short write");
+                    V4L2_TRACE(WARN, "Recorder: {}", error_);
+                }
+            }
+            else
+            {
+                stats_.frames++;
+                stats_.bytes += write.size;
+            }
+            lease = std::move(write.lease);
+            write.lease.reset();
+            free_.push_back(slot);
+        }
+        slot_cv_.notify_all();
+        // ♻️ QBUF outside the lock, the recording thread may be waiting for a slot meanwhile
+        lease.reset();
+    }
+
+    void Recorder::run(std::stop_token stop) noexcept
+    {
+        if (uring_)
+        {
+            bool stopping = false;
+            while (!stopping && !stop.stop_requested())
+            {
+                uring_->reap(
+                    [&](std::uint64_t user_data, int result)
+                    {
+                        if (user_data == STOP_TOKEN)
+                        {
+                            stopping = true;
+                            return;
+                        }
+                        complete(user_data, result);
+                    });
+                if (!stopping)
+                {
+                    uring_->wait();
+                }
+            }
+            return;
+        }
+
+        // pwritev fallback: same completion path, one write at a time
+        while (true)
+        {
+            std::size_t slot = 0;
+            {
+                std::unique_lock lock(mutex_);
+                work_cv_.wait(lock, stop, [&] { return !pending_.empty(); });
+                if (pending_.empty())
+                {
+                    return;
+                }
+                slot = pending_.front();
+                pending_.pop_front();
+            }
+            const Write &write = writes_[slot];
+            ssize_t written = 0;
+            do
+            {
+                written = pwritev(write.fd, write.iov.data(), write.size > 0 ? 2 : 1, static_cast<off_t>(write.offset));
+            } while (written < 0 && errno == EINTR);
+            complete(slot, written < 0 ? -errno : written);
+        }
+    }
+
+    void Recorder::throw_if_failed() const
+    {
+        std::lock_guard lock(mutex_);
+        if (!error_.empty())
+        {
+            throw std::runtime_error(error_);
+        }
+    }
+
+    RecorderStats Recorder::stats() const
+    {
+        std::lock_guard lock(mutex_);
+        return stats_;
+    }
+
+    std::string Recorder::current_path() const
+    {
+        return path_;
+    }
+
+    bool Recorder::uses_io_uring() const noexcept
+    {
+        return uring_ != nullptr;
+    }
+
+    RecordingReader::RecordingReader(const std::string &path)
+    {
+        fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0)
+        {
+            throw std::runtime_error(fmt::format("cannot open recording {}: {}", path, strerror(errno)));
+        }
+        try
+        {
+            struct stat st{};
+            fstat(fd_, &st);
+            const auto file_size = static_cast<std::uint64_t>(st.st_size);
+            auto &header = header_;
+            if (file_size < sizeof(header))
+            {
+                throw std::runtime_error(fmt::format("{} is not a recording", path));
+            }
+            read_fully(fd_, &header, sizeof(header), 0);
+            if (header.magic != RECORDING_MAGIC || header.version != RECORDING_VERSION || header.alignment == 0)
+            {
+                throw std::runtime_error(fmt::format("{} is not a version {} recording", path, RECORDING_VERSION));
+            }
+            alignment_ = header.alignment;
+
+            RecordTrailer trailer{};
+            if (file_size >= alignment_ + sizeof(trailer))
+            {
+                read_fully(fd_, &trailer, sizeof(trailer), file_size - sizeof(trailer));
+            }
+            if (trailer.magic == TRAILER_MAGIC && trailer.index_offset + trailer.frames * sizeof(RecordIndexEntry) <= file_size)
+            {
+                index_.resize(trailer.frames);
+                if (!index_.empty())
+                {
+                    read_fully(fd_, index_.data(), index_.size() * sizeof(RecordIndexEntry), trailer.index_offset);
+                }
+                complete_ = true;
+                return;
+            }
+
+            // 🩹 no trailer: walk the records up to the first one that is cut off
+            std::uint64_t offset = alignment_;
+            while (offset + sizeof(RecordHeader) <= file_size)
+            {
+                RecordHeader record{};
+                read_fully(fd_, &record, sizeof(record), offset);
+                const std::uint64_t length = alignment_ + round_up(record.size, alignment_);
+                if (record.magic != RECORD_MAGIC || offset + alignment_ + record.size > file_size)
+                {
+                    break;
+                }
+                index_.push_back(RecordIndexEntry{.offset = offset,
+                                                  .timestamp_monotonic_us = record.timestamp_monotonic_us,
+                                                  .size = record.size,
+                                                  .sequence = record.sequence});
+                offset += length;
+            }
+        }
+        catch (...)
+        {
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    RecordingReader::~RecordingReader() noexcept
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+
+    RecordingReader::Frame RecordingReader::read(std::size_t i) const
+    {
+        auto const &entry = index_.at(i);
+        Frame frame;
+        read_fully(fd_, &frame.header, sizeof(frame.header), entry.offset);
+        if (frame.header.magic != RECORD_MAGIC || frame.header.size != entry.size)
+        {
+            throw std::runtime_error(fmt::format("recording frame {} at offset {} is damaged", i, entry.offset));
+        }
+        frame.data.resize(frame.header.size);
+        if (!frame.data.empty())
+        {
+            read_fully(fd_, frame.data.data(), frame.data.size(), entry.offset + alignment_);
+        }
+        return frame;
+    }
+} // namespace v4l2
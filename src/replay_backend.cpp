@@ -0,0 +1,795 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fmt/core.h>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "v4l2/replay_backend.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        constexpr std::string_view REPLAY_SCHEME = "replay://";
+        constexpr std::uint64_t RESYNC_US = 1'000'000; // a consumer this far behind restarts the schedule instead of dropping its way back
+        constexpr std::size_t MAX_EVENTS = 32;         // undequeued events kept, the sequence shows what was dropped
+
+        [[nodiscard]] std::uint64_t monotonic_us() noexcept
+        {
+            timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<std::uint64_t>(ts.tv_sec) * 1'000'000ULL + static_cast<std::uint64_t>(ts.tv_nsec) / 1000;
+        }
+
+        [[nodiscard]] std::uint32_t parse_number(std::string_view text, std::string_view uri)
+        {
+            std::uint32_t value = 0;
+            auto const [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (ec != std::errc{} || end != text.data() + text.size() || value == 0)
+            {
+                throw std::invalid_argument(fmt::format("bad number '{}' in replay URI {}", text, uri));
+            }
+            return value;
+        }
+
+        [[nodiscard]] int fail(int error) noexcept
+        {
+            errno = error;
+            return -1;
+        }
+    } // namespace
+
+    ReplayConfig parse_replay_uri(const std::string &uri)
+    {
+        if (!uri.starts_with(REPLAY_SCHEME))
+        {
+            throw std::invalid_argument(fmt::format("not a replay URI: {}", uri));
+        }
+        std::string_view rest = std::string_view(uri).substr(REPLAY_SCHEME.size());
+        const auto query_at = rest.find('?');
+
+        ReplayConfig config;
+        config.path_ = std::string(rest.substr(0, query_at));
+        if (config.path_.empty())
+        {
+            throw std::invalid_argument(fmt::format("replay URI without a file: {}", uri));
+        }
+
+        std::string_view query = query_at == std::string_view::npos ? std::string_view{} : rest.substr(query_at + 1);
+        while (!query.empty())
+        {
+            const auto amp = query.find('&');
+            const auto option = query.substr(0, amp);
+            query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+            const auto eq = option.find('=');
+            const auto key = option.substr(0, eq);
+            const auto value = eq == std::string_view::npos ? std::string_view{} : option.substr(eq + 1);
+            if (key == "rate")
+            {
+                if (value == "recorded")
+                {
+                    config.rate_ = ReplayRate::RECORDED;
+                }
+                else if (value == "max")
+                {
+                    config.rate_ = ReplayRate::MAX;
+                }
+                else
+                {
+                    const auto slash = value.find('/');
+                    config.rate_ = ReplayRate::FIXED;
+                    config.fps_num_ = parse_number(value.substr(0, slash), uri);
+                    config.fps_den_ = slash == std::string_view::npos ? 1 : parse_number(value.substr(slash + 1), uri);
+                }
+            }
+            else if (key == "loop" && (value == "0" || value == "1"))
+            {
+                config.loop_ = value == "1";
+            }
+            else if (key == "mplane" && (value == "0" || value == "1"))
+            {
+                config.mplane_ = value == "1";
+            }
+            else
+            {
+                throw std::invalid_argument(fmt::format("unknown option '{}' in replay URI {}", option, uri));
+            }
+        }
+        return config;
+    }
+
+    ReplayBackend::ReplayBackend(const ReplayConfig &config) : config_(config)
+    {
+        // 🗂 the index comes from the reader, trailer or scan, the frame bytes from our own mapping
+        {
+            RecordingReader reader(config_.path_);
+            header_ = reader.header();
+            frames_.reserve(reader.index().size());
+            for (auto const &entry : reader.index())
+            {
+                if (entry.size > std::numeric_limits<std::uint32_t>::max())
+                {
+                    throw std::runtime_error(fmt::format("recording frame {} at offset {} is damaged", frames_.size(), entry.offset));
+                }
+                frames_.push_back(Frame{.data_offset = entry.offset + header_.alignment,
+                                        .size = static_cast<std::uint32_t>(entry.size),
+                                        .recorded_us = entry.timestamp_monotonic_us});
+            }
+        }
+        if (frames_.empty())
+        {
+            throw std::runtime_error(fmt::format("recording {} holds no frames", config_.path_));
+        }
+
+        const int file = open(config_.path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            throw std::runtime_error(fmt::format("cannot open recording {}: {}", config_.path_, strerror(errno)));
+        }
+        struct stat st{};
+        if (fstat(file, &st) < 0)
+        {
+            const int err = errno;
+            close(file);
+            throw std::runtime_error(fmt::format("cannot stat recording {}: {}", config_.path_, strerror(err)));
+        }
+        mapped_size_ = static_cast<std::size_t>(st.st_size);
+        void *mapped = mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, file, 0);
+        const int err = errno;
+        close(file);
+        if (mapped == MAP_FAILED)
+        {
+            throw std::runtime_error(fmt::format("mmap of recording {} failed: {}", config_.path_, strerror(err)));
+        }
+        base_ = static_cast<std::byte *>(mapped);
+        madvise(base_, mapped_size_, MADV_SEQUENTIAL);
+
+        // 🛡 a trailer index is taken on trust by the reader, every entry has to land inside the mapping
+        std::uint32_t largest = 0;
+        for (std::size_t i = 0; i < frames_.size(); ++i)
+        {
+            auto &frame = frames_[i];
+            const std::uint64_t offset = frame.data_offset - header_.alignment;
+            const std::uint64_t room = offset < mapped_size_ ? mapped_size_ - offset : 0;
+            if (frame.data_offset < header_.alignment || room < std::max<std::uint64_t>(sizeof(RecordHeader), header_.alignment) ||
+                room - header_.alignment < frame.size)
+            {
+                munmap(base_, mapped_size_);
+                throw std::runtime_error(fmt::format("recording frame {} at offset {} is past the end of {}", i, offset, config_.path_));
+            }
+            auto const *record = reinterpret_cast<const RecordHeader *>(base_ + offset);
+            if (record->magic != RECORD_MAGIC || record->size != frame.size)
+            {
+                munmap(base_, mapped_size_);
+                throw std::runtime_error(fmt::format("recording frame {} at offset {} is damaged", i, offset));
+            }
+            frame.error = record->error != 0;
+            largest = std::max(largest, frame.size);
+        }
+        const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        buffer_size_ = (largest + page - 1) / page * page;
+        memory_planes_ = memory_planes(header_.format);
+        config_.mplane_ = config_.mplane_ || memory_planes_ > 1; // no single-planar way to hand those out
+        if (frames_.size() > 1 && frames_.back().recorded_us > frames_.front().recorded_us)
+        {
+            mean_interval_us_ = (frames_.back().recorded_us - frames_.front().recorded_us) / (frames_.size() - 1);
+        }
+        if (mean_interval_us_ == 0)
+        {
+            mean_interval_us_ = 33'333;
+        }
+
+        // 🎛 what a UVC webcam typically offers, class controls and all, in id order
+        controls_ = {
+            {V4L2_CID_USER_CLASS, "User Controls", V4L2_CTRL_TYPE_CTRL_CLASS, 0, 0, 0, 0, 0},
+            {V4L2_CID_AUTO_WHITE_BALANCE, "White Balance, Automatic", V4L2_CTRL_TYPE_BOOLEAN, 0, 1, 1, 1, 1},
+            {V4L2_CID_GAIN, "Gain", V4L2_CTRL_TYPE_INTEGER, 0, 255, 1, 0, 0},
+            {V4L2_CID_WHITE_BALANCE_TEMPERATURE, "White Balance Temperature", V4L2_CTRL_TYPE_INTEGER, 2000, 6500, 10, 4000, 4000},
+            {V4L2_CID_CAMERA_CLASS, "Camera Controls", V4L2_CTRL_TYPE_CTRL_CLASS, 0, 0, 0, 0, 0},
+            {V4L2_CID_EXPOSURE_AUTO, "Auto Exposure", V4L2_CTRL_TYPE_MENU, 0, 3, 1, V4L2_EXPOSURE_APERTURE_PRIORITY, V4L2_EXPOSURE_APERTURE_PRIORITY},
+            {V4L2_CID_EXPOSURE_ABSOLUTE, "Exposure Time, Absolute", V4L2_CTRL_TYPE_INTEGER, 3, 2047, 1, 250, 250},
+        };
+
+        // ⏱ paced: a timer armed for the next due frame; max speed: an eventfd that never drains
+        if (config_.rate_ == ReplayRate::MAX)
+        {
+            fd_ = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+        }
+        else
+        {
+            fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        }
+        if (fd_ < 0)
+        {
+            const int fd_err = errno;
+            munmap(base_, mapped_size_);
+            throw std::runtime_error(fmt::format("replay of {}: cannot create its fd: {}", config_.path_, strerror(fd_err)));
+        }
+        V4L2_TRACE(INFO, "replaying {}: {} frames, {}x{}", config_.path_, frames_.size(), header_.width, header_.height);
+    }
+
+    ReplayBackend::~ReplayBackend() noexcept
+    {
+        close(fd_);
+        munmap(base_, mapped_size_);
+    }
+
+    std::uint64_t ReplayBackend::interval_after(std::size_t frame) const noexcept
+    {
+        if (config_.rate_ == ReplayRate::FIXED)
+        {
+            return std::uint64_t{config_.fps_den_} * 1'000'000 / config_.fps_num_;
+        }
+        if (frame + 1 < frames_.size() && frames_[frame + 1].recorded_us >= frames_[frame].recorded_us)
+        {
+            return frames_[frame + 1].recorded_us - frames_[frame].recorded_us;
+        }
+        return mean_interval_us_; // across the loop seam, or a clock step in the recording
+    }
+
+    v4l2_fract ReplayBackend::time_per_frame() const noexcept
+    {
+        if (config_.rate_ == ReplayRate::FIXED)
+        {
+            return v4l2_fract{.numerator = config_.fps_den_, .denominator = config_.fps_num_};
+        }
+        // recorded and max speed report the recorded rate, seconds per frame in microseconds reduced
+        const auto divisor = std::gcd(mean_interval_us_, std::uint64_t{1'000'000});
+        return v4l2_fract{.numerator = static_cast<std::uint32_t>(mean_interval_us_ / divisor),
+                          .denominator = static_cast<std::uint32_t>(1'000'000 / divisor)};
+    }
+
+    void ReplayBackend::fill_format(v4l2_format &format) const noexcept
+    {
+        if (config_.mplane_)
+        {
+            format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+            auto &pix = format.fmt.pix_mp;
+            pix = v4l2_pix_format_mplane{};
+            pix.width = header_.width;
+            pix.height = header_.height;
+            pix.pixelformat = static_cast<std::uint32_t>(header_.format);
+            pix.field = V4L2_FIELD_NONE;
+            pix.colorspace = V4L2_COLORSPACE_JPEG;
+            pix.num_planes = static_cast<std::uint8_t>(memory_planes_);
+            for (std::uint32_t p = 0; p < memory_planes_; ++p)
+            {
+                pix.plane_fmt[p].bytesperline = header_.bytes_per_line;
+                pix.plane_fmt[p].sizeimage = static_cast<std::uint32_t>(buffer_size_);
+            }
+            return;
+        }
+        format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        format.fmt.pix.width = header_.width;
+        format.fmt.pix.height = header_.height;
+        format.fmt.pix.pixelformat = static_cast<std::uint32_t>(header_.format);
+        format.fmt.pix.field = V4L2_FIELD_NONE;
+        format.fmt.pix.bytesperline = header_.bytes_per_line;
+        format.fmt.pix.sizeimage = static_cast<std::uint32_t>(buffer_size_);
+        format.fmt.pix.colorspace = V4L2_COLORSPACE_JPEG;
+    }
+
+    std::uint32_t ReplayBackend::plane_bytes(const Frame &frame, std::uint32_t plane) const noexcept
+    {
+        if (memory_planes_ == 1)
+        {
+            return frame.size;
+        }
+        const std::uint32_t luma = std::min(frame.size, header_.bytes_per_line * header_.height);
+        return plane == 0 ? luma : frame.size - luma;
+    }
+
+    // Hand the next frame to a queued buffer, or lose it when none is queued. False once a non-looping replay is done.
+    bool ReplayBackend::take_frame(std::uint64_t timestamp_us)
+    {
+        if (next_frame_ == frames_.size())
+        {
+            if (!config_.loop_)
+            {
+                if (eos_subscribed_ && !finished_)
+                {
+                    v4l2_event eos{};
+                    eos.type = V4L2_EVENT_EOS;
+                    push_event(eos);
+                }
+                finished_ = true;
+                return false;
+            }
+            next_frame_ = 0;
+        }
+        if (frame_sync_subscribed_)
+        {
+            // 📸 the sensor starts a frame about one interval before it is read out, buffer or not
+            const auto readout = config_.rate_ == ReplayRate::MAX ? 0 : std::min(timestamp_us, interval_after(next_frame_));
+            v4l2_event sync{};
+            sync.type = V4L2_EVENT_FRAME_SYNC;
+            sync.u.frame_sync.frame_sequence = sequence_;
+            sync.timestamp.tv_sec = static_cast<time_t>((timestamp_us - readout) / 1'000'000);
+            sync.timestamp.tv_nsec = static_cast<long>((timestamp_us - readout) % 1'000'000) * 1000;
+            push_event(sync);
+        }
+        if (!queued_.empty())
+        {
+            ready_.push_back(Ready{.index = queued_.front(), .frame = next_frame_, .sequence = sequence_, .timestamp_us = timestamp_us});
+            queued_.pop_front();
+        }
+        ++sequence_;
+        ++next_frame_;
+        return true;
+    }
+
+    void ReplayBackend::push_event(v4l2_event event)
+    {
+        if (event.timestamp.tv_sec == 0 && event.timestamp.tv_nsec == 0)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &event.timestamp);
+        }
+        event.sequence = event_sequence_++;
+        if (events_.size() == MAX_EVENTS)
+        {
+            events_.pop_front();
+        }
+        events_.push_back(event);
+    }
+
+    ReplayBackend::Control *ReplayBackend::find_control(std::uint32_t id) noexcept
+    {
+        auto const it = std::find_if(controls_.begin(), controls_.end(), [id](const Control &control) { return control.id == id; });
+        return it == controls_.end() ? nullptr : &*it;
+    }
+
+    int ReplayBackend::query_control(v4l2_query_ext_ctrl &query) noexcept
+    {
+        constexpr std::uint32_t NEXT = V4L2_CTRL_FLAG_NEXT_CTRL | V4L2_CTRL_FLAG_NEXT_COMPOUND;
+        const std::uint32_t id = query.id & ~NEXT;
+        auto const it = (query.id & NEXT) != 0
+                            ? std::find_if(controls_.begin(), controls_.end(), [id](const Control &control) { return control.id > id; })
+                            : std::find_if(controls_.begin(), controls_.end(), [id](const Control &control) { return control.id == id; });
+        if (it == controls_.end())
+        {
+            return fail(EINVAL);
+        }
+
+        query = v4l2_query_ext_ctrl{};
+        query.id = it->id;
+        query.type = it->type;
+        std::strncpy(query.name, it->name, sizeof(query.name) - 1);
+        query.minimum = it->minimum;
+        query.maximum = it->maximum;
+        query.step = static_cast<decltype(query.step)>(it->step);
+        query.default_value = it->default_value;
+        query.flags = it->type == V4L2_CTRL_TYPE_CTRL_CLASS ? V4L2_CTRL_FLAG_READ_ONLY | V4L2_CTRL_FLAG_WRITE_ONLY : 0u;
+        query.elem_size = sizeof(std::int32_t);
+        query.elems = 1;
+        return 0;
+    }
+
+    // All or nothing, like the control framework: every control is checked before any is set
+    int ReplayBackend::ext_controls(unsigned long request, v4l2_ext_controls &ext) noexcept
+    {
+        const bool set = request == VIDIOC_S_EXT_CTRLS;
+        const bool get = request == VIDIOC_G_EXT_CTRLS;
+        for (std::uint32_t i = 0; i < ext.count; ++i)
+        {
+            auto &entry = ext.controls[i];
+            Control const *control = find_control(entry.id);
+            if (!control || control->type == V4L2_CTRL_TYPE_CTRL_CLASS)
+            {
+                ext.error_idx = set ? ext.count : i;
+                return fail(EINVAL);
+            }
+            if (!get && control->type == V4L2_CTRL_TYPE_MENU && (entry.value < control->minimum || entry.value > control->maximum))
+            {
+                ext.error_idx = set ? ext.count : i;
+                return fail(ERANGE);
+            }
+        }
+
+        for (std::uint32_t i = 0; i < ext.count; ++i)
+        {
+            auto &entry = ext.controls[i];
+            Control *control = find_control(entry.id);
+            if (get)
+            {
+                entry.value = ext.which == V4L2_CTRL_WHICH_DEF_VAL ? control->default_value : control->value;
+                continue;
+            }
+            // integers are clamped and rounded to the step, booleans are 0 or 1
+            std::int32_t value = std::clamp(entry.value, control->minimum, control->maximum);
+            if (control->step > 1)
+            {
+                value = control->minimum + (value - control->minimum + control->step / 2) / control->step * control->step;
+                value = value > control->maximum ? value - control->step : value;
+            }
+            entry.value = value;
+            if (!set || control->value == value)
+            {
+                continue;
+            }
+            control->value = value;
+            if (std::find(ctrl_events_.begin(), ctrl_events_.end(), control->id) != ctrl_events_.end())
+            {
+                v4l2_event event{};
+                event.type = V4L2_EVENT_CTRL;
+                event.id = control->id;
+                event.u.ctrl.changes = V4L2_EVENT_CTRL_CH_VALUE;
+                event.u.ctrl.type = control->type;
+                event.u.ctrl.value = value;
+                event.u.ctrl.minimum = control->minimum;
+                event.u.ctrl.maximum = control->maximum;
+                event.u.ctrl.step = control->step;
+                event.u.ctrl.default_value = control->default_value;
+                push_event(event);
+            }
+        }
+        return 0;
+    }
+
+    void ReplayBackend::produce(std::uint64_t now_us)
+    {
+        if (!streaming_ || finished_)
+        {
+            return;
+        }
+        if (config_.rate_ == ReplayRate::MAX)
+        {
+            // 🏎 every queued buffer is filled the moment it is asked for
+            while (!queued_.empty() && take_frame(now_us))
+            {
+            }
+            return;
+        }
+
+        if (now_us > next_due_us_ + RESYNC_US)
+        {
+            next_due_us_ = now_us;
+        }
+        while (next_due_us_ <= now_us)
+        {
+            const auto frame = next_frame_ == frames_.size() ? 0 : next_frame_;
+            if (!take_frame(next_due_us_))
+            {
+                break;
+            }
+            next_due_us_ += interval_after(frame);
+        }
+        arm();
+    }
+
+    void ReplayBackend::arm() noexcept
+    {
+        if (config_.rate_ == ReplayRate::MAX)
+        {
+            return;
+        }
+        // drain the expirations; a finished replay stays readable so poll() wakes up for the EPIPE
+        std::uint64_t expirations = 0;
+        [[maybe_unused]] auto const consumed = read(fd_, &expirations, sizeof(expirations));
+        itimerspec spec{};
+        if (streaming_)
+        {
+            const std::uint64_t due = finished_ ? 1 : next_due_us_;
+            spec.it_value.tv_sec = static_cast<time_t>(due / 1'000'000);
+            spec.it_value.tv_nsec = static_cast<long>(due % 1'000'000) * 1000;
+        }
+        timerfd_settime(fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    int ReplayBackend::ioctl(unsigned long request, void *arg) noexcept
+    {
+        std::lock_guard lock(mutex_);
+        switch (request)
+        {
+        case VIDIOC_QUERYCAP:
+        {
+            auto &cap = *static_cast<v4l2_capability *>(arg);
+            cap = v4l2_capability{};
+            std::strncpy(reinterpret_cast<char *>(cap.driver), "replay", sizeof(cap.driver) - 1);
+            // the file name, not the path: 31 bytes of a path would be the same directory for every recording
+            auto const name = std::filesystem::path(config_.path_).filename().string();
+            std::strncpy(reinterpret_cast<char *>(cap.card), name.c_str(), sizeof(cap.card) - 1);
+            std::strncpy(reinterpret_cast<char *>(cap.bus_info), "replay:", sizeof(cap.bus_info) - 1);
+            const std::uint32_t capture = config_.mplane_ ? V4L2_CAP_VIDEO_CAPTURE_MPLANE : V4L2_CAP_VIDEO_CAPTURE;
+            cap.capabilities = capture | V4L2_CAP_STREAMING | V4L2_CAP_DEVICE_CAPS;
+            cap.device_caps = capture | V4L2_CAP_STREAMING;
+            return 0;
+        }
+        case VIDIOC_S_FMT:
+        case VIDIOC_G_FMT:
+        case VIDIOC_TRY_FMT:
+            // 🎞 one mode only: whatever was asked for, the recording's format and size is the answer
+            fill_format(*static_cast<v4l2_format *>(arg));
+            return 0;
+        case VIDIOC_S_PARM:
+        case VIDIOC_G_PARM:
+        {
+            auto &parm = *static_cast<v4l2_streamparm *>(arg);
+            parm.parm.capture.capability = V4L2_CAP_TIMEPERFRAME;
+            parm.parm.capture.timeperframe = time_per_frame();
+            return 0;
+        }
+        case VIDIOC_REQBUFS:
+        {
+            auto &req = *static_cast<v4l2_requestbuffers *>(arg);
+            if (req.memory != V4L2_MEMORY_MMAP)
+            {
+                return fail(EINVAL); // no dmabufs behind a file
+            }
+            if (streaming_)
+            {
+                return fail(EBUSY);
+            }
+            buffer_count_ = req.count;
+            buffer_frame_.assign(buffer_count_, 0);
+            queued_.clear();
+            ready_.clear();
+            req.capabilities = V4L2_BUF_CAP_SUPPORTS_MMAP;
+            return 0;
+        }
+        case VIDIOC_QUERYBUF:
+        {
+            auto &buf = *static_cast<v4l2_buffer *>(arg);
+            if (buf.index >= buffer_count_)
+            {
+                return fail(EINVAL);
+            }
+            if (config_.mplane_)
+            {
+                if (buf.length < memory_planes_ || !buf.m.planes)
+                {
+                    return fail(EINVAL);
+                }
+                buf.length = memory_planes_;
+                for (std::uint32_t p = 0; p < memory_planes_; ++p)
+                {
+                    buf.m.planes[p].length = static_cast<std::uint32_t>(buffer_size_);
+                    buf.m.planes[p].m.mem_offset = static_cast<std::uint32_t>((buf.index * memory_planes_ + p) * buffer_size_);
+                }
+                return 0;
+            }
+            buf.length = static_cast<std::uint32_t>(buffer_size_);
+            buf.m.offset = static_cast<std::uint32_t>(buf.index * buffer_size_);
+            return 0;
+        }
+        case VIDIOC_QBUF:
+        {
+            auto &buf = *static_cast<v4l2_buffer *>(arg);
+            if (buf.index >= buffer_count_ || std::find(queued_.begin(), queued_.end(), buf.index) != queued_.end())
+            {
+                return fail(EINVAL);
+            }
+            if (config_.rate_ != ReplayRate::MAX)
+            {
+                produce(monotonic_us()); // frames due while nothing was queued are lost before this buffer joins
+            }
+            queued_.push_back(buf.index);
+            return 0;
+        }
+        case VIDIOC_DQBUF:
+        {
+            auto &buf = *static_cast<v4l2_buffer *>(arg);
+            if (config_.rate_ == ReplayRate::MAX && ready_.empty() && !finished_)
+            {
+                // max speed fills every queued buffer, but says EAGAIN first: a LATEST drain has to run dry
+                produce(monotonic_us());
+                return fail(EAGAIN);
+            }
+            produce(monotonic_us());
+            if (ready_.empty())
+            {
+                return fail(finished_ ? EPIPE : EAGAIN);
+            }
+            const Ready ready = ready_.front();
+            ready_.pop_front();
+            buffer_frame_[ready.index] = ready.frame;
+
+            auto const &frame = frames_[ready.frame];
+            buf.index = ready.index;
+            if (config_.mplane_ && buf.m.planes && buf.length >= memory_planes_)
+            {
+                for (std::uint32_t p = 0; p < memory_planes_; ++p)
+                {
+                    buf.m.planes[p].bytesused = plane_bytes(frame, p);
+                    buf.m.planes[p].data_offset = 0;
+                }
+            }
+            else
+            {
+                buf.bytesused = frame.size;
+            }
+            buf.sequence = ready.sequence;
+            buf.field = V4L2_FIELD_NONE;
+            buf.flags = V4L2_BUF_FLAG_MAPPED | V4L2_BUF_FLAG_DONE | V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC |
+                        V4L2_BUF_FLAG_TSTAMP_SRC_EOF | (frame.error ? V4L2_BUF_FLAG_ERROR : 0u);
+            buf.timestamp.tv_sec = static_cast<time_t>(ready.timestamp_us / 1'000'000);
+            buf.timestamp.tv_usec = static_cast<suseconds_t>(ready.timestamp_us % 1'000'000);
+            return 0;
+        }
+        case VIDIOC_STREAMON:
+            if (buffer_count_ == 0)
+            {
+                return fail(EINVAL);
+            }
+            streaming_ = true;
+            finished_ = false;
+            next_frame_ = 0;
+            sequence_ = 0;
+            next_due_us_ = monotonic_us();
+            arm();
+            return 0;
+        case VIDIOC_STREAMOFF:
+            // like a driver: every buffer comes back dequeued, frames in flight are gone
+            streaming_ = false;
+            queued_.clear();
+            ready_.clear();
+            arm();
+            return 0;
+        case VIDIOC_ENUM_FMT:
+        {
+            auto &desc = *static_cast<v4l2_fmtdesc *>(arg);
+            if (desc.index != 0)
+            {
+                return fail(EINVAL);
+            }
+            desc.pixelformat = static_cast<std::uint32_t>(header_.format);
+            desc.flags = header_.format == PixelFormat::MJPG ? V4L2_FMT_FLAG_COMPRESSED : 0u;
+            std::strncpy(reinterpret_cast<char *>(desc.description), "replay", sizeof(desc.description) - 1);
+            return 0;
+        }
+        case VIDIOC_ENUM_FRAMESIZES:
+        {
+            auto &size = *static_cast<v4l2_frmsizeenum *>(arg);
+            if (size.index != 0 || size.pixel_format != static_cast<std::uint32_t>(header_.format))
+            {
+                return fail(EINVAL);
+            }
+            size.type = V4L2_FRMSIZE_TYPE_DISCRETE;
+            size.discrete = v4l2_frmsize_discrete{.width = header_.width, .height = header_.height};
+            return 0;
+        }
+        case VIDIOC_ENUM_FRAMEINTERVALS:
+        {
+            auto &ival = *static_cast<v4l2_frmivalenum *>(arg);
+            if (ival.index != 0 || ival.pixel_format != static_cast<std::uint32_t>(header_.format) ||
+                ival.width != header_.width || ival.height != header_.height)
+            {
+                return fail(EINVAL);
+            }
+            ival.type = V4L2_FRMIVAL_TYPE_DISCRETE;
+            ival.discrete = time_per_frame();
+            return 0;
+        }
+        case VIDIOC_SUBSCRIBE_EVENT:
+        case VIDIOC_UNSUBSCRIBE_EVENT:
+        {
+            auto const &sub = *static_cast<const v4l2_event_subscription *>(arg);
+            const bool subscribe = request == VIDIOC_SUBSCRIBE_EVENT;
+            switch (sub.type)
+            {
+            case V4L2_EVENT_FRAME_SYNC:
+                frame_sync_subscribed_ = subscribe;
+                return 0;
+            case V4L2_EVENT_EOS:
+                eos_subscribed_ = subscribe;
+                return 0;
+            case V4L2_EVENT_CTRL:
+            {
+                Control const *control = find_control(sub.id);
+                if (!control || control->type == V4L2_CTRL_TYPE_CTRL_CLASS)
+                {
+                    return fail(EINVAL);
+                }
+                std::erase(ctrl_events_, sub.id);
+                if (subscribe)
+                {
+                    ctrl_events_.push_back(sub.id);
+                }
+                return 0;
+            }
+            case V4L2_EVENT_ALL:
+                if (!subscribe)
+                {
+                    frame_sync_subscribed_ = false;
+                    eos_subscribed_ = false;
+                    ctrl_events_.clear();
+                    return 0;
+                }
+                return fail(EINVAL);
+            default:
+                return fail(EINVAL); // one mode: no source change
+            }
+        }
+        case VIDIOC_DQEVENT:
+        {
+            produce(monotonic_us()); // a frame due now brings its frame sync
+            if (events_.empty())
+            {
+                return fail(ENOENT);
+            }
+            auto &event = *static_cast<v4l2_event *>(arg);
+            event = events_.front();
+            events_.pop_front();
+            event.pending = static_cast<std::uint32_t>(events_.size());
+            return 0;
+        }
+        case VIDIOC_QUERY_EXT_CTRL:
+            return query_control(*static_cast<v4l2_query_ext_ctrl *>(arg));
+        case VIDIOC_QUERYCTRL:
+        {
+            auto &legacy = *static_cast<v4l2_queryctrl *>(arg);
+            v4l2_query_ext_ctrl query{};
+            query.id = legacy.id;
+            if (query_control(query) < 0)
+            {
+                return -1;
+            }
+            legacy = v4l2_queryctrl{};
+            legacy.id = query.id;
+            legacy.type = query.type;
+            std::memcpy(legacy.name, query.name, sizeof(legacy.name));
+            legacy.minimum = static_cast<std::int32_t>(query.minimum);
+            legacy.maximum = static_cast<std::int32_t>(query.maximum);
+            legacy.step = static_cast<std::int32_t>(query.step);
+            legacy.default_value = static_cast<std::int32_t>(query.default_value);
+            legacy.flags = query.flags;
+            return 0;
+        }
+        case VIDIOC_G_CTRL:
+        case VIDIOC_S_CTRL:
+        {
+            // the old single-control calls are a batch of one
+            auto &single = *static_cast<v4l2_control *>(arg);
+            v4l2_ext_control control{};
+            control.id = single.id;
+            control.value = single.value;
+            v4l2_ext_controls ext{};
+            ext.which = V4L2_CTRL_WHICH_CUR_VAL;
+            ext.count = 1;
+            ext.controls = &control;
+            if (ext_controls(request == VIDIOC_G_CTRL ? VIDIOC_G_EXT_CTRLS : VIDIOC_S_EXT_CTRLS, ext) < 0)
+            {
+                return -1;
+            }
+            single.value = control.value;
+            return 0;
+        }
+        case VIDIOC_G_EXT_CTRLS:
+        case VIDIOC_S_EXT_CTRLS:
+        case VIDIOC_TRY_EXT_CTRLS:
+            return ext_controls(request, *static_cast<v4l2_ext_controls *>(arg));
+        case VIDIOC_EXPBUF:
+            return fail(EINVAL);
+        default:
+            return fail(ENOTTY);
+        }
+    }
+
+    void *ReplayBackend::map(std::size_t length, int prot, off_t offset) noexcept
+    {
+        // 🪶 the buffers never hold frame bytes (frame_data() points into the file), lazily zero pages cost nothing
+        static_cast<void>(offset);
+        return mmap(nullptr, length, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    const std::byte *ReplayBackend::frame_data(const v4l2_buffer &buf, const MappedBuffer &mapped,
+                                               std::uint32_t plane) const noexcept
+    {
+        static_cast<void>(mapped);
+        std::lock_guard lock(mutex_);
+        auto const &frame = frames_[buffer_frame_[buf.index]];
+        return base_ + frame.data_offset + (plane == 0 ? 0 : plane_bytes(frame, 0));
+    }
+} // namespace v4l2
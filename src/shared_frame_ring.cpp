@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <linux/futex.h>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "v4l2/shared_frame_ring.hpp"
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        constexpr std::uint64_t RING_MAGIC = 0x5634'4C32'5249'4E47; // "V4L2RING"
+        constexpr std::uint32_t RING_VERSION = 2;
+        constexpr std::size_t CACHE_LINE = 64;
+
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+                      "the ring needs address-free atomics to work across processes");
+
+        // 🗺️ layout: RingHeader, then slot_count x (SlotHeader + slot_size bytes), every part on its own cache line
+        struct alignas(CACHE_LINE) RingHeader
+        {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::uint32_t slot_count;
+            std::uint64_t slot_size;
+            std::uint64_t slot_stride;
+            alignas(CACHE_LINE) std::atomic<std::uint64_t> published; // frames completely written
+            std::atomic<std::uint32_t> generation;                  // futex word, bumped per frame
+            std::atomic<std::uint32_t> waiters;                     // readers inside futex_wait
+        };
+
+        // Where a color plane is in the slot data
+        struct PlaneMeta
+        {
+            std::uint64_t offset;
+            std::uint64_t size;
+            std::uint32_t bytes_per_line;
+        };
+
+        // Plain copy of the FrameView fields, pointers and fds stay in the publishing process
+        struct FrameMeta
+        {
+            std::uint64_t timestamp_monotonic_us;
+            std::uint64_t v4l2_timestamp_us;
+            std::uint64_t size; // image, from the start of the slot data
+            std::uint64_t used; // image and the planes appended after it
+            std::uint32_t plane_count;
+            std::array<PlaneMeta, MAX_PLANES> planes;
+            std::uint32_t width;
+            std::uint32_t height;
+            PixelFormat format;
+            std::uint32_t bytes_per_line;
+            std::uint32_t sequence;
+            std::uint32_t flags;
+            bool error;
+            bool has_jpeg;
+            JpegInfo jpeg;
+        };
+
+        /*
+         * Seqlock per slot: 2 * frame + 1 while frame is being written, 2 * frame + 2 once it is complete.
+         * A reader that sees the same even value before and after reading the slot got an intact frame.
+         */
+        struct alignas(CACHE_LINE) SlotHeader
+        {
+            std::atomic<std::uint64_t> seq;
+            FrameMeta meta;
+        };
+
+        [[nodiscard]] constexpr std::size_t round_up(std::size_t value, std::size_t multiple) noexcept
+        {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        [[nodiscard]] RingHeader *header(std::byte *base) noexcept
+        {
+            return reinterpret_cast<RingHeader *>(base);
+        }
+
+        [[nodiscard]] SlotHeader *slot(std::byte *base, std::uint64_t frame) noexcept
+        {
+            auto *ring = header(base);
+            const auto offset = sizeof(RingHeader) + (frame % ring->slot_count) * ring->slot_stride;
+            return reinterpret_cast<SlotHeader *>(base + offset);
+        }
+
+        [[nodiscard]] std::byte *slot_data(SlotHeader *slot) noexcept
+        {
+            return reinterpret_cast<std::byte *>(slot) + sizeof(SlotHeader);
+        }
+
+        /*
+         * 🔒 A publisher holds an exclusive flock on its segment for as long as it lives, the kernel drops it when
+         * the process dies. So a segment that can be locked was left behind by a crashed publisher and is replaced,
+         * its readers keep the old mapping; one that cannot belongs to a live publisher and stays.
+         */
+        [[nodiscard]] int create_segment(const std::string &name)
+        {
+            for (int attempt = 0; attempt < 2; ++attempt)
+            {
+                const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+                if (fd >= 0)
+                {
+                    flock(fd, LOCK_EX | LOCK_NB); // just created, nobody else holds it
+                    return fd;
+                }
+                if (errno != EEXIST)
+                {
+                    break;
+                }
+                const int existing = shm_open(name.c_str(), O_RDWR, 0);
+                if (existing < 0 && errno != ENOENT)
+                {
+                    break;
+                }
+                if (existing >= 0)
+                {
+                    const bool live = flock(existing, LOCK_EX | LOCK_NB) < 0 && errno == EWOULDBLOCK;
+                    close(existing);
+                    if (live)
+                    {
+                        throw std::runtime_error(fmt::format("{} is already published by a running SharedFrameRing", name));
+                    }
+                    shm_unlink(name.c_str());
+                }
+            }
+            throw std::runtime_error(fmt::format("shm_open({}) failed: {}", name, strerror(errno)));
+        }
+
+        // Not FUTEX_PRIVATE_FLAG: waiter and waker live in different processes
+        long futex(std::atomic<std::uint32_t> *word, int op, std::uint32_t value, const timespec *timeout) noexcept
+        {
+            return syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(word), op, value, timeout, nullptr, 0);
+        }
+    } // namespace
+
+    SharedFrameRing::SharedFrameRing(const SharedFrameRingConfig &config) : config_(config)
+    {
+        if (config_.name_.empty() || config_.slots_ == 0 || config_.slot_size_ == 0)
+        {
+            throw std::invalid_argument("SharedFrameRing needs a name, at least one slot and a slot size");
+        }
+        if (config_.slots_ > UINT32_MAX)
+        {
+            throw std::invalid_argument(fmt::format("SharedFrameRing: {} slots is too many", config_.slots_));
+        }
+
+        const std::size_t stride = sizeof(SlotHeader) + round_up(config_.slot_size_, CACHE_LINE);
+        mapped_size_ = sizeof(RingHeader) + config_.slots_ * stride;
+
+        fd_ = create_segment(config_.name_);
+        if (ftruncate(fd_, static_cast<off_t>(mapped_size_)) < 0)
+        {
+            const int err = errno;
+            shm_unlink(config_.name_.c_str());
+            close(fd_);
+            throw std::runtime_error(fmt::format("ftruncate({}, {}) failed: {}", config_.name_, mapped_size_, strerror(err)));
+        }
+        void *mapped = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapped == MAP_FAILED)
+        {
+            const int err = errno;
+            shm_unlink(config_.name_.c_str());
+            close(fd_);
+            throw std::runtime_error(fmt::format("mmap({}) failed: {}", config_.name_, strerror(err)));
+        }
+        base_ = static_cast<std::byte *>(mapped);
+
+        // the fresh segment is zeroed, so every atomic starts at 0; the magic goes last
+        auto *ring = header(base_);
+        ring->version = RING_VERSION;
+        ring->slot_count = static_cast<std::uint32_t>(config_.slots_);
+        ring->slot_size = config_.slot_size_;
+        ring->slot_stride = stride;
+        std::atomic_ref<std::uint64_t>(ring->magic).store(RING_MAGIC, std::memory_order_release);
+        V4L2_TRACE(INFO, "shared frame ring {}: {} slots of {} bytes", config_.name_, config_.slots_, config_.slot_size_);
+    }
+
+    SharedFrameRing::~SharedFrameRing() noexcept
+    {
+        if (base_ != nullptr)
+        {
+            // unlink while still holding the lock, so a publisher starting now cannot lose its fresh segment to us
+            shm_unlink(config_.name_.c_str());
+            munmap(base_, mapped_size_);
+            close(fd_);
+        }
+    }
+
+    bool SharedFrameRing::publish(const FrameView &frame) noexcept
+    {
+        // 🧅 a color plane inside the image keeps its offset; one in a buffer of its own (NV12M, NV16M) goes right
+        // after the image, the way the Recorder writes it
+        auto const image_end = frame.image.data() + frame.image.size();
+        const auto plane_count = static_cast<std::uint32_t>(std::min<std::size_t>(frame.plane_count, MAX_PLANES));
+        std::array<PlaneMeta, MAX_PLANES> planes{};
+        std::size_t used = frame.image.size();
+        for (std::uint32_t c = 0; c < plane_count; ++c)
+        {
+            auto const data = frame.planes[c].data;
+            planes[c].bytes_per_line = frame.planes[c].bytes_per_line;
+            if (data.empty())
+            {
+                continue;
+            }
+            planes[c].size = data.size();
+            if (data.data() >= frame.image.data() && data.data() + data.size() <= image_end)
+            {
+                planes[c].offset = static_cast<std::uint64_t>(data.data() - frame.image.data());
+            }
+            else
+            {
+                planes[c].offset = used;
+                used += data.size();
+            }
+        }
+        if (used > config_.slot_size_)
+        {
+            V4L2_TRACE(WARN, "shared frame ring {}: frame of {} bytes exceeds the {} byte slots", config_.name_, used,
+                       config_.slot_size_);
+            return false;
+        }
+
+        auto *ring = header(base_);
+        auto *target = slot(base_, next_);
+        // ✍️ odd: readers of this slot now know it is torn, the fence keeps the data writes after it
+        target->seq.store(2 * next_ + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        target->meta = FrameMeta{
+            .timestamp_monotonic_us = frame.timestamp_monotonic_us,
+            .v4l2_timestamp_us = frame.v4l2_timestamp_us,
+            .size = frame.image.size(),
+            .used = used,
+            .plane_count = plane_count,
+            .planes = planes,
+            .width = frame.width,
+            .height = frame.height,
+            .format = frame.format,
+            .bytes_per_line = frame.bytes_per_line,
+            .sequence = frame.sequence,
+            .flags = frame.flags,
+            .error = frame.error,
+            .has_jpeg = frame.jpeg.has_value(),
+            .jpeg = frame.jpeg.value_or(JpegInfo{}),
+        };
+        if (!frame.image.empty())
+        {
+            std::memcpy(slot_data(target), frame.image.data(), frame.image.size());
+        }
+        for (std::uint32_t c = 0; c < plane_count; ++c)
+        {
+            if (planes[c].offset >= frame.image.size() && planes[c].size > 0)
+            {
+                std::memcpy(slot_data(target) + planes[c].offset, frame.planes[c].data.data(), planes[c].size);
+            }
+        }
+
+        target->seq.store(2 * next_ + 2, std::memory_order_release);
+        ++next_;
+        ring->published.store(next_, std::memory_order_release);
+        ring->generation.fetch_add(1, std::memory_order_seq_cst);
+        // 🔔 a syscall only when somebody sleeps, see the waiters dance in SharedFrameSubscriber::next()
+        if (ring->waiters.load(std::memory_order_seq_cst) > 0)
+        {
+            futex(&ring->generation, FUTEX_WAKE, INT_MAX, nullptr);
+        }
+        return true;
+    }
+
+    std::uint64_t SharedFrameRing::published() const noexcept
+    {
+        return next_;
+    }
+
+    SharedFrameSubscriber::SharedFrameSubscriber(const std::string &name)
+    {
+        // read-write: waiters is part of the futex handshake
+        const int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error(fmt::format("shm_open({}) failed: {}", name, strerror(errno)));
+        }
+        struct stat st{};
+        if (fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(RingHeader))
+        {
+            close(fd);
+            throw std::runtime_error(fmt::format("{} is not a shared frame ring", name));
+        }
+        mapped_size_ = static_cast<std::size_t>(st.st_size);
+        void *mapped = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int err = errno;
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            throw std::runtime_error(fmt::format("mmap({}) failed: {}", name, strerror(err)));
+        }
+        base_ = static_cast<std::byte *>(mapped);
+
+        auto *ring = header(base_);
+        const bool valid = std::atomic_ref<std::uint64_t>(ring->magic).load(std::memory_order_acquire) == RING_MAGIC &&
+                           ring->version == RING_VERSION && ring->slot_count > 0 &&
+                           sizeof(RingHeader) + ring->slot_count * ring->slot_stride <= mapped_size_;
+        if (!valid)
+        {
+            munmap(base_, mapped_size_);
+            base_ = nullptr;
+            throw std::runtime_error(fmt::format("{} is not a version {} shared frame ring", name, RING_VERSION));
+        }
+        copy_.resize(ring->slot_size);
+        next_ = ring->published.load(std::memory_order_acquire);
+    }
+
+    SharedFrameSubscriber::~SharedFrameSubscriber() noexcept
+    {
+        if (base_ != nullptr)
+        {
+            munmap(base_, mapped_size_);
+        }
+    }
+
+    std::optional<FrameView> SharedFrameSubscriber::next_view(std::chrono::microseconds timeout)
+    {
+        auto *ring = header(base_);
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        view_seq_ = nullptr;
+        while (true)
+        {
+            // generation before published: a frame landing in between changes it and futex_wait returns at once
+            const auto generation = ring->generation.load(std::memory_order_seq_cst);
+            const auto published = ring->published.load(std::memory_order_acquire);
+            if (published > next_)
+            {
+                // 🏃 lapped: the oldest slots are already overwritten, jump to the oldest one still intact
+                if (published - next_ > ring->slot_count)
+                {
+                    const auto oldest = published - ring->slot_count;
+                    skipped_ += oldest - next_;
+                    next_ = oldest;
+                }
+
+                auto *source = slot(base_, next_);
+                const auto before = source->seq.load(std::memory_order_acquire);
+                if (before == 2 * next_ + 2)
+                {
+                    const FrameMeta meta = source->meta;
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (source->seq.load(std::memory_order_relaxed) == before)
+                    {
+                        // 👀 the metadata is ours now, the pixels stay in the slot until still_valid() says otherwise
+                        view_seq_ = &source->seq;
+                        view_stamp_ = before;
+                        view_used_ = std::min<std::uint64_t>(meta.used, ring->slot_size);
+                        ++next_;
+                        // whatever the metadata claims, nothing points past the slot
+                        auto const in_slot = [&](std::uint64_t offset, std::uint64_t size)
+                        {
+                            offset = std::min<std::uint64_t>(offset, ring->slot_size);
+                            return std::span<std::byte const>(slot_data(source) + offset, std::min(size, ring->slot_size - offset));
+                        };
+                        FrameView frame{
+                            .timestamp_monotonic_us = meta.timestamp_monotonic_us,
+                            .v4l2_timestamp_us = meta.v4l2_timestamp_us,
+                            .image = in_slot(0, meta.size),
+                            .width = meta.width,
+                            .height = meta.height,
+                            .format = meta.format,
+                            .bytes_per_line = meta.bytes_per_line,
+                            .sequence = meta.sequence,
+                            .flags = meta.flags,
+                            .error = meta.error,
+                            .jpeg = meta.has_jpeg ? std::optional<JpegInfo>(meta.jpeg) : std::nullopt,
+                        };
+                        frame.plane_count = std::min<std::uint32_t>(meta.plane_count, MAX_PLANES);
+                        for (std::uint32_t c = 0; c < frame.plane_count; ++c)
+                        {
+                            frame.planes[c] = FramePlane{.data = in_slot(meta.planes[c].offset, meta.planes[c].size),
+                                                         .bytes_per_line = meta.planes[c].bytes_per_line};
+                        }
+                        return frame;
+                    }
+                }
+                // overwritten under us, the publisher is a whole ring ahead: retry from what is left
+                ++skipped_;
+                ++next_;
+                continue;
+            }
+
+            timespec wait{};
+            timespec *wait_ptr = nullptr;
+            if (timeout.count() >= 0)
+            {
+                const auto left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+                if (left.count() <= 0)
+                {
+                    return std::nullopt;
+                }
+                wait.tv_sec = left.count() / 1'000'000;
+                wait.tv_nsec = left.count() % 1'000'000 * 1000;
+                wait_ptr = &wait;
+            }
+            ring->waiters.fetch_add(1, std::memory_order_seq_cst);
+            futex(&ring->generation, FUTEX_WAIT, generation, wait_ptr);
+            ring->waiters.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+
+    bool SharedFrameSubscriber::still_valid() const noexcept
+    {
+        // the seqlock's closing read: everything read from the slot before this fence saw the frame it was given
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return view_seq_ != nullptr && view_seq_->load(std::memory_order_relaxed) == view_stamp_;
+    }
+
+    std::optional<FrameView> SharedFrameSubscriber::next(std::chrono::microseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto left = timeout;
+        while (true)
+        {
+            auto frame = next_view(left);
+            if (!frame)
+            {
+                return std::nullopt;
+            }
+            // the image starts the slot data, the planes are somewhere in its first view_used_ bytes
+            auto const *start = frame->image.data();
+            std::memcpy(copy_.data(), start, view_used_);
+            if (still_valid())
+            {
+                auto const rebase = [&](std::span<std::byte const> data)
+                { return std::span<std::byte const>(copy_.data() + (data.data() - start), data.size()); };
+                frame->image = rebase(frame->image);
+                for (std::uint32_t c = 0; c < frame->plane_count; ++c)
+                {
+                    frame->planes[c].data = rebase(frame->planes[c].data);
+                }
+                return frame;
+            }
+            // the publisher came round while we copied
+            ++skipped_;
+            if (timeout.count() >= 0)
+            {
+                left = std::max(std::chrono::microseconds{0},
+                                std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()));
+            }
+        }
+    }
+} // namespace v4l2
@@ -0,0 +1,78 @@
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+
+#include "v4l2/trace.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        [[nodiscard]] TraceLevel level_from_env() noexcept
+        {
+            const char *env = std::getenv("V4L2_TRACE");
+            if (!env)
+            {
+                return TraceLevel::WARN;
+            }
+            constexpr std::pair<std::string_view, TraceLevel> names[] = {
+                {"off", TraceLevel::OFF}, {"warn", TraceLevel::WARN}, {"info", TraceLevel::INFO},
+                {"debug", TraceLevel::DEBUG}, {"trace", TraceLevel::TRACE},
+            };
+            for (auto const &[name, level] : names)
+            {
+                if (name == env)
+                {
+                    return level;
+                }
+            }
+            return TraceLevel::WARN;
+        }
+
+        [[nodiscard]] std::atomic<TraceLevel> &level_storage() noexcept
+        {
+            static std::atomic<TraceLevel> level{level_from_env()};
+            return level;
+        }
+
+        [[nodiscard]] constexpr std::string_view level_name(TraceLevel level) noexcept
+        {
+            switch (level)
+            {
+            case TraceLevel::WARN:
+                return "WARN";
+            case TraceLevel::INFO:
+                return "INFO";
+            case TraceLevel::DEBUG:
+                return "DEBUG";
+            case TraceLevel::TRACE:
+                return "TRACE";
+            case TraceLevel::OFF:
+            default:
+                return "";
+            }
+        }
+    } // namespace
+
+    [[nodiscard]] TraceLevel trace_level() noexcept
+    {
+        return level_storage().load(std::memory_order_relaxed);
+    }
+
+    void set_trace_level(TraceLevel level) noexcept
+    {
+        level_storage().store(level, std::memory_order_relaxed);
+    }
+
+    void trace_write(TraceLevel level, std::string_view message) noexcept
+    {
+        try
+        {
+            fmt::print(stderr, "{}: {}\n", level_name(level), message);
+        }
+        catch (...)
+        {
+            // a full disk must not take the capture down
+        }
+    }
+} // namespace v4l2
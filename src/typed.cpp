@@ -0,0 +1,53 @@
+#include <fmt/core.h>
+#include <stdexcept>
+
+#include "v4l2/typed.hpp"
+
+namespace v4l2
+{
+    void check_static_mode(const V4L2Camera &camera, PixelFormat format, std::uint32_t width, std::uint32_t height,
+                           std::uint32_t stride, std::size_t frame_size)
+    {
+        auto const &config = camera.config();
+        auto const [w, h] = dimensions_decompress(static_cast<std::uint32_t>(config.dimension_));
+        if (config.format_ != format || w != width || h != height)
+        {
+            throw std::runtime_error(fmt::format("{}: static mode {:#010x} {}x{}, the driver configured {:#010x} {}x{}",
+                                                 config.device_path_, static_cast<std::uint32_t>(format), width, height,
+                                                 static_cast<std::uint32_t>(config.format_), w, h));
+        }
+        if (stride != 0 && camera.bytes_per_line() != stride)
+        {
+            throw std::runtime_error(fmt::format("{}: static mode needs rows of {} bytes, the driver pads them to {}",
+                                                 config.device_path_, stride, camera.bytes_per_line()));
+        }
+        for (auto const &buffer : camera.buffers())
+        {
+            if (!buffer.data || buffer.size < frame_size)
+            {
+                throw std::runtime_error(fmt::format("{}: static mode needs mapped buffers of {} bytes, one has {}",
+                                                     config.device_path_, frame_size, buffer.data ? buffer.size : 0));
+            }
+        }
+    }
+
+    void check_static_frame(const V4L2Camera &camera, const FrameLease &lease, std::size_t frame_size)
+    {
+        auto const &view = lease.view();
+        if (view.image.size() >= frame_size)
+        {
+            return;
+        }
+        auto const buffers = camera.buffers();
+        if (lease.index() < buffers.size())
+        {
+            auto const &buffer = buffers[lease.index()];
+            if (buffer.data && view.image.data() >= buffer.data && view.image.data() + frame_size <= buffer.data + buffer.size)
+            {
+                return; // short, the driver buffer behind it is not
+            }
+        }
+        throw std::runtime_error(fmt::format("{}: frame {} has {} bytes, the static mode reads {}", camera.config().device_path_,
+                                             view.sequence, view.image.size(), frame_size));
+    }
+} // namespace v4l2
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <fmt/core.h>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+#include "v4l2/usb_bandwidth.hpp"
+
+namespace v4l2
+{
+    namespace
+    {
+        namespace fs = std::filesystem;
+
+        [[nodiscard]] std::string read_line(const fs::path &path)
+        {
+            std::ifstream in(path);
+            std::string line;
+            std::getline(in, line);
+            while (!line.empty() && (line.back() == '\n' || line.back() == ' '))
+            {
+                line.pop_back();
+            }
+            return line;
+        }
+
+        // sysfs "speed" is in Mbit/s
+        [[nodiscard]] UsbSpeed parse_speed(std::string_view mbit) noexcept
+        {
+            if (mbit == "1.5")
+            {
+                return UsbSpeed::LOW;
+            }
+            if (mbit == "12")
+            {
+                return UsbSpeed::FULL;
+            }
+            if (mbit == "480")
+            {
+                return UsbSpeed::HIGH;
+            }
+            if (mbit == "5000")
+            {
+                return UsbSpeed::SUPER;
+            }
+            if (mbit == "10000" || mbit == "20000")
+            {
+                return UsbSpeed::SUPER_PLUS;
+            }
+            return UsbSpeed::UNKNOWN;
+        }
+
+        [[nodiscard]] std::optional<UsbTopology> from_sysfs(const std::string &device_path, const fs::path &sysfs)
+        {
+            std::error_code ec;
+            auto const node = fs::canonical(device_path, ec); // /dev/v4l/by-id links resolve to the node
+            if (ec)
+            {
+                return std::nullopt;
+            }
+            auto const interface = fs::canonical(sysfs / "class" / "video4linux" / node.filename() / "device", ec);
+            if (ec)
+            {
+                return std::nullopt;
+            }
+
+            // 🌳 the video interface is "3-1.2:1.0", the first directory above it with a busnum is its USB device,
+            // the root hub "usb3" is further up, and the host controller is the root hub's parent
+            for (auto dir = interface; dir != dir.parent_path(); dir = dir.parent_path())
+            {
+                if (!fs::exists(dir / "busnum", ec) || !fs::exists(dir / "speed", ec))
+                {
+                    continue;
+                }
+                UsbTopology topology{.port = dir.filename().string(),
+                                     .controller = {},
+                                     .speed = parse_speed(read_line(dir / "speed")),
+                                     .serial = fs::exists(dir / "serial", ec) ? read_line(dir / "serial") : std::string{}};
+                try
+                {
+                    topology.bus = static_cast<std::uint32_t>(std::stoul(read_line(dir / "busnum")));
+                }
+                catch (const std::exception &)
+                {
+                    return std::nullopt;
+                }
+                for (auto hub = dir; hub != hub.parent_path(); hub = hub.parent_path())
+                {
+                    if (hub.filename().string().starts_with("usb"))
+                    {
+                        topology.controller = hub.parent_path().filename().string();
+                        break;
+                    }
+                }
+                return topology;
+            }
+            return std::nullopt; // a platform device, CSI for example
+        }
+
+        [[nodiscard]] std::optional<UsbTopology> from_bus_info(std::string_view bus_info)
+        {
+            // "usb-<controller>-<port>", the controller has dashes of its own on some platforms
+            constexpr std::string_view prefix = "usb-";
+            if (!bus_info.starts_with(prefix))
+            {
+                return std::nullopt;
+            }
+            bus_info.remove_prefix(prefix.size());
+            const auto dash = bus_info.rfind('-');
+            if (dash == std::string_view::npos || dash == 0 || dash + 1 == bus_info.size())
+            {
+                return std::nullopt;
+            }
+            return UsbTopology{.port = std::string(bus_info.substr(dash + 1)),
+                               .controller = std::string(bus_info.substr(0, dash)),
+                               .speed = UsbSpeed::HIGH,
+                               .serial = {}};
+        }
+
+        [[nodiscard]] std::string_view speed_str(UsbSpeed speed) noexcept
+        {
+            switch (speed)
+            {
+            case UsbSpeed::LOW:
+                return "low-speed";
+            case UsbSpeed::FULL:
+                return "full-speed";
+            case UsbSpeed::HIGH:
+                return "high-speed";
+            case UsbSpeed::SUPER:
+                return "SuperSpeed";
+            case UsbSpeed::SUPER_PLUS:
+                return "SuperSpeed+";
+            default:
+                return "unknown-speed";
+            }
+        }
+
+        struct Candidate
+        {
+            PixelFormat format{};
+            std::uint32_t width{};
+            std::uint32_t height{};
+            FrameRate rate{};
+            std::uint64_t bytes{};
+            double pixel_rate{};
+        };
+
+        [[nodiscard]] double to_fps(const FrameRate &rate) noexcept
+        {
+            return rate.denominator == 0 ? 0.0 : static_cast<double>(rate.numerator) / rate.denominator;
+        }
+
+        // Every mode within the request that one endpoint can carry, best first
+        [[nodiscard]] std::vector<Candidate> candidates(const BandwidthRequest &request, UsbSpeed speed, const UsbBandwidthModel &model)
+        {
+            auto const [max_width, max_height] = dimensions_decompress(static_cast<std::uint32_t>(request.config.dimension_));
+            const FrameRate max_rate{static_cast<std::uint32_t>(request.config.fps_num_), request.config.fps_den_};
+            const std::uint64_t endpoint = usb_endpoint_limit(speed);
+
+            std::vector<Candidate> list;
+            for (auto const &mode : request.modes)
+            {
+                // configure() takes these two only
+                if ((mode.format != PixelFormat::MJPG && mode.format != PixelFormat::YUYV) || mode.width > max_width || mode.height > max_height)
+                {
+                    continue;
+                }
+                for (auto const &rate : mode.frame_rates)
+                {
+                    if (std::uint64_t{rate.numerator} * max_rate.denominator > std::uint64_t{max_rate.numerator} * rate.denominator)
+                    {
+                        continue;
+                    }
+                    const std::uint64_t bytes = predict_usb_bandwidth(mode.format, mode.width, mode.height, rate, model);
+                    if (bytes > endpoint)
+                    {
+                        continue;
+                    }
+                    list.push_back(Candidate{.format = mode.format,
+                                             .width = mode.width,
+                                             .height = mode.height,
+                                             .rate = rate,
+                                             .bytes = bytes,
+                                             .pixel_rate = double(mode.width) * mode.height * to_fps(rate)});
+                }
+            }
+            std::stable_sort(list.begin(), list.end(), [&](const Candidate &a, const Candidate &b)
+                             {
+                                 if (a.pixel_rate != b.pixel_rate)
+                                 {
+                                     return a.pixel_rate > b.pixel_rate;
+                                 }
+                                 if ((a.format == request.config.format_) != (b.format == request.config.format_))
+                                 {
+                                     return a.format == request.config.format_;
+                                 }
+                                 return a.bytes < b.bytes; });
+            return list;
+        }
+    } // namespace
+
+    std::optional<UsbTopology> usb_topology(const std::string &device_path, const std::string &bus_info, const std::filesystem::path &sysfs)
+    {
+        if (auto topology = from_sysfs(device_path, sysfs))
+        {
+            return topology;
+        }
+        return from_bus_info(bus_info);
+    }
+
+    std::uint64_t predict_usb_bandwidth(PixelFormat format, std::uint32_t width, std::uint32_t height,
+                                        const FrameRate &rate, const UsbBandwidthModel &model) noexcept
+    {
+        // anything but MJPG is taken as 16 bits per pixel, like YUYV
+        const double bytes_per_pixel = format == PixelFormat::MJPG ? model.mjpeg_bytes_per_pixel_ : 2.0;
+        return static_cast<std::uint64_t>(double(width) * height * bytes_per_pixel * to_fps(rate) * (1.0 + model.overhead_));
+    }
+
+    std::uint64_t usb_periodic_budget(UsbSpeed speed) noexcept
+    {
+        switch (speed)
+        {
+        case UsbSpeed::LOW:
+            return 0;
+        case UsbSpeed::FULL:
+            return 1'350'000; // 90 % of 1500 bytes per frame
+        case UsbSpeed::SUPER:
+            return 400'000'000;
+        case UsbSpeed::SUPER_PLUS:
+            return 900'000'000;
+        default:
+            return 48'000'000; // 80 % of 7500 bytes per microframe, also for unknown: the smaller budget is the safe guess
+        }
+    }
+
+    std::uint64_t usb_endpoint_limit(UsbSpeed speed) noexcept
+    {
+        switch (speed)
+        {
+        case UsbSpeed::LOW:
+            return 0;
+        case UsbSpeed::FULL:
+            return 1'023'000; // 1023 bytes per frame
+        case UsbSpeed::SUPER:
+            return 393'216'000; // 3 x 16 x 1024 bytes per 125 us
+        case UsbSpeed::SUPER_PLUS:
+            return 786'432'000;
+        default:
+            return 24'576'000; // 3 x 1024 bytes per microframe
+        }
+    }
+
+    std::vector<BandwidthPlan> plan_usb_bandwidth(const std::vector<BandwidthRequest> &requests, const UsbBandwidthModel &model)
+    {
+        std::vector<BandwidthPlan> plans(requests.size());
+        std::vector<std::vector<Candidate>> lists(requests.size());
+        std::vector<std::size_t> picked(requests.size(), 0);
+        std::map<std::pair<std::string, std::uint32_t>, std::vector<std::size_t>> buses; // (controller, bus) -> cameras
+
+        for (std::size_t i = 0; i < requests.size(); ++i)
+        {
+            auto const &request = requests[i];
+            plans[i].config = request.config;
+            if (!request.topology)
+            {
+                continue; // off USB, nothing to share
+            }
+            auto const speed = request.topology->speed == UsbSpeed::UNKNOWN ? UsbSpeed::HIGH : request.topology->speed;
+            lists[i] = candidates(request, speed, model);
+            if (lists[i].empty())
+            {
+                auto const [w, h] = dimensions_decompress(static_cast<std::uint32_t>(request.config.dimension_));
+                throw std::runtime_error(fmt::format("{}: no MJPG/YUYV mode up to {}x{} at {}/{} fps fits a {} endpoint",
+                                                     request.config.device_path_, w, h, static_cast<std::uint32_t>(request.config.fps_num_),
+                                                     request.config.fps_den_, speed_str(speed)));
+            }
+            buses[{request.topology->controller, request.topology->bus}].push_back(i);
+        }
+
+        // 📉 per bus: while over budget, the biggest user steps down to its next cheaper mode
+        for (auto const &[bus, cameras] : buses)
+        {
+            auto const speed = requests[cameras.front()].topology->speed == UsbSpeed::UNKNOWN ? UsbSpeed::HIGH : requests[cameras.front()].topology->speed;
+            const auto budget = static_cast<std::uint64_t>(static_cast<double>(usb_periodic_budget(speed)) * model.headroom_);
+            auto total = [&]
+            {
+                std::uint64_t sum = 0;
+                for (auto const i : cameras)
+                {
+                    sum += lists[i][picked[i]].bytes;
+                }
+                return sum;
+            };
+            auto next_cheaper = [&](std::size_t i) -> std::optional<std::size_t>
+            {
+                for (std::size_t k = picked[i] + 1; k < lists[i].size(); ++k)
+                {
+                    if (lists[i][k].bytes < lists[i][picked[i]].bytes)
+                    {
+                        return k;
+                    }
+                }
+                return std::nullopt;
+            };
+
+            while (total() > budget)
+            {
+                std::optional<std::size_t> victim;
+                for (auto const i : cameras)
+                {
+                    if (next_cheaper(i) && (!victim || lists[i][picked[i]].bytes > lists[*victim][picked[*victim]].bytes))
+                    {
+                        victim = i;
+                    }
+                }
+                if (!victim)
+                {
+                    throw std::runtime_error(fmt::format("USB bus {} on {}: {} camera(s) need {:.1f} MB/s at their cheapest modes, the {} budget is {:.1f} MB/s",
+                                                         bus.second, bus.first, cameras.size(), static_cast<double>(total()) / 1e6,
+                                                         speed_str(speed), static_cast<double>(budget) / 1e6));
+                }
+                picked[*victim] = *next_cheaper(*victim);
+            }
+        }
+
+        for (std::size_t i = 0; i < requests.size(); ++i)
+        {
+            if (lists[i].empty())
+            {
+                continue;
+            }
+            auto const &choice = lists[i][picked[i]];
+            auto &config = plans[i].config;
+            config.format_ = choice.format;
+            config.dimension_ = to_dimension(choice.width, choice.height);
+            config.fps_num_ = static_cast<FPS>(choice.rate.numerator);
+            config.fps_den_ = choice.rate.denominator;
+            plans[i].bytes_per_second = choice.bytes;
+            plans[i].downgraded = picked[i] != 0;
+        }
+        return plans;
+    }
+} // namespace v4l2
@@ -0,0 +1,836 @@
+#include "v4l2/v4l2-batch-src.hpp"
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#pragma GCC diagnostic pop
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <sched.h> // For CPU_SETSIZE
+
+GST_DEBUG_CATEGORY_STATIC(v4l2_batch_src_debug);
+#define GST_CAT_DEFAULT v4l2_batch_src_debug
+
+// Pad template: every buffer of a list under these caps, one mode for all cameras
+static GstStaticPadTemplate batch_pad_template =
+    GST_STATIC_PAD_TEMPLATE("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+                            GST_STATIC_CAPS(
+                                "image/jpeg, "
+                                "width=(int)[1,MAX], "
+                                "height=(int)[1,MAX], "
+                                "framerate=(fraction)[0/1,MAX]; "
+                                "video/x-raw, "
+                                "format=(string){ YUY2, NV12, NV16 }, "
+                                "width=(int)[1,MAX], "
+                                "height=(int)[1,MAX], "
+                                "framerate=(fraction)[0/1,MAX]"));
+
+// ─── V4L2BatchMeta ──────────────────────────────────────────────────────────────
+
+GType v4l2_batch_meta_api_get_type(void)
+{
+    static gsize type = 0;
+    if (g_once_init_enter(&type))
+    {
+        static const gchar *tags[] = {nullptr}; // no tags: scaling or converting the frame keeps where it came from
+        g_once_init_leave(&type, gst_meta_api_type_register("V4L2BatchMetaAPI", tags));
+    }
+    return static_cast<GType>(type);
+}
+
+static gboolean v4l2_batch_meta_init(GstMeta *meta, [[maybe_unused]] gpointer params, [[maybe_unused]] GstBuffer *buffer)
+{
+    auto *batch = reinterpret_cast<V4L2BatchMeta *>(meta);
+    batch->source = 0;
+    batch->batch = 0;
+    batch->sequence = 0;
+    batch->v4l2_timestamp_us = 0;
+    batch->repeated = FALSE;
+    return TRUE;
+}
+
+static gboolean v4l2_batch_meta_transform(GstBuffer *dest, GstMeta *meta, [[maybe_unused]] GstBuffer *buffer,
+                                          [[maybe_unused]] GQuark type, [[maybe_unused]] gpointer data)
+{
+    auto const *from = reinterpret_cast<const V4L2BatchMeta *>(meta);
+    V4L2BatchMeta *to = gst_buffer_add_v4l2_batch_meta(dest);
+    if (!to)
+    {
+        return FALSE;
+    }
+    to->source = from->source;
+    to->batch = from->batch;
+    to->sequence = from->sequence;
+    to->v4l2_timestamp_us = from->v4l2_timestamp_us;
+    to->repeated = from->repeated;
+    return TRUE;
+}
+
+const GstMetaInfo *v4l2_batch_meta_get_info(void)
+{
+    static gsize info = 0;
+    if (g_once_init_enter(&info))
+    {
+        const GstMetaInfo *registered = gst_meta_register(V4L2_BATCH_META_API_TYPE, "V4L2BatchMeta", sizeof(V4L2BatchMeta),
+                                                          v4l2_batch_meta_init, nullptr, v4l2_batch_meta_transform);
+        g_once_init_leave(&info, reinterpret_cast<gsize>(registered));
+    }
+    return reinterpret_cast<const GstMetaInfo *>(info);
+}
+
+V4L2BatchMeta *gst_buffer_add_v4l2_batch_meta(GstBuffer *buffer)
+{
+    return reinterpret_cast<V4L2BatchMeta *>(gst_buffer_add_meta(buffer, V4L2_BATCH_META_INFO, nullptr));
+}
+
+// ─── v4l2-batch-src ─────────────────────────────────────────────────────────────
+
+template <typename T>
+static T *get_instance(GObject *obj)
+{
+    return reinterpret_cast<T *>(GST_V4L2_BATCH_SRC(obj));
+}
+
+static void _v4l2_batch_src_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec);
+static void _v4l2_batch_src_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec);
+static gboolean _v4l2_batch_src_start(GstBaseSrc *src);
+static gboolean _v4l2_batch_src_stop(GstBaseSrc *src);
+static GstCaps *_v4l2_batch_src_get_caps(GstBaseSrc *src, GstCaps *filter);
+static gboolean _v4l2_batch_src_query(GstBaseSrc *src, GstQuery *query);
+static gboolean _v4l2_batch_src_unlock(GstBaseSrc *src);
+static gboolean _v4l2_batch_src_unlock_stop(GstBaseSrc *src);
+static GstFlowReturn _v4l2_batch_src_create(GstPushSrc *src, GstBuffer **buf);
+static void _v4l2_batch_src_finalize(GObject *object);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wvolatile"
+G_DEFINE_TYPE(V4L2BatchSrc, _v4l2_batch_src, GST_TYPE_PUSH_SRC)
+#pragma GCC diagnostic pop
+
+[[nodiscard]] static GstClockTime batch_ns_per_frame(const v4l2::V4l2Config &config)
+{
+    if (static_cast<gint>(config.fps_num_) <= 0)
+    {
+        return GST_CLOCK_TIME_NONE;
+    }
+    return gst_util_uint64_scale_int(GST_SECOND, static_cast<gint>(config.fps_den_), static_cast<gint>(config.fps_num_));
+}
+
+// Fixed caps of the mode every camera streams
+[[nodiscard]] static GstCaps *batch_caps(const v4l2::V4l2Config &config)
+{
+    auto const [w, h] = v4l2::dimensions_decompress(static_cast<uint32_t>(config.dimension_));
+    GstCaps *caps = nullptr;
+    if (config.format_ == PixelFormatEnum::MJPG)
+    {
+        caps = gst_caps_new_simple("image/jpeg",
+                                   "width", G_TYPE_INT, static_cast<gint>(w),
+                                   "height", G_TYPE_INT, static_cast<gint>(h),
+                                   nullptr);
+    }
+    else
+    {
+        caps = gst_caps_new_simple("video/x-raw",
+                                   "format", G_TYPE_STRING, gst_video_format_to_string(to_gst_video_format(config.format_)),
+                                   "width", G_TYPE_INT, static_cast<gint>(w),
+                                   "height", G_TYPE_INT, static_cast<gint>(h),
+                                   nullptr);
+    }
+    gst_caps_set_simple(caps, "framerate", GST_TYPE_FRACTION, static_cast<gint>(config.fps_num_),
+                        static_cast<gint>(config.fps_den_), nullptr);
+    return caps;
+}
+
+static void _v4l2_batch_src_class_init(V4L2BatchSrcClass *klass)
+{
+    GST_DEBUG_CATEGORY_INIT(v4l2_batch_src_debug, "v4l2-batch-src", 0, "Synchronized V4L2 cameras");
+
+    auto *gclass = G_OBJECT_CLASS(klass);
+    gclass->set_property = _v4l2_batch_src_set_property;
+    gclass->get_property = _v4l2_batch_src_get_property;
+    gclass->finalize = _v4l2_batch_src_finalize;
+
+    // 1 = devices
+    g_object_class_install_property(
+        gclass,
+        1,
+        g_param_spec_string(
+            "devices",
+            "Devices",
+            "Comma-separated V4L2 devices (or replay:// URIs, see v4l2-src), buffer i of every list comes from device i",
+            DEFAULT_BATCH_DEVICES,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 2 = pixel-format
+    g_object_class_install_property(
+        gclass,
+        2,
+        g_param_spec_enum("pixel-format", "Pixel Format", "Pixel format of every camera", v4l2src_pixel_format_get_type(),
+                          static_cast<int>(DEFAULT_BATCH_PIXEL_FORMAT),
+                          static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 3 = width
+    g_object_class_install_property(
+        gclass,
+        3,
+        g_param_spec_uint(
+            "width",
+            "Width",
+            "Frame width of every camera",
+            1, 65535, DEFAULT_BATCH_WIDTH,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 4 = height
+    g_object_class_install_property(
+        gclass,
+        4,
+        g_param_spec_uint(
+            "height",
+            "Height",
+            "Frame height of every camera",
+            1, 65535, DEFAULT_BATCH_HEIGHT,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 5 = framerate
+    g_object_class_install_property(
+        gclass,
+        5,
+        gst_param_spec_fraction(
+            "framerate",
+            "Framerate",
+            "Frame rate of every camera, e.g. 30/1",
+            1, 1, G_MAXINT, 1, DEFAULT_BATCH_FRAMERATE_N, DEFAULT_BATCH_FRAMERATE_D,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 6 = buffer-count
+    g_object_class_install_property(
+        gclass,
+        6,
+        g_param_spec_uint(
+            "buffer-count",
+            "Buffer Count",
+            "Driver buffers per camera: up to 3 wait for the other cameras (4 with missing=repeat), the rest can be downstream",
+            4, 32, DEFAULT_BATCH_BUFFER_COUNT,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 7 = tolerance
+    g_object_class_install_property(
+        gclass,
+        7,
+        g_param_spec_uint(
+            "tolerance",
+            "Tolerance",
+            "Microseconds the driver timestamps of one set may be apart",
+            0, G_MAXUINT, DEFAULT_BATCH_TOLERANCE_US,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 8 = max-wait
+    g_object_class_install_property(
+        gclass,
+        8,
+        g_param_spec_uint(
+            "max-wait",
+            "Max Wait",
+            "Milliseconds a camera may fall behind the others before its frame counts as missing",
+            0, G_MAXUINT / 1000, DEFAULT_BATCH_MAX_WAIT_MS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 9 = missing
+    static const GEnumValue missing_values[] = {
+        {static_cast<int>(BatchMissingEnum::DROP), "drop", "drop"},
+        {static_cast<int>(BatchMissingEnum::REPEAT_LAST), "repeat", "repeat"},
+        {0, nullptr, nullptr}};
+    GType missing_type = g_enum_register_static("V4L2BatchMissingEnum", missing_values);
+    g_object_class_install_property(
+        gclass,
+        9,
+        g_param_spec_enum(
+            "missing",
+            "Missing",
+            "drop: a set without a frame of every camera is not pushed, "
+            "repeat: it is, with the camera's previous frame in the gap (V4L2BatchMeta.repeated)",
+            missing_type,
+            static_cast<int>(DEFAULT_BATCH_MISSING),
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 10 = loop-cpu
+    g_object_class_install_property(
+        gclass,
+        10,
+        g_param_spec_int(
+            "loop-cpu",
+            "Loop CPU",
+            "Pin the thread dequeuing every camera to this CPU (-1 = no affinity)",
+            -1, CPU_SETSIZE - 1, DEFAULT_BATCH_LOOP_CPU,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 11 = capture-timeout
+    g_object_class_install_property(
+        gclass,
+        11,
+        g_param_spec_uint(
+            "capture-timeout",
+            "Capture Timeout",
+            "Milliseconds to wait for a set before erroring out (0 = forever)",
+            0, G_MAXUINT, DEFAULT_BATCH_CAPTURE_TIMEOUT_MS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 12 = stats (read-only)
+    g_object_class_install_property(
+        gclass,
+        12,
+        g_param_spec_boxed(
+            "stats",
+            "Statistics",
+            "Set counters since start: sets, incomplete-sets, repeated-frames, dropped-frames, dropped-sets",
+            GST_TYPE_STRUCTURE,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    // metadata and pads
+    auto *eclass = GST_ELEMENT_CLASS(klass);
+    gst_element_class_set_static_metadata(
+        eclass,
+        "V4L2 Batch Source",
+        "Source/Video",
+        "Frames of several ::V4L2Camera taken at the same moment, pushed as one GstBufferList",
+        "You <you@example.com>");
+    gst_element_class_add_static_pad_template(eclass, &batch_pad_template);
+
+    // override base class virtuals
+    auto *bclass = GST_BASE_SRC_CLASS(klass);
+    bclass->start = _v4l2_batch_src_start;
+    bclass->stop = _v4l2_batch_src_stop;
+    bclass->get_caps = _v4l2_batch_src_get_caps;
+    bclass->query = _v4l2_batch_src_query;
+    bclass->unlock = _v4l2_batch_src_unlock;
+    bclass->unlock_stop = _v4l2_batch_src_unlock_stop;
+
+    // PushSrc virtual method
+    auto *pclass = GST_PUSH_SRC_CLASS(klass);
+    pclass->create = _v4l2_batch_src_create;
+}
+
+static void _v4l2_batch_src_init(V4L2BatchSrc *self)
+{
+    // GObject hands us zeroed memory, bring the C++ members to life
+    std::construct_at(&self->group);
+    std::construct_at(&self->sync);
+    std::construct_at(&self->flushing, false);
+
+    self->devices = g_strdup(DEFAULT_BATCH_DEVICES);
+    self->pixel_format = DEFAULT_BATCH_PIXEL_FORMAT;
+    self->width = DEFAULT_BATCH_WIDTH;
+    self->height = DEFAULT_BATCH_HEIGHT;
+    self->framerate_n = DEFAULT_BATCH_FRAMERATE_N;
+    self->framerate_d = DEFAULT_BATCH_FRAMERATE_D;
+    self->buffer_count = DEFAULT_BATCH_BUFFER_COUNT;
+    self->tolerance_us = DEFAULT_BATCH_TOLERANCE_US;
+    self->max_wait_ms = DEFAULT_BATCH_MAX_WAIT_MS;
+    self->missing = DEFAULT_BATCH_MISSING;
+    self->loop_cpu = DEFAULT_BATCH_LOOP_CPU;
+    self->capture_timeout_ms = DEFAULT_BATCH_CAPTURE_TIMEOUT_MS;
+    self->next_set = 0;
+
+    gst_base_src_set_live(GST_BASE_SRC(self), TRUE);
+    gst_base_src_set_format(GST_BASE_SRC(self), GST_FORMAT_TIME);
+    // ⏱ create() stamps from the driver timestamps, like v4l2-src
+    gst_base_src_set_do_timestamp(GST_BASE_SRC(self), FALSE);
+}
+
+static void _v4l2_batch_src_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(object));
+    switch (prop_id)
+    {
+    case 1: // devices
+        g_free(self->devices);
+        self->devices = g_value_dup_string(value);
+        break;
+    case 2: // pixel-format
+        self->pixel_format = static_cast<PixelFormatEnum>(g_value_get_enum(value));
+        break;
+    case 3: // width
+        self->width = g_value_get_uint(value);
+        break;
+    case 4: // height
+        self->height = g_value_get_uint(value);
+        break;
+    case 5: // framerate
+        self->framerate_n = gst_value_get_fraction_numerator(value);
+        self->framerate_d = gst_value_get_fraction_denominator(value);
+        break;
+    case 6: // buffer-count
+        self->buffer_count = g_value_get_uint(value);
+        break;
+    case 7: // tolerance
+        self->tolerance_us = g_value_get_uint(value);
+        break;
+    case 8: // max-wait
+        self->max_wait_ms = g_value_get_uint(value);
+        break;
+    case 9: // missing
+        self->missing = static_cast<BatchMissingEnum>(g_value_get_enum(value));
+        break;
+    case 10: // loop-cpu
+        self->loop_cpu = g_value_get_int(value);
+        break;
+    case 11: // capture-timeout
+        self->capture_timeout_ms = g_value_get_uint(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void _v4l2_batch_src_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(object));
+    switch (prop_id)
+    {
+    case 1:
+        g_value_set_string(value, self->devices);
+        break;
+    case 2:
+        g_value_set_enum(value, static_cast<gint>(self->pixel_format));
+        break;
+    case 3:
+        g_value_set_uint(value, self->width);
+        break;
+    case 4:
+        g_value_set_uint(value, self->height);
+        break;
+    case 5:
+        gst_value_set_fraction(value, self->framerate_n, self->framerate_d);
+        break;
+    case 6:
+        g_value_set_uint(value, self->buffer_count);
+        break;
+    case 7:
+        g_value_set_uint(value, self->tolerance_us);
+        break;
+    case 8:
+        g_value_set_uint(value, self->max_wait_ms);
+        break;
+    case 9:
+        g_value_set_enum(value, static_cast<gint>(self->missing));
+        break;
+    case 10:
+        g_value_set_int(value, self->loop_cpu);
+        break;
+    case 11:
+        g_value_set_uint(value, self->capture_timeout_ms);
+        break;
+    case 12: // stats
+    {
+        GstStructure *s = gst_structure_new_empty("v4l2-batch-src-stats");
+        GST_OBJECT_LOCK(self);
+        if (self->sync)
+        {
+            auto const stats = self->sync->stats();
+            gst_structure_set(s,
+                              "sets", G_TYPE_UINT64, static_cast<guint64>(stats.sets),
+                              "incomplete-sets", G_TYPE_UINT64, static_cast<guint64>(stats.incomplete_sets),
+                              "repeated-frames", G_TYPE_UINT64, static_cast<guint64>(stats.repeated_frames),
+                              "dropped-frames", G_TYPE_UINT64, static_cast<guint64>(stats.dropped_frames),
+                              "dropped-sets", G_TYPE_UINT64, static_cast<guint64>(stats.dropped_sets),
+                              nullptr);
+        }
+        GST_OBJECT_UNLOCK(self);
+        g_value_take_boxed(value, s);
+        break;
+    }
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+// 📊 "<metrics_key()>/<index>" for each camera of the group, as registered with MetricsRegistry::global()
+[[nodiscard]] static std::vector<std::string> metrics_names(V4L2BatchSrc *self, std::size_t cameras)
+{
+    gchar *key = metrics_key(GST_OBJECT(self));
+    const std::string prefix = key;
+    g_free(key);
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < cameras; ++i)
+    {
+        names.push_back(prefix + "/" + std::to_string(i));
+    }
+    return names;
+}
+
+// The `devices` list, blanks around the commas dropped
+[[nodiscard]] static std::vector<std::string> device_list(const gchar *devices)
+{
+    std::vector<std::string> paths;
+    gchar **parts = g_strsplit(devices ? devices : "", ",", -1);
+    for (gchar **part = parts; *part; ++part)
+    {
+        if (*g_strstrip(*part))
+        {
+            paths.emplace_back(*part);
+        }
+    }
+    g_strfreev(parts);
+    return paths;
+}
+
+static gboolean _v4l2_batch_src_start(GstBaseSrc *basesrc)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(basesrc));
+    auto const paths = device_list(self->devices);
+    if (paths.empty())
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("no devices"), ("devices is \"%s\"", self->devices ? self->devices : ""));
+        return FALSE;
+    }
+
+    v4l2::CameraGroupConfig group_cfg;
+    if (self->loop_cpu >= 0)
+    {
+        group_cfg.loop_cpu_ = static_cast<unsigned>(self->loop_cpu);
+    }
+    auto group = std::make_shared<v4l2::CameraGroup>(group_cfg);
+    for (auto const &path : paths)
+    {
+        v4l2::V4l2Config cfg;
+        cfg.device_path_ = path;
+        cfg.format_ = self->pixel_format;
+        cfg.dimension_ = v4l2::to_dimension(self->width, self->height);
+        cfg.fps_num_ = static_cast<FPSEnum>(self->framerate_n);
+        cfg.fps_den_ = static_cast<std::uint32_t>(self->framerate_d);
+        cfg.buffer_count_ = self->buffer_count;
+        group->add_camera(cfg);
+    }
+    GST_INFO_OBJECT(self, "starting %zu cameras: pixel format %08X, %ux%u, %d/%d fps, %u buffers each",
+                    paths.size(), static_cast<uint32_t>(self->pixel_format), self->width, self->height,
+                    self->framerate_n, self->framerate_d, self->buffer_count);
+
+    try
+    {
+        group->open_all();
+    }
+    catch (const std::exception &ex)
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to open the cameras"), ("%s", ex.what()));
+        return FALSE;
+    }
+
+    // 🎞 one caps for the whole list: a camera the driver moved to another mode cannot be in it
+    auto const &first = group->camera(0).config();
+    for (std::size_t i = 1; i < group->size(); ++i)
+    {
+        auto const &other = group->camera(i).config();
+        if (other.format_ != first.format_ || other.dimension_ != first.dimension_ ||
+            other.fps_num_ != first.fps_num_ || other.fps_den_ != first.fps_den_)
+        {
+            auto const [first_w, first_h] = v4l2::dimensions_decompress(static_cast<uint32_t>(first.dimension_));
+            auto const [other_w, other_h] = v4l2::dimensions_decompress(static_cast<uint32_t>(other.dimension_));
+            GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("the cameras do not stream the same mode"),
+                              ("%s: %08X %ux%u %u/%u fps, %s: %08X %ux%u %u/%u fps",
+                               paths[0].c_str(), static_cast<uint32_t>(first.format_), first_w, first_h,
+                               static_cast<uint32_t>(first.fps_num_), first.fps_den_,
+                               paths[i].c_str(), static_cast<uint32_t>(other.format_), other_w, other_h,
+                               static_cast<uint32_t>(other.fps_num_), other.fps_den_));
+            return FALSE;
+        }
+    }
+
+    std::unique_ptr<v4l2::FrameSynchronizer> sync;
+    try
+    {
+        sync = std::make_unique<v4l2::FrameSynchronizer>(
+            group->size(), v4l2::FrameSyncConfig{.tolerance_ = std::chrono::microseconds(self->tolerance_us),
+                                                 .max_wait_ = std::chrono::milliseconds(self->max_wait_ms),
+                                                 .missing_ = self->missing});
+        sync->start(*group);
+    }
+    catch (const std::exception &ex)
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to start the cameras"), ("%s", ex.what()));
+        return FALSE;
+    }
+
+    auto const names = metrics_names(self, group->size());
+    for (std::size_t i = 0; i < group->size(); ++i)
+    {
+        v4l2::MetricsRegistry::global().add(names[i], group->camera(i).metrics());
+    }
+
+    self->flushing.store(false);
+    self->next_set = 0;
+    GST_OBJECT_LOCK(self);
+    self->group = std::move(group);
+    self->sync = std::move(sync);
+    GST_OBJECT_UNLOCK(self);
+
+    if (!gst_base_src_negotiate(GST_BASE_SRC(self)))
+    {
+        GST_ERROR_OBJECT(self, "negotiation failed");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean _v4l2_batch_src_stop(GstBaseSrc *basesrc)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(basesrc));
+    GST_DEBUG_OBJECT(self, "stopping");
+
+    GST_OBJECT_LOCK(self);
+    auto group = std::move(self->group);
+    auto sync = std::move(self->sync);
+    GST_OBJECT_UNLOCK(self);
+
+    if (group)
+    {
+        group->stop(); // the loop thread is gone, nothing pushes into the synchronizer any more
+        for (auto const &name : metrics_names(self, group->size()))
+        {
+            v4l2::MetricsRegistry::global().remove(name);
+        }
+    }
+    if (sync)
+    {
+        auto const stats = sync->stats();
+        GST_INFO_OBJECT(self, "%" G_GUINT64_FORMAT " sets, %" G_GUINT64_FORMAT " incomplete, %" G_GUINT64_FORMAT
+                              " frames dropped, %" G_GUINT64_FORMAT " sets dropped",
+                        stats.sets, stats.incomplete_sets, stats.dropped_frames, stats.dropped_sets);
+    }
+    sync.reset();  // 🧹 held frames go back to their drivers
+    group.reset(); // buffers still downstream keep the cameras until they return
+    return TRUE;
+}
+
+static GstCaps *_v4l2_batch_src_get_caps(GstBaseSrc *basesrc, GstCaps *filter)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(basesrc));
+    GST_OBJECT_LOCK(self);
+    auto group = self->group;
+    GST_OBJECT_UNLOCK(self);
+
+    GstCaps *caps = group ? batch_caps(group->camera(0).config()) : gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(basesrc));
+    if (filter)
+    {
+        GstCaps *filtered = gst_caps_intersect_full(filter, caps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref(caps);
+        return filtered;
+    }
+    return caps;
+}
+
+// LATENCY: a set is complete one interval after its last member is stamped, up to tolerance after the first;
+// a camera falling behind holds it back for max-wait at most
+static gboolean _v4l2_batch_src_query(GstBaseSrc *src, GstQuery *query)
+{
+    if (GST_QUERY_TYPE(query) != GST_QUERY_LATENCY)
+    {
+        return GST_BASE_SRC_CLASS(_v4l2_batch_src_parent_class)->query(src, query);
+    }
+
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(src));
+    GST_OBJECT_LOCK(self);
+    auto group = self->group;
+    GST_OBJECT_UNLOCK(self);
+    if (!group)
+    {
+        GST_DEBUG_OBJECT(self, "latency query before start, no frame interval yet");
+        return FALSE;
+    }
+
+    auto const &active = group->camera(0).config();
+    const GstClockTime frame = batch_ns_per_frame(active);
+    if (!GST_CLOCK_TIME_IS_VALID(frame))
+    {
+        GST_DEBUG_OBJECT(self, "no frame rate, cannot answer the latency query");
+        return FALSE;
+    }
+    const GstClockTime min_latency = frame + self->tolerance_us * GST_USECOND;
+    const GstClockTime max_latency = frame * active.buffer_count_ + self->max_wait_ms * GST_MSECOND;
+
+    GST_DEBUG_OBJECT(self, "reporting latency min %" GST_TIME_FORMAT " max %" GST_TIME_FORMAT,
+                     GST_TIME_ARGS(min_latency), GST_TIME_ARGS(max_latency));
+    gst_query_set_latency(query, TRUE, min_latency, max_latency);
+    return TRUE;
+}
+
+// unlock()/unlock_stop(): interrupting the synchronizer wakes a create() waiting for the next set
+static gboolean _v4l2_batch_src_unlock(GstBaseSrc *src)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(src));
+    self->flushing.store(true);
+    GST_OBJECT_LOCK(self);
+    if (self->sync)
+    {
+        self->sync->interrupt();
+    }
+    GST_OBJECT_UNLOCK(self);
+    return TRUE;
+}
+
+static gboolean _v4l2_batch_src_unlock_stop(GstBaseSrc *src)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(src));
+    GST_OBJECT_LOCK(self);
+    if (self->sync)
+    {
+        self->sync->clear_interrupt();
+    }
+    GST_OBJECT_UNLOCK(self);
+    self->flushing.store(false);
+    return TRUE;
+}
+
+namespace
+{
+    // GstMemory user data: the driver buffer is re-queued once no memory of any list holds the frame
+    struct BatchHold
+    {
+        std::shared_ptr<v4l2::CameraGroup> group; // declared first, so the camera outlives the lease below
+        std::shared_ptr<v4l2::FrameLease> frame;
+    };
+} // namespace
+
+[[nodiscard]] static GstMemory *wrap_frame_bytes(V4L2BatchSrc *self, const std::shared_ptr<v4l2::FrameLease> &frame,
+                                                 std::span<const std::byte> bytes)
+{
+    auto *data = const_cast<std::byte *>(bytes.data());
+    return gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY, data, bytes.size(), 0, bytes.size(),
+                                  new BatchHold{self->group, frame},
+                                  [](gpointer user_data)
+                                  { delete static_cast<BatchHold *>(user_data); });
+}
+
+// One frame of the set without a copy: its first memory plane, and the CbCr plane in a memory of its own for NV12M/NV16M
+[[nodiscard]] static GstBuffer *wrap_frame(V4L2BatchSrc *self, const std::shared_ptr<v4l2::FrameLease> &frame,
+                                           std::span<const v4l2::PlaneLayout> layout, GstVideoFormat video_format)
+{
+    auto const &view = frame->view();
+    GstBuffer *buf = gst_buffer_new();
+    gst_buffer_append_memory(buf, wrap_frame_bytes(self, frame, view.image));
+    for (std::size_t c = 0; c < layout.size() && c < view.plane_count; ++c)
+    {
+        if (layout[c].memory_plane == 1)
+        {
+            gst_buffer_append_memory(buf, wrap_frame_bytes(self, frame, view.planes[c].data));
+        }
+    }
+
+    if (video_format != GST_VIDEO_FORMAT_UNKNOWN)
+    {
+        // the driver's strides, and where the CbCr plane is: after the Y rows or in the second memory
+        gsize offset[GST_VIDEO_MAX_PLANES]{};
+        gint stride[GST_VIDEO_MAX_PLANES]{};
+        for (std::size_t c = 0; c < layout.size(); ++c)
+        {
+            offset[c] = layout[c].memory_plane == 0 ? layout[c].offset : view.image.size();
+            stride[c] = static_cast<gint>(layout[c].bytes_per_line);
+        }
+        gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE, video_format, view.width, view.height,
+                                       static_cast<guint>(layout.size()), offset, stride);
+    }
+    return buf;
+}
+
+static GstFlowReturn _v4l2_batch_src_create(GstPushSrc *push, GstBuffer **outbuf)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(push));
+    GST_TRACE_OBJECT(self, "create");
+
+    const auto timeout = std::chrono::microseconds(
+        self->capture_timeout_ms == 0 ? -1 : static_cast<std::int64_t>(self->capture_timeout_ms) * 1000);
+    std::optional<v4l2::FrameSet> set;
+    try
+    {
+        set = self->sync->pop(timeout);
+    }
+    catch (const std::exception &ex)
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, READ, ("Camera failed"), ("%s", ex.what()));
+        return GST_FLOW_ERROR;
+    }
+    if (!set)
+    {
+        if (self->flushing.load())
+        {
+            return GST_FLOW_FLUSHING;
+        }
+        GST_ELEMENT_ERROR(self, RESOURCE, READ, ("No synchronized frame set"),
+                          ("none within %u ms: a camera stalled, or the cameras are more than %u us apart",
+                           self->capture_timeout_ms, self->tolerance_us));
+        return GST_FLOW_ERROR;
+    }
+
+    auto &camera = self->group->camera(0);
+    auto const &active = camera.config();
+    auto const layout = camera.plane_layout();
+    const GstVideoFormat video_format = to_gst_video_format(active.format_);
+    const GstClockTime duration = batch_ns_per_frame(active);
+
+    // ⏱ one PTS for the whole list: when its earliest new frame was captured
+    const v4l2::FrameView *earliest = &set->frames[0]->view();
+    for (std::size_t i = 0; i < set->frames.size(); ++i)
+    {
+        if (!set->repeated[i] && (*set->frames[i])->v4l2_timestamp_us == set->timestamp_us)
+        {
+            earliest = &set->frames[i]->view();
+            break;
+        }
+    }
+    const GstClockTime pts = running_time_pts(GST_ELEMENT(self), *earliest);
+    const bool discont = set->number != self->next_set; // sets pop() fell behind on are gone
+    self->next_set = set->number + 1;
+
+    GstBufferList *list = gst_buffer_list_new_sized(static_cast<guint>(set->frames.size()));
+    for (std::size_t i = 0; i < set->frames.size(); ++i)
+    {
+        auto const &view = set->frames[i]->view();
+        GstBuffer *buf = wrap_frame(self, set->frames[i], layout, video_format);
+        GST_BUFFER_PTS(buf) = pts;
+        GST_BUFFER_DURATION(buf) = duration;
+        GST_BUFFER_OFFSET(buf) = set->number;
+        GST_BUFFER_OFFSET_END(buf) = set->number + 1;
+        if (discont)
+        {
+            GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DISCONT);
+        }
+        if (view.error)
+        {
+            GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_CORRUPTED);
+        }
+
+        V4L2BatchMeta *meta = gst_buffer_add_v4l2_batch_meta(buf);
+        meta->source = static_cast<guint>(i);
+        meta->batch = set->number;
+        meta->sequence = view.sequence;
+        meta->v4l2_timestamp_us = view.v4l2_timestamp_us;
+        meta->repeated = set->repeated[i] ? TRUE : FALSE;
+        gst_buffer_list_add(list, buf);
+    }
+
+    GST_LOG_OBJECT(self, "pushing set %" G_GUINT64_FORMAT ": %zu buffers, pts %" GST_TIME_FORMAT ", spread %" G_GUINT64_FORMAT " us",
+                   set->number, set->frames.size(), GST_TIME_ARGS(pts), set->spread_us);
+
+    // 📦 basesrc pushes the list once we return, *outbuf stays empty
+    gst_base_src_submit_buffer_list(GST_BASE_SRC(self), list);
+    *outbuf = nullptr;
+    return GST_FLOW_OK;
+}
+
+static void _v4l2_batch_src_finalize(GObject *object)
+{
+    auto *self = get_instance<V4L2BatchSrc>(G_OBJECT(object));
+    g_free(self->devices);
+    std::destroy_at(&self->flushing);
+    std::destroy_at(&self->sync); // its leases point into the group's cameras
+    std::destroy_at(&self->group);
+
+    G_OBJECT_CLASS(_v4l2_batch_src_parent_class)->finalize(object);
+}
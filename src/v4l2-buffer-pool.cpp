@@ -0,0 +1,406 @@
+#include "v4l2/v4l2-buffer-pool.hpp"
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wconversion"
+#include <gst/allocators/gstdmabuf.h>
+#pragma GCC diagnostic pop
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+
+GST_DEBUG_CATEGORY_STATIC(v4l2_buffer_pool_debug);
+#define GST_CAT_DEFAULT v4l2_buffer_pool_debug
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wvolatile"
+G_DEFINE_TYPE(V4L2BufferPool, v4l2_buffer_pool, GST_TYPE_BUFFER_POOL)
+#pragma GCC diagnostic pop
+
+[[nodiscard]] static std::optional<std::size_t> buffer_index(const V4L2BufferPool *self, const GstBuffer *buffer)
+{
+    auto const it = std::find(self->buffers.begin(), self->buffers.end(), buffer);
+    if (it == self->buffers.end())
+    {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(it - self->buffers.begin());
+}
+
+// Memory over one plane of a driver buffer: its exported dmabuf, or the mmap pointer
+[[nodiscard]] static GstMemory *wrap_driver_plane(const V4L2BufferPool *self, const v4l2::MappedPlane &plane)
+{
+    if (self->dmabuf_allocator && plane.dmabuf_fd >= 0)
+    {
+        return gst_dmabuf_allocator_alloc_with_flags(self->dmabuf_allocator, plane.dmabuf_fd, plane.size,
+                                                     GST_FD_MEMORY_FLAG_DONT_CLOSE);
+    }
+    return gst_memory_new_wrapped(static_cast<GstMemoryFlags>(0), static_cast<gpointer>(plane.data), plane.size,
+                                  0, plane.size, nullptr, nullptr);
+}
+
+// 🧅 one GstMemory per memory plane of the driver buffer, two for NV12M and NV16M
+static void wrap_driver_buffer(const V4L2BufferPool *self, GstBuffer *buf, const v4l2::MappedBuffer &mapped)
+{
+    gst_buffer_remove_all_memory(buf);
+    for (std::uint32_t p = 0; p < mapped.plane_count; ++p)
+    {
+        gst_buffer_append_memory(buf, wrap_driver_plane(self, mapped.plane(p)));
+    }
+}
+
+// Video meta offsets and strides from the camera's plane layout, a memory plane starting where the one before ends
+[[nodiscard]] static guint plane_offsets(const V4L2BufferPool *self, GstBuffer *buf,
+                                         gsize (&offset)[GST_VIDEO_MAX_PLANES], gint (&stride)[GST_VIDEO_MAX_PLANES])
+{
+    auto const layout = self->camera->plane_layout();
+    for (std::size_t c = 0; c < layout.size(); ++c)
+    {
+        gsize start = 0;
+        for (guint m = 0; m < layout[c].memory_plane && m < gst_buffer_n_memory(buf); ++m)
+        {
+            start += gst_buffer_peek_memory(buf, m)->size;
+        }
+        offset[c] = start + layout[c].offset;
+        stride[c] = static_cast<gint>(layout[c].bytes_per_line);
+    }
+    return static_cast<guint>(layout.size());
+}
+
+static void set_plane_meta(const V4L2BufferPool *self, GstBuffer *buf, GstVideoMeta *meta)
+{
+    meta->n_planes = plane_offsets(self, buf, meta->offset, meta->stride);
+}
+
+static const gchar **_v4l2_buffer_pool_get_options([[maybe_unused]] GstBufferPool *pool)
+{
+    static const gchar *options[] = {GST_BUFFER_POOL_OPTION_VIDEO_META, nullptr};
+    return options;
+}
+
+static gboolean _v4l2_buffer_pool_start(GstBufferPool *pool)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(pool);
+    auto const mapped = self->camera->buffers();
+
+    // 🧱 one GstBuffer per driver buffer, built once and reused for every frame
+    self->buffers.assign(mapped.size(), nullptr);
+    self->leases.clear();
+    self->leases.resize(mapped.size());
+
+    for (std::size_t i = 0; i < mapped.size(); ++i)
+    {
+        GstBuffer *buf = gst_buffer_new();
+        wrap_driver_buffer(self, buf, mapped[i]);
+
+        if (self->video_format != GST_VIDEO_FORMAT_UNKNOWN)
+        {
+            // the driver's strides, and where NV12's CbCr is: after the Y rows or in a memory of its own
+            gsize offset[GST_VIDEO_MAX_PLANES]{};
+            gint stride[GST_VIDEO_MAX_PLANES]{};
+            const guint n_planes = plane_offsets(self, buf, offset, stride);
+            auto *meta = gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE, self->video_format,
+                                                        self->width, self->height, n_planes, offset, stride);
+            // survive reset_buffer() so it is attached exactly once
+            meta->meta.flags = static_cast<GstMetaFlags>(meta->meta.flags | GST_META_FLAG_POOLED | GST_META_FLAG_LOCKED);
+        }
+
+        self->buffers[i] = buf;
+    }
+
+    return TRUE;
+}
+
+static gboolean _v4l2_buffer_pool_stop(GstBufferPool *pool)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(pool);
+
+    // every buffer is back (GstBufferPool only stops with nothing outstanding)
+    self->leases.clear();
+    for (auto *buf : self->buffers)
+    {
+        gst_buffer_unref(buf);
+    }
+    self->buffers.clear();
+
+    return TRUE;
+}
+
+static GstFlowReturn _v4l2_buffer_pool_acquire_buffer(GstBufferPool *pool, GstBuffer **buffer,
+                                                      [[maybe_unused]] GstBufferPoolAcquireParams *params)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(pool);
+
+    std::optional<v4l2::FrameLease> maybe_lease;
+    try
+    {
+        maybe_lease = self->capture ? self->capture->pop(std::chrono::microseconds{self->timeout_us})
+                                    : self->camera->try_capture_frame(std::chrono::microseconds{self->timeout_us});
+    }
+    catch (const std::exception &e)
+    {
+        GST_ERROR_OBJECT(pool, "capture_frame failed: %s", e.what());
+        return GST_FLOW_ERROR;
+    }
+
+    if (!maybe_lease)
+    {
+        if (GST_BUFFER_POOL_IS_FLUSHING(pool))
+        {
+            return GST_FLOW_FLUSHING;
+        }
+        GST_ERROR_OBJECT(pool, "no frame within %" G_GINT64_FORMAT " us, camera stalled", self->timeout_us);
+        return GST_FLOW_ERROR;
+    }
+
+    auto lease = std::move(*maybe_lease);
+    auto const index = lease.index();
+    if (index >= self->buffers.size())
+    {
+        GST_ERROR_OBJECT(pool, "camera returned buffer index %u outside the pool", index);
+        return GST_FLOW_ERROR;
+    }
+
+    GstBuffer *buf = self->buffers[index];
+    auto const image = lease->image;
+    auto const layout = self->camera->plane_layout();
+    if (image.data() != self->camera->buffers()[index].data)
+    {
+        // 📼 a replayed frame lives in the recording's mapping, not in the driver buffer: wrap it in place
+        gst_buffer_replace_all_memory(buf, gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY,
+                                                                  const_cast<std::byte *>(image.data()), image.size_bytes(),
+                                                                  0, image.size_bytes(), nullptr, nullptr));
+        for (std::size_t c = 1; c < layout.size(); ++c)
+        {
+            if (layout[c].memory_plane != 0)
+            {
+                auto const plane = lease->planes[c].data;
+                gst_buffer_append_memory(buf, gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY,
+                                                                     const_cast<std::byte *>(plane.data()), plane.size_bytes(),
+                                                                     0, plane.size_bytes(), nullptr, nullptr));
+            }
+        }
+        if (GstVideoMeta *meta = gst_buffer_get_video_meta(buf); meta && gst_buffer_n_memory(buf) > 1)
+        {
+            set_plane_meta(self, buf, meta); // the second memory starts where this frame's Y plane ends
+        }
+    }
+    else if (gst_buffer_n_memory(buf) == 1)
+    {
+        gst_buffer_resize(buf, 0, static_cast<gssize>(image.size_bytes()));
+    }
+    self->leases[index] = std::move(lease);
+
+    *buffer = buf;
+    return GST_FLOW_OK;
+}
+
+static void _v4l2_buffer_pool_release_buffer(GstBufferPool *pool, GstBuffer *buffer)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(pool);
+    auto const index = buffer_index(self, buffer);
+    if (!index)
+    {
+        GST_WARNING_OBJECT(pool, "released buffer %p is not ours, dropping it", static_cast<void *>(buffer));
+        gst_buffer_unref(buffer);
+        return;
+    }
+
+    // take the lease out of its slot before QBUF: once the driver owns the
+    // buffer again, acquire() may refill the same slot from another thread
+    auto lease = std::move(self->leases[*index]);
+    try
+    {
+        lease.release();
+    }
+    catch (const std::exception &e)
+    {
+        GST_WARNING_OBJECT(pool, "failed to re-queue buffer %zu: %s", *index, e.what());
+    }
+}
+
+static void _v4l2_buffer_pool_flush_start(GstBufferPool *pool)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(pool);
+    if (self->capture)
+    {
+        self->capture->interrupt(); // the capture thread keeps its own wait on the camera
+    }
+    else
+    {
+        self->camera->interrupt();
+    }
+}
+
+static void _v4l2_buffer_pool_flush_stop(GstBufferPool *pool)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(pool);
+    if (self->capture)
+    {
+        self->capture->clear_interrupt();
+    }
+    else
+    {
+        self->camera->clear_interrupt();
+    }
+}
+
+static void _v4l2_buffer_pool_finalize(GObject *object)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(object);
+
+    if (self->dmabuf_allocator)
+    {
+        gst_object_unref(self->dmabuf_allocator);
+    }
+    std::destroy_at(&self->leases);
+    std::destroy_at(&self->buffers);
+    std::destroy_at(&self->capture); // stops the thread before the camera can go
+    std::destroy_at(&self->camera);
+
+    G_OBJECT_CLASS(v4l2_buffer_pool_parent_class)->finalize(object);
+}
+
+static void v4l2_buffer_pool_class_init(V4L2BufferPoolClass *klass)
+{
+    GST_DEBUG_CATEGORY_INIT(v4l2_buffer_pool_debug, "v4l2-src-pool", 0, "V4L2 source driver buffer pool");
+
+    auto *gclass = G_OBJECT_CLASS(klass);
+    gclass->finalize = _v4l2_buffer_pool_finalize;
+
+    auto *pclass = GST_BUFFER_POOL_CLASS(klass);
+    pclass->get_options = _v4l2_buffer_pool_get_options;
+    pclass->start = _v4l2_buffer_pool_start;
+    pclass->stop = _v4l2_buffer_pool_stop;
+    pclass->acquire_buffer = _v4l2_buffer_pool_acquire_buffer;
+    pclass->release_buffer = _v4l2_buffer_pool_release_buffer;
+    pclass->flush_start = _v4l2_buffer_pool_flush_start;
+    pclass->flush_stop = _v4l2_buffer_pool_flush_stop;
+}
+
+static void v4l2_buffer_pool_init(V4L2BufferPool *self)
+{
+    // GObject hands us zeroed memory, bring the C++ members to life
+    std::construct_at(&self->camera);
+    std::construct_at(&self->capture);
+    std::construct_at(&self->buffers);
+    std::construct_at(&self->leases);
+    self->dmabuf_allocator = nullptr;
+    self->video_format = GST_VIDEO_FORMAT_UNKNOWN;
+    self->timeout_us = -1;
+}
+
+GstBufferPool *v4l2_buffer_pool_new(std::shared_ptr<v4l2::V4L2Camera> camera,
+                                    GstAllocator *dmabuf_allocator,
+                                    GstVideoFormat video_format,
+                                    guint width,
+                                    guint height)
+{
+    auto *self = GST_V4L2_BUFFER_POOL(g_object_new(GST_TYPE_V4L2_BUFFER_POOL, nullptr));
+    self->camera = std::move(camera);
+    self->dmabuf_allocator = dmabuf_allocator ? GST_ALLOCATOR(gst_object_ref(dmabuf_allocator)) : nullptr;
+    self->video_format = video_format;
+    self->width = width;
+    self->height = height;
+    gst_object_ref_sink(self);
+    return GST_BUFFER_POOL(self);
+}
+
+const v4l2::FrameView *v4l2_buffer_pool_get_frame(V4L2BufferPool *pool, GstBuffer *buffer)
+{
+    auto const index = buffer_index(pool, buffer);
+    if (!index || !pool->leases[*index])
+    {
+        return nullptr;
+    }
+    return &pool->leases[*index].view();
+}
+
+gsize v4l2_buffer_pool_get_capacity(V4L2BufferPool *pool, GstBuffer *buffer)
+{
+    auto const index = buffer_index(pool, buffer);
+    auto const mapped = pool->camera->buffers();
+    if (!index || *index >= mapped.size())
+    {
+        return 0;
+    }
+    gsize capacity = 0;
+    for (std::uint32_t m = 0; m < mapped[*index].plane_count; ++m)
+    {
+        capacity += mapped[*index].plane(m).size;
+    }
+    return capacity;
+}
+
+gboolean v4l2_buffer_pool_has_default_layout(V4L2BufferPool *pool, const GstVideoInfo *info)
+{
+    if (pool->video_format == GST_VIDEO_FORMAT_UNKNOWN)
+    {
+        return TRUE;
+    }
+    auto const layout = pool->camera->plane_layout();
+    auto const mapped = pool->camera->buffers();
+    if (mapped.empty() || layout.size() != GST_VIDEO_INFO_N_PLANES(info))
+    {
+        return FALSE;
+    }
+
+    // same rule as plane_offsets(): a memory plane starts where the one before ends
+    for (std::size_t c = 0; c < layout.size(); ++c)
+    {
+        gsize start = 0;
+        for (std::uint32_t m = 0; m < layout[c].memory_plane && m < mapped[0].plane_count; ++m)
+        {
+            start += mapped[0].plane(m).size;
+        }
+        if (start + layout[c].offset != GST_VIDEO_INFO_PLANE_OFFSET(info, c) ||
+            static_cast<gint>(layout[c].bytes_per_line) != GST_VIDEO_INFO_PLANE_STRIDE(info, c))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+void v4l2_buffer_pool_remap(V4L2BufferPool *pool)
+{
+    auto const mapped = pool->camera->buffers();
+    for (std::size_t i = 0; i < pool->buffers.size() && i < mapped.size(); ++i)
+    {
+        wrap_driver_buffer(pool, pool->buffers[i], mapped[i]);
+    }
+}
+
+void v4l2_buffer_pool_resize(V4L2BufferPool *pool, GstVideoFormat video_format, guint width, guint height)
+{
+    pool->video_format = video_format;
+    pool->width = width;
+    pool->height = height;
+
+    // the memories first, the plane offsets depend on their sizes
+    v4l2_buffer_pool_remap(pool);
+    if (video_format == GST_VIDEO_FORMAT_UNKNOWN)
+    {
+        return; // compressed frames carry no video meta
+    }
+
+    // the meta is locked onto each buffer at start(), rewrite it where it is
+    for (auto *buf : pool->buffers)
+    {
+        GstVideoMeta *meta = gst_buffer_get_video_meta(buf);
+        if (!meta)
+        {
+            gsize offset[GST_VIDEO_MAX_PLANES]{};
+            gint stride[GST_VIDEO_MAX_PLANES]{};
+            const guint n_planes = plane_offsets(pool, buf, offset, stride);
+            meta = gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE, video_format, width, height, n_planes,
+                                                  offset, stride);
+            meta->meta.flags = static_cast<GstMetaFlags>(meta->meta.flags | GST_META_FLAG_POOLED | GST_META_FLAG_LOCKED);
+            continue;
+        }
+        meta->format = video_format;
+        meta->width = width;
+        meta->height = height;
+        set_plane_meta(pool, buf, meta);
+    }
+}
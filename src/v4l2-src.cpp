@@ -1,22 +1,40 @@
 #include "v4l2/v4l2-src.hpp"
+#include "v4l2/v4l2-batch-src.hpp"
+#include "v4l2/jpeg.hpp"
+#include "v4l2/v4l2-buffer-pool.hpp"
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wuseless-cast"
-#include <fmt/core.h>
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #pragma GCC diagnostic pop
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <span>
+#include <string>
+#include <vector>
 
 #include <atomic>
 #include <csignal>
+#include <sched.h> // For CPU_SETSIZE
 
-[[nodiscard]] constexpr GstClockTime ns_per_frame(FPSEnum fps)
+// 🔇 GST_DEBUG=v4l2-src:7 for per-frame logs, nothing is formatted or written below the threshold
+GST_DEBUG_CATEGORY_STATIC(v4l2src_debug);
+#define GST_CAT_DEFAULT v4l2src_debug
+
+[[nodiscard]] static GstClockTime ns_per_frame(FPSEnum fps, std::uint32_t fps_den = 1)
 {
-    return 1'000'000'000 / static_cast<GstClockTime>(fps);
+    if (static_cast<GstClockTime>(fps) == 0)
+    {
+        return GST_CLOCK_TIME_NONE;
+    }
+    return gst_util_uint64_scale_int(GST_SECOND, static_cast<gint>(fps_den), static_cast<gint>(fps));
 }
 
-// Pad template: MJPEG over NVMM or raw YUY2
+// Pad template: MJPEG over NVMM, raw YUY2, NV12 and NV16 or what the YUYV conversion makes
 static GstStaticPadTemplate pad_template =
     GST_STATIC_PAD_TEMPLATE("src", GST_PAD_SRC, GST_PAD_ALWAYS,
                             GST_STATIC_CAPS(
@@ -26,11 +44,57 @@ static GstStaticPadTemplate pad_template =
                                 "height=(int)[1,MAX], "
                                 "framerate=(fraction)[0/1,MAX]; "
                                 "video/x-raw, "
-                                "format=(string)YUY2, "
+                                "format=(string){ YUY2, NV12, NV16, I420, GRAY8, RGB, BGR }, "
                                 "width=(int)[1,MAX], "
                                 "height=(int)[1,MAX], "
                                 "framerate=(fraction)[0/1,MAX]"));
 
+// Capture counters and per-stage latency percentiles of a running camera, as posted and as the stats property
+[[nodiscard]] static GstStructure *build_stats(const v4l2::V4L2Camera *camera)
+{
+    GstStructure *s = gst_structure_new_empty("v4l2-src-stats");
+    if (!camera)
+    {
+        return s;
+    }
+    auto const stats = camera->stats();
+    gst_structure_set(s,
+                      "dropped-frames", G_TYPE_UINT64, static_cast<guint64>(stats.dropped_frames),
+                      "lost-frames", G_TYPE_UINT64, static_cast<guint64>(stats.lost_frames),
+                      "sequence-gaps", G_TYPE_UINT64, static_cast<guint64>(stats.sequence_gaps),
+                      "errored-buffers", G_TYPE_UINT64, static_cast<guint64>(stats.errored_buffers),
+                      "corrupt-frames", G_TYPE_UINT64, static_cast<guint64>(stats.corrupt_frames),
+                      "time-to-first-frame-us", G_TYPE_UINT64, static_cast<guint64>(stats.time_to_first_frame_us),
+                      "reconnects", G_TYPE_UINT64, static_cast<guint64>(stats.reconnects),
+                      "renegotiations", G_TYPE_UINT64, static_cast<guint64>(stats.renegotiations),
+                      nullptr);
+
+    // ⏱ <stage>-count, -p50-us, -p99-us, -p999-us, -max-us per stage
+    auto const latency = camera->latency();
+    const std::pair<const char *, const v4l2::LatencySummary *> stages[] = {
+        {"driver-to-dqbuf", &latency.driver_to_dqbuf},
+        {"dqbuf-to-push", &latency.dqbuf_to_handoff},
+        {"dqbuf-to-qbuf", &latency.dqbuf_to_qbuf},
+    };
+    for (auto const &[stage, summary] : stages)
+    {
+        const std::pair<const char *, std::uint64_t> fields[] = {
+            {"count", summary->count},
+            {"p50-us", summary->p50_us},
+            {"p99-us", summary->p99_us},
+            {"p999-us", summary->p999_us},
+            {"max-us", summary->max_us},
+        };
+        for (auto const &[field, value] : fields)
+        {
+            gchar *name = g_strdup_printf("%s-%s", stage, field);
+            gst_structure_set(s, name, G_TYPE_UINT64, static_cast<guint64>(value), nullptr);
+            g_free(name);
+        }
+    }
+    return s;
+}
+
 // Forward-declarations of GObject methods
 template <typename T>
 static T *get_instance(GObject *obj)
@@ -46,11 +110,88 @@ static void _v4l2src_get_property(GObject *object, guint prop_id,
 // Lifecycle and pushsrc methods
 static gboolean _v4l2src_start(GstBaseSrc *src);
 static gboolean _v4l2src_stop(GstBaseSrc *src);
-static GstCaps *_v4l2src_get_caps([[maybe_unused]] GstBaseSrc *basesrc, GstCaps *filter);
+static GstCaps *_v4l2src_get_caps(GstBaseSrc *basesrc, GstCaps *filter);
 static GstFlowReturn _v4l2src_create(GstPushSrc *src, GstBuffer **buf);
 static void _v4l2src_finalize(GObject *object);
 static GstCaps *get_active_caps(const V4L2Src *self);
 
+// Library target of an output-format, std::nullopt when the driver buffer goes out as-is
+[[nodiscard]] static std::optional<v4l2::ConvertFormat> to_convert_format(OutputFormatEnum output)
+{
+    switch (output)
+    {
+    case OutputFormatEnum::NV12:
+        return v4l2::ConvertFormat::NV12;
+    case OutputFormatEnum::I420:
+        return v4l2::ConvertFormat::I420;
+    case OutputFormatEnum::GRAY8:
+        return v4l2::ConvertFormat::GRAY8;
+    case OutputFormatEnum::RGB:
+        return v4l2::ConvertFormat::RGB;
+    case OutputFormatEnum::BGR:
+        return v4l2::ConvertFormat::BGR;
+    case OutputFormatEnum::NATIVE:
+    default:
+        return std::nullopt;
+    }
+}
+
+// video/x-raw format string of what create() pushes for YUYV capture
+[[nodiscard]] static const gchar *raw_caps_format(OutputFormatEnum output)
+{
+    switch (output)
+    {
+    case OutputFormatEnum::NV12:
+        return "NV12";
+    case OutputFormatEnum::I420:
+        return "I420";
+    case OutputFormatEnum::GRAY8:
+        return "GRAY8";
+    case OutputFormatEnum::RGB:
+        return "RGB";
+    case OutputFormatEnum::BGR:
+        return "BGR";
+    case OutputFormatEnum::NATIVE:
+    default:
+        return "YUY2";
+    }
+}
+
+// video/x-raw format string of the semi-planar formats, pushed as captured; nullptr for the others
+[[nodiscard]] static const gchar *semi_planar_caps_format(PixelFormatEnum format)
+{
+    switch (format)
+    {
+    case PixelFormatEnum::NV12:
+    case PixelFormatEnum::NV12M:
+        return "NV12";
+    case PixelFormatEnum::NV16:
+    case PixelFormatEnum::NV16M:
+        return "NV16";
+    default:
+        return nullptr;
+    }
+}
+
+// Registered once, v4l2-batch-src has a pixel-format property too
+GType v4l2src_pixel_format_get_type(void)
+{
+    static gsize type = 0;
+    if (g_once_init_enter(&type))
+    {
+        static const GEnumValue pixel_format_values[] = {
+            {static_cast<int>(PixelFormatEnum::MJPG), "MJPG", "MJPG"},
+            {static_cast<int>(PixelFormatEnum::YUYV), "YUYV", "YUYV"},
+            {static_cast<int>(PixelFormatEnum::NV12), "NV12", "NV12"},
+            {static_cast<int>(PixelFormatEnum::NV16), "NV16", "NV16"},
+            {static_cast<int>(PixelFormatEnum::NV12M), "NV12M", "NV12M"},
+            {static_cast<int>(PixelFormatEnum::NV16M), "NV16M", "NV16M"},
+            {0, nullptr, nullptr}};
+        g_once_init_leave(&type, g_enum_register_static("PixelFormatEnum", pixel_format_values));
+    }
+    return static_cast<GType>(type);
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wvolatile"
 G_DEFINE_TYPE(V4L2Src, _v4l2src, GST_TYPE_PUSH_SRC)
@@ -104,6 +245,227 @@ static gboolean _v4l2src_negotiate(GstBaseSrc *src)
     return TRUE;
 }
 
+// unlock()/unlock_stop(): flushing the pool interrupts the poll() in a pending capture
+static gboolean _v4l2src_unlock(GstBaseSrc *src)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(src));
+    if (self->pool)
+    {
+        gst_buffer_pool_set_flushing(self->pool, TRUE);
+    }
+    return TRUE;
+}
+
+static gboolean _v4l2src_unlock_stop(GstBaseSrc *src)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(src));
+    if (self->pool)
+    {
+        gst_buffer_pool_set_flushing(self->pool, FALSE);
+    }
+    return TRUE;
+}
+
+// Activate the capture pool for create() alone, nothing downstream sees the driver buffers
+[[nodiscard]] static bool activate_private_pool(V4L2Src *self, guint size, guint count)
+{
+    if (gst_buffer_pool_is_active(self->pool))
+    {
+        return true;
+    }
+    GstStructure *config = gst_buffer_pool_get_config(self->pool);
+    gst_buffer_pool_config_set_params(config, nullptr, size, count, count);
+    if (!gst_buffer_pool_set_config(self->pool, config) || !gst_buffer_pool_set_active(self->pool, TRUE))
+    {
+        GST_ERROR_OBJECT(self, "failed to activate the capture buffer pool");
+        return false;
+    }
+    return true;
+}
+
+static gboolean _v4l2src_decide_allocation(GstBaseSrc *src, GstQuery *query)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(src));
+    if (!self->pool)
+    {
+        GST_ERROR_OBJECT(src, "no buffer pool, camera not started");
+        return FALSE;
+    }
+
+    GstCaps *caps = nullptr;
+    gst_query_parse_allocation(query, &caps, nullptr);
+
+    // our pool is the driver's buffer queue: exactly buffer-count buffers, no more, no less
+    guint size = 0;
+    for (auto const &mapped : self->camera->buffers())
+    {
+        size = std::max(size, static_cast<guint>(mapped.size));
+    }
+    const guint count = self->camera->config().buffer_count_;
+
+    // 🎨 converting: the driver buffers stay private, create() copies into buffers of an ordinary pool
+    if (auto const target = to_convert_format(self->output_format))
+    {
+        if (!activate_private_pool(self, size, count))
+        {
+            return FALSE;
+        }
+
+        // the converted planes are tightly packed, a downstream pool may lay them out differently
+        auto const [w, h] = v4l2::dimensions_decompress(static_cast<uint32_t>(self->camera->config().dimension_));
+        const guint out_size = static_cast<guint>(v4l2::converted_size(*target, w, h));
+        guint down_min = 2;
+        if (gst_query_get_n_allocation_pools(query) > 0)
+        {
+            gst_query_parse_nth_allocation_pool(query, 0, nullptr, nullptr, &down_min, nullptr);
+            gst_query_set_nth_allocation_pool(query, 0, nullptr, out_size, std::max(down_min, 2u), 0);
+        }
+        else
+        {
+            gst_query_add_allocation_pool(query, nullptr, out_size, down_min, 0);
+        }
+
+        // basesrc creates and activates a plain pool for a null entry
+        return GST_BASE_SRC_CLASS(_v4l2src_parent_class)->decide_allocation(src, query);
+    }
+
+    // 🧩 decoding: create() wraps the decoder's own pooled images, no downstream pool to pick
+    if (self->decoder)
+    {
+        return activate_private_pool(self, size, count) ? TRUE : FALSE;
+    }
+
+    // 📋 the driver buffers go downstream only if that cannot deadlock the queue or be misread
+    guint down_min = 0;
+    if (gst_query_get_n_allocation_pools(query) > 0)
+    {
+        gst_query_parse_nth_allocation_pool(query, 0, nullptr, nullptr, &down_min, nullptr);
+    }
+    const bool video_meta = gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, nullptr);
+    GstVideoInfo info;
+    const bool raw = caps && gst_video_info_from_caps(&info, caps);
+    const bool misread = raw && !video_meta && !v4l2_buffer_pool_has_default_layout(GST_V4L2_BUFFER_POOL(self->pool), &info);
+    self->copy_frames = down_min >= count || misread;
+    if (self->copy_frames)
+    {
+        if (down_min >= count)
+        {
+            GST_WARNING_OBJECT(src, "downstream wants to hold %u buffers but buffer-count=%u, copying every frame", down_min, count);
+        }
+        else
+        {
+            GST_WARNING_OBJECT(src, "downstream takes no video meta and the driver pads its rows, copying every frame");
+        }
+        if (!activate_private_pool(self, size, count))
+        {
+            return FALSE;
+        }
+        if (raw)
+        {
+            self->copy_info = info;
+        }
+        else
+        {
+            gst_video_info_init(&self->copy_info); // GST_VIDEO_FORMAT_UNKNOWN: copy_frame() copies bytes
+        }
+        const guint out_size = raw ? static_cast<guint>(GST_VIDEO_INFO_SIZE(&info)) : size;
+        if (gst_query_get_n_allocation_pools(query) > 0)
+        {
+            gst_query_set_nth_allocation_pool(query, 0, nullptr, out_size, std::max(down_min, 2u), 0);
+        }
+        else
+        {
+            gst_query_add_allocation_pool(query, nullptr, out_size, 2, 0);
+        }
+        return GST_BASE_SRC_CLASS(_v4l2src_parent_class)->decide_allocation(src, query);
+    }
+
+    if (gst_query_get_n_allocation_pools(query) > 0)
+    {
+        gst_query_set_nth_allocation_pool(query, 0, self->pool, size, count, count);
+    }
+    else
+    {
+        gst_query_add_allocation_pool(query, self->pool, size, count, count);
+    }
+
+    // an active pool (renegotiation while streaming) keeps its config
+    if (!gst_buffer_pool_is_active(self->pool))
+    {
+        GstStructure *config = gst_buffer_pool_get_config(self->pool);
+        gst_buffer_pool_config_set_params(config, caps, size, count, count);
+        if (video_meta)
+        {
+            gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+        }
+        if (!gst_buffer_pool_set_config(self->pool, config))
+        {
+            GST_ERROR_OBJECT(src, "failed to configure the buffer pool");
+            return FALSE;
+        }
+    }
+
+    // basesrc activates the pool it finds in the query
+    return GST_BASE_SRC_CLASS(_v4l2src_parent_class)->decide_allocation(src, query);
+}
+
+// LATENCY: a frame is complete one interval after it is stamped, decode=true keeps decode-threads
+// frames in flight, and a frame may wait in the driver queue for every other buffer.
+// Worked out on the streaming thread whenever the mode changes, the query only reads the result
+static void publish_latency(V4L2Src *self)
+{
+    GstClockTime min_latency = GST_CLOCK_TIME_NONE;
+    GstClockTime max_latency = GST_CLOCK_TIME_NONE;
+    if (self->camera)
+    {
+        auto const &active = self->camera->config();
+        const GstClockTime frame = ns_per_frame(active.fps_num_, active.fps_den_);
+        if (GST_CLOCK_TIME_IS_VALID(frame))
+        {
+            const GstClockTime in_flight = self->decoder ? frame * (self->decoder->config().threads_ - 1) : 0;
+            min_latency = frame + in_flight;
+            max_latency = frame * active.buffer_count_ + in_flight;
+        }
+    }
+
+    GST_OBJECT_LOCK(self);
+    const bool changed = GST_CLOCK_TIME_IS_VALID(self->latency_min) &&
+                         (self->latency_min != min_latency || self->latency_max != max_latency);
+    self->latency_min = min_latency;
+    self->latency_max = max_latency;
+    GST_OBJECT_UNLOCK(self);
+
+    // ⏱ a running pipeline asks again and redistributes
+    if (changed)
+    {
+        gst_element_post_message(GST_ELEMENT(self), gst_message_new_latency(GST_OBJECT(self)));
+    }
+}
+
+static gboolean _v4l2src_query(GstBaseSrc *src, GstQuery *query)
+{
+    if (GST_QUERY_TYPE(query) != GST_QUERY_LATENCY)
+    {
+        return GST_BASE_SRC_CLASS(_v4l2src_parent_class)->query(src, query);
+    }
+
+    auto *self = get_instance<V4L2Src>(G_OBJECT(src));
+    GST_OBJECT_LOCK(self);
+    const GstClockTime min_latency = self->latency_min;
+    const GstClockTime max_latency = self->latency_max;
+    GST_OBJECT_UNLOCK(self);
+    if (!GST_CLOCK_TIME_IS_VALID(min_latency))
+    {
+        GST_DEBUG_OBJECT(self, "not started or no frame rate, cannot answer the latency query");
+        return FALSE;
+    }
+
+    GST_DEBUG_OBJECT(self, "reporting latency min %" GST_TIME_FORMAT " max %" GST_TIME_FORMAT,
+                     GST_TIME_ARGS(min_latency), GST_TIME_ARGS(max_latency));
+    gst_query_set_latency(query, TRUE, min_latency, max_latency);
+    return TRUE;
+}
+
 static GstCaps *_v4l2src_fixate(GstBaseSrc *src, GstCaps *caps)
 {
     return GST_BASE_SRC_CLASS(_v4l2src_parent_class)->fixate(src, caps);
@@ -111,6 +473,8 @@ static GstCaps *_v4l2src_fixate(GstBaseSrc *src, GstCaps *caps)
 
 static void _v4l2src_class_init(V4L2SrcClass *klass)
 {
+    GST_DEBUG_CATEGORY_INIT(v4l2src_debug, "v4l2-src", 0, "V4L2 source");
+
     auto *gclass = G_OBJECT_CLASS(klass);
     gclass->set_property = _v4l2src_set_property;
     gclass->get_property = _v4l2src_get_property;
@@ -126,20 +490,17 @@ static void _v4l2src_class_init(V4L2SrcClass *klass)
         g_param_spec_string(
             "device",
             "Device Path",
-            "Path to the V4L2 device (e.g., /dev/video0)",
+            "Path to the V4L2 device (e.g., /dev/video0), or replay:///path/file.v4lr[?rate=recorded|max|30/1&loop=0|1&mplane=0|1] to play a recording",
             DEFAULT_DEVICE_PATH,
             static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     // 2 = pixel-format
-    static const GEnumValue pixel_format_values[] = {
-        {static_cast<int>(PixelFormatEnum::MJPG), "MJPG", "MJPG"},
-        {static_cast<int>(PixelFormatEnum::YUYV), "YUYV", "YUYV"},
-        {0, nullptr, nullptr}};
-    const GType pixel_format_type = g_enum_register_static("PixelFormatEnum", pixel_format_values);
     g_object_class_install_property(
         gclass,
         2,
-        g_param_spec_enum("pixel-format", "Pixel Format", "MJPG or YUYV", pixel_format_type,
+        g_param_spec_enum("pixel-format", "Pixel Format",
+                          "MJPG, YUYV, or NV12/NV16 (NV12M/NV16M: Y and CbCr in separate buffers, multi-planar drivers)",
+                          v4l2src_pixel_format_get_type(),
                           static_cast<int>(DEFAULT_PIXEL_FORMAT),
                           static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     g_assert(G_IS_PARAM_SPEC(g_object_class_find_property(gclass, "pixel-format")));
@@ -190,416 +551,2153 @@ static void _v4l2src_class_init(V4L2SrcClass *klass)
             2, 32, DEFAULT_BUFFER_COUNT,
             static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-    // metadata and pads
-    gst_element_class_set_static_metadata(
-        eclass,
-        " V4L2 Source",
-        "Source/Video",
-        "Wraps ::V4L2Camera as GstPushSrc",
-        "You <you@example.com>");
-    gst_element_class_add_static_pad_template(eclass, &pad_template);
+    // 6 = io-mode
+    static const GEnumValue io_mode_values[] = {
+        {static_cast<int>(IoModeEnum::MMAP), "mmap", "mmap"},
+        {static_cast<int>(IoModeEnum::DMABUF_EXPORT), "dmabuf", "dmabuf"},
+        {0, nullptr, nullptr}};
+    GType io_mode_type = g_enum_register_static("IoModeEnum", io_mode_values);
+    g_object_class_install_property(
+        gclass,
+        6,
+        g_param_spec_enum(
+            "io-mode",
+            "IO Mode",
+            "mmap: system memory, dmabuf: export driver buffers as GstDmaBufMemory",
+            io_mode_type,
+            static_cast<int>(DEFAULT_IO_MODE),
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-    // override base class virtuals
-    auto *bclass = GST_BASE_SRC_CLASS(klass);
-    bclass->start = _v4l2src_start;
-    bclass->stop = _v4l2src_stop;
-    bclass->get_caps = _v4l2src_get_caps;
-    bclass->negotiate = _v4l2src_negotiate;
-    bclass->fixate = _v4l2src_fixate;
+    // 7 = capture-timeout
+    g_object_class_install_property(
+        gclass,
+        7,
+        g_param_spec_uint(
+            "capture-timeout",
+            "Capture Timeout",
+            "Milliseconds to wait for a frame, or for downstream to return the buffers on a source change, before erroring out (0 = forever)",
+            0, G_MAXUINT, DEFAULT_CAPTURE_TIMEOUT_MS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-    // PushSrc virtual method
-    auto *pclass = GST_PUSH_SRC_CLASS(klass);
-    pclass->create = _v4l2src_create;
-}
+    // 8 = leaky
+    static const GEnumValue leaky_values[] = {
+        {static_cast<int>(LeakyEnum::ALL), "none", "none"},
+        {static_cast<int>(LeakyEnum::LATEST), "latest", "latest"},
+        {0, nullptr, nullptr}};
+    GType leaky_type = g_enum_register_static("LeakyEnum", leaky_values);
+    g_object_class_install_property(
+        gclass,
+        8,
+        g_param_spec_enum(
+            "leaky",
+            "Leaky",
+            "none: push every frame, latest: push only the newest queued frame and re-queue stale ones",
+            leaky_type,
+            static_cast<int>(DEFAULT_LEAKY),
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-static void _v4l2src_init(V4L2Src *self)
-{
-    self->device_path = g_strdup(DEFAULT_DEVICE_PATH);
-    self->pixel_format = DEFAULT_PIXEL_FORMAT;
-    self->resolution = DEFAULT_RESOLUTION;
-    self->fps = DEFAULT_FPS;
-    self->buffer_count = DEFAULT_BUFFER_COUNT;
-    self->frame_number = 0;
+    // 9 = dropped-frames (read-only)
+    g_object_class_install_property(
+        gclass,
+        9,
+        g_param_spec_uint64(
+            "dropped-frames",
+            "Dropped Frames",
+            "Stale frames skipped by leaky=latest since start",
+            0, G_MAXUINT64, 0,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    // 10 = capture-thread
+    g_object_class_install_property(
+        gclass,
+        10,
+        g_param_spec_boolean(
+            "capture-thread",
+            "Capture Thread",
+            "Dequeue frames on a dedicated thread, decoupled from the streaming thread",
+            DEFAULT_CAPTURE_THREAD,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-    gst_base_src_set_live(GST_BASE_SRC(self), TRUE);
-    gst_base_src_set_format(GST_BASE_SRC(self), GST_FORMAT_TIME);
-    gst_base_src_set_do_timestamp(GST_BASE_SRC(self), TRUE);
-}
+    // 11 = capture-cpu
+    g_object_class_install_property(
+        gclass,
+        11,
+        g_param_spec_int(
+            "capture-cpu",
+            "Capture CPU",
+            "Pin the capture thread to this CPU (-1 = no affinity)",
+            -1, CPU_SETSIZE - 1, DEFAULT_CAPTURE_CPU,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-static void _v4l2src_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
-{
-    auto *self = get_instance<V4L2Src>(G_OBJECT(object));
-    switch (prop_id)
-    {
-    case 1: // device
-        g_free(self->device_path);
-        self->device_path = g_value_dup_string(value);
-        break;
-    case 2: // pixel-format
-        self->pixel_format = static_cast<PixelFormatEnum>(g_value_get_enum(value));
-        break;
-    case 3: // resolution ← now correctly registered
-        self->resolution = static_cast<ResolutionEnum>(g_value_get_enum(value));
-        break;
-    case 4: // fps
-        self->fps = static_cast<FPSEnum>(g_value_get_enum(value));
-        break;
-    case 5: // buffer-count
-        self->buffer_count = g_value_get_uint(value);
-        break;
-    default:
-        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
-    }
-}
+    // 12 = capture-priority
+    g_object_class_install_property(
+        gclass,
+        12,
+        g_param_spec_int(
+            "capture-priority",
+            "Capture Priority",
+            "SCHED_FIFO priority of the capture thread (0 = SCHED_OTHER), needs CAP_SYS_NICE",
+            0, 99, DEFAULT_CAPTURE_PRIORITY,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-static void _v4l2src_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
-{
-    auto *self = get_instance<V4L2Src>(G_OBJECT(object));
-    switch (prop_id)
-    {
-    case 1:
-        g_value_set_string(value, self->device_path);
-        break;
-    case 2:
-        g_value_set_enum(value, static_cast<gint>(self->pixel_format));
-        break;
-    case 3:
-        g_value_set_enum(value, static_cast<gint>(self->resolution));
-        break;
-    case 4:
-        g_value_set_enum(value, static_cast<gint>(self->fps));
-        break;
-    case 5:
-        g_value_set_uint(value, self->buffer_count);
-        break;
-    default:
-        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
-    }
-}
+    // 13 = mlock
+    g_object_class_install_property(
+        gclass,
+        13,
+        g_param_spec_boolean(
+            "mlock",
+            "Lock Memory",
+            "mlockall() the process before capturing so the capture thread never page-faults",
+            DEFAULT_MLOCK,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-[[nodiscard]] static GstCaps *get_active_caps(const V4L2Src *self)
-{
-    const auto [w, h] = v4l2::dimensions_decompress(static_cast<uint32_t>(self->resolution));
-    const gint fpsn = static_cast<gint>(self->fps);
-    const gint fpsd = 1;
+    // 14 = width
+    g_object_class_install_property(
+        gclass,
+        14,
+        g_param_spec_uint(
+            "width",
+            "Width",
+            "Frame width, any size the device offers (0 = from resolution)",
+            0, 65535, DEFAULT_WIDTH,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
-    GstCaps *caps = nullptr;
+    // 15 = height
+    g_object_class_install_property(
+        gclass,
+        15,
+        g_param_spec_uint(
+            "height",
+            "Height",
+            "Frame height, any size the device offers (0 = from resolution)",
+            0, 65535, DEFAULT_HEIGHT,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 16 = framerate
+    g_object_class_install_property(
+        gclass,
+        16,
+        gst_param_spec_fraction(
+            "framerate",
+            "Framerate",
+            "Frame rate, e.g. 25/1 or 30000/1001 (0/1 = from fps)",
+            0, 1, G_MAXINT, 1, DEFAULT_FRAMERATE_N, DEFAULT_FRAMERATE_D,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 17 = output-format
+    static const GEnumValue output_format_values[] = {
+        {static_cast<int>(OutputFormatEnum::NATIVE), "native", "native"},
+        {static_cast<int>(OutputFormatEnum::NV12), "nv12", "nv12"},
+        {static_cast<int>(OutputFormatEnum::I420), "i420", "i420"},
+        {static_cast<int>(OutputFormatEnum::GRAY8), "gray8", "gray8"},
+        {static_cast<int>(OutputFormatEnum::RGB), "rgb", "rgb"},
+        {static_cast<int>(OutputFormatEnum::BGR), "bgr", "bgr"},
+        {0, nullptr, nullptr}};
+    GType output_format_type = g_enum_register_static("OutputFormatEnum", output_format_values);
+    g_object_class_install_property(
+        gclass,
+        17,
+        g_param_spec_enum(
+            "output-format",
+            "Output Format",
+            "native: push the driver buffers, otherwise convert YUYV frames with the SIMD kernels (pixel-format=YUYV only)",
+            output_format_type,
+            static_cast<int>(DEFAULT_OUTPUT_FORMAT),
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 18 = jpeg-policy
+    static const GEnumValue jpeg_policy_values[] = {
+        {static_cast<int>(JpegPolicyEnum::PASS), "pass", "pass"},
+        {static_cast<int>(JpegPolicyEnum::DROP), "drop", "drop"},
+        {static_cast<int>(JpegPolicyEnum::FIX), "fix", "fix"},
+        {0, nullptr, nullptr}};
+    GType jpeg_policy_type = g_enum_register_static("JpegPolicyEnum", jpeg_policy_values);
+    g_object_class_install_property(
+        gclass,
+        18,
+        g_param_spec_enum(
+            "jpeg-policy",
+            "JPEG Policy",
+            "pass: push every MJPEG frame, drop: skip truncated/corrupt ones, fix: drop and insert missing Huffman tables",
+            jpeg_policy_type,
+            static_cast<int>(DEFAULT_JPEG_POLICY),
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 19 = decode
+    g_object_class_install_property(
+        gclass,
+        19,
+        g_param_spec_boolean(
+            "decode",
+            "Decode",
+            "Decode MJPEG frames to I420 on a pool of libjpeg worker threads (pixel-format=MJPG only)",
+            DEFAULT_DECODE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 20 = decode-threads
+    g_object_class_install_property(
+        gclass,
+        20,
+        g_param_spec_uint(
+            "decode-threads",
+            "Decode Threads",
+            "MJPEG decoder worker threads, also the number of frames in flight (decode=true)",
+            1, 16, DEFAULT_DECODE_THREADS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 21 = decode-scale
+    static const GEnumValue decode_scale_values[] = {
+        {static_cast<int>(DecodeScaleEnum::FULL), "full", "full"},
+        {static_cast<int>(DecodeScaleEnum::HALF), "half", "half"},
+        {static_cast<int>(DecodeScaleEnum::QUARTER), "quarter", "quarter"},
+        {static_cast<int>(DecodeScaleEnum::EIGHTH), "eighth", "eighth"},
+        {0, nullptr, nullptr}};
+    GType decode_scale_type = g_enum_register_static("DecodeScaleEnum", decode_scale_values);
+    g_object_class_install_property(
+        gclass,
+        21,
+        g_param_spec_enum(
+            "decode-scale",
+            "Decode Scale",
+            "Decoded size: full, or 1/2, 1/4, 1/8 through DCT scaling, far cheaper than decoding and downscaling (decode=true)",
+            decode_scale_type,
+            static_cast<int>(DEFAULT_DECODE_SCALE),
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 22 = stats (read-only)
+    g_object_class_install_property(
+        gclass,
+        22,
+        g_param_spec_boxed(
+            "stats",
+            "Statistics",
+            "Capture counters and p50/p99/p99.9/max latency per stage (driver-to-dqbuf, dqbuf-to-push, dqbuf-to-qbuf) in us",
+            GST_TYPE_STRUCTURE,
+            static_cast<GParamFlags>(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+    // 23 = stats-interval
+    g_object_class_install_property(
+        gclass,
+        23,
+        g_param_spec_uint(
+            "stats-interval",
+            "Stats Interval",
+            "Post the stats structure as an element message every this many ms while streaming (0 = never)",
+            0, G_MAXUINT, DEFAULT_STATS_INTERVAL_MS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 24 = shm-name
+    g_object_class_install_property(
+        gclass,
+        24,
+        g_param_spec_string(
+            "shm-name",
+            "Shared Memory Name",
+            "Also publish every captured frame (before decode/convert) to this POSIX shared memory ring, e.g. /v4l2-cam0",
+            DEFAULT_SHM_NAME,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 25 = shm-slots
+    g_object_class_install_property(
+        gclass,
+        25,
+        g_param_spec_uint(
+            "shm-slots",
+            "Shared Memory Slots",
+            "Frames the shared memory ring keeps for slow readers (shm-name set)",
+            1, 64, DEFAULT_SHM_SLOTS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 26 = crop
+    g_object_class_install_property(
+        gclass,
+        26,
+        g_param_spec_string(
+            "crop",
+            "Sensor Crop",
+            "Read out only this sensor region, \"left,top,width,height\"; width/height set the delivered size, smaller bins or scales where the driver can",
+            DEFAULT_CROP,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 27 = reconnect
+    g_object_class_install_property(
+        gclass,
+        27,
+        g_param_spec_boolean(
+            "reconnect",
+            "Reconnect",
+            "When the device is unplugged or resets, wait for it to come back and resume with a DISCONT buffer instead of failing the pipeline",
+            DEFAULT_RECONNECT,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 28 = reconnect-timeout
+    g_object_class_install_property(
+        gclass,
+        28,
+        g_param_spec_uint(
+            "reconnect-timeout",
+            "Reconnect Timeout",
+            "Give up and post an error when the device is not back after this many ms (0 = wait forever)",
+            0, G_MAXUINT, DEFAULT_RECONNECT_TIMEOUT_MS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 29 = reconnect-gaps
+    g_object_class_install_property(
+        gclass,
+        29,
+        g_param_spec_boolean(
+            "reconnect-gaps",
+            "Reconnect Gaps",
+            "While waiting for the device, push a GAP event every frame period so downstream keeps its timeline moving",
+            DEFAULT_RECONNECT_GAPS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 30 = frame-sync
+    g_object_class_install_property(
+        gclass,
+        30,
+        g_param_spec_boolean(
+            "frame-sync",
+            "Frame Sync",
+            "Subscribe to V4L2_EVENT_FRAME_SYNC and attach the start of each frame (CLOCK_MONOTONIC) as a "
+            "timestamp/x-v4l2-frame-sync reference timestamp meta; ignored by drivers without the event",
+            DEFAULT_FRAME_SYNC,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // 31 = exposure
+    g_object_class_install_property(
+        gclass,
+        31,
+        g_param_spec_int(
+            "exposure",
+            "Exposure",
+            "Manual exposure time in 100 us units (V4L2_CID_EXPOSURE_ABSOLUTE), turns auto exposure off; "
+            "-1 = leave it to the camera. Can be changed while playing, applied between two frames",
+            -1, G_MAXINT, DEFAULT_EXPOSURE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING)));
+
+    // 32 = gain
+    g_object_class_install_property(
+        gclass,
+        32,
+        g_param_spec_int(
+            "gain",
+            "Gain",
+            "Manual gain (V4L2_CID_GAIN), turns auto gain off where the camera has it; -1 = leave it to the camera. "
+            "Can be changed while playing, applied between two frames",
+            -1, G_MAXINT, DEFAULT_GAIN,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING)));
+
+    // 33 = white-balance
+    g_object_class_install_property(
+        gclass,
+        33,
+        g_param_spec_int(
+            "white-balance",
+            "White Balance",
+            "White balance temperature in K (V4L2_CID_WHITE_BALANCE_TEMPERATURE), turns auto white balance off; "
+            "-1 = leave it to the camera. Can be changed while playing, applied between two frames",
+            -1, G_MAXINT, DEFAULT_WHITE_BALANCE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING)));
+
+    // 34 = extra-controls
+    g_object_class_install_property(
+        gclass,
+        34,
+        g_param_spec_boxed(
+            "extra-controls",
+            "Extra Controls",
+            "Any other controls, named like the driver names them in lower case with '_' between words, "
+            "e.g. \"c,sharpness=3,backlight_compensation=0\"; set together with the properties above in one VIDIOC_S_EXT_CTRLS",
+            GST_TYPE_STRUCTURE,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING)));
+
+    // 35 = metrics-address
+    g_object_class_install_property(
+        gclass,
+        35,
+        g_param_spec_string(
+            "metrics-address",
+            "Metrics Address",
+            "Serve Prometheus metrics of every camera in the process on \"host:port\" or \"unix:/path\"; "
+            "the camera is registered under the element name either way",
+            DEFAULT_METRICS_ADDRESS,
+            static_cast<GParamFlags>(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+    // metadata and pads
+    gst_element_class_set_static_metadata(
+        eclass,
+        " V4L2 Source",
+        "Source/Video",
+        "Wraps ::V4L2Camera as GstPushSrc",
+        "You <you@example.com>");
+    gst_element_class_add_static_pad_template(eclass, &pad_template);
+
+    // override base class virtuals
+    auto *bclass = GST_BASE_SRC_CLASS(klass);
+    bclass->start = _v4l2src_start;
+    bclass->stop = _v4l2src_stop;
+    bclass->get_caps = _v4l2src_get_caps;
+    bclass->negotiate = _v4l2src_negotiate;
+    bclass->fixate = _v4l2src_fixate;
+    bclass->decide_allocation = _v4l2src_decide_allocation;
+    bclass->query = _v4l2src_query;
+    bclass->unlock = _v4l2src_unlock;
+    bclass->unlock_stop = _v4l2src_unlock_stop;
+
+    // PushSrc virtual method
+    auto *pclass = GST_PUSH_SRC_CLASS(klass);
+    pclass->create = _v4l2src_create;
+}
+
+static void _v4l2src_init(V4L2Src *self)
+{
+    // GObject hands us zeroed memory, bring the C++ members to life
+    std::construct_at(&self->controls_pending, false);
+    std::construct_at(&self->camera);
+    std::construct_at(&self->decoder);
+    std::construct_at(&self->shm_ring);
+    std::construct_at(&self->metrics_exporter);
+
+    self->device_path = g_strdup(DEFAULT_DEVICE_PATH);
+    self->pixel_format = DEFAULT_PIXEL_FORMAT;
+    self->resolution = DEFAULT_RESOLUTION;
+    self->fps = DEFAULT_FPS;
+    self->buffer_count = DEFAULT_BUFFER_COUNT;
+    self->io_mode = DEFAULT_IO_MODE;
+    self->capture_timeout_ms = DEFAULT_CAPTURE_TIMEOUT_MS;
+    self->leaky = DEFAULT_LEAKY;
+    self->capture_thread = DEFAULT_CAPTURE_THREAD;
+    self->capture_cpu = DEFAULT_CAPTURE_CPU;
+    self->capture_priority = DEFAULT_CAPTURE_PRIORITY;
+    self->mlock = DEFAULT_MLOCK;
+    self->width = DEFAULT_WIDTH;
+    self->height = DEFAULT_HEIGHT;
+    self->framerate_n = DEFAULT_FRAMERATE_N;
+    self->framerate_d = DEFAULT_FRAMERATE_D;
+    self->output_format = DEFAULT_OUTPUT_FORMAT;
+    self->jpeg_policy = DEFAULT_JPEG_POLICY;
+    self->decode = DEFAULT_DECODE;
+    self->decode_threads = DEFAULT_DECODE_THREADS;
+    self->decode_scale = DEFAULT_DECODE_SCALE;
+    self->stats_interval_ms = DEFAULT_STATS_INTERVAL_MS;
+    self->last_stats_us = 0;
+    self->shm_name = g_strdup(DEFAULT_SHM_NAME);
+    self->shm_slots = DEFAULT_SHM_SLOTS;
+    self->crop = g_strdup(DEFAULT_CROP);
+    self->reconnect = DEFAULT_RECONNECT;
+    self->reconnect_timeout_ms = DEFAULT_RECONNECT_TIMEOUT_MS;
+    self->reconnect_gaps = DEFAULT_RECONNECT_GAPS;
+    self->frame_sync = DEFAULT_FRAME_SYNC;
+    self->exposure = DEFAULT_EXPOSURE;
+    self->gain = DEFAULT_GAIN;
+    self->white_balance = DEFAULT_WHITE_BALANCE;
+    self->extra_controls = nullptr;
+    self->metrics_address = g_strdup(DEFAULT_METRICS_ADDRESS);
+    self->metrics_name = nullptr;
+    self->discont = false;
+    self->latency_min = GST_CLOCK_TIME_NONE;
+    self->latency_max = GST_CLOCK_TIME_NONE;
+    self->dmabuf_allocator = nullptr;
+    self->pool = nullptr;
+    self->frame_number = 0;
+    self->last_sequence = 0;
+    self->have_sequence = false;
+    self->pushed_frames = 0;
+
+    gst_base_src_set_live(GST_BASE_SRC(self), TRUE);
+    gst_base_src_set_format(GST_BASE_SRC(self), GST_FORMAT_TIME);
+    // ⏱ create() stamps from the driver timestamp, basesrc would stamp the time create() returned
+    gst_base_src_set_do_timestamp(GST_BASE_SRC(self), FALSE);
+}
+
+static void _v4l2src_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(object));
+    switch (prop_id)
+    {
+    case 1: // device
+        g_free(self->device_path);
+        self->device_path = g_value_dup_string(value);
+        break;
+    case 2: // pixel-format
+        self->pixel_format = static_cast<PixelFormatEnum>(g_value_get_enum(value));
+        break;
+    case 3: // resolution ← now correctly registered
+        self->resolution = static_cast<ResolutionEnum>(g_value_get_enum(value));
+        break;
+    case 4: // fps
+        self->fps = static_cast<FPSEnum>(g_value_get_enum(value));
+        break;
+    case 5: // buffer-count
+        self->buffer_count = g_value_get_uint(value);
+        break;
+    case 6: // io-mode
+        self->io_mode = static_cast<IoModeEnum>(g_value_get_enum(value));
+        break;
+    case 7: // capture-timeout
+        self->capture_timeout_ms = g_value_get_uint(value);
+        break;
+    case 8: // leaky
+        self->leaky = static_cast<LeakyEnum>(g_value_get_enum(value));
+        break;
+    case 10: // capture-thread
+        self->capture_thread = g_value_get_boolean(value);
+        break;
+    case 11: // capture-cpu
+        self->capture_cpu = g_value_get_int(value);
+        break;
+    case 12: // capture-priority
+        self->capture_priority = g_value_get_int(value);
+        break;
+    case 13: // mlock
+        self->mlock = g_value_get_boolean(value);
+        break;
+    case 14: // width
+        self->width = g_value_get_uint(value);
+        break;
+    case 15: // height
+        self->height = g_value_get_uint(value);
+        break;
+    case 16: // framerate
+        self->framerate_n = gst_value_get_fraction_numerator(value);
+        self->framerate_d = gst_value_get_fraction_denominator(value);
+        break;
+    case 17: // output-format
+        self->output_format = static_cast<OutputFormatEnum>(g_value_get_enum(value));
+        break;
+    case 18: // jpeg-policy
+        self->jpeg_policy = static_cast<JpegPolicyEnum>(g_value_get_enum(value));
+        break;
+    case 19: // decode
+        self->decode = g_value_get_boolean(value);
+        break;
+    case 20: // decode-threads
+        self->decode_threads = g_value_get_uint(value);
+        break;
+    case 21: // decode-scale
+        self->decode_scale = static_cast<DecodeScaleEnum>(g_value_get_enum(value));
+        break;
+    case 23: // stats-interval
+        self->stats_interval_ms = g_value_get_uint(value);
+        break;
+    case 24: // shm-name
+        g_free(self->shm_name);
+        self->shm_name = g_value_dup_string(value);
+        break;
+    case 25: // shm-slots
+        self->shm_slots = g_value_get_uint(value);
+        break;
+    case 26: // crop
+        g_free(self->crop);
+        self->crop = g_value_dup_string(value);
+        break;
+    case 27: // reconnect
+        self->reconnect = g_value_get_boolean(value);
+        break;
+    case 28: // reconnect-timeout
+        self->reconnect_timeout_ms = g_value_get_uint(value);
+        break;
+    case 29: // reconnect-gaps
+        self->reconnect_gaps = g_value_get_boolean(value);
+        break;
+    case 30: // frame-sync
+        self->frame_sync = g_value_get_boolean(value);
+        break;
+    case 31: // exposure
+    case 32: // gain
+    case 33: // white-balance
+    case 34: // extra-controls
+        // 🎛 create() reads them under the lock when it applies them
+        GST_OBJECT_LOCK(self);
+        if (prop_id == 31)
+        {
+            self->exposure = g_value_get_int(value);
+        }
+        else if (prop_id == 32)
+        {
+            self->gain = g_value_get_int(value);
+        }
+        else if (prop_id == 33)
+        {
+            self->white_balance = g_value_get_int(value);
+        }
+        else
+        {
+            if (self->extra_controls)
+            {
+                gst_structure_free(self->extra_controls);
+            }
+            const GstStructure *extra = gst_value_get_structure(value);
+            self->extra_controls = extra ? gst_structure_copy(extra) : nullptr;
+        }
+        GST_OBJECT_UNLOCK(self);
+        self->controls_pending.store(true, std::memory_order_release);
+        break;
+    case 35: // metrics-address
+        g_free(self->metrics_address);
+        self->metrics_address = g_value_dup_string(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+static void _v4l2src_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(object));
+    switch (prop_id)
+    {
+    case 1:
+        g_value_set_string(value, self->device_path);
+        break;
+    case 2:
+        g_value_set_enum(value, static_cast<gint>(self->pixel_format));
+        break;
+    case 3:
+        g_value_set_enum(value, static_cast<gint>(self->resolution));
+        break;
+    case 4:
+        g_value_set_enum(value, static_cast<gint>(self->fps));
+        break;
+    case 5:
+        g_value_set_uint(value, self->buffer_count);
+        break;
+    case 6:
+        g_value_set_enum(value, static_cast<gint>(self->io_mode));
+        break;
+    case 7:
+        g_value_set_uint(value, self->capture_timeout_ms);
+        break;
+    case 8:
+        g_value_set_enum(value, static_cast<gint>(self->leaky));
+        break;
+    case 9:
+        // the object lock guards self->camera against start()/stop() on the streaming thread
+        GST_OBJECT_LOCK(self);
+        g_value_set_uint64(value, self->camera ? self->camera->stats().dropped_frames : 0);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case 10:
+        g_value_set_boolean(value, self->capture_thread);
+        break;
+    case 11:
+        g_value_set_int(value, self->capture_cpu);
+        break;
+    case 12:
+        g_value_set_int(value, self->capture_priority);
+        break;
+    case 13:
+        g_value_set_boolean(value, self->mlock);
+        break;
+    case 14:
+        g_value_set_uint(value, self->width);
+        break;
+    case 15:
+        g_value_set_uint(value, self->height);
+        break;
+    case 16:
+        gst_value_set_fraction(value, self->framerate_n, self->framerate_d);
+        break;
+    case 17:
+        g_value_set_enum(value, static_cast<gint>(self->output_format));
+        break;
+    case 18:
+        g_value_set_enum(value, static_cast<gint>(self->jpeg_policy));
+        break;
+    case 19:
+        g_value_set_boolean(value, self->decode);
+        break;
+    case 20:
+        g_value_set_uint(value, self->decode_threads);
+        break;
+    case 21:
+        g_value_set_enum(value, static_cast<gint>(self->decode_scale));
+        break;
+    case 22:
+        GST_OBJECT_LOCK(self);
+        g_value_take_boxed(value, build_stats(self->camera.get()));
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case 23:
+        g_value_set_uint(value, self->stats_interval_ms);
+        break;
+    case 24:
+        g_value_set_string(value, self->shm_name);
+        break;
+    case 25:
+        g_value_set_uint(value, self->shm_slots);
+        break;
+    case 26:
+        g_value_set_string(value, self->crop);
+        break;
+    case 27:
+        g_value_set_boolean(value, self->reconnect);
+        break;
+    case 28:
+        g_value_set_uint(value, self->reconnect_timeout_ms);
+        break;
+    case 29:
+        g_value_set_boolean(value, self->reconnect_gaps);
+        break;
+    case 30:
+        g_value_set_boolean(value, self->frame_sync);
+        break;
+    case 31:
+        g_value_set_int(value, self->exposure);
+        break;
+    case 32:
+        g_value_set_int(value, self->gain);
+        break;
+    case 33:
+        g_value_set_int(value, self->white_balance);
+        break;
+    case 34:
+        GST_OBJECT_LOCK(self);
+        gst_value_set_structure(value, self->extra_controls);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case 35:
+        g_value_set_string(value, self->metrics_address);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+}
+
+// "Exposure Time, Absolute" -> "exposure_time_absolute": how extra-controls names a control
+[[nodiscard]] static std::string control_key(const std::string &name)
+{
+    std::string key;
+    for (const char c : name)
+    {
+        if (g_ascii_isalnum(c))
+        {
+            key += g_ascii_tolower(c);
+        }
+        else if (!key.empty() && key.back() != '_')
+        {
+            key += '_';
+        }
+    }
+    while (!key.empty() && key.back() == '_')
+    {
+        key.pop_back();
+    }
+    return key;
+}
+
+// 🎛 one batch from the control properties, auto modes switched off ahead of the values they would override
+[[nodiscard]] static std::vector<v4l2::ControlValue> wanted_controls(V4L2Src *self)
+{
+    // copied under the lock, logging takes object locks of its own
+    GST_OBJECT_LOCK(self);
+    const gint exposure = self->exposure;
+    const gint gain = self->gain;
+    const gint white_balance = self->white_balance;
+    GstStructure *extra = self->extra_controls ? gst_structure_copy(self->extra_controls) : nullptr;
+    GST_OBJECT_UNLOCK(self);
+
+    auto const &camera = *self->camera;
+    std::vector<v4l2::ControlValue> batch;
+    auto const manual = [&](std::uint32_t auto_id, std::int64_t off, std::uint32_t id, gint value, const char *property)
+    {
+        if (value < 0)
+        {
+            return;
+        }
+        if (!camera.find_control(id))
+        {
+            GST_WARNING_OBJECT(self, "%s: the camera has no such control", property);
+            return;
+        }
+        if (camera.find_control(auto_id))
+        {
+            batch.push_back(v4l2::ControlValue{.id = auto_id, .value = off});
+        }
+        batch.push_back(v4l2::ControlValue{.id = id, .value = value});
+    };
+    manual(V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL, V4L2_CID_EXPOSURE_ABSOLUTE, exposure, "exposure");
+    manual(V4L2_CID_AUTOGAIN, 0, V4L2_CID_GAIN, gain, "gain");
+    manual(V4L2_CID_AUTO_WHITE_BALANCE, 0, V4L2_CID_WHITE_BALANCE_TEMPERATURE, white_balance, "white-balance");
+
+    for (gint i = 0; extra && i < gst_structure_n_fields(extra); ++i)
+    {
+        const gchar *field = gst_structure_nth_field_name(extra, static_cast<guint>(i));
+        auto const &controls = camera.controls();
+        auto const control = std::find_if(controls.begin(), controls.end(),
+                                          [&](const v4l2::ControlInfo &info) { return control_key(info.name) == field; });
+        const GValue *value = gst_structure_get_value(extra, field);
+        if (control == controls.end())
+        {
+            GST_WARNING_OBJECT(self, "extra-controls: the camera has no control '%s'", field);
+        }
+        else if (G_VALUE_HOLDS_INT(value))
+        {
+            batch.push_back(v4l2::ControlValue{.id = control->id, .value = g_value_get_int(value)});
+        }
+        else if (G_VALUE_HOLDS_BOOLEAN(value))
+        {
+            batch.push_back(v4l2::ControlValue{.id = control->id, .value = g_value_get_boolean(value) ? 1 : 0});
+        }
+        else if (G_VALUE_HOLDS_INT64(value))
+        {
+            batch.push_back(v4l2::ControlValue{.id = control->id, .value = g_value_get_int64(value)});
+        }
+        else
+        {
+            GST_WARNING_OBJECT(self, "extra-controls: '%s' needs an integer or boolean value", field);
+        }
+    }
+    if (extra)
+    {
+        gst_structure_free(extra);
+    }
+    return batch;
+}
+
+// Set whatever the control properties ask for, a refused batch is a warning: the stream goes on as it was
+static void apply_controls(V4L2Src *self)
+{
+    self->controls_pending.store(false, std::memory_order_relaxed);
+    auto const batch = wanted_controls(self);
+    if (batch.empty())
+    {
+        return;
+    }
+    try
+    {
+        self->camera->set_controls(batch);
+        GST_DEBUG_OBJECT(self, "set %zu controls", batch.size());
+    }
+    catch (const std::exception &ex)
+    {
+        GST_ELEMENT_WARNING(self, RESOURCE, SETTINGS, ("Failed to set camera controls"), ("%s", ex.what()));
+    }
+}
+
+// "left,top,width,height", std::nullopt for anything else
+[[nodiscard]] static std::optional<v4l2::Rect> parse_crop(const gchar *text)
+{
+    gint left = 0;
+    gint top = 0;
+    guint width = 0;
+    guint height = 0;
+    gchar tail = 0;
+    if (std::sscanf(text, "%d,%d,%u,%u%c", &left, &top, &width, &height, &tail) != 4 || width == 0 || height == 0)
+    {
+        return std::nullopt;
+    }
+    return v4l2::Rect{.left = left, .top = top, .width = width, .height = height};
+}
+
+[[nodiscard]] static GstCaps *get_active_caps(const V4L2Src *self)
+{
+    if (!self->camera)
+    {
+        GST_ERROR("get_active_caps: camera not started");
+        return nullptr;
+    }
+
+    // what the driver accepted in configure(), not what the properties asked for
+    auto const &active = self->camera->config();
+    const auto [w, h] = v4l2::dimensions_decompress(static_cast<uint32_t>(active.dimension_));
+    const gint fpsn = static_cast<gint>(active.fps_num_);
+    const gint fpsd = static_cast<gint>(active.fps_den_);
+    const PixelFormatEnum pixel_format = active.format_;
+
+    GstCaps *caps = nullptr;
+
+    if (pixel_format == PixelFormatEnum::MJPG && self->decoder)
+    {
+        auto const [out_w, out_h] = v4l2::MjpegDecoder::scaled_size(w, h, self->decoder->config().scale_denom_);
+        caps = gst_caps_new_simple("video/x-raw",
+                                   "format", G_TYPE_STRING, "I420",
+                                   "width", G_TYPE_INT, static_cast<gint>(out_w),
+                                   "height", G_TYPE_INT, static_cast<gint>(out_h),
+                                   "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
+                                   nullptr);
+    }
+    else if (pixel_format == PixelFormatEnum::MJPG)
+    {
+        caps = gst_caps_new_simple("image/jpeg",
+                                   "width", G_TYPE_INT, w,
+                                   "height", G_TYPE_INT, h,
+                                   "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
+                                   nullptr);
+    }
+    else if (pixel_format == PixelFormatEnum::YUYV)
+    {
+        caps = gst_caps_new_simple("video/x-raw",
+                                   "format", G_TYPE_STRING, raw_caps_format(self->output_format),
+                                   "width", G_TYPE_INT, w,
+                                   "height", G_TYPE_INT, h,
+                                   "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
+                                   nullptr);
+    }
+    else if (const gchar *semi_planar = semi_planar_caps_format(pixel_format))
+    {
+        // 🧅 both layouts are plain NV12/NV16 downstream, the video meta says where CbCr is
+        caps = gst_caps_new_simple("video/x-raw",
+                                   "format", G_TYPE_STRING, semi_planar,
+                                   "width", G_TYPE_INT, w,
+                                   "height", G_TYPE_INT, h,
+                                   "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
+                                   nullptr);
+    }
+    else
+    {
+        GST_ERROR("get_active_caps: invalid pixel format enum = %d", static_cast<int>(pixel_format));
+        return nullptr;
+    }
+
+    // ✂️ a crop scaled unevenly to the delivered size leaves non-square pixels
+    if (active.crop_ && w > 0 && h > 0)
+    {
+        auto par_n = static_cast<std::uint64_t>(active.crop_->width) * h;
+        auto par_d = static_cast<std::uint64_t>(active.crop_->height) * w;
+        const auto divisor = std::gcd(par_n, par_d);
+        par_n /= divisor;
+        par_d /= divisor;
+        if (par_n != par_d && par_n <= G_MAXINT && par_d <= G_MAXINT)
+        {
+            gst_caps_set_simple(caps, "pixel-aspect-ratio", GST_TYPE_FRACTION,
+                                static_cast<gint>(par_n), static_cast<gint>(par_d), nullptr);
+        }
+    }
+
+    // attempt to fixate
+    GstCaps *fixed = gst_caps_fixate(gst_caps_copy(caps));
+    gst_caps_unref(caps);
+
+    if (!fixed || !gst_caps_is_fixed(fixed))
+    {
+        GST_ERROR("get_active_caps: fixation failed or result is not fixed");
+        if (fixed)
+            gst_caps_unref(fixed);
+        return nullptr;
+    }
+
+    return fixed;
+}
+
+[[nodiscard]] std::optional<PixelFormatEnum> to_pixel_format(gint value)
+{
+    switch (static_cast<PixelFormatEnum>(value))
+    {
+    case PixelFormatEnum::MJPG:
+        return PixelFormatEnum::MJPG;
+    case PixelFormatEnum::YUYV:
+        return PixelFormatEnum::YUYV;
+    case PixelFormatEnum::NV12:
+        return PixelFormatEnum::NV12;
+    case PixelFormatEnum::NV16:
+        return PixelFormatEnum::NV16;
+    case PixelFormatEnum::NV12M:
+        return PixelFormatEnum::NV12M;
+    case PixelFormatEnum::NV16M:
+        return PixelFormatEnum::NV16M;
+    default:
+        GST_ERROR("invalid pixel format value: %d", value);
+        return std::nullopt;
+    }
+}
+
+[[nodiscard]] std::optional<FPSEnum> to_fps_enum(gint value)
+{
+    switch (static_cast<FPSEnum>(value))
+    {
+    case FPSEnum::FPS_15:
+        return FPSEnum::FPS_15;
+    case FPSEnum::FPS_30:
+        return FPSEnum::FPS_30;
+    case FPSEnum::FPS_60:
+        return FPSEnum::FPS_60;
+    default:
+        GST_ERROR("invalid fps enum: %d", value);
+        return std::nullopt;
+    }
+}
+
+// Convert our FourCC enum into a GstVideoFormat for gst_buffer_add_video_meta()
+GstVideoFormat to_gst_video_format(PixelFormatEnum fmt)
+{
+    switch (fmt)
+    {
+    case PixelFormatEnum::YUYV:
+        return GST_VIDEO_FORMAT_YUY2;
+    case PixelFormatEnum::NV12:
+    case PixelFormatEnum::NV12M:
+        return GST_VIDEO_FORMAT_NV12;
+    case PixelFormatEnum::NV16:
+    case PixelFormatEnum::NV16M:
+        return GST_VIDEO_FORMAT_NV16;
+    case PixelFormatEnum::MJPG:
+        // MJPEG isn’t raw video, there is no meaningful video meta before decode
+    default:
+        return GST_VIDEO_FORMAT_UNKNOWN;
+    }
+}
+
+// Everything start() set up, in reverse: stop() and every start() failure once the camera exists come through here,
+// basesrc does not call stop() when start() fails
+static void release_streaming(V4L2Src *self)
+{
+    if (self->pool)
+    {
+        // the capture thread must be gone before STREAMOFF below
+        if (auto &capture = GST_V4L2_BUFFER_POOL(self->pool)->capture)
+        {
+            capture->stop();
+        }
+        gst_buffer_pool_set_active(self->pool, FALSE);
+        gst_object_unref(self->pool);
+        self->pool = nullptr;
+    }
+
+    // 🧹 decoded buffers still downstream keep the decoder, and its workers, alive until they return
+    GST_OBJECT_LOCK(self);
+    self->decoder.reset();
+    self->latency_min = GST_CLOCK_TIME_NONE;
+    self->latency_max = GST_CLOCK_TIME_NONE;
+    GST_OBJECT_UNLOCK(self);
+    self->shm_ring.reset();
+    self->metrics_exporter.reset();
+    if (self->metrics_name)
+    {
+        v4l2::MetricsRegistry::global().remove(self->metrics_name);
+        g_free(self->metrics_name);
+        self->metrics_name = nullptr;
+    }
+
+    if (self->camera)
+    {
+        try
+        {
+            self->camera->stop_streaming();
+        }
+        catch (const std::exception &ex)
+        {
+            GST_WARNING_OBJECT(self, "stop_streaming threw: %s", ex.what());
+        }
+
+        if (auto const dropped = self->camera->stats().dropped_frames; dropped > 0)
+        {
+            GST_INFO_OBJECT(self, "leaky=latest skipped %" G_GUINT64_FORMAT " stale frames", dropped);
+        }
+
+        GST_OBJECT_LOCK(self);
+        self->camera.reset(); // 🧹 the pool drops its reference once the last buffer returns
+        GST_OBJECT_UNLOCK(self);
+    }
 
-    if (self->pixel_format == PixelFormatEnum::MJPG)
+    if (self->dmabuf_allocator)
     {
-        caps = gst_caps_new_simple("image/jpeg",
-                                   "width", G_TYPE_INT, w,
-                                   "height", G_TYPE_INT, h,
-                                   "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
-                                   nullptr);
+        gst_object_unref(self->dmabuf_allocator);
+        self->dmabuf_allocator = nullptr;
+    }
+}
+
+// 📇 the modes get_caps() offers, listed here on the streaming side: a caps query from another thread only reads
+// V4L2Camera::cached_modes() and never touches the device
+static void list_modes(V4L2Src *self, bool refresh)
+{
+    try
+    {
+        [[maybe_unused]] auto const modes = self->camera->enumerate_modes(refresh);
+    }
+    catch (const std::exception &ex)
+    {
+        GST_DEBUG_OBJECT(self, "cannot enumerate %s (%s), caps queries get the template caps", self->device_path, ex.what());
+    }
+}
+
+// Slots as big as the largest driver buffer, all its memory planes
+[[nodiscard]] static std::size_t shm_slot_size(V4L2Src *self)
+{
+    std::size_t slot_size = 0;
+    for (auto const &buffer : self->camera->buffers())
+    {
+        std::size_t size = 0;
+        for (std::uint32_t m = 0; m < buffer.plane_count; ++m)
+        {
+            size += buffer.plane(m).size;
+        }
+        slot_size = std::max(slot_size, size);
+    }
+    return slot_size;
+}
+
+[[nodiscard]] static std::unique_ptr<v4l2::SharedFrameRing> make_shm_ring(V4L2Src *self, std::size_t slot_size)
+{
+    return std::make_unique<v4l2::SharedFrameRing>(v4l2::SharedFrameRingConfig{
+        .name_ = self->shm_name,
+        .slots_ = self->shm_slots,
+        .slot_size_ = slot_size,
+    });
+}
+
+static gboolean _v4l2src_start(GstBaseSrc *basesrc)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(basesrc)); // for GstBaseSrc*
+    v4l2::V4l2Config cfg;
+    cfg.device_path_ = self->device_path;
+    auto maybe_fmt = to_pixel_format(static_cast<gint>(self->pixel_format));
+    if (!maybe_fmt)
+    {
+        GST_ERROR_OBJECT(self, "invalid pixel format: %d", static_cast<int>(self->pixel_format));
+        return FALSE;
+    }
+    cfg.format_ = *maybe_fmt;
+    if (to_convert_format(self->output_format) && cfg.format_ != PixelFormatEnum::YUYV)
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("output-format needs pixel-format=YUYV"),
+                          ("compressed frames cannot be converted, got pixel format %08X", static_cast<uint32_t>(cfg.format_)));
+        return FALSE;
+    }
+    if (self->decode && (cfg.format_ != PixelFormatEnum::MJPG || to_convert_format(self->output_format)))
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("decode needs pixel-format=MJPG and output-format=native"),
+                          ("got pixel format %08X, output-format %d", static_cast<uint32_t>(cfg.format_),
+                           static_cast<int>(self->output_format)));
+        return FALSE;
+    }
+
+    // width/height and framerate take any mode the device lists, the enums only the named ones
+    if (self->width > 0 && self->height > 0)
+    {
+        cfg.dimension_ = v4l2::to_dimension(self->width, self->height);
+    }
+    else
+    {
+        cfg.dimension_ = static_cast<ResolutionEnum>(self->resolution);
+    }
+    if (self->framerate_n > 0)
+    {
+        cfg.fps_num_ = static_cast<FPSEnum>(self->framerate_n);
+        cfg.fps_den_ = static_cast<std::uint32_t>(self->framerate_d);
+    }
+    else
+    {
+        auto maybe_fps = to_fps_enum(static_cast<gint>(self->fps));
+        if (!maybe_fps)
+        {
+            GST_ERROR_OBJECT(self, "invalid FPS enum: %d", static_cast<int>(self->fps));
+            return FALSE;
+        }
+        cfg.fps_num_ = *maybe_fps;
+    }
+
+    cfg.buffer_count_ = self->buffer_count;
+    cfg.memory_ = self->io_mode;
+    cfg.capture_policy_ = self->leaky;
+    if (self->crop && *self->crop)
+    {
+        auto const crop = parse_crop(self->crop);
+        if (!crop)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("invalid crop \"%s\"", self->crop),
+                              ("expected \"left,top,width,height\" with a non-zero width and height"));
+            return FALSE;
+        }
+        cfg.crop_ = crop;
+        if (self->width <= 0 || self->height <= 0)
+        {
+            cfg.dimension_ = v4l2::to_dimension(crop->width, crop->height); // the crop at native resolution
+        }
+    }
+
+    auto [width, height] = v4l2::dimensions_decompress(static_cast<uint32_t>(cfg.dimension_));
+    GST_INFO_OBJECT(self, "starting %s: pixel format %08X, %ux%u, %u/%u fps, %u buffers",
+                    cfg.device_path_.c_str(), static_cast<uint32_t>(cfg.format_), width, height,
+                    static_cast<uint32_t>(cfg.fps_num_), cfg.fps_den_, cfg.buffer_count_);
+
+    auto camera = std::make_shared<v4l2::V4L2Camera>(cfg);
+    GST_OBJECT_LOCK(self);
+    self->camera = std::move(camera);
+    GST_OBJECT_UNLOCK(self);
+
+    try
+    {
+        self->camera->open_device();
+        list_modes(self, false);
+        if (self->camera->try_soe())
+        {
+            GST_INFO_OBJECT(self, "driver timestamps at start of exposure");
+        }
+        // 📬 a new input resolution renegotiates in create() instead of failing the stream
+        if (!self->camera->subscribe_event(v4l2::CameraEventType::SOURCE_CHANGE))
+        {
+            GST_DEBUG_OBJECT(self, "driver has no source change events");
+        }
+        if (self->frame_sync && !self->camera->subscribe_event(v4l2::CameraEventType::FRAME_SYNC))
+        {
+            GST_WARNING_OBJECT(self, "frame-sync: driver has no V4L2_EVENT_FRAME_SYNC, buffers go without");
+        }
+        self->camera->configure();
+        apply_controls(self); // before the first frame is exposed
+        self->camera->start_streaming();
+    }
+    catch (const std::exception &ex)
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to start camera"), ("%s", ex.what()));
+        release_streaming(self);
+        return FALSE;
+    }
+
+    self->frame_number = 0;
+    self->last_sequence = 0;
+    self->have_sequence = false;
+    self->pushed_frames = 0;
+    self->last_stats_us = 0;
+    self->discont = false;
+
+    if (self->io_mode == IoModeEnum::DMABUF_EXPORT)
+    {
+        self->dmabuf_allocator = gst_dmabuf_allocator_new();
+    }
+
+    // 🧱 pre-build one GstBuffer per driver buffer, offered in decide_allocation()
+    auto const &active = self->camera->config();
+    auto const [active_w, active_h] = v4l2::dimensions_decompress(static_cast<uint32_t>(active.dimension_));
+    self->pool = v4l2_buffer_pool_new(self->camera, self->dmabuf_allocator,
+                                      to_gst_video_format(active.format_), active_w, active_h);
+    GST_V4L2_BUFFER_POOL(self->pool)->timeout_us =
+        self->capture_timeout_ms == 0 ? -1 : static_cast<gint64>(self->capture_timeout_ms) * 1000;
+
+    // 🧵 optional capture thread: DQBUF timing stops depending on downstream chain functions
+    if (self->capture_thread)
+    {
+        v4l2::CaptureThreadConfig thread_cfg;
+        if (self->capture_cpu >= 0)
+        {
+            thread_cfg.cpu_ = static_cast<unsigned>(self->capture_cpu);
+        }
+        thread_cfg.fifo_priority_ = self->capture_priority;
+        thread_cfg.mlock_all_ = self->mlock;
+
+        try
+        {
+            auto &capture = GST_V4L2_BUFFER_POOL(self->pool)->capture;
+            capture = std::make_unique<v4l2::CaptureThread>(*self->camera, thread_cfg);
+            capture->start();
+        }
+        catch (const std::exception &ex)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to start the capture thread"), ("%s", ex.what()));
+            release_streaming(self);
+            return FALSE;
+        }
+    }
+
+    // 🧩 optional MJPEG decode: a couple of spare output images so downstream can hold some while workers fill others
+    if (self->decode)
+    {
+        try
+        {
+            auto decoder = std::make_shared<v4l2::MjpegDecoder>(v4l2::MjpegDecoderConfig{
+                .threads_ = self->decode_threads,
+                .scale_denom_ = static_cast<unsigned>(self->decode_scale),
+                .output_buffers_ = self->decode_threads + 4,
+            });
+            GST_OBJECT_LOCK(self);
+            self->decoder = std::move(decoder);
+            GST_OBJECT_UNLOCK(self);
+        }
+        catch (const std::exception &ex)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("Failed to start the MJPEG decoder"), ("%s", ex.what()));
+            release_streaming(self);
+            return FALSE;
+        }
+    }
+
+    publish_latency(self);
+
+    // 📊 every camera is registered, serving them is opt-in; a busy port costs the metrics, not the stream
+    g_free(self->metrics_name);
+    self->metrics_name = metrics_key(GST_OBJECT(self));
+    v4l2::MetricsRegistry::global().add(self->metrics_name, self->camera->metrics());
+    if (self->metrics_address && *self->metrics_address)
+    {
+        try
+        {
+            self->metrics_exporter = v4l2::MetricsExporter::shared(self->metrics_address);
+            GST_INFO_OBJECT(self, "metrics on %s", self->metrics_exporter->address().c_str());
+        }
+        catch (const std::exception &ex)
+        {
+            GST_ELEMENT_WARNING(self, RESOURCE, SETTINGS, ("Cannot serve metrics"), ("%s", ex.what()));
+        }
+    }
+
+    // 📡 optional fan-out to other processes
+    if (self->shm_name && *self->shm_name)
+    {
+        const std::size_t slot_size = shm_slot_size(self);
+        try
+        {
+            self->shm_ring = make_shm_ring(self, slot_size);
+        }
+        catch (const std::exception &ex)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, OPEN_WRITE, ("Failed to create the shared memory ring"), ("%s", ex.what()));
+            release_streaming(self);
+            return FALSE;
+        }
+        GST_INFO_OBJECT(self, "publishing frames to %s, %u slots of %zu bytes", self->shm_name, self->shm_slots, slot_size);
+    }
+
+    // ✅ NO CAPS SETTING HERE.
+    // let negotiate() figure it out like a grown up
+    if (!gst_base_src_negotiate(GST_BASE_SRC(self)))
+    {
+        GST_ERROR_OBJECT(self, "negotiation failed");
+        release_streaming(self);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean _v4l2src_stop(GstBaseSrc *basesrc)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(basesrc));
+    GST_DEBUG_OBJECT(self, "stopping, cleanup engaged");
+    release_streaming(self);
+    return TRUE;
+}
+
+// One caps structure per device mode we can stream: MJPG, YUYV and the NV formats, only YUYV when converting,
+// only MJPG as scaled I420 when decoding at 1/decode_scale
+[[nodiscard]] static GstCaps *build_caps(const std::vector<v4l2::CaptureMode> &modes, OutputFormatEnum output,
+                                         std::optional<unsigned> decode_scale)
+{
+    GstCaps *caps = gst_caps_new_empty();
+
+    for (auto const &mode : modes)
+    {
+        const gchar *semi_planar = semi_planar_caps_format(mode.format);
+        if ((mode.format != PixelFormatEnum::MJPG && mode.format != PixelFormatEnum::YUYV && !semi_planar) ||
+            mode.frame_rates.empty())
+        {
+            continue; // configure() only accepts these
+        }
+        if (mode.format != PixelFormatEnum::YUYV && to_convert_format(output))
+        {
+            continue; // output-format converts YUYV only
+        }
+        if (mode.format != PixelFormatEnum::MJPG && decode_scale)
+        {
+            continue; // decode takes MJPEG only
+        }
+
+        GstStructure *s = nullptr;
+        if (decode_scale)
+        {
+            auto const [out_w, out_h] = v4l2::MjpegDecoder::scaled_size(mode.width, mode.height, *decode_scale);
+            s = gst_structure_new("video/x-raw",
+                                  "format", G_TYPE_STRING, "I420",
+                                  "width", G_TYPE_INT, static_cast<gint>(out_w),
+                                  "height", G_TYPE_INT, static_cast<gint>(out_h),
+                                  nullptr);
+        }
+        else if (mode.format == PixelFormatEnum::MJPG)
+        {
+            s = gst_structure_new("image/jpeg",
+                                  // must match static pad: name + type + value
+                                  "memory", G_TYPE_STRING, "NVMM",
+                                  "width", G_TYPE_INT, static_cast<gint>(mode.width),
+                                  "height", G_TYPE_INT, static_cast<gint>(mode.height),
+                                  nullptr);
+        }
+        else if (semi_planar)
+        {
+            s = gst_structure_new("video/x-raw",
+                                  "format", G_TYPE_STRING, semi_planar,
+                                  "width", G_TYPE_INT, static_cast<gint>(mode.width),
+                                  "height", G_TYPE_INT, static_cast<gint>(mode.height),
+                                  nullptr);
+        }
+        else
+        {
+            s = gst_structure_new("video/x-raw",
+                                  "format", G_TYPE_STRING, raw_caps_format(output),
+                                  "width", G_TYPE_INT, static_cast<gint>(mode.width),
+                                  "height", G_TYPE_INT, static_cast<gint>(mode.height),
+                                  nullptr);
+        }
+
+        // 🎞 exactly the rates the device lists for this size, 25/1 and 30000/1001 included
+        GValue rates = G_VALUE_INIT;
+        g_value_init(&rates, GST_TYPE_LIST);
+        for (auto const &rate : mode.frame_rates)
+        {
+            GValue fraction = G_VALUE_INIT;
+            g_value_init(&fraction, GST_TYPE_FRACTION);
+            gst_value_set_fraction(&fraction, static_cast<gint>(rate.numerator), static_cast<gint>(rate.denominator));
+            gst_value_list_append_and_take_value(&rates, &fraction);
+        }
+        gst_structure_take_value(s, "framerate", &rates);
+
+        gst_caps_append_structure(caps, s);
+    }
+
+    return gst_caps_simplify(caps);
+}
+
+static GstCaps *_v4l2src_get_caps(GstBaseSrc *basesrc, GstCaps *filter)
+{
+    auto *self = get_instance<V4L2Src>(G_OBJECT(basesrc));
+
+    // 📇 what the device really has, from the per-device-path cache: any thread may ask, so an open camera is never
+    // queried here, start() and the reconnect and renegotiation paths list its modes on the streaming side
+    std::vector<v4l2::CaptureMode> modes;
+    OutputFormatEnum output = DEFAULT_OUTPUT_FORMAT;
+    std::optional<unsigned> decode_scale;
+    try
+    {
+        GST_OBJECT_LOCK(self);
+        const bool open = self->camera != nullptr;
+        v4l2::V4l2Config probe_cfg;
+        probe_cfg.device_path_ = self->device_path;
+        output = self->output_format;
+        if (self->decode)
+        {
+            decode_scale = static_cast<unsigned>(self->decode_scale);
+        }
+        GST_OBJECT_UNLOCK(self);
+
+        if (auto cached = v4l2::V4L2Camera::cached_modes(probe_cfg.device_path_))
+        {
+            modes = std::move(*cached);
+        }
+        else if (!open)
+        {
+            v4l2::V4L2Camera probe(probe_cfg);
+            probe.open_device();
+            modes = probe.enumerate_modes();
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        GST_DEBUG_OBJECT(self, "cannot enumerate %s yet (%s), offering the template caps", self->device_path, ex.what());
+    }
+
+    GstCaps *caps = modes.empty() ? gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(basesrc)) : build_caps(modes, output, decode_scale);
+    if (filter)
+    {
+        GstCaps *filtered = gst_caps_intersect_full(filter, caps, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref(caps);
+        return filtered;
+    }
+
+    return caps;
+}
+
+// Describe the tightly packed planes convert_yuyv() writes, GStreamer pads rows to 4 bytes by default
+static void add_converted_video_meta(GstBuffer *buf, OutputFormatEnum output, v4l2::ConvertFormat target, guint w, guint h)
+{
+    const gsize luma = static_cast<gsize>(w) * h;
+    const gsize half = w / 2;
+    const gsize chroma_rows = (h + 1) / 2;
+    gsize offset[GST_VIDEO_MAX_PLANES] = {0};
+    gint stride[GST_VIDEO_MAX_PLANES] = {0};
+    guint planes = 1;
+    switch (target)
+    {
+    case v4l2::ConvertFormat::NV12:
+        planes = 2;
+        stride[0] = stride[1] = static_cast<gint>(w);
+        offset[1] = luma;
+        break;
+    case v4l2::ConvertFormat::I420:
+        planes = 3;
+        stride[0] = static_cast<gint>(w);
+        stride[1] = stride[2] = static_cast<gint>(half);
+        offset[1] = luma;
+        offset[2] = luma + half * chroma_rows;
+        break;
+    case v4l2::ConvertFormat::GRAY8:
+        stride[0] = static_cast<gint>(w);
+        break;
+    case v4l2::ConvertFormat::RGB:
+    case v4l2::ConvertFormat::BGR:
+        stride[0] = static_cast<gint>(w * 3);
+        break;
+    }
+    gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE, gst_video_format_from_string(raw_caps_format(output)),
+                                   w, h, planes, offset, stride);
+}
+
+// Convert a YUYV frame into a buffer from the negotiated downstream pool
+[[nodiscard]] static GstFlowReturn convert_frame(V4L2Src *self, const v4l2::FrameView &view, v4l2::ConvertFormat target,
+                                                 GstBuffer **converted)
+{
+    const gsize size = v4l2::converted_size(target, view.width, view.height);
+    GstBuffer *out = nullptr;
+    if (GstBufferPool *out_pool = gst_base_src_get_buffer_pool(GST_BASE_SRC(self)))
+    {
+        GstFlowReturn ret = gst_buffer_pool_acquire_buffer(out_pool, &out, nullptr);
+        gst_object_unref(out_pool);
+        if (ret != GST_FLOW_OK)
+        {
+            return ret;
+        }
+    }
+    else
+    {
+        out = gst_buffer_new_allocate(nullptr, size, nullptr);
+    }
+
+    GstMapInfo map;
+    if (!out || !gst_buffer_map(out, &map, GST_MAP_WRITE))
+    {
+        GST_ERROR_OBJECT(self, "cannot map an output buffer of %" G_GSIZE_FORMAT " bytes", size);
+        if (out)
+            gst_buffer_unref(out);
+        return GST_FLOW_ERROR;
+    }
+
+    try
+    {
+        v4l2::convert_yuyv(view, target, std::span<std::byte>(reinterpret_cast<std::byte *>(map.data), map.size));
+    }
+    catch (const std::exception &ex)
+    {
+        gst_buffer_unmap(out, &map);
+        gst_buffer_unref(out);
+        GST_ELEMENT_ERROR(self, STREAM, FORMAT, ("Failed to convert the frame"), ("%s", ex.what()));
+        return GST_FLOW_ERROR;
+    }
+    gst_buffer_unmap(out, &map);
+    gst_buffer_set_size(out, static_cast<gssize>(size));
+
+    add_converted_video_meta(out, self->output_format, target, view.width, view.height);
+    *converted = out;
+    return GST_FLOW_OK;
+}
+
+// Copy a driver buffer into one of the negotiated downstream pool, rows at the default stride
+[[nodiscard]] static GstFlowReturn copy_frame(V4L2Src *self, GstBuffer *frame, GstBuffer **copied)
+{
+    GstBuffer *out = nullptr;
+    GstBufferPool *out_pool = gst_base_src_get_buffer_pool(GST_BASE_SRC(self));
+    if (!out_pool)
+    {
+        GST_ERROR_OBJECT(self, "no downstream pool to copy frames into");
+        return GST_FLOW_ERROR;
+    }
+    GstFlowReturn ret = gst_buffer_pool_acquire_buffer(out_pool, &out, nullptr);
+    gst_object_unref(out_pool);
+    if (ret != GST_FLOW_OK)
+    {
+        return ret;
     }
-    else if (self->pixel_format == PixelFormatEnum::YUYV)
+
+    bool ok = false;
+    if (GST_VIDEO_INFO_FORMAT(&self->copy_info) != GST_VIDEO_FORMAT_UNKNOWN)
     {
-        caps = gst_caps_new_simple("video/x-raw",
-                                   "format", G_TYPE_STRING, "YUY2",
-                                   "width", G_TYPE_INT, w,
-                                   "height", G_TYPE_INT, h,
-                                   "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
-                                   nullptr);
+        // the source follows its video meta, the copy the default layout of the caps
+        GstVideoFrame src_frame;
+        GstVideoFrame dst_frame;
+        if (gst_video_frame_map(&src_frame, &self->copy_info, frame, GST_MAP_READ))
+        {
+            if (gst_video_frame_map(&dst_frame, &self->copy_info, out, GST_MAP_WRITE))
+            {
+                ok = gst_video_frame_copy(&dst_frame, &src_frame);
+                gst_video_frame_unmap(&dst_frame);
+            }
+            gst_video_frame_unmap(&src_frame);
+        }
     }
     else
     {
-        GST_ERROR("get_active_caps: invalid pixel format enum = %d", static_cast<int>(self->pixel_format));
-        return nullptr;
+        // compressed: the bytes as they are
+        const gsize size = gst_buffer_get_size(frame);
+        GstMapInfo map;
+        if (gst_buffer_get_size(out) >= size && gst_buffer_map(frame, &map, GST_MAP_READ))
+        {
+            ok = gst_buffer_fill(out, 0, map.data, size) == size;
+            gst_buffer_unmap(frame, &map);
+            gst_buffer_set_size(out, static_cast<gssize>(size));
+        }
+    }
+    if (!ok)
+    {
+        GST_ERROR_OBJECT(self, "cannot copy a frame of %" G_GSIZE_FORMAT " bytes", gst_buffer_get_size(frame));
+        gst_buffer_unref(out);
+        return GST_FLOW_ERROR;
     }
+    *copied = out;
+    return GST_FLOW_OK;
+}
 
-    // attempt to fixate
-    GstCaps *fixed = gst_caps_fixate(gst_caps_copy(caps));
-    gst_caps_unref(caps);
+// jpeg-policy gate: false if the frame must not go downstream
+[[nodiscard]] static bool jpeg_acceptable(V4L2Src *self, const v4l2::FrameView &view)
+{
+    if (!view.jpeg || self->jpeg_policy == JpegPolicyEnum::PASS)
+    {
+        return true;
+    }
+    auto const &info = *view.jpeg;
+    if (info.ok() && info.width == view.width && info.height == view.height)
+    {
+        return true;
+    }
+    GST_WARNING_OBJECT(self, "dropping corrupt MJPEG frame, sequence %u: scan status %u, %ux%u in a %ux%u stream",
+                       view.sequence, static_cast<guint>(info.status), info.width, info.height, view.width, view.height);
+    return false;
+}
 
-    if (!fixed || !gst_caps_is_fixed(fixed))
+// Copy of an MJPEG frame with the standard Huffman tables inserted, nullptr on failure
+[[nodiscard]] static GstBuffer *with_standard_dht(V4L2Src *self, const v4l2::FrameView &view)
+{
+    auto const &info = *view.jpeg;
+    GstBuffer *fixed = gst_buffer_new_allocate(nullptr, info.size + v4l2::standard_dht_segment().size(), nullptr);
+    GstMapInfo map;
+    if (!fixed || !gst_buffer_map(fixed, &map, GST_MAP_WRITE))
     {
-        GST_ERROR("get_active_caps: fixation failed or result is not fixed");
+        GST_ERROR_OBJECT(self, "cannot allocate a buffer for the DHT insertion");
         if (fixed)
-            gst_caps_unref(fixed);
+            gst_buffer_unref(fixed);
         return nullptr;
     }
-
+    try
+    {
+        (void)v4l2::insert_standard_dht(view.image, info, std::span<std::byte>(reinterpret_cast<std::byte *>(map.data), map.size));
+    }
+    catch (const std::exception &ex)
+    {
+        GST_ERROR_OBJECT(self, "DHT insertion failed: %s", ex.what());
+        gst_buffer_unmap(fixed, &map);
+        gst_buffer_unref(fixed);
+        return nullptr;
+    }
+    gst_buffer_unmap(fixed, &map);
     return fixed;
 }
 
-[[nodiscard]] std::optional<PixelFormatEnum> to_pixel_format(gint value)
+// Running time of now, GST_CLOCK_TIME_NONE outside a playing pipeline
+[[nodiscard]] static GstClockTime running_time_now(V4L2Src *self)
 {
-    switch (static_cast<PixelFormatEnum>(value))
+    GstClock *clock = gst_element_get_clock(GST_ELEMENT(self));
+    if (!clock)
     {
-    case PixelFormatEnum::MJPG:
-        return PixelFormatEnum::MJPG;
-    case PixelFormatEnum::YUYV:
-        return PixelFormatEnum::YUYV;
-    default:
-        fmt::print(stderr, "invalid pixel format value: {}\n", value);
-        return std::nullopt;
+        return GST_CLOCK_TIME_NONE;
     }
+    const GstClockTime now = gst_clock_get_time(clock);
+    gst_object_unref(clock);
+    const GstClockTime base_time = gst_element_get_base_time(GST_ELEMENT(self));
+    return now > base_time ? now - base_time : 0;
 }
 
-[[nodiscard]] std::optional<FPSEnum> to_fps_enum(gint value)
+// 🔌 reconnect=true and the device is gone: wait for it to come back, the pipeline keeps running.
+// The wait is cut into frame periods, so unlock() is seen soon and GAP events can keep downstream moving
+[[nodiscard]] static GstFlowReturn reconnect_camera(V4L2Src *self)
 {
-    switch (static_cast<FPSEnum>(value))
+    auto *pool = GST_V4L2_BUFFER_POOL(self->pool);
+    auto const &active = self->camera->config();
+    const GstClockTime period = ns_per_frame(active.fps_num_, active.fps_den_);
+    const GstClockTime slice = GST_CLOCK_TIME_IS_VALID(period) ? period : 100 * GST_MSECOND;
+    const gint64 lost_us = g_get_monotonic_time();
+    GST_WARNING_OBJECT(self, "device %s lost, waiting for it to come back", self->device_path);
+
+    // its ring goes back to the driver that is no more, it starts again on the new buffers
+    if (pool->capture)
     {
-    case FPSEnum::FPS_15:
-        return FPSEnum::FPS_15;
-    case FPSEnum::FPS_30:
-        return FPSEnum::FPS_30;
-    case FPSEnum::FPS_60:
-        return FPSEnum::FPS_60;
-    default:
-        fmt::print(stderr, "invalid fps enum: {}\n", value);
-        return std::nullopt;
+        pool->capture->stop();
     }
-}
 
-static gboolean _v4l2src_start(GstBaseSrc *basesrc)
-{
-    auto *self = get_instance<V4L2Src>(G_OBJECT(basesrc)); // for GstBaseSrc*
-    v4l2::V4l2Config cfg;
-    cfg.device_path_ = self->device_path;
-    auto maybe_fmt = to_pixel_format(static_cast<gint>(self->pixel_format));
-    if (!maybe_fmt)
+    while (true)
     {
-        fmt::print(stderr, "ERROR: pixel format enum conversion failed: {}\n", static_cast<int>(self->pixel_format));
-        GST_ERROR_OBJECT(self, "invalid pixel format: %d", static_cast<int>(self->pixel_format));
-        return FALSE;
+        if (GST_BUFFER_POOL_IS_FLUSHING(self->pool))
+        {
+            return GST_FLOW_FLUSHING;
+        }
+        const auto waited_ms = static_cast<std::uint64_t>(g_get_monotonic_time() - lost_us) / 1000;
+        if (self->reconnect_timeout_ms > 0 && waited_ms >= self->reconnect_timeout_ms)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, NOT_FOUND, ("Device %s did not come back", self->device_path),
+                              ("waited %u ms for it to reappear", self->reconnect_timeout_ms));
+            return GST_FLOW_ERROR;
+        }
+
+        try
+        {
+            // buffers still downstream point into the old mappings, they come back as downstream drops them:
+            // wait on the camera's release notification for up to a period, unlock() cuts it short
+            const auto slice_us = std::chrono::microseconds(static_cast<std::int64_t>(slice / GST_USECOND));
+            if (self->camera->outstanding_frames() > 0)
+            {
+                if (self->camera->wait_for_all_released(slice_us))
+                {
+                    continue; // reconnect right away, no period went by
+                }
+            }
+            else if (self->camera->reconnect(slice_us))
+            {
+                break;
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to reconnect %s", self->device_path), ("%s", ex.what()));
+            return GST_FLOW_ERROR;
+        }
+
+        // ⏳ tell downstream nothing is coming for this period, only once a segment is out
+        const GstClockTime now = running_time_now(self);
+        if (self->reconnect_gaps && self->pushed_frames > 0 && GST_CLOCK_TIME_IS_VALID(now))
+        {
+            gst_pad_push_event(GST_BASE_SRC_PAD(self), gst_event_new_gap(now, slice));
+        }
     }
-    cfg.format_ = *maybe_fmt;
-    cfg.dimension_ = static_cast<ResolutionEnum>(self->resolution);
-    auto maybe_fps = to_fps_enum(static_cast<gint>(self->fps));
-    if (!maybe_fps)
+
+    v4l2_buffer_pool_remap(pool);
+    list_modes(self, true); // a replugged camera may list other modes
+    publish_latency(self); // the camera may have come back with another rate
+    if (pool->capture)
     {
-        GST_ERROR_OBJECT(self, "invalid FPS enum: %d", static_cast<int>(self->fps));
-        return FALSE;
+        try
+        {
+            pool->capture->start();
+        }
+        catch (const std::exception &ex)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to restart the capture thread"), ("%s", ex.what()));
+            return GST_FLOW_ERROR;
+        }
     }
-    cfg.fps_num_ = *maybe_fps;
 
-    cfg.buffer_count_ = self->buffer_count;
-
-    auto [width, height] = v4l2::dimensions_decompress(static_cast<uint32_t>(cfg.dimension_));
-    fmt::print("DEBUG: Starting _v4l2src with:\n"
-               "  device_path: {}\n"
-               "  pixel_format: {} ({:08X})\n"
-               "  resolution: {}x{}\n"
-               "  fps: {}\n"
-               "  buffer_count: {}\n",
-               cfg.device_path_,
-               static_cast<uint32_t>(cfg.format_), static_cast<uint32_t>(cfg.format_),
-               width, height,
-               static_cast<uint32_t>(cfg.fps_num_),
-               cfg.buffer_count_);
-
-    self->camera = std::make_unique<v4l2::V4L2Camera>(cfg);
+    // the driver sequence starts over: offsets carry on past the frames the outage cost
+    const auto outage = static_cast<GstClockTime>(g_get_monotonic_time() - lost_us) * GST_USECOND;
+    self->frame_number += 1 + (GST_CLOCK_TIME_IS_VALID(period) ? outage / period : 0);
+    self->have_sequence = false;
+    self->discont = true;
+    self->controls_pending.store(true, std::memory_order_release); // a camera that reset forgot them
+    GST_INFO_OBJECT(self, "device %s is back after %" GST_TIME_FORMAT, self->device_path, GST_TIME_ARGS(outage));
+    return GST_FLOW_OK;
+}
 
+// ⏳ until downstream gave back every buffer it holds, blocked on the camera's release notification;
+// unlock() interrupts it through the pool flush, capture-timeout bounds it
+[[nodiscard]] static GstFlowReturn wait_for_leases(V4L2Src *self)
+{
+    const auto timeout = std::chrono::microseconds(
+        self->capture_timeout_ms == 0 ? -1 : static_cast<std::int64_t>(self->capture_timeout_ms) * 1000);
     try
     {
-        self->camera->open_device();
-        self->camera->configure();
-        self->camera->start_streaming();
+        if (self->camera->wait_for_all_released(timeout))
+        {
+            return GST_FLOW_OK;
+        }
     }
     catch (const std::exception &ex)
     {
-        GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to start camera"), ("%s", ex.what()));
-        self->camera.reset();
-
-        return FALSE;
+        GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to wait for the buffers of %s", self->device_path), ("%s", ex.what()));
+        return GST_FLOW_ERROR;
+    }
+    if (GST_BUFFER_POOL_IS_FLUSHING(self->pool))
+    {
+        return GST_FLOW_FLUSHING;
     }
+    GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Downstream did not return the buffers of %s", self->device_path),
+                      ("%u still held after %u ms, they cannot be reallocated under it", self->camera->outstanding_frames(),
+                       self->capture_timeout_ms));
+    return GST_FLOW_ERROR;
+}
 
-    self->frame_number = 0;
+// 🔀 the input changed its resolution: move the driver queue over to the new mode and renegotiate caps,
+// same pool and capture thread, the first buffer in the new mode is DISCONT
+[[nodiscard]] static GstFlowReturn renegotiate_camera(V4L2Src *self)
+{
+    auto *pool = GST_V4L2_BUFFER_POOL(self->pool);
+    if (pool->capture)
+    {
+        pool->capture->stop();
+    }
 
-    // ✅ NO CAPS SETTING HERE.
-    // let negotiate() figure it out like a grown up
-    if (!gst_base_src_negotiate(GST_BASE_SRC(self)))
+    // buffers still downstream are in the old format and point into the old mappings
+    if (auto const ret = wait_for_leases(self); ret != GST_FLOW_OK)
     {
-        GST_ERROR_OBJECT(self, "negotiation failed");
-        return FALSE;
+        return ret;
     }
 
-    return TRUE;
-}
+    try
+    {
+        self->camera->renegotiate();
+    }
+    catch (const std::exception &ex)
+    {
+        GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, ("Failed to follow the source change of %s", self->device_path), ("%s", ex.what()));
+        return GST_FLOW_ERROR;
+    }
 
-static gboolean _v4l2src_stop(GstBaseSrc *basesrc)
-{
-    auto *self = get_instance<V4L2Src>(G_OBJECT(basesrc));
-    fmt::print(stderr, "🛑 _v4l2src_stop() called — cleanup engaged\n");
+    auto const &active = self->camera->config();
+    auto const [width, height] = v4l2::dimensions_decompress(static_cast<uint32_t>(active.dimension_));
+    v4l2_buffer_pool_resize(pool, to_gst_video_format(active.format_), width, height);
+    list_modes(self, true); // the new input may offer other modes, caps follow
+    publish_latency(self);
 
-    if (self->camera)
+    // 📡 slots sized for the old mode would refuse every frame of a bigger one: a new ring under the same name,
+    // readers attached to the old one keep it and have to attach again
+    if (auto const slot_size = shm_slot_size(self); self->shm_ring && slot_size > self->shm_ring->config().slot_size_)
     {
+        self->shm_ring.reset(); // unlinks the name first
         try
         {
-            self->camera->stop_streaming();
+            self->shm_ring = make_shm_ring(self, slot_size);
+            GST_INFO_OBJECT(self, "publishing frames to %s again, %u slots of %zu bytes", self->shm_name, self->shm_slots, slot_size);
         }
         catch (const std::exception &ex)
         {
-            fmt::print(stderr, "💥 stop_streaming threw: {}\n", ex.what());
+            GST_ELEMENT_WARNING(self, RESOURCE, OPEN_WRITE, ("Stopped publishing frames to %s", self->shm_name),
+                                ("the ring for %zu byte frames cannot be created: %s", slot_size, ex.what()));
+        }
+    }
+    if (pool->capture)
+    {
+        try
+        {
+            pool->capture->start();
+        }
+        catch (const std::exception &ex)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, FAILED, ("Failed to restart the capture thread"), ("%s", ex.what()));
+            return GST_FLOW_ERROR;
         }
-
-        self->camera.reset(); // 🧹 clear it for real
     }
 
-    return TRUE;
+    // get_active_caps() reads the camera config, the active pool keeps its buffers
+    if (!gst_base_src_negotiate(GST_BASE_SRC(self)))
+    {
+        GST_ELEMENT_ERROR(self, CORE, NEGOTIATION, ("Downstream refused %ux%u after the source change", width, height), (nullptr));
+        return GST_FLOW_NOT_NEGOTIATED;
+    }
+    self->have_sequence = false; // STREAMON started the driver sequence over
+    self->discont = true;
+    GST_INFO_OBJECT(self, "source of %s changed, now %ux%u", self->device_path, width, height);
+    return GST_FLOW_OK;
 }
 
-static GstCaps *build_caps()
+// Dequeue the next frame jpeg-policy lets through: the pool hands out the pre-built GstBuffer of that
+// driver buffer and re-queues it once the buffer is dropped
+[[nodiscard]] static GstFlowReturn acquire_frame(V4L2Src *self, GstBuffer **captured, v4l2::FrameView *view)
 {
-    GstCaps *caps = gst_caps_new_empty();
-
-    for (auto format : {PixelFormatEnum::MJPG, PixelFormatEnum::YUYV})
+    GstBuffer *buf = nullptr;
+    const v4l2::FrameView *frame = nullptr;
+    while (true)
     {
-        for (auto res : {ResolutionEnum::DIM_HD, ResolutionEnum::DIM_FHD, ResolutionEnum::DIM_2K, ResolutionEnum::DIM_4K})
+        GstFlowReturn ret = gst_buffer_pool_acquire_buffer(self->pool, &buf, nullptr);
+        if (ret == GST_FLOW_ERROR && self->reconnect && self->camera->device_lost())
+        {
+            if (ret = reconnect_camera(self); ret != GST_FLOW_OK)
+            {
+                return ret;
+            }
+            continue;
+        }
+        if (ret == GST_FLOW_ERROR && self->camera->source_changed())
         {
-            for (auto fps : {FPSEnum::FPS_15, FPSEnum::FPS_30, FPSEnum::FPS_60})
+            if (ret = renegotiate_camera(self); ret != GST_FLOW_OK)
             {
-                const auto [w, h] = v4l2::dimensions_decompress(static_cast<uint32_t>(res));
-                gint fpsn = static_cast<gint>(fps), fpsd = 1;
+                return ret;
+            }
+            continue;
+        }
+        if (ret == GST_FLOW_ERROR)
+        {
+            GST_ELEMENT_ERROR(self, RESOURCE, READ, ("Failed to capture a frame"),
+                              ("device %s failed or delivered nothing within %u ms", self->device_path, self->capture_timeout_ms));
+            return ret;
+        }
+        if (ret != GST_FLOW_OK)
+        {
+            GST_DEBUG_OBJECT(self, "pool acquire returned %s", gst_flow_get_name(ret));
+            return ret;
+        }
 
-                GstStructure *s = nullptr;
+        frame = v4l2_buffer_pool_get_frame(GST_V4L2_BUFFER_POOL(self->pool), buf);
+        if (!frame)
+        {
+            GST_ERROR_OBJECT(self, "pool returned a buffer without frame metadata");
+            gst_buffer_unref(buf);
+            return GST_FLOW_ERROR;
+        }
+        if (jpeg_acceptable(self, *frame))
+        {
+            break;
+        }
+        gst_buffer_unref(buf); // 🗑 straight back to the driver, the decoder never sees it
+    }
 
-                if (format == PixelFormatEnum::MJPG)
-                {
-                    s = gst_structure_new("image/jpeg",
-                                          // must match static pad: name + type + value
-                                          "memory", G_TYPE_STRING, "NVMM",
-                                          "width", G_TYPE_INT, w,
-                                          "height", G_TYPE_INT, h,
-                                          "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
-                                          nullptr);
-                }
-                else
-                {
-                    s = gst_structure_new("video/x-raw",
-                                          "format", G_TYPE_STRING, "YUY2",
-                                          "width", G_TYPE_INT, w,
-                                          "height", G_TYPE_INT, h,
-                                          "framerate", GST_TYPE_FRACTION, fpsn, fpsd,
-                                          nullptr);
-                }
+    // 🔐 sanity check: driver gave us trash bytesused, more than the buffer it filled can hold
+    auto const capacity = v4l2_buffer_pool_get_capacity(GST_V4L2_BUFFER_POOL(self->pool), buf);
+    if (frame->image.empty() || frame->image.size_bytes() > capacity)
+    {
+        GST_ERROR_OBJECT(self, "invalid image size from V4L2 driver: %zu bytes in a %" G_GSIZE_FORMAT " byte buffer",
+                         frame->image.size_bytes(), capacity);
+        gst_buffer_unref(buf);
+        return GST_FLOW_ERROR;
+    }
 
-                gst_caps_append_structure(caps, s);
-            }
-        }
+    GST_TRACE_OBJECT(self, "valid image captured: %ux%u @ %zu bytes", frame->width, frame->height, frame->image.size_bytes());
+
+    // 📡 one copy into shared memory, readers that fall behind lose frames, we never wait for them
+    if (self->shm_ring && !self->shm_ring->publish(*frame))
+    {
+        GST_WARNING_OBJECT(self, "frame of %zu bytes does not fit the shared memory slots", frame->image.size_bytes());
     }
 
-    return caps;
+    *view = *frame;
+    *captured = buf;
+    return GST_FLOW_OK;
 }
 
-// Convert our FourCC enum into a GstVideoFormat for gst_buffer_add_video_meta()
-static GstVideoFormat to_gst_video_format(PixelFormatEnum fmt)
+namespace
 {
-    switch (fmt)
+    // GstBuffer user data of a decoded image: the slot goes back to the decoder when downstream drops the buffer
+    struct DecodedHold
     {
-    case PixelFormatEnum::YUYV:
-        return GST_VIDEO_FORMAT_YUY2;
-    case PixelFormatEnum::MJPG:
-        // MJPEG isn’t raw planar—if you really want metadata you'll
-        // need to decode first. But GStreamer does define an MJPEG enum:
-        return GST_VIDEO_FORMAT_I420;
-    default:
-        return GST_VIDEO_FORMAT_UNKNOWN;
+        std::shared_ptr<v4l2::MjpegDecoder> decoder; // declared first, so it outlives the frame below
+        v4l2::DecodedFrame frame;
+    };
+} // namespace
+
+// Next decoded frame in capture order, wrapped without a copy; `view` gets the source frame metadata
+[[nodiscard]] static GstFlowReturn decode_next(V4L2Src *self, GstBuffer **decoded, v4l2::FrameView *view)
+{
+    auto &decoder = *self->decoder;
+    auto const &active = self->camera->config();
+    auto const [w, h] = v4l2::dimensions_decompress(static_cast<uint32_t>(active.dimension_));
+    auto const [out_w, out_h] = v4l2::MjpegDecoder::scaled_size(w, h, decoder.config().scale_denom_);
+    const auto timeout = std::chrono::microseconds(
+        self->capture_timeout_ms == 0 ? -1 : static_cast<std::int64_t>(self->capture_timeout_ms) * 1000);
+
+    while (true)
+    {
+        // 🧩 keep one frame per worker in flight, the driver buffer goes back as soon as its bytes are copied
+        while (decoder.pending() < decoder.config().threads_)
+        {
+            GstBuffer *captured = nullptr;
+            v4l2::FrameView frame{};
+            if (GstFlowReturn ret = acquire_frame(self, &captured, &frame); ret != GST_FLOW_OK)
+            {
+                return ret;
+            }
+            decoder.submit(frame);
+            gst_buffer_unref(captured);
+        }
+
+        auto result = decoder.pop(timeout);
+        if (!result)
+        {
+            GST_ELEMENT_ERROR(self, STREAM, DECODE, ("MJPEG decoder stalled"),
+                              ("no decoded frame within %u ms, is downstream holding every output buffer?", self->capture_timeout_ms));
+            return GST_FLOW_ERROR;
+        }
+        auto const &image = (*result)->image;
+        if (image.empty() || (*result)->width != out_w || (*result)->height != out_h)
+        {
+            // the next pushed buffer shows the gap as DISCONT
+            GST_WARNING_OBJECT(self, "dropping undecodable MJPEG frame, sequence %u: %ux%u in a %ux%u stream",
+                               (*result)->sequence, (*result)->width, (*result)->height, out_w, out_h);
+            continue;
+        }
+
+        *view = v4l2::FrameView{};
+        view->timestamp_monotonic_us = (*result)->timestamp_monotonic_us;
+        view->v4l2_timestamp_us = (*result)->v4l2_timestamp_us;
+        view->width = (*result)->width;
+        view->height = (*result)->height;
+        view->sequence = (*result)->sequence;
+        view->flags = (*result)->flags;
+        view->error = (*result)->error;
+
+        gsize offset[GST_VIDEO_MAX_PLANES] = {0};
+        gint stride[GST_VIDEO_MAX_PLANES] = {0};
+        for (std::size_t plane = 0; plane < 3; ++plane)
+        {
+            offset[plane] = (*result)->offset[plane];
+            stride[plane] = static_cast<gint>((*result)->stride[plane]);
+        }
+        auto *data = const_cast<std::byte *>(image.data());
+        const gsize size = image.size();
+        auto *hold = new DecodedHold{self->decoder, std::move(*result)};
+        GstBuffer *buf = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, data, size, 0, size, hold,
+                                                     [](gpointer user_data)
+                                                     { delete static_cast<DecodedHold *>(user_data); });
+        gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE, GST_VIDEO_FORMAT_I420, out_w, out_h, 3,
+                                       offset, stride);
+        *decoded = buf;
+        return GST_FLOW_OK;
     }
 }
 
-static GstCaps *_v4l2src_get_caps([[maybe_unused]] GstBaseSrc *basesrc, GstCaps *filter)
+// Running time of the capture instant. The driver stamps CLOCK_MONOTONIC, the pipeline clock may be any clock:
+// measure how long ago the frame was stamped on the monotonic clock and go back that far on the pipeline clock
+[[nodiscard]] GstClockTime running_time_pts(GstElement *self, const v4l2::FrameView &view)
 {
-    static GstCaps *caps_cache = build_caps(); // build once, never again
+    GstClock *clock = gst_element_get_clock(self);
+    if (!clock)
+    {
+        return GST_CLOCK_TIME_NONE; // not in a playing pipeline yet
+    }
+    const GstClockTime base_time = gst_element_get_base_time(self);
+    const GstClockTime now = gst_clock_get_time(clock);
+    gst_object_unref(clock);
+
+    // the DQBUF time is always monotonic, the driver timestamp only when its flags say so
+    const bool driver_monotonic = (view.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    const std::uint64_t stamped_us = driver_monotonic ? view.v4l2_timestamp_us : view.timestamp_monotonic_us;
+    const auto now_us = static_cast<std::uint64_t>(g_get_monotonic_time());
+    GstClockTime age = now_us > stamped_us ? (now_us - stamped_us) * GST_USECOND : 0;
+    if (age > GST_SECOND)
+    {
+        GST_DEBUG_OBJECT(self, "frame %u stamped %" GST_TIME_FORMAT " ago, not trusting the driver clock",
+                         view.sequence, GST_TIME_ARGS(age));
+        age = 0;
+    }
 
-    if (filter)
+    if (now < base_time + age)
     {
-        return gst_caps_intersect_full(
-            gst_caps_ref(filter),
-            gst_caps_ref(caps_cache),
-            GST_CAPS_INTERSECT_FIRST);
+        return 0; // captured before the pipeline started running
     }
+    return now - base_time - age;
+}
 
-    return gst_caps_ref(caps_cache);
+// 📊 the path alone is not unique: two pipelines may each hold an element of the same name
+[[nodiscard]] gchar *metrics_key(GstObject *object)
+{
+    gchar *path = gst_object_get_path_string(object);
+    gchar *key = g_strdup_printf("%s@%p", path, static_cast<void *>(object));
+    g_free(path);
+    return key;
 }
 
 static GstFlowReturn _v4l2src_create(GstPushSrc *push, GstBuffer **outbuf)
 {
     auto *self = get_instance<V4L2Src>(G_OBJECT(push));
-    fmt::print(stderr, "🟡 ENTER: _v4l2src_create()\n");
+    GST_TRACE_OBJECT(self, "create");
 
-    // 1) dequeue a frame (records last_buf_index_ in the camera)
-    v4l2::FrameView view{};
-    try
+    // 🎛 between two frames, on the streaming thread: one S_EXT_CTRLS for whatever changed since the last one
+    if (self->controls_pending.load(std::memory_order_acquire))
     {
-        view = self->camera->capture_frame();
+        apply_controls(self);
     }
-    catch (const std::exception &e)
+
+    // 1) a driver buffer as-is, or a decoded image when decode=true
+    GstBuffer *buf = nullptr;
+    v4l2::FrameView view{};
+    GstFlowReturn ret = self->decoder ? decode_next(self, &buf, &view) : acquire_frame(self, &buf, &view);
+    if (ret != GST_FLOW_OK)
     {
-        GST_ERROR_OBJECT(self, "capture_frame failed: %s", e.what());
-        return GST_FLOW_ERROR;
+        return ret;
     }
 
-    // 🔐 sanity check: driver gave us trash bytesused
-    if (view.image.empty() || view.image.size_bytes() > 16 * 1024 * 1024)
+    // start() rules out output-format with decode, and decoded views carry no jpeg scan
+    if (auto const target = to_convert_format(self->output_format))
     {
-        fmt::print(stderr, "💩 invalid image from capture_frame. size={} bytes\n", view.image.size_bytes());
-        GST_ERROR_OBJECT(self, "invalid image size from V4L2 driver: %zu", view.image.size_bytes());
-        return GST_FLOW_ERROR;
+        GstBuffer *converted = nullptr;
+        if (GstFlowReturn conv = convert_frame(self, view, *target, &converted); conv != GST_FLOW_OK)
+        {
+            gst_buffer_unref(buf);
+            return conv;
+        }
+        gst_buffer_unref(buf); // 🔁 the driver buffer goes straight back to the queue
+        buf = converted;
     }
-
-    fmt::print(stderr, "📦 valid image captured: {}x{} @ {} bytes\n",
-               view.width, view.height, view.image.size_bytes());
-
-    auto *ptr = const_cast<std::byte *>(view.image.data());
-    auto size = view.image.size_bytes();
-
-    // 2) wrap that mmap’d pointer in a GstBuffer.
-    //    We pass the raw camera pointer as user_data, and in destroy
-    //    we call release_frame() to re-queue it back to V4L2.
-    GstBuffer *buf = gst_buffer_new_wrapped_full(
-        GST_MEMORY_FLAG_READONLY,
-        static_cast<gpointer>(ptr), size,
-        0, size,
-        self->camera.get(),
-        [](gpointer user_data)
+    else if (self->jpeg_policy == JpegPolicyEnum::FIX && view.jpeg && !view.jpeg->has_dht)
+    {
+        GstBuffer *fixed = with_standard_dht(self, view);
+        if (!fixed)
         {
-            try
-            {
-                auto *cam = static_cast<v4l2::V4L2Camera *>(user_data);
-                if (cam->has_valid_frame())
-                {
-                    fmt::print(stderr, "🔁 requeuing buffer back to camera\n");
-                    cam->release_frame();
-                }
-                else
-                {
-                    fmt::print(stderr, "⚠️ no valid buffer to release\n");
-                }
-            }
-            catch (const std::exception &e)
-            {
-                fmt::print(stderr, "❌ release_frame EXCEPTION: {}\n", e.what());
-            }
-            catch (...)
-            {
-                fmt::print(stderr, "💥 unknown exception in release_frame\n");
-            }
-        });
+            gst_buffer_unref(buf);
+            return GST_FLOW_ERROR;
+        }
+        gst_buffer_unref(buf);
+        buf = fixed;
+    }
+    else if (self->copy_frames && !self->decoder)
+    {
+        GstBuffer *copied = nullptr;
+        if (GstFlowReturn copy = copy_frame(self, buf, &copied); copy != GST_FLOW_OK)
+        {
+            gst_buffer_unref(buf);
+            return copy;
+        }
+        gst_buffer_unref(buf); // 🔁 the driver buffer goes straight back to the queue
+        buf = copied;
+    }
 
-    GstClockTime dur = ns_per_frame(self->fps);
+    auto const &active = self->camera->config();
+    GstClockTime dur = ns_per_frame(active.fps_num_, active.fps_den_);
     GST_BUFFER_DURATION(buf) = dur;
+    GST_BUFFER_PTS(buf) = running_time_pts(GST_ELEMENT(self), view);
+
+    // 🔢 offsets follow the driver sequence, so a jump is visible downstream
+    std::uint32_t skipped = 0;
+    if (self->have_sequence)
+    {
+        const std::uint32_t delta = view.sequence - self->last_sequence; // wraps like the driver counter
+        skipped = delta - 1;
+        self->frame_number += delta;
+    }
+    self->last_sequence = view.sequence;
+    self->have_sequence = true;
     GST_BUFFER_OFFSET(buf) = self->frame_number;
     GST_BUFFER_OFFSET_END(buf) = self->frame_number + 1;
-    self->frame_number++;
-    GST_BUFFER_PTS(buf) = view.v4l2_timestamp_us * 1000; // 💡 nsec
+    self->pushed_frames++;
+
+    if (skipped > 0)
+    {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DISCONT);
+
+        // 📉 QoS: tell the application how many frames never made it out of the camera
+        auto const stats = self->camera->stats();
+        GST_WARNING_OBJECT(self, "sequence gap: %u frame(s) missing before sequence %u", skipped, view.sequence);
+        GstMessage *qos = gst_message_new_qos(GST_OBJECT(self), TRUE, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE,
+                                              GST_BUFFER_PTS(buf), dur * skipped);
+        const std::uint64_t rejected = self->jpeg_policy == JpegPolicyEnum::PASS ? 0 : stats.corrupt_frames;
+        gst_message_set_qos_stats(qos, GST_FORMAT_BUFFERS, self->pushed_frames,
+                                  stats.lost_frames + stats.dropped_frames + rejected);
+        gst_element_post_message(GST_ELEMENT(self), qos);
+    }
+    if (self->discont)
+    {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DISCONT); // 🔌 first frame after a reconnect or a source change
+        self->discont = false;
+    }
+    if (view.error)
+    {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_CORRUPTED);
+    }
+    if (view.frame_sync_us != 0)
+    {
+        // 📸 when the sensor started the frame, ahead of the buffer stamp; the pool's reset drops the meta again
+        static GstStaticCaps frame_sync_caps = GST_STATIC_CAPS("timestamp/x-v4l2-frame-sync");
+        GstCaps *reference = gst_static_caps_get(&frame_sync_caps);
+        gst_buffer_add_reference_timestamp_meta(buf, reference, view.frame_sync_us * GST_USECOND, GST_CLOCK_TIME_NONE);
+        gst_caps_unref(reference);
+    }
 
-    fmt::print(stderr, "🟢 pushing buffer: pts={} dur={} offset={}\n",
-               GST_BUFFER_PTS(buf), dur, GST_BUFFER_OFFSET(buf));
+    GST_LOG_OBJECT(self, "pushing buffer: pts %" GST_TIME_FORMAT " dur %" GST_TIME_FORMAT " offset %" G_GUINT64_FORMAT,
+                   GST_TIME_ARGS(GST_BUFFER_PTS(buf)), GST_TIME_ARGS(dur), GST_BUFFER_OFFSET(buf));
 
-    // If downstream expects video metadata, attach it now:
-    GstVideoFormat vf = to_gst_video_format(self->pixel_format);
-    if (vf != GST_VIDEO_FORMAT_UNKNOWN && vf != GST_VIDEO_FORMAT_I420)
+    // 📊 in-process latency accounting, no probes on the pads
+    self->camera->record_handoff(view);
+    if (self->stats_interval_ms > 0)
     {
-        gst_buffer_add_video_meta(
-            buf,
-            GST_VIDEO_FRAME_FLAG_NONE,
-            vf,
-            view.width,
-            view.height);
+        const auto now_us = static_cast<std::uint64_t>(g_get_monotonic_time());
+        if (now_us - self->last_stats_us >= std::uint64_t{self->stats_interval_ms} * 1000)
+        {
+            self->last_stats_us = now_us;
+            gst_element_post_message(GST_ELEMENT(self),
+                                     gst_message_new_element(GST_OBJECT(self), build_stats(self->camera.get())));
+        }
     }
+
     *outbuf = buf;
     return GST_FLOW_OK;
 }
@@ -608,8 +2706,21 @@ static void _v4l2src_finalize(GObject *object)
 {
     auto *self = get_instance<V4L2Src>(G_OBJECT(object));
     g_free(self->device_path);
+    g_free(self->shm_name);
+    g_free(self->crop);
+    g_free(self->metrics_address);
+    g_free(self->metrics_name);
+    if (self->extra_controls)
+    {
+        gst_structure_free(self->extra_controls);
+    }
+    std::destroy_at(&self->metrics_exporter);
+    std::destroy_at(&self->shm_ring);
+    std::destroy_at(&self->decoder);
+    std::destroy_at(&self->camera);
+    std::destroy_at(&self->controls_pending);
+
     G_OBJECT_CLASS(_v4l2src_parent_class)->finalize(object);
-    self->camera.reset();
 }
 
 gboolean plugin_init(GstPlugin *p)
@@ -618,7 +2729,8 @@ gboolean plugin_init(GstPlugin *p)
     g_setenv("GST_REGISTRY_UPDATE", "no", TRUE);
     g_setenv("GST_REGISTRY_FORK", "no", TRUE);
 
-    return gst_element_register(p, "v4l2-src", GST_RANK_NONE, GST_TYPE_V4L2SRC);
+    return gst_element_register(p, "v4l2-src", GST_RANK_NONE, GST_TYPE_V4L2SRC) &&
+           gst_element_register(p, "v4l2-batch-src", GST_RANK_NONE, GST_TYPE_V4L2_BATCH_SRC);
 }
 
 GST_PLUGIN_DEFINE(
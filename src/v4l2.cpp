@@ -1,15 +1,27 @@
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cerrno>
 #include <cstring>
 #include <ctime> // For clock_gettime
 #include <fcntl.h>
+#include <filesystem>
 #include <fmt/core.h>
 #include <linux/videodev2.h>
+#include <mutex>
+#include <poll.h>
 #include <stdexcept>
 #include <string_view>
-#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/mman.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
 
+#include "v4l2/jpeg.hpp"
+#include "v4l2/replay_backend.hpp"
+#include "v4l2/trace.hpp"
 #include "v4l2/v4l2.hpp"
 
 #ifndef V4L2_CID_TIMESTAMP_SOURCE
@@ -23,79 +35,251 @@
 
 namespace v4l2
 {
+    [[nodiscard]] static constexpr v4l2_memory to_v4l2_memory(MemoryMode mode) noexcept
+    {
+        return mode == MemoryMode::DMABUF_IMPORT ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_MMAP;
+    }
+
+    // Same clock as FrameView::timestamp_monotonic_us
+    [[nodiscard]] static std::uint64_t monotonic_now_us() noexcept
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    FrameLease::FrameLease(V4L2Camera *camera, std::uint32_t index, const FrameView &view) noexcept
+        : camera_(camera),
+          index_(index),
+          view_(view)
+    {
+    }
+
+    FrameLease::~FrameLease() noexcept
+    {
+        try
+        {
+            release();
+        }
+        catch (const std::exception &e)
+        {
+            V4L2_TRACE(WARN, "failed to re-queue leased buffer {}: {}", index_, e.what());
+        }
+    }
+
+    FrameLease::FrameLease(FrameLease &&other) noexcept
+        : camera_(std::exchange(other.camera_, nullptr)),
+          index_(other.index_),
+          view_(other.view_)
+    {
+    }
+
+    FrameLease &FrameLease::operator=(FrameLease &&other) noexcept
+    {
+        if (this != &other)
+        {
+            try
+            {
+                release();
+            }
+            catch (const std::exception &e)
+            {
+                V4L2_TRACE(WARN, "failed to re-queue leased buffer {}: {}", index_, e.what());
+            }
+            camera_ = std::exchange(other.camera_, nullptr);
+            index_ = other.index_;
+            view_ = other.view_;
+        }
+        return *this;
+    }
+
+    void FrameLease::release()
+    {
+        if (auto *camera = std::exchange(camera_, nullptr))
+        {
+            camera->release_frame(index_, view_.timestamp_monotonic_us);
+        }
+    }
+
     V4L2Camera::V4L2Camera(const V4l2Config &config)
         : config_(config),
-          fd_(-1),
+          wake_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+          free_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
           configured_(false),
-          last_buf_index_(std::nullopt),
+          bytes_per_line_(0),
+          buf_type_(V4L2_BUF_TYPE_VIDEO_CAPTURE),
+          memory_planes_(1),
+          plane_count_(1),
+          outstanding_(0),
+          dropped_frames_(0),
+          sequence_gaps_(0),
+          lost_frames_(0),
+          errored_buffers_(0),
+          corrupt_frames_(0),
+          reconnects_(0),
+          renegotiations_(0),
+          lost_(false),
+          source_changed_(false),
+          draining_(false),
+          last_sequence_{},
+          opened_us_(0),
+          first_frame_us_(0),
+          latency_(std::make_unique<LatencyHistograms>()),
+          metrics_(std::make_shared<CameraMetrics>(config_.device_path_)),
+          controls_{},
           buffers_(config_.buffer_count_),
           caps_{}
     {
+        if (wake_fd_ < 0 || free_fd_ < 0)
+        {
+            auto const msg = fmt::format("eventfd failed: {}", strerror(errno));
+            if (wake_fd_ >= 0)
+            {
+                close(wake_fd_);
+            }
+            if (free_fd_ >= 0)
+            {
+                close(free_fd_);
+            }
+            throw std::runtime_error(msg);
+        }
     }
 
     V4L2Camera::~V4L2Camera() noexcept
     {
         cleanup();
+        if (wake_fd_ >= 0)
+        {
+            close(wake_fd_);
+        }
+        if (free_fd_ >= 0)
+        {
+            close(free_fd_);
+        }
     }
 
     V4L2Camera::V4L2Camera(V4L2Camera &&other) noexcept
         : config_(std::move(other.config_)),
-          fd_(other.fd_),
-          last_buf_index_(std::move(other.last_buf_index_)),
+          backend_(std::move(other.backend_)),
+          wake_fd_(std::exchange(other.wake_fd_, -1)),
+          free_fd_(std::exchange(other.free_fd_, -1)),
+          configured_(std::exchange(other.configured_, false)),
+          bytes_per_line_(std::exchange(other.bytes_per_line_, 0)),
+          buf_type_(other.buf_type_),
+          memory_planes_(other.memory_planes_),
+          layout_(other.layout_),
+          plane_count_(other.plane_count_),
+          outstanding_(other.outstanding_.exchange(0)),
+          dropped_frames_(other.dropped_frames_.exchange(0)),
+          sequence_gaps_(other.sequence_gaps_.exchange(0)),
+          lost_frames_(other.lost_frames_.exchange(0)),
+          errored_buffers_(other.errored_buffers_.exchange(0)),
+          corrupt_frames_(other.corrupt_frames_.exchange(0)),
+          reconnects_(other.reconnects_.exchange(0)),
+          renegotiations_(other.renegotiations_.exchange(0)),
+          lost_(other.lost_.exchange(false)),
+          source_changed_(other.source_changed_.exchange(false)),
+          draining_(false),
+          subscriptions_(std::move(other.subscriptions_)),
+          on_event_(std::move(other.on_event_)),
+          frame_syncs_(other.frame_syncs_),
+          last_sequence_(std::exchange(other.last_sequence_, std::nullopt)),
+          opened_us_(other.opened_us_.exchange(0)),
+          first_frame_us_(other.first_frame_us_.exchange(0)),
+          cache_key_(std::move(other.cache_key_)),
+          cached_(std::exchange(other.cached_, std::nullopt)),
+          latency_(std::move(other.latency_)),
+          metrics_(std::move(other.metrics_)),
+          controls_(std::move(other.controls_)),
+          buffers_(std::move(other.buffers_)),
           caps_(std::move(other.caps_))
     {
-        for (std::size_t i = 0; i < config_.buffer_count_; ++i)
-        {
-            buffers_[i] = other.buffers_[i];
-        }
-        other.fd_ = -1;
+        // a FrameLease points at the camera it came from, one still out would be left with the moved-from shell
+        assert(outstanding_.load() == 0 && "V4L2Camera moved with frames leased out");
     }
 
     V4L2Camera &V4L2Camera::operator=(V4L2Camera &&other) noexcept
     {
         if (this != &other)
         {
+            // leases of either camera would be left pointing at the wrong one, see the move constructor
+            assert(outstanding_.load() == 0 && other.outstanding_.load() == 0 && "V4L2Camera moved with frames leased out");
             cleanup();
             config_ = std::move(other.config_);
-            fd_ = other.fd_;
-            last_buf_index_ = std::move(other.last_buf_index_);
-            caps_ = std::move(other.caps_);
-            for (std::size_t i = 0; i < config_.buffer_count_; ++i)
+            backend_ = std::move(other.backend_);
+            if (wake_fd_ >= 0)
+            {
+                close(wake_fd_);
+            }
+            wake_fd_ = std::exchange(other.wake_fd_, -1);
+            if (free_fd_ >= 0)
             {
-                buffers_[i] = other.buffers_[i];
+                close(free_fd_);
             }
-            other.fd_ = -1;
+            free_fd_ = std::exchange(other.free_fd_, -1);
+            configured_ = std::exchange(other.configured_, false);
+            bytes_per_line_ = std::exchange(other.bytes_per_line_, 0);
+            buf_type_ = other.buf_type_;
+            memory_planes_ = other.memory_planes_;
+            layout_ = other.layout_;
+            plane_count_ = other.plane_count_;
+            outstanding_ = other.outstanding_.exchange(0);
+            dropped_frames_ = other.dropped_frames_.exchange(0);
+            sequence_gaps_ = other.sequence_gaps_.exchange(0);
+            lost_frames_ = other.lost_frames_.exchange(0);
+            errored_buffers_ = other.errored_buffers_.exchange(0);
+            corrupt_frames_ = other.corrupt_frames_.exchange(0);
+            reconnects_ = other.reconnects_.exchange(0);
+            renegotiations_ = other.renegotiations_.exchange(0);
+            lost_ = other.lost_.exchange(false);
+            source_changed_ = other.source_changed_.exchange(false);
+            subscriptions_ = std::move(other.subscriptions_);
+            on_event_ = std::move(other.on_event_);
+            frame_syncs_ = other.frame_syncs_;
+            last_sequence_ = std::exchange(other.last_sequence_, std::nullopt);
+            opened_us_ = other.opened_us_.exchange(0);
+            first_frame_us_ = other.first_frame_us_.exchange(0);
+            cache_key_ = std::move(other.cache_key_);
+            cached_ = std::exchange(other.cached_, std::nullopt);
+            latency_ = std::move(other.latency_);
+            metrics_ = std::move(other.metrics_);
+            controls_ = std::move(other.controls_);
+            buffers_ = std::move(other.buffers_);
+            caps_ = std::move(other.caps_);
         }
         return *this;
     }
 
     void V4L2Camera::open_device()
     {
-        fd_ = open(config_.device_path_.c_str(), O_RDWR);
-        if (fd_ < 0)
-        {
-            if (errno == EBUSY)
-            {
-                fmt::print(stderr, "device already in use: {}\n", config_.device_path_);
-            }
-            auto const msg = fmt::format("Failed to open device: {}\n", strerror(errno));
-            throw std::runtime_error(msg);
-        }
+        opened_us_.store(monotonic_now_us(), std::memory_order_relaxed);
+        first_frame_us_.store(0, std::memory_order_relaxed);
+        backend_ = open_backend(config_.device_path_);
 
         v4l2_capability cap{};
-        if (ioctl(fd_, VIDIOC_QUERYCAP, &cap) < 0)
+        if (backend_->ioctl(VIDIOC_QUERYCAP, &cap) < 0)
         {
             auto const msg = fmt::format("VIDIOC_QUERYCAP failed: {}\n", strerror(errno));
             throw std::runtime_error(msg);
         }
 
-        if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE))
+        // what this node does, not everything the driver behind it does
+        const std::uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+        if (caps & V4L2_CAP_VIDEO_CAPTURE)
+        {
+            buf_type_ = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        }
+        else if (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE)
+        {
+            // 🧅 MIPI CSI receivers and ISPs: same capture, a v4l2_plane array in every buffer ioctl
+            buf_type_ = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        }
+        else
         {
             auto const msg = fmt::format("Device does not support video capture\n");
             throw std::runtime_error(msg);
         }
 
-        if (!(cap.capabilities & V4L2_CAP_STREAMING))
+        if (!(caps & V4L2_CAP_STREAMING))
         {
             auto const msg = fmt::format("Device doesn't support streaming I/O\n");
             throw std::runtime_error(msg);
@@ -103,19 +287,43 @@ namespace v4l2
 
         caps_ = V4lCaps{
             .driver = std::string(reinterpret_cast<const char *>(cap.driver), strnlen(reinterpret_cast<const char *>(cap.driver), sizeof(cap.driver))),
-            .card = std::string(reinterpret_cast<const char *>(cap.card), strnlen(reinterpret_cast<const char *>(cap.card), sizeof(cap.card)))};
+            .card = std::string(reinterpret_cast<const char *>(cap.card), strnlen(reinterpret_cast<const char *>(cap.card), sizeof(cap.card))),
+            .bus_info = std::string(reinterpret_cast<const char *>(cap.bus_info), strnlen(reinterpret_cast<const char *>(cap.bus_info), sizeof(cap.bus_info)))};
+
+        if (!config_.cache_dir_.empty())
+        {
+            cache_key_ = negotiation_key(caps_, config_.device_path_);
+            cached_ = load_negotiation(config_.cache_dir_, cache_key_);
+            V4L2_TRACE(DEBUG, "negotiation cache {} for {}", cached_ ? "hit" : "miss", cache_key_);
+        }
+
+        enumerate_controls();
+
+        // 📬 a new fd has no subscriptions, whatever subscribe_event() asked for comes back with it
+        for (auto const &[type, id] : subscriptions_)
+        {
+            if (!subscribe(type, id))
+            {
+                V4L2_TRACE(WARN, "{} no longer offers event {}: {}", config_.device_path_, static_cast<std::uint32_t>(type), strerror(errno));
+            }
+        }
     }
 
     [[nodiscard]] bool V4L2Camera::try_soe() noexcept
     {
+        if (!backend_)
+        {
+            return false; // not open, or a reconnect that failed left no device
+        }
+
         v4l2_queryctrl qctrl{};
         qctrl.id = V4L2_CID_TIMESTAMP_SOURCE;
-        if (ioctl(fd_, VIDIOC_QUERYCTRL, &qctrl) == 0)
+        if (backend_->ioctl(VIDIOC_QUERYCTRL, &qctrl) == 0)
         {
             v4l2_control ctrl{};
             ctrl.id = V4L2_CID_TIMESTAMP_SOURCE;
             ctrl.value = V4L2_TIMESTAMP_SRC_SOE;
-            if (ioctl(fd_, VIDIOC_S_CTRL, &ctrl) == 0)
+            if (backend_->ioctl(VIDIOC_S_CTRL, &ctrl) == 0)
             {
                 return true;
             }
@@ -124,6 +332,169 @@ namespace v4l2
         return false;
     }
 
+    // 🎛 once per open: set_controls() clamps from this map instead of asking the driver every frame
+    void V4L2Camera::enumerate_controls()
+    {
+        controls_.clear();
+        v4l2_query_ext_ctrl query{};
+        query.id = V4L2_CTRL_FLAG_NEXT_CTRL;
+        while (backend_->ioctl(VIDIOC_QUERY_EXT_CTRL, &query) == 0)
+        {
+            const bool scalar = (query.flags & V4L2_CTRL_FLAG_HAS_PAYLOAD) == 0 && query.type != V4L2_CTRL_TYPE_CTRL_CLASS;
+            if (scalar && (query.flags & V4L2_CTRL_FLAG_DISABLED) == 0)
+            {
+                controls_.push_back(ControlInfo{
+                    .id = query.id,
+                    .name = std::string(query.name, strnlen(query.name, sizeof(query.name))),
+                    .type = query.type,
+                    .minimum = query.minimum,
+                    .maximum = query.maximum,
+                    .step = query.step,
+                    .default_value = query.default_value,
+                    .flags = query.flags,
+                });
+            }
+            query.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
+        }
+        // NEXT_CTRL walks by id already, sorted anyway so find_control() holds for any backend
+        std::sort(controls_.begin(), controls_.end(), [](const ControlInfo &a, const ControlInfo &b) { return a.id < b.id; });
+        V4L2_TRACE(DEBUG, "{} has {} controls", config_.device_path_, controls_.size());
+    }
+
+    [[nodiscard]] const std::vector<ControlInfo> &V4L2Camera::controls() const noexcept
+    {
+        return controls_;
+    }
+
+    [[nodiscard]] const ControlInfo *V4L2Camera::find_control(std::uint32_t id) const noexcept
+    {
+        auto const it = std::lower_bound(controls_.begin(), controls_.end(), id,
+                                         [](const ControlInfo &control, std::uint32_t wanted) { return control.id < wanted; });
+        return it != controls_.end() && it->id == id ? &*it : nullptr;
+    }
+
+    // 🎚 into the control's range, on its step grid counted from the minimum
+    [[nodiscard]] static std::int64_t clamp_control(const ControlInfo &control, std::int64_t value) noexcept
+    {
+        value = std::clamp(value, control.minimum, control.maximum);
+        if (control.step > 1 && (control.type == V4L2_CTRL_TYPE_INTEGER || control.type == V4L2_CTRL_TYPE_INTEGER64))
+        {
+            auto const step = static_cast<std::int64_t>(control.step);
+            auto const offset = value - control.minimum;
+            value = control.minimum + (offset + step / 2) / step * step;
+            if (value > control.maximum)
+            {
+                value -= step;
+            }
+        }
+        return value;
+    }
+
+    void V4L2Camera::set_controls(std::span<const ControlValue> values)
+    {
+        if (values.empty())
+        {
+            return;
+        }
+        if (!backend_)
+        {
+            throw std::runtime_error("set_controls: device is not open");
+        }
+
+        std::vector<v4l2_ext_control> batch(values.size());
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            const ControlInfo *control = find_control(values[i].id);
+            if (!control)
+            {
+                throw std::invalid_argument(fmt::format("{} has no control {:#x}", config_.device_path_, values[i].id));
+            }
+            if (control->flags & V4L2_CTRL_FLAG_READ_ONLY)
+            {
+                throw std::invalid_argument(fmt::format("control '{}' is read-only", control->name));
+            }
+            batch[i].id = control->id;
+            auto const value = clamp_control(*control, values[i].value);
+            if (control->type == V4L2_CTRL_TYPE_INTEGER64)
+            {
+                batch[i].value64 = value;
+            }
+            else
+            {
+                batch[i].value = static_cast<std::int32_t>(value);
+            }
+        }
+
+        v4l2_ext_controls ext{};
+        ext.which = V4L2_CTRL_WHICH_CUR_VAL;
+        ext.count = static_cast<std::uint32_t>(batch.size());
+        ext.controls = batch.data();
+        if (backend_->ioctl(VIDIOC_S_EXT_CTRLS, &ext) < 0)
+        {
+            // error_idx == count: refused before any control was touched
+            const int err = errno;
+            const ControlInfo *failed = ext.error_idx < batch.size() ? find_control(batch[ext.error_idx].id) : nullptr;
+            throw std::runtime_error(fmt::format("VIDIOC_S_EXT_CTRLS failed{}{}: {}", failed ? " on " : "",
+                                                 failed ? failed->name : std::string{}, strerror(err)));
+        }
+    }
+
+    [[nodiscard]] std::vector<ControlValue> V4L2Camera::get_controls(std::span<const std::uint32_t> ids)
+    {
+        if (!backend_)
+        {
+            throw std::runtime_error("get_controls: device is not open");
+        }
+
+        std::vector<v4l2_ext_control> batch(ids.size());
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+            if (!find_control(ids[i]))
+            {
+                throw std::invalid_argument(fmt::format("{} has no control {:#x}", config_.device_path_, ids[i]));
+            }
+            batch[i].id = ids[i];
+        }
+
+        v4l2_ext_controls ext{};
+        ext.which = V4L2_CTRL_WHICH_CUR_VAL;
+        ext.count = static_cast<std::uint32_t>(batch.size());
+        ext.controls = batch.data();
+        if (!ids.empty() && backend_->ioctl(VIDIOC_G_EXT_CTRLS, &ext) < 0)
+        {
+            throw std::runtime_error(fmt::format("VIDIOC_G_EXT_CTRLS failed: {}", strerror(errno)));
+        }
+
+        std::vector<ControlValue> values;
+        values.reserve(batch.size());
+        for (auto const &entry : batch)
+        {
+            const bool wide = find_control(entry.id)->type == V4L2_CTRL_TYPE_INTEGER64;
+            values.push_back(ControlValue{.id = entry.id, .value = wide ? entry.value64 : entry.value});
+        }
+        return values;
+    }
+
+    static_assert(static_cast<std::uint32_t>(PixelFormat::NV12) == V4L2_PIX_FMT_NV12);
+    static_assert(static_cast<std::uint32_t>(PixelFormat::NV16) == V4L2_PIX_FMT_NV16);
+    static_assert(static_cast<std::uint32_t>(PixelFormat::NV12M) == V4L2_PIX_FMT_NV12M);
+    static_assert(static_cast<std::uint32_t>(PixelFormat::NV16M) == V4L2_PIX_FMT_NV16M);
+
+    [[nodiscard]] static constexpr bool is_supported_format(PixelFormat format) noexcept
+    {
+        switch (format)
+        {
+        case PixelFormat::MJPG:
+        case PixelFormat::YUYV:
+        case PixelFormat::NV12:
+        case PixelFormat::NV16:
+        case PixelFormat::NV12M:
+        case PixelFormat::NV16M:
+            return true;
+        }
+        return false;
+    }
+
     [[nodiscard]] constexpr std::string_view fourcc_str(std::uint32_t fourcc)
     {
         static thread_local char str[5];
@@ -135,241 +506,1329 @@ namespace v4l2
         return str;
     }
 
+    // ✂️ the selection API, the legacy crop ioctls for VIDIOC_S_SELECTION-less drivers; returns what the driver set
+    [[nodiscard]] static Rect set_selection(CaptureBackend &backend, std::uint32_t target, const Rect &wanted)
+    {
+        v4l2_selection sel{};
+        sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE; // the selection API takes the single-planar type for _MPLANE queues too
+        sel.target = target;
+        sel.r = v4l2_rect{.left = wanted.left, .top = wanted.top, .width = wanted.width, .height = wanted.height};
+        if (backend.ioctl(VIDIOC_S_SELECTION, &sel) == 0)
+        {
+            return Rect{.left = sel.r.left, .top = sel.r.top, .width = sel.r.width, .height = sel.r.height};
+        }
+
+        const char *what = target == V4L2_SEL_TGT_CROP ? "crop" : "compose";
+        if ((errno != ENOTTY && errno != EINVAL) || target != V4L2_SEL_TGT_CROP)
+        {
+            throw std::runtime_error(fmt::format("VIDIOC_S_SELECTION ({}) failed: {}", what, strerror(errno)));
+        }
+
+        v4l2_crop crop{};
+        crop.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        crop.c = sel.r;
+        if (backend.ioctl(VIDIOC_S_CROP, &crop) < 0)
+        {
+            throw std::runtime_error(fmt::format("driver cannot crop, VIDIOC_S_SELECTION and VIDIOC_S_CROP failed: {}", strerror(errno)));
+        }
+        // S_CROP is write-only, the driver's rounding shows in G_CROP
+        if (backend.ioctl(VIDIOC_G_CROP, &crop) < 0)
+        {
+            return wanted;
+        }
+        return Rect{.left = crop.c.left, .top = crop.c.top, .width = crop.c.width, .height = crop.c.height};
+    }
+
     void V4L2Camera::configure()
     {
-        if (fd_ < 0 || configured_)
+        if (!backend_ || configured_)
         {
             return;
         }
 
         const auto [width, height] = dimensions_decompress(static_cast<std::uint32_t>(config_.dimension_));
+        const PixelDimension requested_dimension = config_.dimension_;
+        const FrameRate requested_rate{static_cast<std::uint32_t>(config_.fps_num_), config_.fps_den_};
 
         // ✍️ validate format up front
         const std::uint32_t requested_fourcc = static_cast<std::uint32_t>(config_.format_);
-        if (requested_fourcc != V4L2_PIX_FMT_MJPEG && requested_fourcc != V4L2_PIX_FMT_YUYV)
+        if (!is_supported_format(config_.format_))
         {
             throw std::invalid_argument(fmt::format("Unsupported pixel format: fourcc={:08X}", requested_fourcc));
         }
 
+        if ((config_.crop_ && config_.crop_->empty()) || (config_.compose_ && config_.compose_->empty()))
+        {
+            throw std::invalid_argument("crop and compose rectangles need a width and a height");
+        }
+
         v4l2_format fmt{};
-        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        fmt.fmt.pix.width = width;
-        fmt.fmt.pix.height = height;
-        fmt.fmt.pix.pixelformat = requested_fourcc;
-        fmt.fmt.pix.field = V4L2_FIELD_NONE;
-        fmt.fmt.pix.bytesperline = 0;
-        fmt.fmt.pix.sizeimage = 0;
-        fmt.fmt.pix.colorspace = V4L2_COLORSPACE_JPEG;
+        fmt.type = buf_type_;
+        if (multiplanar())
+        {
+            fmt.fmt.pix_mp.width = width;
+            fmt.fmt.pix_mp.height = height;
+            fmt.fmt.pix_mp.pixelformat = requested_fourcc;
+            fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+            fmt.fmt.pix_mp.colorspace = V4L2_COLORSPACE_JPEG;
+            fmt.fmt.pix_mp.num_planes = static_cast<std::uint8_t>(memory_planes(config_.format_));
+        }
+        else
+        {
+            fmt.fmt.pix.width = width;
+            fmt.fmt.pix.height = height;
+            fmt.fmt.pix.pixelformat = requested_fourcc;
+            fmt.fmt.pix.field = V4L2_FIELD_NONE;
+            fmt.fmt.pix.bytesperline = 0;
+            fmt.fmt.pix.sizeimage = 0;
+            fmt.fmt.pix.colorspace = V4L2_COLORSPACE_JPEG;
+        }
 
-        if (ioctl(fd_, VIDIOC_S_FMT, &fmt) < 0)
+        if (backend_->ioctl(VIDIOC_S_FMT, &fmt) < 0)
         {
             if (errno == EBUSY)
             {
-                fmt::print(stderr, "device busy during VIDIOC_S_FMT: {}\n", config_.device_path_);
+                V4L2_TRACE(WARN, "device busy during VIDIOC_S_FMT: {}", config_.device_path_);
             }
             throw std::runtime_error(fmt::format("VIDIOC_S_FMT failed: {}", strerror(errno)));
         }
+        const FormatInfo negotiated = format_info(fmt);
 
         // 🧠 validate driver didn't mess us
-        if (fmt.fmt.pix.pixelformat != requested_fourcc)
+        if (negotiated.fourcc != requested_fourcc)
         {
             throw std::runtime_error(fmt::format(
                 "driver rejected pixel format: requested '{}', got '{}'",
-                fourcc_str(requested_fourcc),
-                fourcc_str(fmt.fmt.pix.pixelformat)));
+                std::string(fourcc_str(requested_fourcc)),
+                std::string(fourcc_str(negotiated.fourcc)))); // both copied, fourcc_str() reuses its buffer
         }
-        fmt::print("NEGOTIATED PIXEL FORMAT: {}\n", fourcc_str(fmt.fmt.pix.pixelformat));
+        V4L2_TRACE(INFO, "negotiated pixel format: {}", fourcc_str(negotiated.fourcc));
 
         // update config with the confirmed format
-        config_.format_ = static_cast<PixelFormat>(fmt.fmt.pix.pixelformat);
+        config_.format_ = static_cast<PixelFormat>(negotiated.fourcc);
 
-        // 🛠 verify format actually got set
-        v4l2_format check_fmt{};
-        check_fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        if (ioctl(fd_, VIDIOC_G_FMT, &check_fmt) < 0)
+        // after S_FMT: the format size stays, crop and compose set the scaling, the driver may still round the size
+        if (config_.crop_)
+        {
+            config_.crop_ = set_selection(*backend_, V4L2_SEL_TGT_CROP, *config_.crop_);
+            V4L2_TRACE(INFO, "sensor crop {}x{} at {},{}", config_.crop_->width, config_.crop_->height, config_.crop_->left, config_.crop_->top);
+        }
+        if (config_.compose_)
         {
-            throw std::runtime_error("VIDIOC_G_FMT failed after format negotiation");
+            config_.compose_ = set_selection(*backend_, V4L2_SEL_TGT_COMPOSE, *config_.compose_);
         }
 
-        if (check_fmt.fmt.pix.pixelformat != static_cast<std::uint32_t>(config_.format_))
+        // 💾 same request, same camera, and S_FMT answered what it did last time: the G_FMT round trip can go
+        const bool cache_hit = cached_ && !config_.crop_ && !config_.compose_ &&
+                               cached_->requested_format == static_cast<PixelFormat>(requested_fourcc) &&
+                               cached_->requested_dimension == requested_dimension && cached_->requested_rate == requested_rate &&
+                               cached_->format == config_.format_ &&
+                               cached_->dimension == to_dimension(negotiated.width, negotiated.height) &&
+                               cached_->bytes_per_line == negotiated.bytes_per_line[0];
+        FormatInfo active = negotiated;
+        if (!cache_hit)
         {
-            throw std::runtime_error(fmt::format(
-                "driver format mismatch: got '{}', expected '{}'",
-                fourcc_str(check_fmt.fmt.pix.pixelformat),
-                fourcc_str(static_cast<std::uint32_t>(config_.format_))));
+            // 🛠 verify format actually got set
+            v4l2_format check_fmt{};
+            check_fmt.type = buf_type_;
+            if (backend_->ioctl(VIDIOC_G_FMT, &check_fmt) < 0)
+            {
+                throw std::runtime_error("VIDIOC_G_FMT failed after format negotiation");
+            }
+            active = format_info(check_fmt);
+
+            if (active.fourcc != static_cast<std::uint32_t>(config_.format_))
+            {
+                throw std::runtime_error(fmt::format(
+                    "driver format mismatch: got '{}', expected '{}'",
+                    std::string(fourcc_str(active.fourcc)),
+                    std::string(fourcc_str(static_cast<std::uint32_t>(config_.format_)))));
+            }
         }
+        // the driver may round the size to what it has
+        config_.dimension_ = to_dimension(active.width, active.height);
+        bytes_per_line_ = active.bytes_per_line[0];
+        set_layout(active);
 
-        // 🐢 fix FPS assignment: denominator should be FPS
+        // 🐢 time per frame is the inverse of the rate: fps_den_ / fps_num_
         v4l2_streamparm parm{};
-        parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        parm.parm.capture.timeperframe.numerator = 1;
+        parm.type = buf_type_;
+        parm.parm.capture.timeperframe.numerator = config_.fps_den_;
         parm.parm.capture.timeperframe.denominator = static_cast<std::uint32_t>(config_.fps_num_);
 
-        if (ioctl(fd_, VIDIOC_S_PARM, &parm) < 0)
+        if (backend_->ioctl(VIDIOC_S_PARM, &parm) < 0)
         {
             throw std::runtime_error(fmt::format("VIDIOC_S_PARM failed: {}", strerror(errno)));
         }
 
-        // 🧽 request MMAP buffers
+        // and may pick the nearest interval it supports
+        if (auto const &tpf = parm.parm.capture.timeperframe; tpf.numerator != 0 && tpf.denominator != 0)
+        {
+            config_.fps_num_ = static_cast<FPS>(tpf.denominator);
+            config_.fps_den_ = tpf.numerator;
+        }
+
+        if (!cache_key_.empty())
+        {
+            const NegotiationRecord record{
+                .requested_format = static_cast<PixelFormat>(requested_fourcc),
+                .requested_dimension = requested_dimension,
+                .requested_rate = requested_rate,
+                .format = config_.format_,
+                .dimension = config_.dimension_,
+                .bytes_per_line = bytes_per_line_,
+                .rate = FrameRate{static_cast<std::uint32_t>(config_.fps_num_), config_.fps_den_},
+                .modes = cached_ ? std::move(cached_->modes) : std::vector<CaptureMode>{},
+            };
+            const bool changed = !cache_hit || cached_->rate != record.rate;
+            cached_ = record;
+            if (changed)
+            {
+                store_cache();
+            }
+        }
+
+        // 🧽 request driver buffers (or announce the caller's dmabufs)
+        const bool importing = config_.memory_ == MemoryMode::DMABUF_IMPORT;
+        if (importing && config_.dmabuf_fds_.size() < config_.buffer_count_)
+        {
+            throw std::invalid_argument(fmt::format("DMABUF_IMPORT needs {} dmabuf fds, got {}",
+                                                    config_.buffer_count_, config_.dmabuf_fds_.size()));
+        }
+        if (importing && memory_planes_ > 1)
+        {
+            throw std::invalid_argument(fmt::format("DMABUF_IMPORT takes one dmabuf per buffer, '{}' needs {}",
+                                                    fourcc_str(requested_fourcc), memory_planes_));
+        }
+
         v4l2_requestbuffers req{};
         req.count = config_.buffer_count_;
-        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        req.memory = V4L2_MEMORY_MMAP;
+        req.type = buf_type_;
+        req.memory = to_v4l2_memory(config_.memory_);
 
-        if (ioctl(fd_, VIDIOC_REQBUFS, &req) < 0)
+        if (backend_->ioctl(VIDIOC_REQBUFS, &req) < 0)
         {
             throw std::runtime_error(fmt::format("VIDIOC_REQBUFS failed: {}", strerror(errno)));
         }
 
         // map buffers
-        for (std::size_t i = 0; i < config_.buffer_count_; ++i)
+        for (std::uint32_t i = 0; i < config_.buffer_count_; ++i)
         {
-            v4l2_buffer buf{};
-            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            if (importing)
+            {
+                // the caller owns the dmabuf, we only map it for the CPU view
+                const int dmabuf_fd = config_.dmabuf_fds_[i];
+                const off_t length = lseek(dmabuf_fd, 0, SEEK_END);
+                if (length <= 0)
+                {
+                    throw std::runtime_error(fmt::format("cannot size dmabuf fd {} at index {}: {}", dmabuf_fd, i, strerror(errno)));
+                }
+
+                void *mapped = mmap(nullptr, static_cast<std::size_t>(length), PROT_READ, MAP_SHARED, dmabuf_fd, 0);
+                if (mapped == MAP_FAILED)
+                {
+                    throw std::runtime_error(fmt::format("dmabuf mmap failed at index {}: {}", i, strerror(errno)));
+                }
+
+                buffers_[i].data = static_cast<std::byte *>(mapped);
+                buffers_[i].size = static_cast<std::size_t>(length);
+                buffers_[i].dmabuf_fd = dmabuf_fd;
+                continue;
+            }
+
+            std::array<v4l2_plane, VIDEO_MAX_PLANES> planes{};
+            v4l2_buffer buf = make_buffer(planes);
             buf.memory = V4L2_MEMORY_MMAP;
             buf.index = i;
 
-            if (ioctl(fd_, VIDIOC_QUERYBUF, &buf) < 0)
+            if (backend_->ioctl(VIDIOC_QUERYBUF, &buf) < 0)
             {
                 throw std::runtime_error(fmt::format("VIDIOC_QUERYBUF failed for index {}: {}", i, strerror(errno)));
             }
 
-            void *mapped = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, buf.m.offset);
-            if (mapped == MAP_FAILED)
+            // 🧅 one mapping (and one exported dmabuf) per memory plane, a single one without the multi-planar API
+            buffers_[i].plane_count = memory_planes_;
+            for (std::uint32_t p = 0; p < memory_planes_; ++p)
             {
-                throw std::runtime_error(fmt::format("mmap failed at index {}: {}", i, strerror(errno)));
-            }
+                const std::uint32_t length = multiplanar() ? planes[p].length : buf.length;
+                const std::uint32_t offset = multiplanar() ? planes[p].m.mem_offset : buf.m.offset;
+                void *mapped = backend_->map(length, PROT_READ | PROT_WRITE, offset);
+                if (mapped == MAP_FAILED)
+                {
+                    throw std::runtime_error(fmt::format("mmap failed at index {} plane {}: {}", i, p, strerror(errno)));
+                }
+
+                int dmabuf_fd = -1;
+                if (config_.memory_ == MemoryMode::DMABUF_EXPORT)
+                {
+                    v4l2_exportbuffer expbuf{};
+                    expbuf.type = buf_type_;
+                    expbuf.index = i;
+                    expbuf.plane = p;
+                    expbuf.flags = O_CLOEXEC | O_RDONLY;
+
+                    if (backend_->ioctl(VIDIOC_EXPBUF, &expbuf) < 0)
+                    {
+                        munmap(mapped, length);
+                        throw std::runtime_error(fmt::format("VIDIOC_EXPBUF failed at index {} plane {}: {}", i, p, strerror(errno)));
+                    }
+                    dmabuf_fd = expbuf.fd;
+                }
 
-            buffers_[i].data = static_cast<std::byte *>(mapped);
-            buffers_[i].size = buf.length;
+                const MappedPlane plane{.data = static_cast<std::byte *>(mapped), .size = length, .dmabuf_fd = dmabuf_fd};
+                if (p == 0)
+                {
+                    buffers_[i].data = plane.data;
+                    buffers_[i].size = plane.size;
+                    buffers_[i].dmabuf_fd = plane.dmabuf_fd;
+                }
+                else
+                {
+                    buffers_[i].more_planes[p - 1] = plane;
+                }
+            }
         }
 
         // enqueue
-        for (std::size_t i = 0; i < config_.buffer_count_; ++i)
+        for (std::uint32_t i = 0; i < config_.buffer_count_; ++i)
         {
-            v4l2_buffer buf{};
-            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            buf.memory = V4L2_MEMORY_MMAP;
-            buf.index = i;
-
-            if (ioctl(fd_, VIDIOC_QBUF, &buf) < 0)
-            {
-                throw std::runtime_error(fmt::format("VIDIOC_QBUF failed at index {}: {}", i, strerror(errno)));
-            }
+            queue_buffer(i);
         }
 
+        dropped_frames_.store(0, std::memory_order_relaxed);
+        sequence_gaps_.store(0, std::memory_order_relaxed);
+        lost_frames_.store(0, std::memory_order_relaxed);
+        errored_buffers_.store(0, std::memory_order_relaxed);
+        corrupt_frames_.store(0, std::memory_order_relaxed);
+        latency_->driver_to_dqbuf.reset();
+        latency_->dqbuf_to_handoff.reset();
+        latency_->dqbuf_to_qbuf.reset();
+        metrics_->set_buffers(config_.buffer_count_,
+                              static_cast<double>(config_.fps_num_) / static_cast<double>(std::max(config_.fps_den_, 1u)));
         configured_ = true;
     }
 
     void V4L2Camera::start_streaming()
     {
-        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        if (ioctl(fd_, VIDIOC_STREAMON, &type) < 0)
+        auto type = static_cast<v4l2_buf_type>(buf_type_);
+        if (backend_->ioctl(VIDIOC_STREAMON, &type) < 0)
         {
             throw std::runtime_error("VIDIOC_STREAMON failed");
         }
+        last_sequence_.reset(); // the driver restarts its sequence at STREAMON
+        frame_syncs_.fill(FrameSync{});
     }
 
-    [[nodiscard]] FrameView V4L2Camera::capture_frame()
+    [[nodiscard]] FrameLease V4L2Camera::capture_frame()
     {
-        v4l2_buffer buf{};
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
+        auto lease = try_capture_frame(std::chrono::microseconds{-1});
+        if (!lease)
+        {
+            throw std::runtime_error("capture interrupted");
+        }
+        return std::move(*lease);
+    }
 
-        if (ioctl(fd_, VIDIOC_DQBUF, &buf) < 0)
+    [[nodiscard]] std::optional<FrameLease> V4L2Camera::try_capture_frame(std::chrono::microseconds timeout)
+    {
+        if (outstanding_.load(std::memory_order_acquire) >= buffers_.size())
+        {
+            throw std::runtime_error(fmt::format("all {} buffers are leased, release a frame first", buffers_.size()));
+        }
+        if (source_changed_.load(std::memory_order_acquire))
         {
-            throw std::runtime_error("VIDIOC_DQBUF failed");
+            throw std::runtime_error(fmt::format("source of {} changed, renegotiate() first", config_.device_path_));
         }
 
-        if (buf.index >= buffers_.size())
+        // a frame may already be waiting, skip the poll() syscall then; its frame sync came before it
+        drain_events();
+        if (auto lease = dequeue_frame())
         {
-            throw std::runtime_error(fmt::format("DQBUF returned invalid buffer index: {}", buf.index));
+            return keep_latest(std::move(*lease));
         }
 
-        last_buf_index_ = buf.index;
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true)
+        {
+            std::array<pollfd, 2> fds{{{.fd = backend_->fd(), .events = POLLIN | POLLPRI, .revents = 0},
+                                       {.fd = wake_fd_, .events = POLLIN, .revents = 0}}};
 
-        // parse format & dimensions
-        const auto &mapped = buffers_[buf.index];
-        auto const [width, height] = dimensions_decompress(static_cast<uint32_t>(config_.dimension_));
-        // Get the driver-provided timestamp in microseconds.
-        const std::uint64_t v4l2_ts_us =
-            static_cast<std::uint64_t>(buf.timestamp.tv_sec) * 1'000'000ULL + buf.timestamp.tv_usec;
-        // Get current host monotonic time.
-        // const std::uint64_t now_monotonic_us = get_monotonic_time_us();
-        std::uint64_t const now_monotonic_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-
-        return FrameView{
-            .timestamp_monotonic_us = now_monotonic_us,
-            .v4l2_timestamp_us = v4l2_ts_us,
-            .image = std::span<std::byte const>(mapped.data, buf.bytesused),
-            .width = width,
-            .height = height,
-            .format = config_.format_,
-        };
+            timespec ts{};
+            timespec *ts_ptr = nullptr;
+            if (timeout.count() >= 0)
+            {
+                auto const left = std::max(std::chrono::nanoseconds{0}, deadline - std::chrono::steady_clock::now());
+                ts.tv_sec = left.count() / 1'000'000'000;
+                ts.tv_nsec = left.count() % 1'000'000'000;
+                ts_ptr = &ts;
+            }
+
+            const int ready = ppoll(fds.data(), fds.size(), ts_ptr, nullptr);
+            if (ready < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error(fmt::format("poll on {} failed: {}", config_.device_path_, strerror(errno)));
+            }
+            if (ready == 0)
+            {
+                return std::nullopt; // ⏱ timed out
+            }
+            if (fds[1].revents & POLLIN)
+            {
+                return std::nullopt; // 🛑 interrupt()
+            }
+            // 📬 on any wakeup, not only POLLPRI: the frame sync and its buffer may be ready together, and
+            // before the error check, a source change is what stopped the stream
+            drain_events();
+            if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+            {
+                // 🔌 POLLERR also means "not streaming" or "nothing queued": only an unregistered node says ENODEV
+                v4l2_capability cap{};
+                if (backend_->ioctl(VIDIOC_QUERYCAP, &cap) < 0 && errno == ENODEV)
+                {
+                    lost_.store(true, std::memory_order_release);
+                }
+                throw std::runtime_error(fmt::format("device {} reported an error (unplugged or stream stopped)", config_.device_path_));
+            }
+            if (auto lease = dequeue_frame())
+            {
+                return keep_latest(std::move(*lease));
+            }
+        }
     }
 
-    void V4L2Camera::release_frame()
+    [[nodiscard]] FrameLease V4L2Camera::keep_latest(FrameLease lease)
     {
-        if (!last_buf_index_.has_value())
+        if (config_.capture_policy_ != CapturePolicy::LATEST)
         {
-            fmt::print(stderr, "WARN: release_frame called without valid last_buf_index_\n");
-            return;
+            return lease;
         }
 
-        v4l2_buffer buf{};
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = *last_buf_index_;
-
-        if (ioctl(fd_, VIDIOC_QBUF, &buf) < 0)
+        // 🏃 drain without blocking: each newer frame replaces the one we hold,
+        // the stale buffer goes straight back to the driver
+        while (auto newer = dequeue_frame())
         {
-            throw std::runtime_error(fmt::format("VIDIOC_QBUF failed for index {}", buf.index));
+            lease.release();
+            lease = std::move(*newer);
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            metrics_->record_dropped();
         }
-
-        last_buf_index_.reset();
+        return lease;
     }
 
-    void V4L2Camera::stop_streaming()
+    [[nodiscard]] std::optional<FrameLease> V4L2Camera::dequeue_frame()
     {
-        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        if (ioctl(fd_, VIDIOC_STREAMOFF, &type) < 0)
-        {
-            throw std::runtime_error("VIDIOC_STREAMOFF failed");
-        }
-    }
+        std::array<v4l2_plane, VIDEO_MAX_PLANES> planes{};
+        v4l2_buffer buf = make_buffer(planes);
+        buf.memory = to_v4l2_memory(config_.memory_);
 
-    void V4L2Camera::cleanup() noexcept
-    {
-        for (auto &buf : buffers_)
+        if (backend_->ioctl(VIDIOC_DQBUF, &buf) < 0)
         {
-            if (buf.is_valid())
+            if (errno == EAGAIN)
             {
-                munmap(buf.data, buf.size);
-                buf.data = nullptr;
-                buf.size = 0;
+                return std::nullopt;
+            }
+            if (errno == ENODEV)
+            {
+                lost_.store(true, std::memory_order_release);
             }
+            throw std::runtime_error(fmt::format("VIDIOC_DQBUF failed: {}", strerror(errno)));
         }
 
-        if (fd_ >= 0)
+        if (buf.index >= buffers_.size())
         {
-            close(fd_);
+            throw std::runtime_error(fmt::format("DQBUF returned invalid buffer index: {}", buf.index));
         }
-        fd_ = -1;
-    }
-
-    V4lCaps V4L2Camera::get_caps() const noexcept
-    {
-        return caps_;
-    }
-
-    [[nodiscard]] bool MappedBuffer::is_valid() const noexcept
-    {
-        return data && data != MAP_FAILED;
-    }
 
-    [[nodiscard]] bool V4L2Camera::has_valid_frame() const noexcept
+        // parse format & dimensions
+        const auto &mapped = buffers_[buf.index];
+        auto const [width, height] = dimensions_decompress(static_cast<uint32_t>(config_.dimension_));
+        // Get the driver-provided timestamp in microseconds.
+        const std::uint64_t v4l2_ts_us =
+            static_cast<std::uint64_t>(buf.timestamp.tv_sec) * 1'000'000ULL + static_cast<std::uint64_t>(buf.timestamp.tv_usec);
+        // Get current host monotonic time.
+        std::uint64_t const now_monotonic_us = monotonic_now_us();
+        if (std::uint64_t none = 0; first_frame_us_.load(std::memory_order_relaxed) == 0)
+        {
+            first_frame_us_.compare_exchange_strong(none, now_monotonic_us, std::memory_order_relaxed);
+        }
+        // ⏱ only a monotonic driver clock can be compared with ours
+        if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC && now_monotonic_us >= v4l2_ts_us)
+        {
+            latency_->driver_to_dqbuf.record(now_monotonic_us - v4l2_ts_us);
+        }
+
+        // 🔢 sequence gaps: the driver had no free buffer, or the bus dropped frames
+        if (last_sequence_)
+        {
+            const std::uint32_t missing = buf.sequence - (*last_sequence_ + 1); // wraps like the driver counter
+            if (missing != 0 && missing < (1u << 31))
+            {
+                sequence_gaps_.fetch_add(1, std::memory_order_relaxed);
+                lost_frames_.fetch_add(missing, std::memory_order_relaxed);
+                metrics_->record_gap(missing);
+            }
+        }
+        last_sequence_ = buf.sequence;
+
+        const bool errored = (buf.flags & V4L2_BUF_FLAG_ERROR) != 0;
+        if (errored)
+        {
+            errored_buffers_.fetch_add(1, std::memory_order_relaxed);
+            metrics_->record_errored();
+        }
+
+        // 🧅 what the driver filled of each memory plane, then where the color planes are in them
+        std::array<std::span<std::byte const>, MAX_PLANES> filled{};
+        std::uint64_t filled_bytes = 0;
+        for (std::uint32_t p = 0; p < memory_planes_; ++p)
+        {
+            const std::uint32_t used = multiplanar() ? planes[p].bytesused : buf.bytesused;
+            const std::uint32_t skip = multiplanar() ? std::min(planes[p].data_offset, used) : 0;
+            filled[p] = std::span<std::byte const>(backend_->frame_data(buf, mapped, p) + skip, used - skip);
+            filled_bytes += filled[p].size();
+        }
+        const auto image = filled[0];
+        std::array<FramePlane, MAX_PLANES> frame_planes{};
+        for (std::uint32_t c = 0; c < plane_count_; ++c)
+        {
+            auto const &where = layout_[c];
+            auto const &data = filled[where.memory_plane];
+            frame_planes[c] = FramePlane{.data = data.subspan(std::min(where.offset, data.size())), .bytes_per_line = where.bytes_per_line};
+        }
+        std::optional<JpegInfo> jpeg;
+        if (config_.format_ == PixelFormat::MJPG)
+        {
+            // 🩺 headers and tail only, cheap enough to run on every frame
+            jpeg = scan_jpeg(image);
+            if (!jpeg->ok())
+            {
+                corrupt_frames_.fetch_add(1, std::memory_order_relaxed);
+                metrics_->record_corrupt();
+            }
+        }
+
+        auto const &sync = frame_syncs_[buf.sequence % frame_syncs_.size()];
+        const std::uint64_t frame_sync_us = sync.sequence == buf.sequence ? sync.timestamp_us : 0;
+
+        outstanding_.fetch_add(1, std::memory_order_acq_rel);
+        metrics_->record_frame(filled_bytes, now_monotonic_us);
+        V4L2_TRACE(TRACE, "DQBUF index {} sequence {} bytesused {} flags {:#x}", buf.index, buf.sequence, image.size(), buf.flags);
+        return FrameLease{this, buf.index, FrameView{
+                                               .timestamp_monotonic_us = now_monotonic_us,
+                                               .v4l2_timestamp_us = v4l2_ts_us,
+                                               .image = image,
+                                               .width = width,
+                                               .height = height,
+                                               .format = config_.format_,
+                                               .bytes_per_line = bytes_per_line_,
+                                               .dmabuf_fd = mapped.dmabuf_fd,
+                                               .sequence = buf.sequence,
+                                               .flags = buf.flags,
+                                               .error = errored,
+                                               .jpeg = jpeg,
+                                               .crop = config_.crop_.value_or(Rect{}),
+                                               .frame_sync_us = frame_sync_us,
+                                               .planes = frame_planes,
+                                               .plane_count = plane_count_,
+                                           }};
+    }
+
+    void V4L2Camera::interrupt() noexcept
+    {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] auto const written = write(wake_fd_, &one, sizeof(one));
+    }
+
+    void V4L2Camera::clear_interrupt() noexcept
+    {
+        std::uint64_t count = 0;
+        [[maybe_unused]] auto const consumed = read(wake_fd_, &count, sizeof(count));
+    }
+
+    [[nodiscard]] int V4L2Camera::fd() const noexcept
+    {
+        return backend_ ? backend_->fd() : -1;
+    }
+
+    [[nodiscard]] int V4L2Camera::free_fd() const noexcept
+    {
+        return free_fd_;
+    }
+
+    [[nodiscard]] bool V4L2Camera::device_lost() const noexcept
+    {
+        return lost_.load(std::memory_order_acquire);
+    }
+
+    // The file reconnect() waits for: the node or its by-id link, the recording behind a replay:// uri
+    [[nodiscard]] static std::filesystem::path watched_path(const std::string &device_path)
+    {
+        if (device_path.starts_with("replay://"))
+        {
+            return parse_replay_uri(device_path).path_;
+        }
+        return device_path;
+    }
+
+    [[nodiscard]] bool V4L2Camera::try_reopen(const V4l2Config &before)
+    {
+        auto const caps = caps_;
+        try
+        {
+            open_device();
+            if (caps_.driver != caps.driver || caps_.card != caps.card)
+            {
+                // /dev/videoN went to another camera meanwhile
+                throw std::runtime_error(fmt::format("it is a '{}' now, not '{}'", caps_.card, caps.card));
+            }
+            configure();
+            if (config_.format_ == before.format_ && config_.dimension_ == before.dimension_)
+            {
+                start_streaming();
+                return true;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            // ⏳ not there yet, udev still setting permissions, or the camera still booting
+            V4L2_TRACE(DEBUG, "reconnect {}: {}", config_.device_path_, e.what());
+            cleanup();
+            configured_ = false;
+            caps_ = caps;
+            return false;
+        }
+
+        // whoever holds our buffers' format (caps, video meta) would be wrong from here on
+        auto const [w, h] = dimensions_decompress(static_cast<std::uint32_t>(config_.dimension_));
+        auto const [was_w, was_h] = dimensions_decompress(static_cast<std::uint32_t>(before.dimension_));
+        const std::string format(fourcc_str(static_cast<std::uint32_t>(config_.format_))); // fourcc_str() reuses its buffer
+        cleanup();
+        configured_ = false;
+        throw std::runtime_error(fmt::format("{} came back as {} {}x{}, it was {} {}x{}", config_.device_path_, format, w, h,
+                                             fourcc_str(static_cast<std::uint32_t>(before.format_)), was_w, was_h));
+    }
+
+    [[nodiscard]] bool V4L2Camera::reconnect(std::chrono::microseconds timeout)
+    {
+        if (auto const leased = outstanding_.load(std::memory_order_acquire); leased > 0)
+        {
+            throw std::runtime_error(fmt::format("reconnect {}: {} frame(s) still leased, release them first", config_.device_path_, leased));
+        }
+
+        // the old fd and mappings are of no use any more, the counters are
+        const V4l2Config before = config_;
+        auto const kept = stats();
+        cleanup();
+        configured_ = false;
+
+        const int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0)
+        {
+            throw std::runtime_error(fmt::format("inotify_init1 failed: {}", strerror(errno)));
+        }
+
+        // 🔁 a missed or filtered event costs at most one retry period, udev renames and chmods in several steps
+        constexpr auto RETRY = std::chrono::milliseconds(250);
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto const watched = watched_path(config_.device_path_);
+        bool back = false;
+        try
+        {
+            while (true)
+            {
+                // 👀 watch before trying: a node created between the attempt and the poll still wakes us.
+                // /dev/v4l/by-id goes away with the last camera, the nearest directory that exists will do
+                auto dir = watched.has_parent_path() ? watched.parent_path() : std::filesystem::path(".");
+                while (inotify_add_watch(inotify_fd, dir.c_str(), IN_CREATE | IN_ATTRIB | IN_MOVED_TO) < 0 && dir.has_parent_path() &&
+                       dir != dir.parent_path())
+                {
+                    dir = dir.parent_path();
+                }
+
+                if (try_reopen(before))
+                {
+                    back = true;
+                    break;
+                }
+
+                auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(RETRY);
+                if (timeout.count() >= 0)
+                {
+                    auto const left = deadline - std::chrono::steady_clock::now();
+                    if (left <= std::chrono::nanoseconds{0})
+                    {
+                        break; // ⏱ timed out
+                    }
+                    wait = std::min(wait, std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+                }
+                std::array<pollfd, 2> fds{{{.fd = inotify_fd, .events = POLLIN, .revents = 0},
+                                           {.fd = wake_fd_, .events = POLLIN, .revents = 0}}};
+                const timespec ts{.tv_sec = wait.count() / 1'000'000'000,
+                                  .tv_nsec = wait.count() % 1'000'000'000};
+                if (ppoll(fds.data(), fds.size(), &ts, nullptr) < 0 && errno != EINTR)
+                {
+                    throw std::runtime_error(fmt::format("poll on inotify failed: {}", strerror(errno)));
+                }
+                if (fds[1].revents & POLLIN)
+                {
+                    break; // 🛑 interrupt()
+                }
+                // the events only wake us, whatever they name the next attempt tells
+                alignas(inotify_event) std::array<char, 4096> events{};
+                while (read(inotify_fd, events.data(), events.size()) > 0)
+                {
+                }
+            }
+        }
+        catch (...)
+        {
+            close(inotify_fd);
+            throw;
+        }
+        close(inotify_fd);
+
+        if (back)
+        {
+            restore_counters(kept);
+            reconnects_.fetch_add(1, std::memory_order_relaxed);
+            lost_.store(false, std::memory_order_release);
+            source_changed_.store(false, std::memory_order_release); // configured in the mode it had
+            V4L2_TRACE(INFO, "reconnected {}", config_.device_path_);
+        }
+        return back;
+    }
+
+    // ⚙️ configure() starts the counters over, a reconnect or renegotiation is not a new capture
+    void V4L2Camera::restore_counters(const CaptureStats &kept) noexcept
+    {
+        dropped_frames_.store(kept.dropped_frames, std::memory_order_relaxed);
+        sequence_gaps_.store(kept.sequence_gaps, std::memory_order_relaxed);
+        lost_frames_.store(kept.lost_frames, std::memory_order_relaxed);
+        errored_buffers_.store(kept.errored_buffers, std::memory_order_relaxed);
+        corrupt_frames_.store(kept.corrupt_frames, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static constexpr std::uint32_t to_v4l2_event(CameraEventType type) noexcept
+    {
+        switch (type)
+        {
+        case CameraEventType::FRAME_SYNC:
+            return V4L2_EVENT_FRAME_SYNC;
+        case CameraEventType::SOURCE_CHANGE:
+            return V4L2_EVENT_SOURCE_CHANGE;
+        case CameraEventType::CTRL:
+            return V4L2_EVENT_CTRL;
+        case CameraEventType::EOS:
+            return V4L2_EVENT_EOS;
+        }
+        return V4L2_EVENT_ALL;
+    }
+
+    [[nodiscard]] bool V4L2Camera::subscribe(CameraEventType type, std::uint32_t id) noexcept
+    {
+        v4l2_event_subscription sub{};
+        sub.type = to_v4l2_event(type);
+        sub.id = id;
+        return backend_->ioctl(VIDIOC_SUBSCRIBE_EVENT, &sub) == 0;
+    }
+
+    [[nodiscard]] bool V4L2Camera::subscribe_event(CameraEventType type, std::uint32_t id)
+    {
+        if (!backend_)
+        {
+            throw std::runtime_error("subscribe_event: device is not open");
+        }
+        if (!subscribe(type, id))
+        {
+            if (errno == EINVAL || errno == ENOTTY || errno == ENOENT)
+            {
+                return false; // 🤷 not every driver has every event, uvcvideo only knows CTRL
+            }
+            throw std::runtime_error(fmt::format("VIDIOC_SUBSCRIBE_EVENT failed: {}", strerror(errno)));
+        }
+        auto const subscription = std::pair{type, id};
+        if (std::find(subscriptions_.begin(), subscriptions_.end(), subscription) == subscriptions_.end())
+        {
+            subscriptions_.push_back(subscription);
+        }
+        return true;
+    }
+
+    void V4L2Camera::set_event_callback(EventCallback callback)
+    {
+        on_event_ = std::move(callback);
+    }
+
+    [[nodiscard]] bool V4L2Camera::source_changed() const noexcept
+    {
+        return source_changed_.load(std::memory_order_acquire);
+    }
+
+    void V4L2Camera::drain_events()
+    {
+        if (subscriptions_.empty())
+        {
+            return; // no DQEVENT syscall on every capture for nothing
+        }
+
+        bool changed = false;
+        v4l2_event ev{};
+        while (backend_->ioctl(VIDIOC_DQEVENT, &ev) == 0)
+        {
+            CameraEvent event{
+                .timestamp_monotonic_us = static_cast<std::uint64_t>(ev.timestamp.tv_sec) * 1'000'000ULL +
+                                          static_cast<std::uint64_t>(ev.timestamp.tv_nsec) / 1000,
+                .sequence = ev.sequence,
+                .id = ev.id,
+            };
+            switch (ev.type)
+            {
+            case V4L2_EVENT_FRAME_SYNC:
+                event.type = CameraEventType::FRAME_SYNC;
+                event.frame_sequence = ev.u.frame_sync.frame_sequence;
+                // ⏱ the driver counts both sequences from STREAMON, dequeue_frame() pairs them up
+                frame_syncs_[event.frame_sequence % frame_syncs_.size()] =
+                    FrameSync{.sequence = event.frame_sequence, .timestamp_us = event.timestamp_monotonic_us};
+                break;
+            case V4L2_EVENT_SOURCE_CHANGE:
+                event.type = CameraEventType::SOURCE_CHANGE;
+                event.changes = ev.u.src_change.changes;
+                changed = changed || (event.changes & V4L2_EVENT_SRC_CH_RESOLUTION) != 0;
+                break;
+            case V4L2_EVENT_CTRL:
+                event.type = CameraEventType::CTRL;
+                event.changes = ev.u.ctrl.changes;
+                event.value = ev.u.ctrl.type == V4L2_CTRL_TYPE_INTEGER64 ? ev.u.ctrl.value64 : ev.u.ctrl.value;
+                break;
+            case V4L2_EVENT_EOS:
+                event.type = CameraEventType::EOS;
+                break;
+            default:
+                continue; // not one we subscribed to
+            }
+            V4L2_TRACE(TRACE, "DQEVENT type {} sequence {} pending {}", ev.type, ev.sequence, ev.pending);
+            if (on_event_)
+            {
+                on_event_(event);
+            }
+        }
+        if (errno != ENOENT && errno != EAGAIN)
+        {
+            throw std::runtime_error(fmt::format("VIDIOC_DQEVENT failed: {}", strerror(errno)));
+        }
+
+        if (changed)
+        {
+            // 🔀 frames from here on would not fit our buffers' format, whoever captures has to renegotiate
+            source_changed_.store(true, std::memory_order_release);
+            throw std::runtime_error(fmt::format("source of {} changed its resolution, renegotiate()", config_.device_path_));
+        }
+    }
+
+    void V4L2Camera::renegotiate()
+    {
+        if (!backend_)
+        {
+            throw std::runtime_error("renegotiate: device is not open");
+        }
+        if (auto const leased = outstanding_.load(std::memory_order_acquire); leased > 0)
+        {
+            throw std::runtime_error(fmt::format("renegotiate {}: {} frame(s) still leased, release them first", config_.device_path_, leased));
+        }
+
+        auto const kept = stats();
+        auto type = static_cast<v4l2_buf_type>(buf_type_);
+        if (backend_->ioctl(VIDIOC_STREAMOFF, &type) < 0 && errno != ENODEV)
+        {
+            throw std::runtime_error(fmt::format("VIDIOC_STREAMOFF failed: {}", strerror(errno)));
+        }
+        unmap_buffers();
+        v4l2_requestbuffers req{};
+        req.type = buf_type_;
+        req.memory = to_v4l2_memory(config_.memory_);
+        if (backend_->ioctl(VIDIOC_REQBUFS, &req) < 0)
+        {
+            throw std::runtime_error(fmt::format("VIDIOC_REQBUFS(0) failed: {}", strerror(errno)));
+        }
+
+        // 📺 HDMI and SDI receivers only switch over once told to take the timings they detected
+        if (v4l2_dv_timings timings{}; backend_->ioctl(VIDIOC_QUERY_DV_TIMINGS, &timings) == 0)
+        {
+            if (backend_->ioctl(VIDIOC_S_DV_TIMINGS, &timings) < 0)
+            {
+                throw std::runtime_error(fmt::format("VIDIOC_S_DV_TIMINGS failed: {}", strerror(errno)));
+            }
+        }
+
+        // the new mode is what the driver has now, not what we asked for before
+        v4l2_format fmt{};
+        fmt.type = buf_type_;
+        if (backend_->ioctl(VIDIOC_G_FMT, &fmt) < 0)
+        {
+            throw std::runtime_error(fmt::format("VIDIOC_G_FMT failed: {}", strerror(errno)));
+        }
+        auto const now = format_info(fmt);
+        config_.dimension_ = to_dimension(now.width, now.height);
+        config_.format_ = static_cast<PixelFormat>(now.fourcc);
+
+        configured_ = false;
+        configure();
+        start_streaming();
+        restore_counters(kept);
+        source_changed_.store(false, std::memory_order_release);
+        renegotiations_.fetch_add(1, std::memory_order_relaxed);
+        auto const [width, height] = dimensions_decompress(static_cast<std::uint32_t>(config_.dimension_));
+        V4L2_TRACE(INFO, "renegotiated {}: {} {}x{}", config_.device_path_, fourcc_str(static_cast<std::uint32_t>(config_.format_)), width, height);
+    }
+
+    void V4L2Camera::release_frame(std::uint32_t index, std::uint64_t dequeued_us)
+    {
+        // seq_cst pairs with wait_for_all_released(): either it sees the count drop or we see it waiting
+        const auto before = outstanding_.fetch_sub(1);
+        const bool signal = before == buffers_.size() || (before == 1 && draining_.load());
+        const std::uint64_t released_us = monotonic_now_us();
+        if (metrics_)
+        {
+            metrics_->record_release(released_us >= dequeued_us ? released_us - dequeued_us : 0);
+        }
+        const std::uint64_t one = 1;
+        try
+        {
+            queue_buffer(index);
+        }
+        catch (...)
+        {
+            if (signal)
+            {
+                [[maybe_unused]] auto const written = write(free_fd_, &one, sizeof(one)); // the waiter still gets it back
+            }
+            throw;
+        }
+        V4L2_TRACE(TRACE, "QBUF index {}", index);
+        const std::uint64_t now = monotonic_now_us();
+        if (metrics_)
+        {
+            metrics_->record_requeue(now - released_us);
+        }
+        if (latency_ && now >= dequeued_us)
+        {
+            latency_->dqbuf_to_qbuf.record(now - dequeued_us);
+        }
+        if (signal)
+        {
+            // only leaving the all-leased state, or a waited-for last release, costs a syscall
+            [[maybe_unused]] auto const written = write(free_fd_, &one, sizeof(one));
+        }
+    }
+
+    [[nodiscard]] bool V4L2Camera::wait_for_free_buffer(std::chrono::microseconds timeout)
+    {
+        return wait_for_leases_below(static_cast<std::uint32_t>(buffers_.size()), timeout);
+    }
+
+    [[nodiscard]] bool V4L2Camera::wait_for_all_released(std::chrono::microseconds timeout)
+    {
+        draining_.store(true);
+        try
+        {
+            const bool released = wait_for_leases_below(1, timeout);
+            draining_.store(false);
+            return released;
+        }
+        catch (...)
+        {
+            draining_.store(false);
+            throw;
+        }
+    }
+
+    [[nodiscard]] bool V4L2Camera::wait_for_leases_below(std::uint32_t limit, std::chrono::microseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (true)
+        {
+            // drain first: a release after this point signals again, so the poll below cannot miss it
+            std::uint64_t count = 0;
+            [[maybe_unused]] auto const consumed = read(free_fd_, &count, sizeof(count));
+            if (outstanding_.load() < limit)
+            {
+                return true;
+            }
+
+            std::array<pollfd, 2> fds{{{.fd = free_fd_, .events = POLLIN, .revents = 0},
+                                       {.fd = wake_fd_, .events = POLLIN, .revents = 0}}};
+            timespec ts{};
+            timespec *ts_ptr = nullptr;
+            if (timeout.count() >= 0)
+            {
+                auto const left = std::max(std::chrono::nanoseconds{0}, deadline - std::chrono::steady_clock::now());
+                ts.tv_sec = left.count() / 1'000'000'000;
+                ts.tv_nsec = left.count() % 1'000'000'000;
+                ts_ptr = &ts;
+            }
+
+            const int ready = ppoll(fds.data(), fds.size(), ts_ptr, nullptr);
+            if (ready < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error(fmt::format("poll for a free buffer failed: {}", strerror(errno)));
+            }
+            if (ready == 0 || (fds[1].revents & POLLIN))
+            {
+                return false; // ⏱ timed out or 🛑 interrupt()
+            }
+        }
+    }
+
+    void V4L2Camera::queue_buffer(std::uint32_t index)
+    {
+        std::array<v4l2_plane, VIDEO_MAX_PLANES> planes{};
+        v4l2_buffer buf = make_buffer(planes);
+        buf.memory = to_v4l2_memory(config_.memory_);
+        buf.index = index;
+        if (config_.memory_ == MemoryMode::DMABUF_IMPORT && multiplanar())
+        {
+            planes[0].m.fd = buffers_[index].dmabuf_fd;
+            planes[0].length = static_cast<std::uint32_t>(buffers_[index].size);
+        }
+        else if (config_.memory_ == MemoryMode::DMABUF_IMPORT)
+        {
+            buf.m.fd = buffers_[index].dmabuf_fd;
+            buf.length = static_cast<std::uint32_t>(buffers_[index].size);
+        }
+
+        if (backend_->ioctl(VIDIOC_QBUF, &buf) < 0)
+        {
+            if (errno == ENODEV)
+            {
+                lost_.store(true, std::memory_order_release);
+            }
+            throw std::runtime_error(fmt::format("VIDIOC_QBUF failed for index {}: {}", index, strerror(errno)));
+        }
+    }
+
+    void V4L2Camera::stop_streaming()
+    {
+        auto type = static_cast<v4l2_buf_type>(buf_type_);
+        if (backend_->ioctl(VIDIOC_STREAMOFF, &type) < 0)
+        {
+            throw std::runtime_error("VIDIOC_STREAMOFF failed");
+        }
+    }
+
+    void V4L2Camera::cleanup() noexcept
     {
-        return last_buf_index_.has_value();
+        unmap_buffers();
+        backend_.reset();
+    }
+
+    void V4L2Camera::unmap_buffers() noexcept
+    {
+        for (auto &buf : buffers_)
+        {
+            if (buf.is_valid())
+            {
+                munmap(buf.data, buf.size);
+                buf.data = nullptr;
+                buf.size = 0;
+            }
+            // exported fds are ours, imported ones belong to the caller
+            if (buf.dmabuf_fd >= 0 && config_.memory_ == MemoryMode::DMABUF_EXPORT)
+            {
+                close(buf.dmabuf_fd);
+            }
+            buf.dmabuf_fd = -1;
+            for (auto &plane : buf.more_planes)
+            {
+                if (plane.data && plane.data != MAP_FAILED)
+                {
+                    munmap(plane.data, plane.size);
+                }
+                if (plane.dmabuf_fd >= 0)
+                {
+                    close(plane.dmabuf_fd); // exported, imports have one plane
+                }
+                plane = MappedPlane{};
+            }
+            buf.plane_count = 1;
+        }
+    }
+
+    // 📇 modes per device path, enumeration is a few hundred ioctls on some UVC cameras
+    static std::mutex modes_mutex;
+    static std::unordered_map<std::string, std::vector<CaptureMode>> modes_cache;
+
+    [[nodiscard]] static std::vector<FrameRate> enumerate_rates(CaptureBackend &backend, std::uint32_t fourcc, std::uint32_t width, std::uint32_t height)
+    {
+        std::vector<FrameRate> rates;
+        v4l2_frmivalenum ival{};
+        ival.pixel_format = fourcc;
+        ival.width = width;
+        ival.height = height;
+        for (ival.index = 0; backend.ioctl(VIDIOC_ENUM_FRAMEINTERVALS, &ival) == 0; ++ival.index)
+        {
+            if (ival.type == V4L2_FRMIVAL_TYPE_DISCRETE)
+            {
+                // interval is seconds per frame, the rate is its inverse
+                rates.push_back({ival.discrete.denominator, ival.discrete.numerator});
+            }
+            else
+            {
+                // stepwise / continuous: the fastest and the slowest end
+                rates.push_back({ival.stepwise.min.denominator, ival.stepwise.min.numerator});
+                rates.push_back({ival.stepwise.max.denominator, ival.stepwise.max.numerator});
+                break;
+            }
+        }
+
+        std::erase_if(rates, [](const FrameRate &r)
+                      { return r.numerator == 0 || r.denominator == 0; });
+        std::sort(rates.begin(), rates.end(), [](const FrameRate &a, const FrameRate &b)
+                  { return std::uint64_t{a.numerator} * b.denominator > std::uint64_t{b.numerator} * a.denominator; });
+        rates.erase(std::unique(rates.begin(), rates.end()), rates.end());
+        return rates;
+    }
+
+    [[nodiscard]] std::vector<CaptureMode> V4L2Camera::enumerate_modes(bool refresh)
+    {
+        if (!backend_)
+        {
+            throw std::runtime_error("enumerate_modes: device is not open");
+        }
+
+        {
+            std::lock_guard lock(modes_mutex);
+            if (auto const it = modes_cache.find(config_.device_path_); it != modes_cache.end() && !refresh)
+            {
+                return it->second;
+            }
+        }
+
+        // 💾 the disk remembers what this camera listed last time
+        if (cached_ && !cached_->modes.empty() && !refresh)
+        {
+            std::lock_guard lock(modes_mutex);
+            modes_cache[config_.device_path_] = cached_->modes;
+            return cached_->modes;
+        }
+
+        std::vector<CaptureMode> modes;
+        v4l2_fmtdesc desc{};
+        desc.type = buf_type_;
+        for (desc.index = 0; backend_->ioctl(VIDIOC_ENUM_FMT, &desc) == 0; ++desc.index)
+        {
+            v4l2_frmsizeenum size{};
+            size.pixel_format = desc.pixelformat;
+            for (size.index = 0; backend_->ioctl(VIDIOC_ENUM_FRAMESIZES, &size) == 0; ++size.index)
+            {
+                auto add = [&](std::uint32_t w, std::uint32_t h)
+                {
+                    modes.push_back(CaptureMode{
+                        .format = static_cast<PixelFormat>(desc.pixelformat),
+                        .width = w,
+                        .height = h,
+                        .frame_rates = enumerate_rates(*backend_, desc.pixelformat, w, h),
+                    });
+                };
+
+                if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE)
+                {
+                    add(size.discrete.width, size.discrete.height);
+                }
+                else
+                {
+                    add(size.stepwise.min_width, size.stepwise.min_height);
+                    add(size.stepwise.max_width, size.stepwise.max_height);
+                    break;
+                }
+            }
+        }
+
+        std::lock_guard lock(modes_mutex);
+        modes_cache[config_.device_path_] = modes;
+        if (!cache_key_.empty())
+        {
+            if (!cached_)
+            {
+                cached_.emplace(); // written by configure(), once there is a negotiation to go with the modes
+            }
+            cached_->modes = modes;
+            if (cached_->format != PixelFormat{})
+            {
+                store_cache();
+            }
+        }
+        return modes;
+    }
+
+    void V4L2Camera::store_cache() noexcept
+    {
+        if (cached_ && !cache_key_.empty())
+        {
+            store_negotiation(config_.cache_dir_, cache_key_, *cached_);
+        }
+    }
+
+    [[nodiscard]] std::optional<std::vector<CaptureMode>> V4L2Camera::cached_modes(const std::string &device_path)
+    {
+        std::lock_guard lock(modes_mutex);
+        if (auto const it = modes_cache.find(device_path); it != modes_cache.end())
+        {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    V4lCaps V4L2Camera::get_caps() const noexcept
+    {
+        return caps_;
+    }
+
+    [[nodiscard]] std::span<const MappedBuffer> V4L2Camera::buffers() const noexcept
+    {
+        return buffers_;
+    }
+
+    [[nodiscard]] const V4l2Config &V4L2Camera::config() const noexcept
+    {
+        return config_;
+    }
+
+    [[nodiscard]] std::uint32_t V4L2Camera::bytes_per_line() const noexcept
+    {
+        return bytes_per_line_;
+    }
+
+    [[nodiscard]] std::span<const PlaneLayout> V4L2Camera::plane_layout() const noexcept
+    {
+        return std::span<const PlaneLayout>(layout_.data(), plane_count_);
+    }
+
+    [[nodiscard]] bool V4L2Camera::multiplanar() const noexcept
+    {
+        return buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    }
+
+    [[nodiscard]] V4L2Camera::FormatInfo V4L2Camera::format_info(const v4l2_format &fmt) const noexcept
+    {
+        if (multiplanar())
+        {
+            auto const &pix = fmt.fmt.pix_mp;
+            FormatInfo info{.width = pix.width,
+                            .height = pix.height,
+                            .fourcc = pix.pixelformat,
+                            .memory_planes = std::clamp<std::uint32_t>(pix.num_planes, 1, MAX_PLANES)};
+            for (std::uint32_t p = 0; p < info.memory_planes; ++p)
+            {
+                info.bytes_per_line[p] = pix.plane_fmt[p].bytesperline;
+            }
+            return info;
+        }
+        return FormatInfo{.width = fmt.fmt.pix.width,
+                          .height = fmt.fmt.pix.height,
+                          .fourcc = fmt.fmt.pix.pixelformat,
+                          .bytes_per_line = {fmt.fmt.pix.bytesperline}};
+    }
+
+    [[nodiscard]] v4l2_buffer V4L2Camera::make_buffer(std::array<v4l2_plane, VIDEO_MAX_PLANES> &planes) const noexcept
+    {
+        v4l2_buffer buf{};
+        buf.type = buf_type_;
+        if (multiplanar())
+        {
+            buf.m.planes = planes.data();
+            buf.length = memory_planes_;
+        }
+        return buf;
+    }
+
+    void V4L2Camera::set_layout(const FormatInfo &format)
+    {
+        memory_planes_ = format.memory_planes;
+        if (memory_planes_ != memory_planes(config_.format_))
+        {
+            throw std::runtime_error(fmt::format("driver splits '{}' into {} buffer planes, expected {}",
+                                                 fourcc_str(static_cast<std::uint32_t>(config_.format_)), memory_planes_,
+                                                 memory_planes(config_.format_)));
+        }
+
+        plane_count_ = color_planes(config_.format_);
+        layout_[0] = PlaneLayout{.memory_plane = 0, .offset = 0, .bytes_per_line = format.bytes_per_line[0], .height = format.height};
+        if (plane_count_ > 1)
+        {
+            // 🧅 CbCr after the Y rows, or at the start of a buffer plane of its own (NV12M, NV16M)
+            const bool half_height = config_.format_ == PixelFormat::NV12 || config_.format_ == PixelFormat::NV12M;
+            const std::uint32_t chroma_rows = half_height ? (format.height + 1) / 2 : format.height;
+            layout_[1] = memory_planes_ > 1
+                             ? PlaneLayout{.memory_plane = 1, .offset = 0, .bytes_per_line = format.bytes_per_line[1], .height = chroma_rows}
+                             : PlaneLayout{.memory_plane = 0,
+                                           .offset = std::size_t{format.bytes_per_line[0]} * format.height,
+                                           .bytes_per_line = format.bytes_per_line[0],
+                                           .height = chroma_rows};
+        }
+    }
+
+    [[nodiscard]] bool MappedBuffer::is_valid() const noexcept
+    {
+        return data && data != MAP_FAILED;
+    }
+
+    [[nodiscard]] std::uint32_t V4L2Camera::outstanding_frames() const noexcept
+    {
+        return outstanding_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] CaptureStats V4L2Camera::stats() const noexcept
+    {
+        return CaptureStats{
+            .dropped_frames = dropped_frames_.load(std::memory_order_relaxed),
+            .sequence_gaps = sequence_gaps_.load(std::memory_order_relaxed),
+            .lost_frames = lost_frames_.load(std::memory_order_relaxed),
+            .errored_buffers = errored_buffers_.load(std::memory_order_relaxed),
+            .corrupt_frames = corrupt_frames_.load(std::memory_order_relaxed),
+            .time_to_first_frame_us = [&]() -> std::uint64_t
+            {
+                auto const first = first_frame_us_.load(std::memory_order_relaxed);
+                auto const opened = opened_us_.load(std::memory_order_relaxed);
+                return first > opened ? first - opened : 0;
+            }(),
+            .reconnects = reconnects_.load(std::memory_order_relaxed),
+            .renegotiations = renegotiations_.load(std::memory_order_relaxed),
+        };
+    }
+
+    [[nodiscard]] LatencyStats V4L2Camera::latency() const noexcept
+    {
+        if (!latency_)
+        {
+            return LatencyStats{}; // moved-from
+        }
+        return LatencyStats{
+            .driver_to_dqbuf = latency_->driver_to_dqbuf.summary(),
+            .dqbuf_to_handoff = latency_->dqbuf_to_handoff.summary(),
+            .dqbuf_to_qbuf = latency_->dqbuf_to_qbuf.summary(),
+        };
+    }
+
+    [[nodiscard]] std::shared_ptr<const CameraMetrics> V4L2Camera::metrics() const noexcept
+    {
+        return metrics_;
+    }
+
+    void V4L2Camera::record_handoff(const FrameView &frame) noexcept
+    {
+        const std::uint64_t now = monotonic_now_us();
+        if (latency_ && now >= frame.timestamp_monotonic_us)
+        {
+            latency_->dqbuf_to_handoff.record(now - frame.timestamp_monotonic_us);
+        }
     }
 
 } // namespace v4l2
@@ -0,0 +1,156 @@
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <cassert>    // For assert
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <stdexcept>  // For std::runtime_error
+#include <vector>     // For std::vector
+
+// No camera needed: a replay:// recording stands in for the device
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+    constexpr std::uint32_t FRAMES = 10;
+
+    v4l2::V4l2Config replay_config(const fs::path &recording, const char *options)
+    {
+        return v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}{}", recording.string(), options),
+                                .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                .format_ = v4l2::PixelFormat::YUYV,
+                                .buffer_count_ = 4};
+    }
+} // namespace
+
+void test_frame_sync(const fs::path &recording)
+{
+    fmt::print("Testing frame sync events\n");
+    v4l2::V4L2Camera camera(replay_config(recording, "?rate=100"));
+    try
+    {
+        [[maybe_unused]] auto const subscribed = camera.subscribe_event(v4l2::CameraEventType::FRAME_SYNC);
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    camera.open_device();
+    camera.configure();
+    assert(camera.subscribe_event(v4l2::CameraEventType::FRAME_SYNC));
+    // a recording has one mode, and no brightness control
+    assert(!camera.subscribe_event(v4l2::CameraEventType::SOURCE_CHANGE));
+    assert(!camera.subscribe_event(v4l2::CameraEventType::CTRL, 0x00980900));
+
+    std::vector<v4l2::CameraEvent> events;
+    camera.set_event_callback([&](const v4l2::CameraEvent &event) { events.push_back(event); });
+    camera.start_streaming();
+    for (std::uint32_t i = 0; i < 5; ++i)
+    {
+        auto lease = camera.capture_frame();
+        // 📸 every frame carries the start of its readout, a frame interval before its buffer was done
+        assert(lease->frame_sync_us != 0 && lease->frame_sync_us < lease->v4l2_timestamp_us);
+        assert(lease->v4l2_timestamp_us - lease->frame_sync_us <= 10'000);
+        assert(!events.empty() && events.back().type == v4l2::CameraEventType::FRAME_SYNC);
+        assert(events.back().frame_sequence == lease->sequence);
+        assert(events.back().timestamp_monotonic_us == lease->frame_sync_us);
+    }
+    for (std::size_t i = 1; i < events.size(); ++i)
+    {
+        assert(events[i].sequence == events[i - 1].sequence + 1); // nothing dropped
+    }
+    camera.stop_streaming();
+}
+
+void test_without_subscription(const fs::path &recording)
+{
+    fmt::print("Testing frames without events\n");
+    v4l2::V4L2Camera camera(replay_config(recording, "?rate=max"));
+    camera.open_device();
+    camera.configure();
+    camera.start_streaming();
+    auto lease = camera.capture_frame();
+    assert(lease->frame_sync_us == 0);
+    lease.release();
+    camera.stop_streaming();
+}
+
+void test_eos(const fs::path &recording)
+{
+    fmt::print("Testing end of stream event\n");
+    v4l2::V4L2Camera camera(replay_config(recording, "?rate=max&loop=0"));
+    camera.open_device();
+    camera.configure();
+    assert(camera.subscribe_event(v4l2::CameraEventType::EOS));
+    bool eos = false;
+    camera.set_event_callback([&](const v4l2::CameraEvent &event) { eos = eos || event.type == v4l2::CameraEventType::EOS; });
+    camera.start_streaming();
+
+    std::uint32_t frames = 0;
+    try
+    {
+        while (true)
+        {
+            auto lease = camera.capture_frame();
+            ++frames;
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    assert(frames == FRAMES && eos);
+}
+
+void test_renegotiate(const fs::path &recording)
+{
+    fmt::print("Testing renegotiation\n");
+    v4l2::V4L2Camera camera(replay_config(recording, "?rate=100"));
+    camera.open_device();
+    camera.configure();
+    assert(camera.subscribe_event(v4l2::CameraEventType::FRAME_SYNC));
+    camera.start_streaming();
+    assert(!camera.source_changed());
+
+    auto lease = camera.capture_frame();
+    try
+    {
+        camera.renegotiate();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    lease.release();
+
+    // the recording did not change: same mode again, streaming on the same fd, events still subscribed
+    const int fd = camera.fd();
+    camera.renegotiate();
+    assert(camera.fd() == fd);
+    assert(camera.config().dimension_ == v4l2::to_dimension(WIDTH, HEIGHT));
+    assert(camera.stats().renegotiations == 1 && !camera.source_changed());
+    lease = camera.capture_frame();
+    assert(lease->sequence == 0 && lease->frame_sync_us != 0 && lease->width == WIDTH);
+    lease.release();
+    camera.stop_streaming();
+}
+
+int main()
+{
+    fmt::print("Starting camera event tests\n");
+    const fixture::ScratchDir dir("events");
+    auto const recording = fixture::make_recording(dir / "events.v4lr", {.width = WIDTH, .height = HEIGHT, .frames = FRAMES, .interval_us = 10'000});
+
+    test_frame_sync(recording);
+    test_without_subscription(recording);
+    test_eos(recording);
+    test_renegotiate(recording);
+
+    fmt::print("Success\n");
+    return 0;
+}
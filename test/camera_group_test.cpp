@@ -0,0 +1,109 @@
+#include "v4l2/camera_group.hpp"
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <cassert>        // For assert
+#include <chrono>         // For std::chrono
+#include <filesystem>     // For std::filesystem
+#include <fmt/core.h>     // For fmt::print
+#include <mutex>          // For std::mutex
+#include <sys/resource.h> // For getrusage
+#include <thread>         // For std::this_thread
+#include <vector>         // For std::vector
+
+// No camera needed: a replay:// recording stands in for the device
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+
+    // User plus system time of the whole process, the loop thread is the only one working
+    std::chrono::microseconds cpu_time()
+    {
+        rusage usage{};
+        assert(getrusage(RUSAGE_SELF, &usage) == 0);
+        return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+               std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+    }
+} // namespace
+
+void test_all_leased_sleeps(const fs::path &recording)
+{
+    fmt::print("Testing that the loop sleeps while every buffer is leased\n");
+    v4l2::CameraGroup group;
+    group.add_camera(v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}?rate=max", recording.string()),
+                                      .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                      .format_ = v4l2::PixelFormat::YUYV,
+                                      .buffer_count_ = 4});
+
+    std::mutex mutex;
+    std::vector<v4l2::FrameLease> held;
+    std::size_t frames = 0;
+    group.start([&](std::size_t, v4l2::FrameLease &&frame)
+                {
+                    std::lock_guard lock(mutex);
+                    held.push_back(std::move(frame));
+                    ++frames; });
+
+    auto const deadline = std::chrono::steady_clock::now() + 2s;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        std::lock_guard lock(mutex);
+        if (held.size() == 4)
+        {
+            break;
+        }
+    }
+    {
+        std::lock_guard lock(mutex);
+        assert(held.size() == 4);
+    }
+
+    // 💤 the replay fd stays readable at max rate, a loop still polling it would burn this whole window
+    auto const before = cpu_time();
+    std::this_thread::sleep_for(300ms);
+    auto const spent = cpu_time() - before;
+    fmt::print("  {} us of CPU in 300 ms with every lease held\n", spent.count());
+    assert(spent < 60ms);
+
+    // a lease coming back re-arms the camera
+    std::size_t seen = 0;
+    {
+        std::lock_guard lock(mutex);
+        held.clear();
+        seen = frames;
+    }
+    auto const again = std::chrono::steady_clock::now() + 2s;
+    while (std::chrono::steady_clock::now() < again)
+    {
+        std::lock_guard lock(mutex);
+        if (frames >= seen + 4)
+        {
+            break;
+        }
+    }
+    {
+        std::lock_guard lock(mutex);
+        assert(frames >= seen + 4);
+    }
+
+    group.stop();
+    std::lock_guard lock(mutex);
+    held.clear();
+}
+
+int main()
+{
+    fmt::print("Starting camera group tests\n");
+    const fixture::ScratchDir dir("camera-group");
+    auto const recording = fixture::make_recording(dir / "group.v4lr", {.width = WIDTH, .height = HEIGHT});
+
+    test_all_leased_sleeps(recording);
+
+    fmt::print("Success\n");
+    return 0;
+}
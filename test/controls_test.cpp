@@ -0,0 +1,176 @@
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <array>      // For std::array
+#include <cassert>    // For assert
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <linux/videodev2.h>
+#include <stdexcept> // For std::invalid_argument
+#include <vector>    // For std::vector
+
+// No camera needed: a replay:// recording stands in for a UVC camera and its controls
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+
+    v4l2::V4L2Camera open_camera(const fs::path &recording)
+    {
+        v4l2::V4L2Camera camera(v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}?rate=100", recording.string()),
+                                                 .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                                 .format_ = v4l2::PixelFormat::YUYV,
+                                                 .buffer_count_ = 4});
+        camera.open_device();
+        camera.configure();
+        return camera;
+    }
+
+    std::int64_t value_of(v4l2::V4L2Camera &camera, std::uint32_t id)
+    {
+        const std::array ids{id};
+        auto const values = camera.get_controls(ids);
+        assert(values.size() == 1 && values[0].id == id);
+        return values[0].value;
+    }
+} // namespace
+
+void test_enumerate(const fs::path &recording)
+{
+    fmt::print("Testing control enumeration\n");
+    auto camera = open_camera(recording);
+
+    // the class entries are left out, the rest comes sorted by id
+    auto const &controls = camera.controls();
+    assert(controls.size() == 5);
+    for (std::size_t i = 1; i < controls.size(); ++i)
+    {
+        assert(controls[i - 1].id < controls[i].id);
+    }
+    assert(!camera.find_control(V4L2_CID_USER_CLASS) && !camera.find_control(V4L2_CID_BRIGHTNESS));
+
+    auto const *exposure = camera.find_control(V4L2_CID_EXPOSURE_ABSOLUTE);
+    assert(exposure && exposure->name == "Exposure Time, Absolute" && exposure->type == V4L2_CTRL_TYPE_INTEGER);
+    assert(exposure->minimum == 3 && exposure->maximum == 2047 && exposure->default_value == 250);
+    auto const *temperature = camera.find_control(V4L2_CID_WHITE_BALANCE_TEMPERATURE);
+    assert(temperature && temperature->step == 10);
+    for (auto const &control : controls)
+    {
+        fmt::print("  {:#010x} {}: {}..{} step {}\n", control.id, control.name, control.minimum, control.maximum, control.step);
+    }
+}
+
+void test_set_batch(const fs::path &recording)
+{
+    fmt::print("Testing batched set\n");
+    auto camera = open_camera(recording);
+
+    // 🎛 one VIDIOC_S_EXT_CTRLS: auto modes off first, then the manual values
+    const std::array<v4l2::ControlValue, 5> batch{{
+        {.id = V4L2_CID_EXPOSURE_AUTO, .value = V4L2_EXPOSURE_MANUAL},
+        {.id = V4L2_CID_AUTO_WHITE_BALANCE, .value = 0},
+        {.id = V4L2_CID_EXPOSURE_ABSOLUTE, .value = 100},
+        {.id = V4L2_CID_GAIN, .value = 32},
+        {.id = V4L2_CID_WHITE_BALANCE_TEMPERATURE, .value = 5000},
+    }};
+    camera.set_controls(batch);
+    assert(value_of(camera, V4L2_CID_EXPOSURE_AUTO) == V4L2_EXPOSURE_MANUAL);
+    assert(value_of(camera, V4L2_CID_AUTO_WHITE_BALANCE) == 0);
+    const std::array ids{std::uint32_t{V4L2_CID_EXPOSURE_ABSOLUTE}, std::uint32_t{V4L2_CID_GAIN},
+                         std::uint32_t{V4L2_CID_WHITE_BALANCE_TEMPERATURE}};
+    auto const values = camera.get_controls(ids);
+    assert(values.size() == 3 && values[0].value == 100 && values[1].value == 32 && values[2].value == 5000);
+
+    // clamped into range and onto the step before the driver sees them
+    const std::array<v4l2::ControlValue, 3> wild{{
+        {.id = V4L2_CID_EXPOSURE_ABSOLUTE, .value = 1'000'000},
+        {.id = V4L2_CID_GAIN, .value = -5},
+        {.id = V4L2_CID_WHITE_BALANCE_TEMPERATURE, .value = 4567},
+    }};
+    camera.set_controls(wild);
+    assert(value_of(camera, V4L2_CID_EXPOSURE_ABSOLUTE) == 2047);
+    assert(value_of(camera, V4L2_CID_GAIN) == 0);
+    assert(value_of(camera, V4L2_CID_WHITE_BALANCE_TEMPERATURE) == 4570);
+
+    // while streaming too, between frames
+    camera.start_streaming();
+    for (std::int64_t gain = 1; gain <= 3; ++gain)
+    {
+        [[maybe_unused]] auto lease = camera.capture_frame();
+        const std::array<v4l2::ControlValue, 1> step{{{.id = V4L2_CID_GAIN, .value = gain}}};
+        camera.set_controls(step);
+        assert(value_of(camera, V4L2_CID_GAIN) == gain);
+    }
+    camera.stop_streaming();
+}
+
+void test_errors(const fs::path &recording)
+{
+    fmt::print("Testing control errors\n");
+    auto camera = open_camera(recording);
+
+    // an unknown control fails the whole batch, nothing is set
+    const std::array<v4l2::ControlValue, 2> bad{{{.id = V4L2_CID_GAIN, .value = 99}, {.id = V4L2_CID_BRIGHTNESS, .value = 1}}};
+    try
+    {
+        camera.set_controls(bad);
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    assert(value_of(camera, V4L2_CID_GAIN) == 0);
+
+    // menus are clamped into their range like integers
+    const std::array<v4l2::ControlValue, 1> menu{{{.id = V4L2_CID_EXPOSURE_AUTO, .value = 7}}};
+    camera.set_controls(menu);
+    assert(value_of(camera, V4L2_CID_EXPOSURE_AUTO) == V4L2_EXPOSURE_APERTURE_PRIORITY);
+
+    v4l2::V4L2Camera closed(v4l2::V4l2Config{.device_path_ = "replay:///nowhere.v4lr"});
+    try
+    {
+        closed.set_controls(bad);
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+void test_events(const fs::path &recording)
+{
+    fmt::print("Testing control events\n");
+    auto camera = open_camera(recording);
+    assert(camera.subscribe_event(v4l2::CameraEventType::CTRL, V4L2_CID_GAIN));
+    std::vector<v4l2::CameraEvent> events;
+    camera.set_event_callback([&](const v4l2::CameraEvent &event) { events.push_back(event); });
+    camera.start_streaming();
+
+    const std::array<v4l2::ControlValue, 2> batch{{{.id = V4L2_CID_GAIN, .value = 77}, {.id = V4L2_CID_EXPOSURE_ABSOLUTE, .value = 300}}};
+    camera.set_controls(batch);
+    camera.set_controls(batch); // unchanged: no event
+    [[maybe_unused]] auto lease = camera.capture_frame();
+    assert(events.size() == 1 && events[0].type == v4l2::CameraEventType::CTRL);
+    assert(events[0].id == V4L2_CID_GAIN && events[0].value == 77 && (events[0].changes & V4L2_EVENT_CTRL_CH_VALUE));
+    lease.release();
+    camera.stop_streaming();
+}
+
+int main()
+{
+    fmt::print("Starting control tests\n");
+    const fixture::ScratchDir dir("controls");
+    auto const recording = fixture::make_recording(dir / "controls.v4lr", {.width = WIDTH, .height = HEIGHT, .frames = 4, .interval_us = 10'000});
+
+    test_enumerate(recording);
+    test_set_batch(recording);
+    test_errors(recording);
+    test_events(recording);
+
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "v4l2/convert.hpp"
+#include <algorithm>  // For std::equal
+#include <cassert>    // For assert
+#include <cstddef>    // For std::byte
+#include <fmt/core.h> // For fmt::print
+#include <stdexcept>  // For std::invalid_argument
+#include <vector>     // For std::vector
+
+// No camera needed: synthetic YUYV frames, the SIMD kernels must match the scalar reference byte for byte
+
+namespace
+{
+    constexpr v4l2::ConvertFormat all_formats[] = {v4l2::ConvertFormat::NV12, v4l2::ConvertFormat::I420,
+                                                   v4l2::ConvertFormat::GRAY8, v4l2::ConvertFormat::RGB,
+                                                   v4l2::ConvertFormat::BGR};
+
+    std::vector<std::byte> make_yuyv(std::uint32_t width, std::uint32_t height, std::uint32_t stride)
+    {
+        std::vector<std::byte> image(std::size_t{stride} * height);
+        std::uint32_t state = 0x12345678u ^ width ^ (height << 16);
+        for (auto &b : image)
+        {
+            state = state * 1664525u + 1013904223u; // LCG, full range incl. 0 and 255
+            b = static_cast<std::byte>(state >> 24);
+        }
+        return image;
+    }
+
+    v4l2::FrameView make_view(const std::vector<std::byte> &image, std::uint32_t width, std::uint32_t height, std::uint32_t stride)
+    {
+        return v4l2::FrameView{.image = image, .width = width, .height = height, .format = v4l2::PixelFormat::YUYV, .bytes_per_line = stride};
+    }
+} // namespace
+
+void test_converted_size()
+{
+    assert(v4l2::converted_size(v4l2::ConvertFormat::NV12, 640, 480) == 640 * 480 * 3 / 2);
+    assert(v4l2::converted_size(v4l2::ConvertFormat::I420, 640, 480) == 640 * 480 * 3 / 2);
+    assert(v4l2::converted_size(v4l2::ConvertFormat::GRAY8, 640, 480) == 640 * 480);
+    assert(v4l2::converted_size(v4l2::ConvertFormat::RGB, 640, 480) == 640 * 480 * 3);
+    assert(v4l2::converted_size(v4l2::ConvertFormat::NV12, 4, 3) == 4 * 3 + 4 * 2); // odd height keeps a chroma row
+}
+
+void test_known_values()
+{
+    // Y=16 is black, Y=235 white, U=V=128 grey axis
+    const std::vector<std::byte> image = {std::byte{16}, std::byte{128}, std::byte{235}, std::byte{128}};
+    const auto view = make_view(image, 2, 1, 4);
+
+    std::vector<std::byte> rgb(6);
+    v4l2::convert_yuyv(view, v4l2::ConvertFormat::RGB, rgb);
+    const std::vector<std::byte> expected = {std::byte{0}, std::byte{0}, std::byte{0},
+                                             std::byte{255}, std::byte{255}, std::byte{255}};
+    assert(rgb == expected);
+
+    std::vector<std::byte> gray(2);
+    v4l2::convert_yuyv(view, v4l2::ConvertFormat::GRAY8, gray);
+    assert(gray[0] == std::byte{16} && gray[1] == std::byte{235});
+}
+
+void test_kernels_match_scalar()
+{
+    fmt::print("Best conversion kernel: {}\n", v4l2::best_convert_kernel());
+
+    // widths around the 16/32 pixel SIMD steps, odd heights, padded strides
+    const std::uint32_t widths[] = {2, 14, 16, 30, 32, 34, 62, 64, 98, 640};
+    const std::uint32_t heights[] = {1, 2, 3, 7, 48};
+    for (auto const width : widths)
+    {
+        for (auto const height : heights)
+        {
+            for (auto const padding : {0u, 24u})
+            {
+                const std::uint32_t stride = width * 2 + padding;
+                const auto image = make_yuyv(width, height, stride);
+                const auto view = make_view(image, width, height, stride);
+                for (auto const format : all_formats)
+                {
+                    const auto size = v4l2::converted_size(format, width, height);
+                    std::vector<std::byte> best(size), scalar(size);
+                    v4l2::convert_yuyv(view, format, best, v4l2::ConvertKernel::BEST);
+                    v4l2::convert_yuyv(view, format, scalar, v4l2::ConvertKernel::SCALAR);
+                    if (best != scalar)
+                    {
+                        fmt::print("Mismatch: format {} {}x{} stride {}\n", static_cast<std::uint32_t>(format), width, height, stride);
+                        assert(false && "SIMD kernel differs from scalar reference");
+                    }
+                }
+            }
+        }
+    }
+}
+
+void test_rejects_bad_input()
+{
+    const auto image = make_yuyv(8, 2, 16);
+    std::vector<std::byte> out(v4l2::converted_size(v4l2::ConvertFormat::RGB, 8, 2));
+
+    auto const throws = [&](v4l2::FrameView view, std::size_t out_size)
+    {
+        try
+        {
+            v4l2::convert_yuyv(view, v4l2::ConvertFormat::RGB, std::span<std::byte>(out).first(out_size));
+        }
+        catch (const std::invalid_argument &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+            return true;
+        }
+        return false;
+    };
+
+    auto view = make_view(image, 8, 2, 16);
+    assert(throws(view, out.size() - 1));
+
+    view.format = v4l2::PixelFormat::MJPG;
+    assert(throws(view, out.size()));
+
+    view = make_view(image, 7, 2, 16);
+    assert(throws(view, out.size()));
+
+    view = make_view(image, 8, 3, 16); // image too short for three rows
+    assert(throws(view, out.size()));
+}
+
+int main()
+{
+    fmt::print("Starting conversion tests\n");
+    test_converted_size();
+    test_known_values();
+    test_kernels_match_scalar();
+    test_rejects_bad_input();
+    fmt::print("Success\n");
+    return 0;
+}
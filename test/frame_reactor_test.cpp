@@ -0,0 +1,217 @@
+#include "v4l2/frame_reactor.hpp"
+#include "replay_fixture.hpp"
+#include <cassert>    // For assert
+#include <chrono>     // For std::chrono
+#include <coroutine>  // For std::coroutine_handle, std::suspend_always
+#include <exception>  // For std::exception_ptr
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <stdexcept>  // For std::invalid_argument
+#include <stop_token> // For std::stop_source
+#include <thread>     // For std::jthread
+#include <utility>    // For std::exchange
+#include <vector>     // For std::vector
+
+// No camera needed: replay:// recordings stand in for the devices
+
+namespace
+{
+    namespace fs = std::filesystem;
+    using namespace std::chrono_literals;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+
+    // Minimal eager coroutine, what an application's task type would be; the frame lives as long as the Task
+    struct Task
+    {
+        struct promise_type
+        {
+            std::exception_ptr error;
+
+            Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+        };
+
+        explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+        Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+        Task &operator=(Task &&) = delete;
+        ~Task()
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+            }
+        }
+
+        [[nodiscard]] bool done() const noexcept { return handle_.done(); }
+        [[nodiscard]] std::exception_ptr error() const noexcept { return handle_.promise().error; }
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    v4l2::V4L2Camera streaming_camera(const fs::path &recording, const char *rate)
+    {
+        v4l2::V4L2Camera camera(v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}?rate={}", recording.string(), rate),
+                                                 .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                                 .format_ = v4l2::PixelFormat::YUYV,
+                                                 .buffer_count_ = 4});
+        camera.open_device();
+        camera.configure();
+        camera.start_streaming();
+        return camera;
+    }
+
+    Task take_frames(v4l2::FrameReactor &reactor, v4l2::V4L2Camera &camera, std::uint32_t count, std::vector<std::uint32_t> &sequences)
+    {
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            auto frame = co_await reactor.next_frame(camera, 1s);
+            assert(frame && (*frame)->width == WIDTH);
+            sequences.push_back((*frame)->sequence);
+        }
+    }
+
+    // 📸 the outcome of a single co_await: 1 a frame, 0 nothing, -1 it threw
+    Task wait_once(v4l2::FrameReactor &reactor, v4l2::V4L2Camera &camera, std::chrono::microseconds timeout,
+                   std::stop_token stop, int &outcome)
+    {
+        try
+        {
+            auto frame = co_await reactor.next_frame(camera, timeout, std::move(stop));
+            outcome = frame ? 1 : 0;
+        }
+        catch (const std::invalid_argument &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+            outcome = -1;
+        }
+    }
+
+    void run_all(v4l2::FrameReactor &reactor)
+    {
+        while (reactor.pending() > 0)
+        {
+            reactor.run_once(-1us);
+        }
+    }
+} // namespace
+
+void test_two_cameras(const fs::path &recording)
+{
+    fmt::print("Testing two cameras on one thread\n");
+    auto fast = streaming_camera(recording, "100");
+    auto slow = streaming_camera(recording, "50");
+    v4l2::FrameReactor reactor;
+
+    std::vector<std::uint32_t> fast_sequences;
+    std::vector<std::uint32_t> slow_sequences;
+    auto a = take_frames(reactor, fast, 6, fast_sequences);
+    auto b = take_frames(reactor, slow, 3, slow_sequences);
+    run_all(reactor);
+
+    assert(a.done() && b.done() && !a.error() && !b.error());
+    assert(fast_sequences.size() == 6 && slow_sequences.size() == 3);
+    for (std::size_t i = 1; i < fast_sequences.size(); ++i)
+    {
+        assert(fast_sequences[i] == fast_sequences[i - 1] + 1); // nothing lost in between
+    }
+    fast.stop_streaming();
+    slow.stop_streaming();
+}
+
+void test_timeout(const fs::path &recording)
+{
+    fmt::print("Testing timeouts\n");
+    auto camera = streaming_camera(recording, "2");
+    v4l2::FrameReactor reactor;
+    int outcome = 2;
+    auto first = wait_once(reactor, camera, 2s, {}, outcome);
+    run_all(reactor);
+    assert(outcome == 1);
+
+    // the next one is half a second away
+    auto const start = std::chrono::steady_clock::now();
+    auto task = wait_once(reactor, camera, 20ms, {}, outcome);
+    assert(reactor.pending() == 1 && reactor.next_timeout() <= 20ms);
+    run_all(reactor);
+    auto const waited = std::chrono::steady_clock::now() - start;
+    assert(task.done() && outcome == 0);
+    assert(waited >= 20ms && waited < 400ms);
+
+    // no waiting at all with a zero timeout
+    auto now = wait_once(reactor, camera, 0us, {}, outcome);
+    assert(now.done() && outcome == 0 && reactor.pending() == 0);
+    camera.stop_streaming();
+}
+
+void test_cancel(const fs::path &recording)
+{
+    fmt::print("Testing cancellation\n");
+    auto camera = streaming_camera(recording, "2");
+    v4l2::FrameReactor reactor;
+    int outcome = 2;
+    auto first = wait_once(reactor, camera, 2s, {}, outcome);
+    run_all(reactor);
+
+    // 🛑 from another thread, while run_once() sleeps
+    std::stop_source stop;
+    auto task = wait_once(reactor, camera, -1us, stop.get_token(), outcome);
+    assert(reactor.pending() == 1);
+    std::jthread canceller([&]
+                           {
+                               std::this_thread::sleep_for(20ms);
+                               stop.request_stop(); });
+    auto const start = std::chrono::steady_clock::now();
+    assert(reactor.run_once(-1us) == 1);
+    assert(task.done() && outcome == 0 && std::chrono::steady_clock::now() - start < 400ms);
+
+    // already stopped: done without suspending
+    auto again = wait_once(reactor, camera, -1us, stop.get_token(), outcome);
+    assert(again.done() && outcome == 0);
+    camera.stop_streaming();
+}
+
+void test_one_waiter_per_camera(const fs::path &recording)
+{
+    fmt::print("Testing two waiters on one camera\n");
+    auto camera = streaming_camera(recording, "2");
+    v4l2::FrameReactor reactor;
+    int outcome = 2;
+    auto first = wait_once(reactor, camera, 2s, {}, outcome);
+    run_all(reactor);
+
+    int second_outcome = 2;
+    auto waiting = wait_once(reactor, camera, 2s, {}, outcome);
+    auto second = wait_once(reactor, camera, 2s, {}, second_outcome);
+    assert(second.done() && second_outcome == -1);
+    assert(reactor.pending() == 1);
+
+    // destroying a suspended coroutine takes it out of the reactor
+    {
+        auto dropped = std::move(waiting);
+    }
+    assert(reactor.pending() == 0);
+    assert(reactor.run_once(0us) == 0);
+    camera.stop_streaming();
+}
+
+int main()
+{
+    fmt::print("Starting frame reactor tests\n");
+    const fixture::ScratchDir dir("reactor");
+    auto const recording = fixture::make_recording(dir / "reactor.v4lr", {.width = WIDTH, .height = HEIGHT, .interval_us = 10'000});
+
+    test_two_cameras(recording);
+    test_timeout(recording);
+    test_cancel(recording);
+    test_one_waiter_per_camera(recording);
+
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "v4l2/frame_sync.hpp"
+#include "replay_fixture.hpp"
+#include <cassert>    // For assert
+#include <chrono>     // For std::chrono
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <stdexcept>  // For std::invalid_argument, std::out_of_range, std::runtime_error
+#include <thread>     // For std::jthread, std::this_thread
+#include <utility>    // For std::pair
+
+// No camera needed: replay:// recordings stand in for the devices
+
+namespace
+{
+    namespace fs = std::filesystem;
+    using namespace std::chrono_literals;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+
+    v4l2::V4l2Config replay_config(const fs::path &recording, const char *rate)
+    {
+        return v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}?rate={}&loop=1", recording.string(), rate),
+                                .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                .format_ = v4l2::PixelFormat::YUYV,
+                                .buffer_count_ = 4};
+    }
+
+    v4l2::V4L2Camera streaming_camera(const fs::path &recording)
+    {
+        v4l2::V4L2Camera camera(replay_config(recording, "max"));
+        camera.open_device();
+        camera.configure();
+        camera.start_streaming();
+        return camera;
+    }
+
+    // Max speed frames are a few microseconds apart: at this tolerance every frame has a partner, the push order decides
+    constexpr v4l2::FrameSyncConfig MANUAL{.tolerance_ = 1s, .max_wait_ = 10s, .max_pending_ = 1};
+} // namespace
+
+void test_complete_sets(const fs::path &recording)
+{
+    fmt::print("Testing complete sets\n");
+    auto left = streaming_camera(recording);
+    auto right = streaming_camera(recording);
+    v4l2::FrameSynchronizer sync(2, MANUAL);
+    assert(sync.size() == 2);
+
+    sync.push(0, left.capture_frame());
+    assert(!sync.pop(0us)); // the right camera may still deliver
+    sync.push(1, right.capture_frame());
+    auto set = sync.pop(0us);
+    assert(set && set->number == 0 && set->frames.size() == 2);
+    assert(set->frames[0] && set->frames[1] && !set->repeated[0] && !set->repeated[1]);
+    assert(set->timestamp_us == std::min((*set->frames[0])->v4l2_timestamp_us, (*set->frames[1])->v4l2_timestamp_us));
+    assert(set->spread_us <= 1'000'000);
+
+    sync.push(1, right.capture_frame());
+    sync.push(0, left.capture_frame());
+    auto next = sync.pop(0us);
+    assert(next && next->number == 1);
+    assert((*next->frames[0])->sequence == (*set->frames[0])->sequence + 1);
+    assert(sync.stats().sets == 2 && sync.stats().incomplete_sets == 0);
+}
+
+void test_drop(const fs::path &recording)
+{
+    fmt::print("Testing DROP with a camera missing\n");
+    auto left = streaming_camera(recording);
+    auto right = streaming_camera(recording);
+    v4l2::FrameSynchronizer sync(2, MANUAL);
+
+    // a second frame over max_pending_: the right camera is given up on for the first one
+    sync.push(0, left.capture_frame());
+    sync.push(0, left.capture_frame());
+    assert(!sync.pop(0us));
+    auto stats = sync.stats();
+    assert(stats.incomplete_sets == 1 && stats.dropped_frames == 1);
+
+    sync.push(1, right.capture_frame());
+    auto set = sync.pop(0us);
+    assert(set && set->number == 0 && !set->repeated[0] && !set->repeated[1]);
+    assert((*set->frames[0])->sequence == 1);
+}
+
+void test_repeat_last(const fs::path &recording)
+{
+    fmt::print("Testing REPEAT_LAST with a camera missing\n");
+    auto left = streaming_camera(recording);
+    auto right = streaming_camera(recording);
+    auto config = MANUAL;
+    config.missing_ = v4l2::MissingFramePolicy::REPEAT_LAST;
+    config.max_pending_ = 2;
+    v4l2::FrameSynchronizer sync(2, config);
+
+    // nothing to repeat yet: dropped like DROP would
+    for (int i = 0; i < 3; ++i)
+    {
+        sync.push(0, left.capture_frame());
+    }
+    assert(!sync.pop(0us) && sync.stats().dropped_frames == 1);
+    sync.clear();
+
+    sync.push(0, left.capture_frame());
+    sync.push(1, right.capture_frame());
+    for (int i = 0; i < 3; ++i)
+    {
+        sync.push(0, left.capture_frame());
+    }
+    auto first = sync.pop(0us);
+    auto second = sync.pop(0us);
+    assert(first && second && second->number == first->number + 1);
+    assert(!first->repeated[1] && second->repeated[1] && !second->repeated[0]);
+    assert(second->frames[1] == first->frames[1]); // the same buffer, shared
+    auto const stats = sync.stats();
+    assert(stats.incomplete_sets == 2 && stats.repeated_frames == 1);
+}
+
+void test_paced_group(const fs::path &recording)
+{
+    fmt::print("Testing a 50 fps and a 25 fps camera in one group\n");
+    v4l2::CameraGroup group;
+    group.add_camera(replay_config(recording, "50"));
+    group.add_camera(replay_config(recording, "25"));
+    {
+        // 🎞 every other 50 fps frame has no partner
+        v4l2::FrameSynchronizer sync(2, v4l2::FrameSyncConfig{.tolerance_ = 8ms});
+        sync.start(group);
+        std::uint64_t previous_us = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            auto set = sync.pop(1s);
+            assert(set && set->frames[0] && set->frames[1]);
+            assert(set->spread_us <= 8'000);
+            auto const left_us = (*set->frames[0])->v4l2_timestamp_us;
+            auto const right_us = (*set->frames[1])->v4l2_timestamp_us;
+            assert(set->timestamp_us == std::min(left_us, right_us));
+            assert(previous_us == 0 || set->timestamp_us - previous_us >= 30'000);
+            previous_us = set->timestamp_us;
+        }
+        group.stop();
+        auto const stats = sync.stats();
+        fmt::print("  {} sets, {} frames without a partner\n", stats.sets, stats.dropped_frames);
+        assert(stats.sets == 8 && stats.dropped_frames >= 6);
+    }
+}
+
+void test_interrupt_and_fail()
+{
+    fmt::print("Testing interrupt and fail\n");
+    v4l2::FrameSynchronizer sync(3);
+    {
+        std::jthread waker([&]
+                           {
+                               std::this_thread::sleep_for(20ms);
+                               sync.interrupt(); });
+        assert(!sync.pop(-1us));
+    }
+    assert(!sync.pop(0us)); // still signalled
+    sync.clear_interrupt();
+    assert(!sync.pop(1ms));
+
+    sync.fail("camera 2 failed: gone");
+    try
+    {
+        static_cast<void>(sync.pop(1s));
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    sync.clear();
+    assert(!sync.pop(0us));
+}
+
+void test_invalid_arguments()
+{
+    fmt::print("Testing invalid arguments\n");
+    for (auto const &[cameras, pending] : {std::pair<std::size_t, std::size_t>{0, 2}, std::pair<std::size_t, std::size_t>{2, 0}})
+    {
+        try
+        {
+            v4l2::FrameSynchronizer sync(cameras, v4l2::FrameSyncConfig{.max_pending_ = pending});
+            assert(false && "should have thrown");
+        }
+        catch (const std::invalid_argument &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+    }
+
+    v4l2::FrameSynchronizer sync(2);
+    try
+    {
+        sync.push(2, v4l2::FrameLease{});
+        assert(false && "should have thrown");
+    }
+    catch (const std::out_of_range &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    v4l2::CameraGroup group;
+    try
+    {
+        sync.start(group);
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+int main()
+{
+    fmt::print("Starting frame synchronizer tests\n");
+    const fixture::ScratchDir dir("frame-sync");
+    auto const recording = fixture::make_recording(dir / "sync.v4lr", {.width = WIDTH, .height = HEIGHT, .interval_us = 20'000});
+
+    test_complete_sets(recording);
+    test_drop(recording);
+    test_repeat_last(recording);
+    test_paced_group(recording);
+    test_interrupt_and_fail();
+    test_invalid_arguments();
+
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "v4l2/jpeg.hpp"
+#include <cassert>    // For assert
+#include <chrono>     // For std::chrono::steady_clock
+#include <cstddef>    // For std::byte
+#include <fmt/core.h> // For fmt::print
+#include <stdexcept>  // For std::invalid_argument
+#include <vector>     // For std::vector
+
+// No camera needed: synthetic MJPEG frames, the scanner only looks at markers, never at the entropy data
+
+namespace
+{
+    void put(std::vector<std::byte> &out, std::initializer_list<int> bytes)
+    {
+        for (auto const b : bytes)
+        {
+            out.push_back(static_cast<std::byte>(b));
+        }
+    }
+
+    // SOI, APP0, DQT, SOF0, [DHT], SOS, entropy data, EOI, like a UVC camera sends it
+    std::vector<std::byte> make_jpeg(int width, int height, bool with_dht, std::size_t entropy_bytes)
+    {
+        std::vector<std::byte> out;
+        put(out, {0xFF, 0xD8});
+        put(out, {0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0});
+        put(out, {0xFF, 0xDB, 0x00, 0x43, 0x00});
+        out.insert(out.end(), 64, std::byte{1});
+        put(out, {0xFF, 0xC0, 0x00, 0x11, 0x08, height >> 8, height & 0xFF, width >> 8, width & 0xFF, 3,
+                  1, 0x21, 0, 2, 0x11, 0, 3, 0x11, 0});
+        if (with_dht)
+        {
+            auto const dht = v4l2::standard_dht_segment();
+            out.insert(out.end(), dht.begin(), dht.end());
+        }
+        put(out, {0xFF, 0xDA, 0x00, 0x0C, 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0});
+        for (std::size_t i = 0; i < entropy_bytes; ++i)
+        {
+            out.push_back(static_cast<std::byte>(i % 0xFF)); // never 0xFF, no stuffing needed
+        }
+        put(out, {0xFF, 0xD9});
+        return out;
+    }
+} // namespace
+
+void test_valid_frame()
+{
+    auto const jpeg = make_jpeg(3840, 2160, true, 1000);
+    auto const info = v4l2::scan_jpeg(jpeg);
+    assert(info.ok());
+    assert(info.width == 3840 && info.height == 2160);
+    assert(info.has_dht);
+    assert(info.size == jpeg.size());
+}
+
+void test_padding_after_eoi()
+{
+    auto jpeg = make_jpeg(1280, 720, false, 100);
+    const std::size_t real_size = jpeg.size();
+    jpeg.resize(real_size + 4096); // bytesused rounded up, zero-filled
+    auto const info = v4l2::scan_jpeg(jpeg);
+    assert(info.ok());
+    assert(!info.has_dht);
+    assert(info.size == real_size);
+}
+
+void test_corrupt_frames()
+{
+    auto const jpeg = make_jpeg(1280, 720, true, 1000);
+
+    assert(v4l2::scan_jpeg({}).status == v4l2::JpegStatus::NO_SOI);
+    assert(v4l2::scan_jpeg(std::span(jpeg).subspan(2)).status == v4l2::JpegStatus::NO_SOI);
+
+    // cut short on the bus: EOI missing
+    assert(v4l2::scan_jpeg(std::span(jpeg).first(jpeg.size() - 300)).status == v4l2::JpegStatus::NO_EOI);
+
+    // cut inside the headers: the DHT segment runs past the end
+    assert(v4l2::scan_jpeg(std::span(jpeg).first(200)).status == v4l2::JpegStatus::TRUNCATED);
+
+    auto garbage = jpeg;
+    garbage[20] = std::byte{0x42}; // where the DQT marker should be
+    assert(v4l2::scan_jpeg(garbage).status == v4l2::JpegStatus::BAD_MARKER);
+
+    auto const zero_size = make_jpeg(0, 720, true, 10);
+    assert(v4l2::scan_jpeg(zero_size).status == v4l2::JpegStatus::NO_SOF);
+}
+
+void test_insert_dht()
+{
+    auto jpeg = make_jpeg(1920, 1080, false, 500);
+    jpeg.resize(jpeg.size() + 64);
+    auto const info = v4l2::scan_jpeg(jpeg);
+    assert(info.ok() && !info.has_dht);
+
+    std::vector<std::byte> fixed(info.size + v4l2::standard_dht_segment().size());
+    const std::size_t written = v4l2::insert_standard_dht(jpeg, info, fixed);
+    assert(written == fixed.size());
+    assert(fixed == make_jpeg(1920, 1080, true, 500));
+
+    auto const rescan = v4l2::scan_jpeg(fixed);
+    assert(rescan.ok() && rescan.has_dht);
+
+    try
+    {
+        std::vector<std::byte> small(written - 1);
+        (void)v4l2::insert_standard_dht(jpeg, info, small);
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+void test_scan_cost()
+{
+    // 4K MJPEG frames are a few MB, the scan must not depend on that
+    auto const jpeg = make_jpeg(3840, 2160, false, 4 * 1024 * 1024);
+    constexpr int rounds = 1000;
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t ok = 0;
+    for (int i = 0; i < rounds; ++i)
+    {
+        ok += v4l2::scan_jpeg(jpeg).ok() ? 1u : 0u;
+    }
+    const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+    assert(ok == rounds);
+    fmt::print("scan_jpeg on {} bytes: {:.3f} us per frame\n", jpeg.size(), elapsed.count() / rounds);
+}
+
+int main()
+{
+    fmt::print("Starting JPEG scanner tests\n");
+    test_valid_frame();
+    test_padding_after_eoi();
+    test_corrupt_frames();
+    test_insert_dht();
+    test_scan_cost();
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "v4l2/latency_histogram.hpp"
+#include <cassert>    // For assert
+#include <fmt/core.h> // For fmt::print
+#include <thread>     // For std::jthread
+#include <vector>     // For std::vector
+
+// No camera needed: the histogram is plain counters
+
+void test_buckets()
+{
+    // exact below 8 us, then every bucket bound within 12.5% of what it holds
+    for (std::uint64_t us = 0; us < 8; ++us)
+    {
+        assert(v4l2::LatencyHistogram::upper_bound(v4l2::LatencyHistogram::bucket_of(us)) == us);
+    }
+    std::size_t previous = 0;
+    for (std::uint64_t us = 1; us < (std::uint64_t{1} << 32); us = us * 17 / 16 + 1)
+    {
+        const std::size_t bucket = v4l2::LatencyHistogram::bucket_of(us);
+        assert(bucket >= previous && bucket < v4l2::LatencyHistogram::BUCKETS);
+        const std::uint64_t bound = v4l2::LatencyHistogram::upper_bound(bucket);
+        assert(bound >= us && bound - us <= us / 8);
+        previous = bucket;
+    }
+    assert(v4l2::LatencyHistogram::bucket_of(~std::uint64_t{0}) == v4l2::LatencyHistogram::BUCKETS - 1);
+}
+
+void test_percentiles()
+{
+    v4l2::LatencyHistogram histogram;
+    assert(histogram.summary().count == 0 && histogram.summary().p99_us == 0);
+
+    // 1000 frames at 1..1000 us
+    for (std::uint64_t us = 1; us <= 1000; ++us)
+    {
+        histogram.record(us);
+    }
+    auto const summary = histogram.summary();
+    assert(summary.count == 1000 && summary.max_us == 1000);
+    assert(summary.p50_us >= 500 && summary.p50_us <= 500 + 500 / 8);
+    assert(summary.p99_us >= 990 && summary.p99_us <= 1000);
+    assert(summary.p999_us >= 999 && summary.p999_us <= 1000);
+    fmt::print("p50 {} p99 {} p99.9 {} max {}\n", summary.p50_us, summary.p99_us, summary.p999_us, summary.max_us);
+
+    // one outlier in a thousand shows up in p99.9 only
+    v4l2::LatencyHistogram spiky;
+    for (int i = 0; i < 999; ++i)
+    {
+        spiky.record(100);
+    }
+    spiky.record(50'000);
+    auto const spikes = spiky.summary();
+    assert(spikes.p99_us < 120 && spikes.p999_us < 120 && spikes.max_us == 50'000);
+
+    histogram.reset();
+    assert(histogram.summary().count == 0 && histogram.summary().max_us == 0);
+}
+
+void test_concurrent_readers()
+{
+    // writers on three threads, a reader that never sees a count go backwards
+    v4l2::LatencyHistogram histogram;
+    constexpr std::uint64_t per_thread = 200'000;
+    {
+        std::vector<std::jthread> writers;
+        for (std::uint64_t t = 0; t < 3; ++t)
+        {
+            writers.emplace_back([&histogram, t]
+                                 {
+                                     for (std::uint64_t i = 0; i < per_thread; ++i)
+                                     {
+                                         histogram.record((i % 5000) + t);
+                                     } });
+        }
+        std::uint64_t last = 0;
+        while (last < 3 * per_thread)
+        {
+            auto const summary = histogram.summary();
+            assert(summary.count >= last);
+            last = summary.count;
+        }
+    }
+    auto const summary = histogram.summary();
+    assert(summary.count == 3 * per_thread && summary.max_us == 4999 + 2);
+}
+
+int main()
+{
+    fmt::print("Starting latency histogram tests\n");
+    test_buckets();
+    test_percentiles();
+    test_concurrent_readers();
+    fmt::print("Success\n");
+    return 0;
+}
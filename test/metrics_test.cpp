@@ -0,0 +1,279 @@
+#include "v4l2/metrics.hpp"
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <array>        // For std::array
+#include <cassert>      // For assert
+#include <chrono>       // For std::chrono
+#include <filesystem>   // For std::filesystem
+#include <fmt/core.h>   // For fmt::print
+#include <memory>       // For std::make_shared
+#include <netinet/in.h> // For sockaddr_in
+#include <arpa/inet.h>  // For inet_pton
+#include <stdexcept>    // For std::invalid_argument
+#include <string>       // For std::string
+#include <sys/socket.h> // For socket, connect
+#include <sys/un.h>     // For sockaddr_un
+#include <thread>       // For std::this_thread
+#include <unistd.h>     // For close
+#include <vector>       // For std::vector
+
+// No camera needed: a replay:// recording stands in for the device
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+    constexpr std::size_t FRAME_BYTES = std::size_t{WIDTH} * HEIGHT * 2;
+
+    v4l2::V4L2Camera streaming_camera(const fs::path &recording)
+    {
+        v4l2::V4L2Camera camera(v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}?rate=max&loop=0", recording.string()),
+                                                 .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                                 .format_ = v4l2::PixelFormat::YUYV,
+                                                 .buffer_count_ = 4});
+        camera.open_device();
+        camera.configure();
+        camera.start_streaming();
+        return camera;
+    }
+
+    // One HTTP GET over an already connected socket, the whole answer
+    std::string scrape(int fd)
+    {
+        const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+        assert(send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size()));
+        std::string response;
+        std::array<char, 4096> chunk{};
+        while (true)
+        {
+            auto const received = recv(fd, chunk.data(), chunk.size(), 0);
+            if (received <= 0)
+            {
+                break;
+            }
+            response.append(chunk.data(), static_cast<std::size_t>(received));
+        }
+        close(fd);
+        return response;
+    }
+
+    int connect_tcp(const std::string &address)
+    {
+        auto const colon = address.rfind(':');
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(std::stoul(address.substr(colon + 1))));
+        assert(inet_pton(AF_INET, address.substr(0, colon).c_str(), &addr.sin_addr) == 1);
+        const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        assert(fd >= 0 && connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0);
+        return fd;
+    }
+
+    int connect_unix(const std::string &path)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        assert(fd >= 0 && connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0);
+        return fd;
+    }
+} // namespace
+
+void test_counters(const fs::path &recording)
+{
+    fmt::print("Testing camera counters and gauges\n");
+    auto camera = streaming_camera(recording);
+    auto const metrics = camera.metrics();
+    assert(metrics);
+
+    auto before = metrics->snapshot();
+    assert(before.frames == 0 && before.buffers == 4 && before.queued == 4 && before.last_frame_us == 0);
+    assert(before.nominal_fps > 0);
+
+    {
+        auto first = camera.capture_frame();
+        auto second = camera.capture_frame();
+        auto const held = metrics->snapshot();
+        assert(held.frames == 2 && held.leased == 2 && held.queued == 2 && held.bytes == 2 * FRAME_BYTES);
+        assert(held.last_frame_us == second->timestamp_monotonic_us);
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        static_cast<void>(camera.capture_frame());
+    }
+
+    auto const after = metrics->snapshot();
+    assert(after.frames == 5 && after.leased == 0 && after.queued == 4);
+    assert(after.sequence_gaps == 0 && after.lost_frames == 0 && after.errored_buffers == 0); // replay numbers frames itself
+    assert(after.lease_hold.count == 5 && after.requeue.count >= 5);
+
+    // 🔁 configure() starts stats() and latency() over, the exported counters keep counting
+    camera.stop_streaming();
+    camera.configure();
+    assert(metrics->snapshot().frames == 5 && metrics->snapshot().lease_hold.count == 5);
+
+    // moving the camera moves its metrics along
+    auto moved = std::move(camera);
+    assert(moved.metrics() == metrics && !camera.metrics());
+}
+
+void test_registry(const fs::path &recording)
+{
+    fmt::print("Testing the registry\n");
+    v4l2::MetricsRegistry registry;
+    {
+        auto left = streaming_camera(recording);
+        auto right = streaming_camera(recording);
+        registry.add("left", left.metrics());
+        registry.add("right", right.metrics());
+        static_cast<void>(left.capture_frame());
+
+        auto cameras = registry.snapshot();
+        assert(cameras.size() == 2 && cameras[0].camera == "left" && cameras[1].camera == "right");
+        assert(cameras[0].frames == 1 && cameras[1].frames == 0);
+        assert(cameras[0].device.starts_with("replay://"));
+
+        registry.add("left", right.metrics()); // a restarted element takes over its name
+        cameras = registry.snapshot();
+        assert(cameras.size() == 2 && cameras[0].camera == "left" && cameras[0].frames == 0);
+        registry.remove("left");
+        assert(registry.snapshot().size() == 1);
+    }
+    assert(registry.snapshot().empty()); // destroyed cameras drop out
+
+    try
+    {
+        registry.add("", nullptr);
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+void test_prometheus()
+{
+    fmt::print("Testing the Prometheus text format\n");
+    std::vector<v4l2::CameraMetricsSnapshot> cameras(1);
+    cameras[0].camera = "cam\"0";
+    cameras[0].device = "/dev/video0";
+    cameras[0].frames = 42;
+    cameras[0].buffers = 4;
+    cameras[0].queued = 3;
+    cameras[0].requeue = v4l2::LatencySummary{.count = 2, .p50_us = 10, .p99_us = 20, .p999_us = 20, .max_us = 20};
+    cameras[0].requeue_sum_us = 30;
+
+    auto const text = v4l2::to_prometheus(cameras);
+    assert(text.find("# TYPE v4l2_frames_total counter\n") != std::string::npos);
+    assert(text.find("v4l2_frames_total{camera=\"cam\\\"0\",device=\"/dev/video0\"} 42\n") != std::string::npos);
+    assert(text.find("v4l2_queued_buffers{camera=\"cam\\\"0\",device=\"/dev/video0\"} 3\n") != std::string::npos);
+    assert(text.find("v4l2_last_frame_age_seconds{camera=\"cam\\\"0\",device=\"/dev/video0\"} NaN\n") != std::string::npos);
+    assert(text.find("# TYPE v4l2_requeue_latency_seconds summary\n") != std::string::npos);
+    assert(text.find("v4l2_requeue_latency_seconds{camera=\"cam\\\"0\",device=\"/dev/video0\",quantile=\"0.99\"} 2e-05\n") != std::string::npos);
+    assert(text.find("v4l2_requeue_latency_seconds_sum{camera=\"cam\\\"0\",device=\"/dev/video0\"} 3e-05\n") != std::string::npos);
+    assert(text.find("v4l2_requeue_latency_seconds_count{camera=\"cam\\\"0\",device=\"/dev/video0\"} 2\n") != std::string::npos);
+    assert(v4l2::to_prometheus({}).find("# TYPE v4l2_frames_total counter") != std::string::npos);
+}
+
+void test_exporter(const fs::path &recording, const fs::path &dir)
+{
+    fmt::print("Testing the exporter over TCP and a Unix socket\n");
+    v4l2::MetricsRegistry registry;
+    auto camera = streaming_camera(recording);
+    registry.add("cam0", camera.metrics());
+    static_cast<void>(camera.capture_frame());
+
+    {
+        v4l2::MetricsExporter tcp({.listen_ = "127.0.0.1:0", .registry_ = &registry});
+        assert(tcp.address().starts_with("127.0.0.1:") && !tcp.address().ends_with(":0"));
+        auto const response = scrape(connect_tcp(tcp.address()));
+        assert(response.starts_with("HTTP/1.0 200 OK\r\n"));
+        assert(response.find("Content-Type: text/plain; version=0.0.4") != std::string::npos);
+        assert(response.find("v4l2_frames_total{camera=\"cam0\"") != std::string::npos);
+        fmt::print("  {} bytes from {}\n", response.size(), tcp.address());
+
+        const int fd = connect_tcp(tcp.address());
+        const std::string post = "POST /metrics HTTP/1.0\r\n\r\n";
+        assert(send(fd, post.data(), post.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(post.size()));
+        std::array<char, 256> reply{};
+        assert(recv(fd, reply.data(), reply.size(), 0) > 0 && std::string(reply.data()).starts_with("HTTP/1.0 405"));
+        close(fd);
+    }
+
+    auto const path = (dir / "metrics.sock").string();
+    {
+        v4l2::MetricsExporter unix_socket({.listen_ = "unix:" + path, .registry_ = &registry});
+        assert(fs::exists(path));
+        auto const response = scrape(connect_unix(path));
+        assert(response.starts_with("HTTP/1.0 200 OK\r\n") && response.find("v4l2_buffers{camera=\"cam0\"") != std::string::npos);
+    }
+    assert(!fs::exists(path)); // unlinked again
+
+    // one exporter per address, shared by whoever asks
+    {
+        auto const a = v4l2::MetricsExporter::shared("unix:" + path);
+        auto const b = v4l2::MetricsExporter::shared("unix:" + path);
+        assert(a == b);
+    }
+    assert(!fs::exists(path));
+
+    for (auto const *bad : {"nowhere", "127.0.0.1:http", "unix:"})
+    {
+        try
+        {
+            v4l2::MetricsExporter exporter({.listen_ = bad, .registry_ = &registry});
+            assert(false && "should have thrown");
+        }
+        catch (const std::invalid_argument &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+    }
+}
+
+// A scraper that asks and then stops reading must not keep the exporter, and so its owner, from shutting down
+void test_stalled_scraper(const fs::path &dir)
+{
+    fmt::print("Testing an exporter with a scraper that stops reading\n");
+    v4l2::MetricsRegistry registry;
+    std::vector<std::shared_ptr<v4l2::CameraMetrics>> cameras;
+    for (int i = 0; i < 4000; ++i) // megabytes of text, far more than the socket buffers hold
+    {
+        cameras.push_back(std::make_shared<v4l2::CameraMetrics>(fmt::format("/dev/video{}", i)));
+        registry.add(fmt::format("cam{}", i), cameras.back());
+    }
+
+    auto const path = (dir / "stalled.sock").string();
+    auto exporter = std::make_unique<v4l2::MetricsExporter>(v4l2::MetricsExporterConfig{.listen_ = "unix:" + path, .registry_ = &registry});
+    const int fd = connect_unix(path);
+    const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    assert(send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // the answer is being written and stuck
+
+    auto const start = std::chrono::steady_clock::now();
+    exporter.reset();
+    auto const took = std::chrono::steady_clock::now() - start;
+    fmt::print("  destroyed after {} ms\n", std::chrono::duration_cast<std::chrono::milliseconds>(took).count());
+    assert(took < std::chrono::seconds(5));
+    close(fd);
+}
+
+int main()
+{
+    fmt::print("Starting metrics tests\n");
+    const fixture::ScratchDir dir("metrics");
+    auto const recording = fixture::make_recording(dir / "metrics.v4lr", {.width = WIDTH, .height = HEIGHT, .interval_us = 20'000});
+
+    test_counters(recording);
+    test_registry(recording);
+    test_prometheus();
+    test_exporter(recording, dir.path());
+    test_stalled_scraper(dir.path());
+
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "v4l2/mjpeg_decoder.hpp"
+#include <cassert>    // For assert
+#include <cstdio>     // For FILE, jpeglib.h needs it
+#include <cstdlib>    // For std::free
+#include <fmt/core.h> // For fmt::print
+#include <jpeglib.h>  // For encoding test frames
+#include <stdexcept>  // For std::invalid_argument
+#include <vector>     // For std::vector
+
+// No camera needed: frames are encoded here with libjpeg in the subsamplings cameras use
+
+namespace
+{
+    struct Sampling
+    {
+        const char *name;
+        int h; // luma factors, chroma is always 1x1
+        int v;
+    };
+
+    constexpr Sampling samplings[] = {{"4:2:0", 2, 2}, {"4:2:2", 2, 1}, {"4:4:4", 1, 1}};
+
+    // A smooth YCbCr gradient, chroma changes slowly so the 4:2:0 average stays close to the source
+    std::vector<unsigned char> make_ycbcr(int width, int height)
+    {
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(width * height * 3));
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                auto *p = &pixels[static_cast<std::size_t>((y * width + x) * 3)];
+                p[0] = static_cast<unsigned char>(16 + (x * 200) / width);
+                p[1] = static_cast<unsigned char>(64 + (y * 128) / height);
+                p[2] = 100;
+            }
+        }
+        return pixels;
+    }
+
+    std::vector<std::byte> encode(const std::vector<unsigned char> &pixels, int width, int height, int components, Sampling sampling)
+    {
+        jpeg_compress_struct cinfo{};
+        jpeg_error_mgr err{};
+        cinfo.err = jpeg_std_error(&err);
+        jpeg_create_compress(&cinfo);
+        unsigned char *buffer = nullptr;
+        unsigned long size = 0;
+        jpeg_mem_dest(&cinfo, &buffer, &size);
+
+        cinfo.image_width = static_cast<JDIMENSION>(width);
+        cinfo.image_height = static_cast<JDIMENSION>(height);
+        cinfo.input_components = components;
+        cinfo.in_color_space = components == 1 ? JCS_GRAYSCALE : JCS_YCbCr;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, 95, TRUE);
+        if (components == 3)
+        {
+            cinfo.comp_info[0].h_samp_factor = sampling.h;
+            cinfo.comp_info[0].v_samp_factor = sampling.v;
+        }
+        jpeg_start_compress(&cinfo, TRUE);
+        std::vector<unsigned char> row(static_cast<std::size_t>(width * components));
+        while (cinfo.next_scanline < cinfo.image_height)
+        {
+            for (int x = 0; x < width * components; ++x)
+            {
+                // grey images take the luma channel
+                const auto at = static_cast<std::size_t>(cinfo.next_scanline * static_cast<unsigned>(width) * 3) +
+                                static_cast<std::size_t>(components == 1 ? x * 3 : x);
+                row[static_cast<std::size_t>(x)] = pixels[at];
+            }
+            JSAMPROW rows[] = {row.data()};
+            jpeg_write_scanlines(&cinfo, rows, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        std::vector<std::byte> out(reinterpret_cast<std::byte *>(buffer), reinterpret_cast<std::byte *>(buffer) + size);
+        std::free(buffer);
+        return out;
+    }
+
+    v4l2::FrameView as_frame(const std::vector<std::byte> &jpeg, std::uint32_t sequence)
+    {
+        return v4l2::FrameView{.image = jpeg, .format = v4l2::PixelFormat::MJPG, .sequence = sequence};
+    }
+
+    int at(const v4l2::DecodedView &view, std::size_t plane, std::uint32_t x, std::uint32_t y)
+    {
+        return static_cast<int>(view.image[view.offset[plane] + y * view.stride[plane] + x]);
+    }
+} // namespace
+
+void test_layout()
+{
+    // GStreamer's default I420 layout: strides padded to 4, chroma rounded up
+    assert(v4l2::MjpegDecoder::i420_size(640, 480) == 640 * 480 * 3 / 2);
+    assert(v4l2::MjpegDecoder::i420_size(30, 21) == 32 * 22 + 2 * 16 * 11);
+    assert((v4l2::MjpegDecoder::scaled_size(3840, 2160, 8) == std::pair<std::uint32_t, std::uint32_t>{480, 270}));
+    assert((v4l2::MjpegDecoder::scaled_size(1366, 767, 4) == std::pair<std::uint32_t, std::uint32_t>{342, 192}));
+}
+
+void test_decode_subsamplings()
+{
+    v4l2::MjpegDecoder decoder(v4l2::MjpegDecoderConfig{.threads_ = 2});
+    const int sizes[][2] = {{64, 48}, {37, 29}, {640, 480}};
+    for (auto const &size : sizes)
+    {
+        const int width = size[0];
+        const int height = size[1];
+        auto const pixels = make_ycbcr(width, height);
+        for (auto const sampling : samplings)
+        {
+            auto const jpeg = encode(pixels, width, height, 3, sampling);
+            decoder.submit(as_frame(jpeg, 7));
+            auto const frame = decoder.pop(std::chrono::seconds{5});
+            assert(frame.has_value());
+            auto const &view = frame->view();
+            assert(!view.error && !view.image.empty());
+            assert(view.width == static_cast<std::uint32_t>(width) && view.height == static_cast<std::uint32_t>(height));
+            assert(view.sequence == 7);
+            assert(view.image.size() == v4l2::MjpegDecoder::i420_size(view.width, view.height));
+
+            // lossy, but a quality 95 gradient stays within a few levels
+            for (std::uint32_t y = 0; y < view.height; y += 3)
+            {
+                for (std::uint32_t x = 0; x < view.width; x += 3)
+                {
+                    const int expected = pixels[(y * view.width + x) * 3];
+                    assert(std::abs(at(view, 0, x, y) - expected) <= 6);
+                }
+            }
+            for (std::uint32_t y = 0; y < (view.height + 1) / 2; y += 2)
+            {
+                for (std::uint32_t x = 0; x < (view.width + 1) / 2; x += 2)
+                {
+                    const int u = pixels[(2 * y * view.width + 2 * x) * 3 + 1];
+                    assert(std::abs(at(view, 1, x, y) - u) <= 8);
+                    assert(std::abs(at(view, 2, x, y) - 100) <= 6);
+                }
+            }
+            fmt::print("decoded {}x{} {}\n", width, height, sampling.name);
+        }
+    }
+}
+
+void test_grey_and_scaled()
+{
+    v4l2::MjpegDecoder decoder(v4l2::MjpegDecoderConfig{.threads_ = 1, .scale_denom_ = 4});
+    auto const pixels = make_ycbcr(160, 120);
+    auto const jpeg = encode(pixels, 160, 120, 1, samplings[0]);
+    decoder.submit(as_frame(jpeg, 1));
+    auto const frame = decoder.pop(std::chrono::seconds{5});
+    assert(frame.has_value() && !(*frame)->error);
+    assert((*frame)->width == 40 && (*frame)->height == 30);
+    assert(at(frame->view(), 1, 3, 3) == 128 && at(frame->view(), 2, 10, 7) == 128);
+}
+
+void test_order_kept()
+{
+    // frames of very different cost on four workers must still come out in submission order
+    v4l2::MjpegDecoder decoder(v4l2::MjpegDecoderConfig{.threads_ = 4, .output_buffers_ = 3});
+    auto const big = encode(make_ycbcr(1280, 720), 1280, 720, 3, samplings[1]);
+    auto const small = encode(make_ycbcr(32, 32), 32, 32, 3, samplings[0]);
+
+    constexpr std::uint32_t frames = 40;
+    std::uint32_t expected = 0;
+    for (std::uint32_t seq = 0; seq < frames; ++seq)
+    {
+        decoder.submit(as_frame(seq % 3 == 0 ? big : small, seq));
+        // keep a few in flight, popping releases the output slot right away
+        while (decoder.pending() > 6)
+        {
+            auto const frame = decoder.pop(std::chrono::seconds{5});
+            assert(frame.has_value() && (*frame)->sequence == expected++);
+        }
+    }
+    while (expected < frames)
+    {
+        auto const frame = decoder.pop(std::chrono::seconds{5});
+        assert(frame.has_value() && (*frame)->sequence == expected++);
+    }
+    assert(decoder.pending() == 0);
+    assert(!decoder.pop(std::chrono::milliseconds{10}).has_value());
+}
+
+void test_corrupt_input()
+{
+    v4l2::MjpegDecoder decoder;
+    std::vector<std::byte> garbage(1000, std::byte{0x42});
+    decoder.submit(as_frame(garbage, 3));
+
+    // cut in the middle of the entropy data: libjpeg warns and pads the picture
+    auto truncated = encode(make_ycbcr(640, 480), 640, 480, 3, samplings[0]);
+    truncated.resize(truncated.size() / 2);
+    decoder.submit(as_frame(truncated, 4));
+
+    auto const bad = decoder.pop(std::chrono::seconds{5});
+    assert(bad.has_value() && (*bad)->error && (*bad)->image.empty() && (*bad)->sequence == 3);
+    auto const cut = decoder.pop(std::chrono::seconds{5});
+    assert(cut.has_value() && (*cut)->error && !(*cut)->image.empty());
+
+    try
+    {
+        v4l2::MjpegDecoder invalid(v4l2::MjpegDecoderConfig{.scale_denom_ = 3});
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+int main()
+{
+    fmt::print("Starting MJPEG decoder tests\n");
+    test_layout();
+    test_decode_subsamplings();
+    test_grey_and_scaled();
+    test_order_kept();
+    test_corrupt_input();
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "v4l2/recorder.hpp"
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <algorithm>  // For std::copy, std::equal
+#include <cassert>    // For assert
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <span>       // For std::span
+#include <stdexcept>  // For std::runtime_error, std::invalid_argument
+#include <vector>     // For std::vector
+
+// No camera needed: replay:// recordings stand in for single- and multi-planar capture nodes
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+    constexpr std::size_t LUMA = std::size_t{WIDTH} * HEIGHT;
+    constexpr std::size_t CHROMA = LUMA / 2; // NV12: interleaved CbCr at half height
+
+    // Y counts up with the frame, CbCr is 0x80 apart from it: a plane read from the wrong place shows
+    std::vector<std::byte> luma(std::uint32_t seq)
+    {
+        std::vector<std::byte> plane(LUMA);
+        for (std::size_t i = 0; i < plane.size(); ++i)
+        {
+            plane[i] = static_cast<std::byte>((i + seq) & 0x7F);
+        }
+        return plane;
+    }
+
+    std::vector<std::byte> chroma(std::uint32_t seq)
+    {
+        std::vector<std::byte> plane(CHROMA);
+        for (std::size_t i = 0; i < plane.size(); ++i)
+        {
+            plane[i] = static_cast<std::byte>(0x80 | ((i + seq) & 0x7F));
+        }
+        return plane;
+    }
+
+    // Y then CbCr, the fixture hands NV12M frames out as two planes
+    void fill_planes(std::uint32_t seq, std::span<std::byte> image)
+    {
+        auto const y = luma(seq);
+        auto const cbcr = chroma(seq);
+        std::copy(y.begin(), y.end(), image.begin());
+        std::copy(cbcr.begin(), cbcr.end(), image.begin() + static_cast<std::ptrdiff_t>(LUMA));
+    }
+
+    fs::path record(const fs::path &path, v4l2::PixelFormat format)
+    {
+        return fixture::make_recording(path, {.format = format,
+                                              .width = WIDTH,
+                                              .height = HEIGHT,
+                                              .frames = 4,
+                                              .interval_us = 10'000,
+                                              .fill = fill_planes});
+    }
+
+    v4l2::V4L2Camera open_camera(const fs::path &recording, const char *options, v4l2::PixelFormat format)
+    {
+        v4l2::V4L2Camera camera(v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}?rate=max{}", recording.string(), options),
+                                                 .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                                 .format_ = format,
+                                                 .buffer_count_ = 4});
+        camera.open_device();
+        return camera;
+    }
+
+    void check_planes(const v4l2::FrameView &view)
+    {
+        auto const seq = view.sequence;
+        assert(view.plane_count == 2);
+        assert(view.planes[0].data.data() == view.image.data());
+        assert(view.planes[0].bytes_per_line == WIDTH && view.planes[1].bytes_per_line == WIDTH);
+        assert(view.planes[0].data.size() >= LUMA && view.planes[1].data.size() == CHROMA);
+        auto const y = luma(seq % 4);
+        auto const cbcr = chroma(seq % 4);
+        assert(std::equal(y.begin(), y.end(), view.planes[0].data.begin()));
+        assert(std::equal(cbcr.begin(), cbcr.end(), view.planes[1].data.begin()));
+    }
+} // namespace
+
+void test_single_buffer(const fs::path &recording, const char *options, bool multiplanar)
+{
+    fmt::print("Testing NV12 in one buffer, {} API\n", multiplanar ? "multi-planar" : "single-planar");
+    auto camera = open_camera(recording, options, v4l2::PixelFormat::NV12);
+    assert(camera.multiplanar() == multiplanar);
+    camera.configure();
+
+    auto const layout = camera.plane_layout();
+    assert(layout.size() == 2);
+    assert(layout[0].memory_plane == 0 && layout[0].offset == 0 && layout[0].height == HEIGHT);
+    assert(layout[1].memory_plane == 0 && layout[1].offset == LUMA && layout[1].height == HEIGHT / 2);
+    assert(camera.buffers()[0].plane_count == 1);
+
+    camera.start_streaming();
+    for (std::uint32_t i = 0; i < 4; ++i)
+    {
+        auto lease = camera.capture_frame();
+        assert(lease->image.size() == LUMA + CHROMA);
+        assert(lease->planes[1].data.data() == lease->image.data() + LUMA);
+        check_planes(lease.view());
+    }
+    camera.stop_streaming();
+}
+
+void test_separate_buffers(const fs::path &recording)
+{
+    fmt::print("Testing NV12M in two buffers\n");
+    auto camera = open_camera(recording, "", v4l2::PixelFormat::NV12M);
+    assert(camera.multiplanar()); // there is no single-planar NV12M
+    camera.configure();
+
+    auto const layout = camera.plane_layout();
+    assert(layout.size() == 2);
+    assert(layout[1].memory_plane == 1 && layout[1].offset == 0 && layout[1].height == HEIGHT / 2);
+    auto const &mapped = camera.buffers()[0];
+    assert(mapped.plane_count == 2 && mapped.plane(1).data != nullptr && mapped.plane(1).data != mapped.data);
+
+    camera.start_streaming();
+    for (std::uint32_t i = 0; i < 4; ++i)
+    {
+        auto lease = camera.capture_frame();
+        assert(lease->image.size() == LUMA); // the first buffer only
+        check_planes(lease.view());
+    }
+    camera.stop_streaming();
+}
+
+void test_recorded_again(const fs::path &recording, const fs::path &dir)
+{
+    fmt::print("Testing a recording of NV12M frames from a camera\n");
+    auto camera = open_camera(recording, "", v4l2::PixelFormat::NV12M);
+    camera.configure();
+    camera.start_streaming();
+
+    // both buffers end up in the record, one after the other
+    auto const path = dir / "again.v4lr";
+    {
+        v4l2::Recorder recorder({.path_ = path.string(), .queue_depth_ = 2});
+        for (std::uint32_t i = 0; i < 4; ++i)
+        {
+            recorder.record(camera.capture_frame());
+        }
+        recorder.close();
+    }
+    camera.stop_streaming();
+
+    auto again = open_camera(path, "", v4l2::PixelFormat::NV12M);
+    again.configure();
+    again.start_streaming();
+    check_planes(again.capture_frame().view());
+    again.stop_streaming();
+}
+
+void test_wrong_split(const fs::path &nv12, const fs::path &nv12m)
+{
+    fmt::print("Testing formats the device does not deliver\n");
+    auto contiguous = open_camera(nv12, "&mplane=1", v4l2::PixelFormat::NV12M);
+    try
+    {
+        contiguous.configure();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    v4l2::V4L2Camera importing(v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}", nv12m.string()),
+                                                .dimension_ = v4l2::to_dimension(WIDTH, HEIGHT),
+                                                .format_ = v4l2::PixelFormat::NV12M,
+                                                .buffer_count_ = 2,
+                                                .memory_ = v4l2::MemoryMode::DMABUF_IMPORT,
+                                                .dmabuf_fds_ = {-1, -1}});
+    importing.open_device();
+    try
+    {
+        importing.configure();
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+int main()
+{
+    fmt::print("Starting multi-planar tests\n");
+    const fixture::ScratchDir dir("mplane");
+    auto const nv12 = record(dir / "nv12.v4lr", v4l2::PixelFormat::NV12);
+    auto const nv12m = record(dir / "nv12m.v4lr", v4l2::PixelFormat::NV12M);
+
+    test_single_buffer(nv12, "", false);
+    test_single_buffer(nv12, "&mplane=1", true);
+    test_separate_buffers(nv12m);
+    test_recorded_again(nv12m, dir.path());
+    test_wrong_split(nv12, nv12m);
+
+    fmt::print("Success\n");
+    return 0;
+}
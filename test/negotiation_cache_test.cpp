@@ -0,0 +1,184 @@
+#include "v4l2/camera_group.hpp"
+#include "v4l2/negotiation_cache.hpp"
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <atomic>     // For std::atomic
+#include <cassert>    // For assert
+#include <chrono>     // For std::chrono
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <fstream>    // For std::ofstream
+#include <stdexcept>  // For std::runtime_error
+#include <thread>     // For std::this_thread
+
+// No camera needed: replay:// recordings stand in for the devices
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+
+    // the in-process mode cache is keyed on the device path: a different query string keeps it out of the way
+    v4l2::V4l2Config replay_config(const fs::path &recording, const fs::path &cache_dir, const char *options)
+    {
+        return v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}{}", recording.string(), options),
+                                .dimension_ = v4l2::to_dimension(640, 480),
+                                .format_ = v4l2::PixelFormat::YUYV,
+                                .buffer_count_ = 4,
+                                .cache_dir_ = cache_dir.string()};
+    }
+
+    std::size_t count_files(const fs::path &dir)
+    {
+        std::size_t count = 0;
+        for ([[maybe_unused]] auto const &entry : fs::directory_iterator(dir))
+        {
+            ++count;
+        }
+        return count;
+    }
+} // namespace
+
+void test_round_trip(const fs::path &dir)
+{
+    fmt::print("Testing store and load\n");
+    const v4l2::NegotiationRecord record{
+        .requested_format = v4l2::PixelFormat::MJPG,
+        .requested_dimension = v4l2::PixelDimension::DIM_FHD,
+        .requested_rate = {30, 1},
+        .format = v4l2::PixelFormat::MJPG,
+        .dimension = v4l2::PixelDimension::DIM_HD,
+        .bytes_per_line = 0,
+        .rate = {30000, 1001},
+        .modes = {{.format = v4l2::PixelFormat::MJPG, .width = 1280, .height = 720, .frame_rates = {{30, 1}, {15, 1}}},
+                  {.format = v4l2::PixelFormat::YUYV, .width = 640, .height = 480, .frame_rates = {{30, 1}}}},
+    };
+    v4l2::store_negotiation(dir, "uvcvideo-Cam-SN1", record);
+
+    auto const loaded = v4l2::load_negotiation(dir, "uvcvideo-Cam-SN1");
+    assert(loaded);
+    assert(loaded->requested_format == record.requested_format && loaded->requested_dimension == record.requested_dimension);
+    assert(loaded->requested_rate == record.requested_rate && loaded->rate == record.rate);
+    assert(loaded->format == record.format && loaded->dimension == record.dimension && loaded->bytes_per_line == 0);
+    assert(loaded->modes.size() == 2 && loaded->modes[0].frame_rates.size() == 2);
+    assert(loaded->modes[0].frame_rates[1] == (v4l2::FrameRate{15, 1}) && loaded->modes[1].format == v4l2::PixelFormat::YUYV);
+
+    // nothing there, or not ours: no shortcut
+    assert(!v4l2::load_negotiation(dir, "missing"));
+    std::ofstream(dir / "garbage.cache") << "v4l2-negotiation 1\nrequest 47504a4d 1920\n";
+    assert(!v4l2::load_negotiation(dir, "garbage"));
+    std::ofstream(dir / "future.cache") << "v4l2-negotiation 2\n";
+    assert(!v4l2::load_negotiation(dir, "future"));
+
+    // a file name whatever the card is called
+    const v4l2::V4lCaps caps{.driver = "uvcvideo", .card = "HD Pro Webcam C920", .bus_info = "usb-0000:00:14.0-1"};
+    assert(v4l2::negotiation_key(caps, "/dev/video99") == "uvcvideo-HD_Pro_Webcam_C920-usb-0000_00_14.0-1");
+}
+
+void test_camera_cache(const fs::path &dir, const fs::path &recording)
+{
+    fmt::print("Testing the cache on a camera\n");
+    auto const cache = dir / "camera";
+    {
+        v4l2::V4L2Camera camera(replay_config(recording, cache, ""));
+        camera.open_device();
+        camera.configure();
+        auto const modes = camera.enumerate_modes();
+        assert(modes.size() == 1 && modes[0].width == WIDTH);
+    }
+    assert(count_files(cache) == 1);
+    auto const key = fs::directory_iterator(cache)->path().stem().string();
+    auto record = v4l2::load_negotiation(cache, key);
+    assert(record && record->dimension == v4l2::to_dimension(WIDTH, HEIGHT));
+    assert(record->requested_dimension == v4l2::to_dimension(640, 480) && record->modes.size() == 1);
+
+    // 💾 the modes come from disk now: a mode the recording does not have shows up
+    record->modes.push_back({.format = v4l2::PixelFormat::MJPG, .width = 32, .height = 24, .frame_rates = {{5, 1}}});
+    v4l2::store_negotiation(cache, key, *record);
+    {
+        v4l2::V4L2Camera camera(replay_config(recording, cache, "?loop=1"));
+        camera.open_device();
+        camera.configure();
+        assert(camera.config().dimension_ == v4l2::to_dimension(WIDTH, HEIGHT));
+        auto const modes = camera.enumerate_modes();
+        assert(modes.size() == 2 && modes[1].width == 32);
+        // but never in place of asking the device
+        assert(camera.enumerate_modes(true).size() == 1);
+
+        assert(camera.stats().time_to_first_frame_us == 0);
+        camera.start_streaming();
+        [[maybe_unused]] auto lease = camera.capture_frame();
+        fmt::print("  time to first frame: {} us\n", camera.stats().time_to_first_frame_us);
+        assert(camera.stats().time_to_first_frame_us > 0);
+        camera.stop_streaming();
+    }
+
+    // another request is another negotiation, the record follows the latest one
+    auto other = replay_config(recording, cache, "?loop=0");
+    other.dimension_ = v4l2::to_dimension(320, 240);
+    {
+        v4l2::V4L2Camera camera(other);
+        camera.open_device();
+        camera.configure();
+    }
+    auto const updated = v4l2::load_negotiation(cache, key);
+    assert(updated && updated->requested_dimension == v4l2::to_dimension(320, 240) && updated->modes.size() == 1);
+}
+
+void test_group(const fs::path &dir, const fs::path &first, const fs::path &second)
+{
+    fmt::print("Testing parallel open\n");
+    auto const cache = dir / "group";
+    {
+        v4l2::CameraGroup group;
+        group.add_camera(replay_config(first, cache, "?rate=max"));
+        group.add_camera(replay_config(second, cache, "?rate=max"));
+        group.open_all();
+        assert(group.camera(0).config().dimension_ == v4l2::to_dimension(WIDTH, HEIGHT));
+        assert(group.camera(1).config().dimension_ == v4l2::to_dimension(WIDTH, HEIGHT));
+        assert(count_files(cache) == 2); // one file per camera
+
+        std::atomic<int> frames{0};
+        group.start([&](std::size_t, v4l2::FrameLease &&) { ++frames; });
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (frames < 4 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        group.stop();
+        assert(frames >= 4);
+        assert(group.camera(0).stats().time_to_first_frame_us > 0 && group.camera(1).stats().time_to_first_frame_us > 0);
+    }
+
+    // one camera failing does not keep the others from being opened, its error comes out
+    v4l2::CameraGroup group;
+    group.add_camera(replay_config(first, cache, "?rate=100"));
+    group.add_camera(replay_config(dir / "missing.v4lr", cache, ""));
+    try
+    {
+        group.open_all();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    assert(group.camera(0).fd() >= 0);
+}
+
+int main()
+{
+    fmt::print("Starting negotiation cache tests\n");
+    const fixture::ScratchDir dir("negotiation");
+    auto const first = fixture::make_recording(dir / "first.v4lr", {.width = WIDTH, .height = HEIGHT});
+    auto const second = fixture::make_recording(dir / "second.v4lr", {.width = WIDTH, .height = HEIGHT});
+
+    test_round_trip(dir.path());
+    test_camera_cache(dir.path(), first);
+    test_group(dir.path(), first, second);
+
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <cassert>    // For assert
+#include <chrono>     // For std::chrono
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <optional>   // For std::optional
+#include <stdexcept>  // For std::runtime_error
+#include <thread>     // For std::jthread
+
+// No camera needed: a recording that is moved away and back stands in for an unplugged device
+
+namespace
+{
+    namespace fs = std::filesystem;
+    using namespace std::chrono_literals;
+
+    v4l2::V4L2Camera open_replay(const fs::path &path)
+    {
+        v4l2::V4L2Camera camera({.device_path_ = fmt::format("replay://{}?rate=100", path.string()),
+                                 .dimension_ = v4l2::to_dimension(640, 480),
+                                 .format_ = v4l2::PixelFormat::YUYV,
+                                 .buffer_count_ = 4});
+        camera.open_device();
+        camera.configure();
+        camera.start_streaming();
+        return camera;
+    }
+} // namespace
+
+void test_comes_back(const fs::path &path)
+{
+    fmt::print("Testing reconnect\n");
+    auto camera = open_replay(path);
+    {
+        auto lease = camera.capture_frame();
+        assert(lease->width == 64);
+    }
+
+    // 🔌 gone, and back a moment later
+    fs::rename(path, fs::path(path).concat(".away"));
+    std::jthread replug([&]
+                        {
+                            std::this_thread::sleep_for(100ms);
+                            fs::rename(fs::path(path).concat(".away"), path); });
+    auto const started = std::chrono::steady_clock::now();
+    assert(camera.reconnect(5s));
+    fmt::print("  back after {} ms\n", std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count());
+    replug.join();
+
+    {
+        auto lease = camera.capture_frame();
+        assert(lease->width == 64 && lease->sequence == 0); // the sequence starts over
+    }
+    assert(camera.stats().reconnects == 1 && !camera.device_lost());
+    assert(camera.config().dimension_ == v4l2::to_dimension(64, 48));
+    assert(camera.stats().time_to_first_frame_us > 0);
+}
+
+void test_gives_up(const fs::path &path)
+{
+    fmt::print("Testing timeout and interrupt\n");
+    auto camera = open_replay(path);
+    fs::rename(path, fs::path(path).concat(".away"));
+
+    assert(!camera.reconnect(100ms));
+    {
+        std::jthread waker([&]
+                           {
+                               std::this_thread::sleep_for(50ms);
+                               camera.interrupt(); });
+        assert(!camera.reconnect(-1us));
+    }
+    camera.clear_interrupt();
+
+    // still waiting where it left off
+    fs::rename(fs::path(path).concat(".away"), path);
+    assert(camera.reconnect(1s));
+    assert(camera.stats().reconnects == 1);
+}
+
+// What v4l2-src blocks on before it reconnects: every lease back, without polling
+void test_wait_for_release(const fs::path &path)
+{
+    fmt::print("Testing the wait for leases to come back\n");
+    auto camera = open_replay(path);
+    assert(camera.wait_for_all_released(0us));
+
+    std::optional<v4l2::FrameLease> first = camera.capture_frame();
+    std::optional<v4l2::FrameLease> second = camera.capture_frame();
+    assert(camera.outstanding_frames() == 2);
+    assert(!camera.wait_for_all_released(50ms));
+    {
+        std::jthread consumer([&]
+                              {
+                                  std::this_thread::sleep_for(20ms);
+                                  first.reset();
+                                  std::this_thread::sleep_for(20ms);
+                                  second.reset(); });
+        auto const started = std::chrono::steady_clock::now();
+        assert(camera.wait_for_all_released(5s));
+        assert(std::chrono::steady_clock::now() - started < 1s && camera.outstanding_frames() == 0);
+    }
+
+    auto held = camera.capture_frame();
+    {
+        std::jthread waker([&]
+                           {
+                               std::this_thread::sleep_for(50ms);
+                               camera.interrupt(); });
+        assert(!camera.wait_for_all_released(-1us));
+    }
+    camera.clear_interrupt();
+}
+
+void test_errors(const fs::path &path)
+{
+    fmt::print("Testing reconnect errors\n");
+    auto camera = open_replay(path);
+    {
+        auto lease = camera.capture_frame();
+        try
+        {
+            [[maybe_unused]] auto const back = camera.reconnect(0us);
+            assert(false && "should have thrown");
+        }
+        catch (const std::runtime_error &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+    }
+
+    // same camera, another mode: nothing downstream would fit it
+    fs::rename(path, fs::path(path).concat(".away"));
+    fixture::make_recording(path, {.width = 32, .height = 24});
+    try
+    {
+        [[maybe_unused]] auto const back = camera.reconnect(1s);
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    fs::remove(path);
+    fs::rename(fs::path(path).concat(".away"), path);
+}
+
+int main()
+{
+    fmt::print("Starting reconnect tests\n");
+    const fixture::ScratchDir dir("reconnect");
+    auto const path = dir / "cam0.v4lr";
+    fixture::make_recording(path, {.width = 64, .height = 48});
+
+    test_comes_back(path);
+    test_gives_up(path);
+    test_wait_for_release(path);
+    test_errors(path);
+
+    fmt::print("Success\n");
+    return 0;
+}
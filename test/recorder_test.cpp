@@ -0,0 +1,199 @@
+#include "v4l2/recorder.hpp"
+#include <algorithm>  // For std::sort
+#include <cassert>    // For assert
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <stdexcept>  // For std::runtime_error
+#include <unistd.h>   // For getpid
+#include <vector>     // For std::vector
+
+// No camera needed: frames are synthetic; the recordings go to a scratch directory next to the binary's cwd
+
+namespace
+{
+    std::filesystem::path scratch_dir(const char *what)
+    {
+        auto dir = std::filesystem::current_path() / fmt::format("v4l2-recorder-test-{}-{}", getpid(), what);
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        return dir;
+    }
+
+    std::vector<std::byte> make_image(std::uint32_t sequence, std::size_t size)
+    {
+        std::vector<std::byte> image(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            image[i] = static_cast<std::byte>((sequence * 7 + i) & 0xFF);
+        }
+        return image;
+    }
+
+    v4l2::FrameView as_frame(const std::vector<std::byte> &image, std::uint32_t sequence, std::uint64_t timestamp_us)
+    {
+        return v4l2::FrameView{.timestamp_monotonic_us = timestamp_us,
+                               .v4l2_timestamp_us = timestamp_us - 10,
+                               .image = image,
+                               .width = 1920,
+                               .height = 1080,
+                               .format = v4l2::PixelFormat::MJPG,
+                               .sequence = sequence,
+                               .flags = 0x4000};
+    }
+
+    // odd sizes so every frame needs padding
+    std::size_t size_of(std::uint32_t sequence)
+    {
+        return 1000 + (sequence % 5) * 12345;
+    }
+
+    void check_recording(const std::filesystem::path &path, std::uint32_t first, std::uint32_t frames)
+    {
+        v4l2::RecordingReader reader(path.string());
+        assert(reader.complete());
+        assert(reader.format() == v4l2::PixelFormat::MJPG);
+        assert(reader.index().size() == frames);
+        for (std::uint32_t i = 0; i < frames; ++i)
+        {
+            const std::uint32_t seq = first + i;
+            auto const frame = reader.read(i);
+            assert(frame.header.sequence == seq && reader.index()[i].sequence == seq);
+            assert(frame.header.flags == 0x4000);
+            assert(frame.header.v4l2_timestamp_us + 10 == frame.header.timestamp_monotonic_us);
+            assert(frame.data == make_image(seq, size_of(seq)));
+        }
+    }
+} // namespace
+
+void test_roundtrip(bool io_uring, bool direct)
+{
+    fmt::print("Testing roundtrip, io_uring {}, O_DIRECT {}\n", io_uring, direct);
+    auto const dir = scratch_dir(io_uring ? "uring" : "pwritev");
+    auto const path = dir / "capture.v4lr";
+    constexpr std::uint32_t frames = 50;
+    {
+        v4l2::Recorder recorder({.path_ = path.string(), .direct_ = direct, .queue_depth_ = 4, .io_uring_ = io_uring});
+        assert(recorder.uses_io_uring() || !io_uring);
+        for (std::uint32_t seq = 0; seq < frames; ++seq)
+        {
+            auto const image = make_image(seq, size_of(seq));
+            recorder.record(as_frame(image, seq, 1'000'000 + seq * 33'333));
+        }
+        recorder.close();
+        auto const stats = recorder.stats();
+        assert(stats.frames == frames && stats.segments == 1);
+        fmt::print("  {} bytes, direct {}\n", stats.bytes, recorder.uses_direct_io());
+
+        try
+        {
+            auto const image = make_image(0, 10);
+            recorder.record(as_frame(image, 0, 0));
+            assert(false && "should have thrown");
+        }
+        catch (const std::runtime_error &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+    }
+    check_recording(path, 0, frames);
+
+    // 🔌 power loss before the index: cut the file inside the last frame, the scan finds the intact ones
+    const auto index_offset = [&]
+    {
+        v4l2::RecordingReader reader(path.string());
+        return reader.index().back().offset;
+    }();
+    std::filesystem::resize_file(path, index_offset + 100);
+    v4l2::RecordingReader cut(path.string());
+    assert(!cut.complete() && cut.index().size() == frames - 1);
+    assert(cut.read(frames - 2).data == make_image(frames - 2, size_of(frames - 2)));
+    std::filesystem::remove_all(dir);
+}
+
+void test_ring_mode()
+{
+    fmt::print("Testing ring mode\n");
+    auto const dir = scratch_dir("ring");
+    auto const prefix = (dir / "cam0").string();
+    {
+        // 30 fps for 20 s into 2 s segments, keep 5 s
+        v4l2::Recorder recorder({.path_ = prefix,
+                                 .queue_depth_ = 8,
+                                 .ring_duration_ = std::chrono::seconds{5},
+                                 .segment_duration_ = std::chrono::seconds{2}});
+        for (std::uint32_t seq = 0; seq < 600; ++seq)
+        {
+            auto const image = make_image(seq, size_of(seq));
+            recorder.record(as_frame(image, seq, 1'000'000 + std::uint64_t{seq} * 33'333));
+        }
+        assert(recorder.stats().segments == 10);
+    }
+
+    // the newest segments cover the last five seconds, the rest is gone
+    std::vector<std::filesystem::path> left;
+    for (auto const &entry : std::filesystem::directory_iterator(dir))
+    {
+        left.push_back(entry.path());
+    }
+    std::sort(left.begin(), left.end());
+    assert(left.size() == 3 || left.size() == 4);
+    assert(left.back().filename() == "cam0.000010.v4lr");
+    v4l2::RecordingReader newest(left.back().string());
+    assert(newest.complete() && newest.index().back().sequence == 599);
+    std::filesystem::remove_all(dir);
+
+    // ⏪ time going back (a looped replay) closes the segment instead of wrapping the elapsed time
+    auto const back = scratch_dir("ring-back");
+    {
+        v4l2::Recorder recorder({.path_ = (back / "cam0").string(),
+                                 .queue_depth_ = 4,
+                                 .ring_duration_ = std::chrono::seconds{5},
+                                 .segment_duration_ = std::chrono::seconds{2}});
+        for (std::uint32_t seq = 0; seq < 20; ++seq)
+        {
+            auto const image = make_image(seq, size_of(seq));
+            recorder.record(as_frame(image, seq, (seq < 10 ? 2'000'000 : 1'000'000) + std::uint64_t{seq % 10} * 33'333));
+        }
+        assert(recorder.stats().segments == 2);
+    }
+    v4l2::RecordingReader second((back / "cam0.000002.v4lr").string());
+    assert(second.complete() && second.index().size() == 10 && second.index().front().sequence == 10);
+    std::filesystem::remove_all(back);
+}
+
+void test_errors()
+{
+    try
+    {
+        v4l2::Recorder invalid({.path_ = "", .queue_depth_ = 4});
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    v4l2::Recorder nowhere({.path_ = "/nonexistent/dir/capture.v4lr"});
+    try
+    {
+        auto const image = make_image(0, 10);
+        nowhere.record(as_frame(image, 0, 0));
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+int main()
+{
+    fmt::print("Starting recorder tests\n");
+    test_roundtrip(true, true);
+    test_roundtrip(false, true);
+    test_roundtrip(true, false);
+    test_ring_mode();
+    test_errors();
+    fmt::print("Success\n");
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include "v4l2/replay_backend.hpp"
+#include "v4l2/v4l2.hpp"
+#include "replay_fixture.hpp"
+#include <algorithm>  // For std::copy
+#include <cassert>    // For assert
+#include <chrono>     // For std::chrono
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <fstream>    // For std::fstream
+#include <span>       // For std::span
+#include <stdexcept>  // For std::runtime_error
+#include <thread>     // For std::this_thread
+#include <vector>     // For std::vector
+
+// No camera needed: a synthetic recording is played back through V4L2Camera
+
+namespace
+{
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+    constexpr std::uint32_t FRAMES = 20;
+
+    std::vector<std::byte> make_image(std::uint32_t sequence)
+    {
+        std::vector<std::byte> image(std::size_t{WIDTH} * HEIGHT * 2);
+        for (std::size_t i = 0; i < image.size(); ++i)
+        {
+            image[i] = static_cast<std::byte>((sequence * 13 + i) & 0xFF);
+        }
+        return image;
+    }
+
+    // 30 fps, frame 7 flagged as errored by the driver
+    std::filesystem::path make_recording(const std::filesystem::path &path)
+    {
+        return fixture::make_recording(path, {.width = WIDTH,
+                                              .height = HEIGHT,
+                                              .frames = FRAMES,
+                                              .fill = [](std::uint32_t seq, std::span<std::byte> image)
+                                              {
+                                                  auto const expected = make_image(seq);
+                                                  std::copy(expected.begin(), expected.end(), image.begin());
+                                              },
+                                              .errored = 7});
+    }
+
+    v4l2::V4L2Camera open_replay(const std::filesystem::path &path, const char *options)
+    {
+        v4l2::V4L2Camera camera({.device_path_ = fmt::format("replay://{}{}", path.string(), options),
+                                 .dimension_ = v4l2::to_dimension(640, 480),
+                                 .format_ = v4l2::PixelFormat::YUYV,
+                                 .buffer_count_ = 4});
+        camera.open_device();
+        camera.configure();
+        camera.start_streaming();
+        return camera;
+    }
+} // namespace
+
+void test_max_rate(const std::filesystem::path &path)
+{
+    fmt::print("Testing max rate replay\n");
+    auto camera = open_replay(path, "?rate=max&loop=0");
+    assert(camera.get_caps().driver == "replay");
+    // the recording decides the mode, whatever was asked for
+    assert(camera.config().dimension_ == v4l2::to_dimension(WIDTH, HEIGHT));
+
+    const std::byte *previous = nullptr;
+    for (std::uint32_t seq = 0; seq < FRAMES; ++seq)
+    {
+        auto lease = camera.capture_frame();
+        assert(lease->sequence == seq);
+        assert(lease->error == (seq == 7));
+        assert(lease->bytes_per_line == WIDTH * 2);
+        auto const expected = make_image(seq);
+        assert(std::equal(lease->image.begin(), lease->image.end(), expected.begin(), expected.end()));
+        // 📼 zero-copy: every frame points into the file mapping, one recording stride after the last
+        if (previous)
+        {
+            assert(lease->image.data() > previous);
+        }
+        previous = lease->image.data();
+        assert(camera.buffers()[lease.index()].data != lease->image.data());
+    }
+
+    // no loop: past the last frame the stream ends like an unplugged camera
+    try
+    {
+        [[maybe_unused]] auto const lease = camera.capture_frame();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+void test_paced_loop(const std::filesystem::path &path)
+{
+    fmt::print("Testing paced, looping replay\n");
+    auto camera = open_replay(path, "?rate=100");
+    assert(camera.config().fps_num_ == static_cast<v4l2::FPS>(100) && camera.config().fps_den_ == 1);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::uint64_t first_us = 0;
+    std::uint64_t last_us = 0;
+    constexpr std::uint32_t frames = FRAMES + 10; // wraps around once
+    for (std::uint32_t seq = 0; seq < frames; ++seq)
+    {
+        auto lease = camera.capture_frame();
+        assert(lease->sequence == seq);
+        auto const expected = make_image(seq % FRAMES);
+        assert(std::equal(lease->image.begin(), lease->image.end(), expected.begin(), expected.end()));
+        first_us = seq == 0 ? lease->v4l2_timestamp_us : first_us;
+        last_us = lease->v4l2_timestamp_us;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    // 29 intervals of 10 ms, stamped at the due time
+    assert(last_us - first_us == 29 * 10'000);
+    assert(elapsed >= std::chrono::milliseconds{280} && elapsed < std::chrono::seconds{2});
+    assert(camera.stats().lost_frames == 0);
+}
+
+void test_recorded_rate(const std::filesystem::path &path)
+{
+    fmt::print("Testing recorded rate replay\n");
+    auto camera = open_replay(path, "");
+    // the mean recorded interval, to the microsecond
+    assert(camera.config().fps_num_ == static_cast<v4l2::FPS>(1'000'000) && camera.config().fps_den_ == 33'333);
+
+    auto first = camera.capture_frame();
+    const auto first_us = first->v4l2_timestamp_us;
+    first.release();
+    auto second = camera.capture_frame();
+    assert(second->v4l2_timestamp_us - first_us == 33'333);
+
+    // 🐢 a slow consumer: frames due with no buffer queued are lost, the sequence shows the gap
+    auto held = std::vector<v4l2::FrameLease>{};
+    held.push_back(std::move(second));
+    for (int i = 0; i < 3; ++i)
+    {
+        held.push_back(camera.capture_frame());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{200});
+    held.clear();
+    auto after = camera.capture_frame();
+    assert(after->sequence > 5 && camera.stats().lost_frames > 0);
+}
+
+void test_errors(const std::filesystem::path &path)
+{
+    for (auto const *uri : {"replay://", "replay:///x.v4lr?rate=0", "replay:///x.v4lr?rate=30/x", "replay:///x.v4lr?loop=2",
+                            "replay:///x.v4lr?speed=1", "/dev/video0"})
+    {
+        try
+        {
+            [[maybe_unused]] auto const config = v4l2::parse_replay_uri(uri);
+            assert(false && "should have thrown");
+        }
+        catch (const std::invalid_argument &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+    }
+    auto const config = v4l2::parse_replay_uri(fmt::format("replay://{}?rate=30000/1001&loop=0", path.string()));
+    assert(config.path_ == path.string() && config.rate_ == v4l2::ReplayRate::FIXED);
+    assert(config.fps_num_ == 30000 && config.fps_den_ == 1001 && !config.loop_);
+
+    // a recording has no sensor to crop: both crop ioctls fail and configure() says so
+    try
+    {
+        v4l2::V4L2Camera cropped({.device_path_ = fmt::format("replay://{}", path.string()),
+                                  .format_ = v4l2::PixelFormat::YUYV,
+                                  .crop_ = v4l2::Rect{.left = 0, .top = 8, .width = WIDTH, .height = 16}});
+        cropped.open_device();
+        cropped.configure();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    try
+    {
+        v4l2::ReplayBackend missing({.path_ = "/nonexistent/capture.v4lr"});
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    // no backend before open_device(): the noexcept entry points say no instead of touching it
+    v4l2::V4L2Camera closed({.device_path_ = fmt::format("replay://{}", path.string()), .format_ = v4l2::PixelFormat::YUYV});
+    assert(!closed.try_soe());
+}
+
+// A trailer index is trusted by RecordingReader: entries pointing past the end or at no record must not be mapped
+void test_damaged_index(const std::filesystem::path &path, const std::filesystem::path &dir)
+{
+    fmt::print("Testing a damaged trailer index\n");
+    for (auto const offset : {std::uint64_t{1} << 40, std::uint64_t{0}})
+    {
+        auto const damaged = dir / "damaged.v4lr";
+        std::filesystem::copy_file(path, damaged, std::filesystem::copy_options::overwrite_existing);
+        {
+            std::fstream file(damaged, std::ios::in | std::ios::out | std::ios::binary);
+            v4l2::RecordTrailer trailer{};
+            file.seekg(-static_cast<std::streamoff>(sizeof(trailer)), std::ios::end);
+            file.read(reinterpret_cast<char *>(&trailer), sizeof(trailer));
+            assert(trailer.magic == v4l2::TRAILER_MAGIC && trailer.frames == FRAMES);
+            v4l2::RecordIndexEntry entry{};
+            auto const third = static_cast<std::streamoff>(trailer.index_offset + 3 * sizeof(entry));
+            file.seekg(third);
+            file.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+            entry.offset = offset;
+            file.seekp(third);
+            file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            assert(file.good());
+        }
+        try
+        {
+            v4l2::ReplayBackend backend({.path_ = damaged.string()});
+            assert(false && "should have thrown");
+        }
+        catch (const std::runtime_error &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+    }
+}
+
+int main()
+{
+    fmt::print("Starting replay backend tests\n");
+    const fixture::ScratchDir dir("replay");
+    auto const path = make_recording(dir / "replay.v4lr");
+    test_max_rate(path);
+    test_paced_loop(path);
+    test_recorded_rate(path);
+    test_errors(path);
+    test_damaged_index(path, dir.path());
+    fmt::print("Success\n");
+    return 0;
+}
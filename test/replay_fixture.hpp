@@ -0,0 +1,122 @@
+#pragma once
+#include "v4l2/recorder.hpp"
+#include "v4l2/v4l2.hpp"
+#include <cassert>     // For assert
+#include <cstdint>     // For std::uint32_t, std::uint64_t
+#include <filesystem>  // For std::filesystem
+#include <fmt/core.h>  // For fmt::format
+#include <functional>  // For std::function
+#include <optional>    // For std::optional
+#include <span>        // For std::span
+#include <string_view> // For std::string_view
+#include <unistd.h>    // For getpid
+#include <vector>      // For std::vector
+
+// What the replay:// tests share: a scratch directory and synthetic recordings to stand in for a camera
+
+namespace fixture
+{
+    namespace fs = std::filesystem;
+
+    // Fills the image of frame `sequence`, sized for the format already
+    using ImageFill = std::function<void(std::uint32_t sequence, std::span<std::byte> image)>;
+
+    struct RecordingSpec
+    {
+        v4l2::PixelFormat format = v4l2::PixelFormat::YUYV; // YUYV, NV12(M) or NV16(M)
+        std::uint32_t width = 64;
+        std::uint32_t height = 48;
+        std::uint32_t frames = 10;
+        std::uint64_t interval_us = 33'333;        // stamps are 1'000'000 + sequence * interval_us
+        ImageFill fill = {};                       // empty: every byte 0x80
+        std::optional<std::uint32_t> errored = {}; // this frame flagged as errored by the driver
+    };
+
+    [[nodiscard]] inline bool is_semi_planar(v4l2::PixelFormat format) noexcept
+    {
+        return format == v4l2::PixelFormat::NV12 || format == v4l2::PixelFormat::NV12M ||
+               format == v4l2::PixelFormat::NV16 || format == v4l2::PixelFormat::NV16M;
+    }
+
+    // Y then CbCr for the NV formats, at half height for NV12(M)
+    [[nodiscard]] inline std::size_t image_size(const RecordingSpec &spec) noexcept
+    {
+        const std::size_t luma = std::size_t{spec.width} * spec.height;
+        if (spec.format == v4l2::PixelFormat::NV12 || spec.format == v4l2::PixelFormat::NV12M)
+        {
+            return luma + luma / 2;
+        }
+        return luma * 2;
+    }
+
+    /*
+     * Record spec.frames frames to `path` and close it, the recording a replay:// camera plays back.
+     * NV12M and NV16M frames keep CbCr in a plane of its own, as a multi-planar driver hands them out.
+     */
+    inline fs::path make_recording(const fs::path &path, const RecordingSpec &spec = {})
+    {
+        assert(spec.format == v4l2::PixelFormat::YUYV || is_semi_planar(spec.format));
+        v4l2::Recorder recorder({.path_ = path.string(), .queue_depth_ = 4});
+        std::vector<std::byte> image(image_size(spec), std::byte{0x80});
+        const std::size_t luma = std::size_t{spec.width} * spec.height;
+        const std::uint32_t bytes_per_line = is_semi_planar(spec.format) ? spec.width : spec.width * 2;
+        for (std::uint32_t seq = 0; seq < spec.frames; ++seq)
+        {
+            if (spec.fill)
+            {
+                spec.fill(seq, image);
+            }
+            v4l2::FrameView view{.timestamp_monotonic_us = 1'000'000 + std::uint64_t{seq} * spec.interval_us,
+                                 .v4l2_timestamp_us = 1'000'000 + std::uint64_t{seq} * spec.interval_us,
+                                 .image = image,
+                                 .width = spec.width,
+                                 .height = spec.height,
+                                 .format = spec.format,
+                                 .bytes_per_line = bytes_per_line,
+                                 .sequence = seq,
+                                 .error = spec.errored == seq};
+            if (spec.format == v4l2::PixelFormat::NV12M || spec.format == v4l2::PixelFormat::NV16M)
+            {
+                auto const planes = std::span<const std::byte>(image);
+                view.image = planes.first(luma);
+                view.planes = {v4l2::FramePlane{.data = planes.first(luma), .bytes_per_line = spec.width},
+                               v4l2::FramePlane{.data = planes.subspan(luma), .bytes_per_line = spec.width}};
+                view.plane_count = 2;
+            }
+            recorder.record(view);
+        }
+        recorder.close();
+        return path;
+    }
+
+    /*
+     * fs::current_path() / "v4l2-<name>-test-<pid>", emptied when made and removed again on destruction.
+     */
+    class [[nodiscard]] ScratchDir final
+    {
+    public:
+        explicit ScratchDir(std::string_view name)
+            : path_(fs::current_path() / fmt::format("v4l2-{}-test-{}", name, getpid()))
+        {
+            fs::remove_all(path_);
+            fs::create_directories(path_);
+        }
+        ~ScratchDir() noexcept
+        {
+            std::error_code ignored;
+            fs::remove_all(path_, ignored);
+        }
+
+        // No copy or move semantics, one owner removes it
+        ScratchDir(const ScratchDir &) = delete;
+        ScratchDir &operator=(const ScratchDir &) = delete;
+        ScratchDir(ScratchDir &&) = delete;
+        ScratchDir &operator=(ScratchDir &&) = delete;
+
+        [[nodiscard]] const fs::path &path() const noexcept { return path_; }
+        [[nodiscard]] fs::path operator/(std::string_view name) const { return path_ / name; }
+
+    private:
+        fs::path path_;
+    };
+} // namespace fixture
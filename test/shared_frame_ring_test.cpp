@@ -0,0 +1,282 @@
+#include "v4l2/shared_frame_ring.hpp"
+#include <algorithm>  // For std::equal
+#include <cassert>    // For assert
+#include <fcntl.h>    // For O_CREAT, O_EXCL, O_RDWR
+#include <fmt/core.h> // For fmt::print
+#include <stdexcept>  // For std::runtime_error
+#include <sys/mman.h> // For shm_open
+#include <sys/wait.h> // For waitpid
+#include <unistd.h>   // For close, fork, getpid
+#include <vector>     // For std::vector
+
+// No camera needed: frames are synthetic, the reader side runs in this process or in a forked child
+
+namespace
+{
+    std::string ring_name(const char *what)
+    {
+        return fmt::format("/v4l2-ring-test-{}-{}", getpid(), what);
+    }
+
+    // Every byte derives from the sequence, so a torn copy shows up as a mismatch
+    std::vector<std::byte> make_image(std::uint32_t sequence, std::size_t size)
+    {
+        std::vector<std::byte> image(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            image[i] = static_cast<std::byte>((sequence * 31 + i) & 0xFF);
+        }
+        return image;
+    }
+
+    bool image_matches(const v4l2::FrameView &frame)
+    {
+        for (std::size_t i = 0; i < frame.image.size(); ++i)
+        {
+            if (frame.image[i] != static_cast<std::byte>((frame.sequence * 31 + i) & 0xFF))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    v4l2::FrameView as_frame(const std::vector<std::byte> &image, std::uint32_t sequence)
+    {
+        return v4l2::FrameView{.timestamp_monotonic_us = 1000u + sequence,
+                               .image = image,
+                               .width = 64,
+                               .height = 16,
+                               .format = v4l2::PixelFormat::YUYV,
+                               .bytes_per_line = 128,
+                               .sequence = sequence};
+    }
+} // namespace
+
+void test_roundtrip()
+{
+    const auto name = ring_name("roundtrip");
+    v4l2::SharedFrameRing ring({.name_ = name, .slots_ = 4, .slot_size_ = 4096});
+    v4l2::SharedFrameSubscriber subscriber(name);
+    assert(!subscriber.next(std::chrono::milliseconds{1}).has_value());
+
+    auto const image = make_image(5, 2048);
+    auto frame = as_frame(image, 5);
+    frame.error = true;
+    frame.jpeg = v4l2::JpegInfo{.status = v4l2::JpegStatus::OK, .width = 64, .height = 16, .size = 2000};
+    assert(ring.publish(frame));
+
+    auto const got = subscriber.next(std::chrono::milliseconds{100});
+    assert(got.has_value());
+    assert(got->sequence == 5 && got->width == 64 && got->height == 16 && got->bytes_per_line == 128);
+    assert(got->format == v4l2::PixelFormat::YUYV && got->timestamp_monotonic_us == 1005 && got->error);
+    assert(got->dmabuf_fd == -1 && got->image.size() == 2048 && image_matches(*got));
+    assert(got->jpeg.has_value() && got->jpeg->ok() && got->jpeg->size == 2000);
+
+    // too big for a slot: refused, nothing published
+    auto const huge = make_image(6, 8192);
+    assert(!ring.publish(as_frame(huge, 6)));
+    assert(ring.published() == 1);
+    assert(!subscriber.next(std::chrono::milliseconds{1}).has_value());
+}
+
+// NV12M: the CbCr plane is in a buffer of its own, subscribers get it after the Y plane
+void test_separate_plane()
+{
+    const auto name = ring_name("planes");
+    v4l2::SharedFrameRing ring({.name_ = name, .slots_ = 2, .slot_size_ = 1536});
+    v4l2::SharedFrameSubscriber subscriber(name);
+
+    auto const luma = make_image(7, 1024);
+    auto const chroma = make_image(9, 512);
+    auto frame = as_frame(luma, 7);
+    frame.format = v4l2::PixelFormat::NV12M;
+    frame.bytes_per_line = 64;
+    frame.plane_count = 2;
+    frame.planes[0] = v4l2::FramePlane{.data = luma, .bytes_per_line = 64};
+    frame.planes[1] = v4l2::FramePlane{.data = chroma, .bytes_per_line = 64};
+    assert(ring.publish(frame));
+
+    auto const view = subscriber.next_view(std::chrono::milliseconds{100});
+    assert(view.has_value() && view->plane_count == 2 && image_matches(*view));
+    assert(view->planes[0].data.data() == view->image.data() && view->planes[0].data.size() == 1024);
+    assert(view->planes[1].data.data() == view->image.data() + 1024 && view->planes[1].bytes_per_line == 64);
+    assert(std::equal(chroma.begin(), chroma.end(), view->planes[1].data.begin(), view->planes[1].data.end()));
+    assert(subscriber.still_valid());
+
+    assert(ring.publish(frame));
+    auto const copy = subscriber.next(std::chrono::milliseconds{100});
+    assert(copy.has_value() && copy->plane_count == 2 && image_matches(*copy));
+    assert(copy->planes[1].data.data() == copy->image.data() + 1024);
+    assert(std::equal(chroma.begin(), chroma.end(), copy->planes[1].data.begin(), copy->planes[1].data.end()));
+
+    // Y fits, Y and CbCr together do not: refused as a whole
+    auto const big_chroma = make_image(9, 600);
+    frame.planes[1].data = big_chroma;
+    assert(!ring.publish(frame));
+    assert(ring.published() == 2);
+}
+
+void test_lapped_reader()
+{
+    const auto name = ring_name("lapped");
+    v4l2::SharedFrameRing ring({.name_ = name, .slots_ = 4, .slot_size_ = 256});
+    v4l2::SharedFrameSubscriber subscriber(name);
+    for (std::uint32_t seq = 0; seq < 10; ++seq)
+    {
+        assert(ring.publish(as_frame(make_image(seq, 200), seq)));
+    }
+
+    // the publisher never waited: the reader finds only the last four and counts the rest
+    for (std::uint32_t seq = 6; seq < 10; ++seq)
+    {
+        auto const got = subscriber.next(std::chrono::milliseconds{10});
+        assert(got.has_value() && got->sequence == seq && image_matches(*got));
+    }
+    assert(subscriber.skipped() == 6);
+    assert(!subscriber.next(std::chrono::milliseconds{1}).has_value());
+}
+
+void test_view_in_place()
+{
+    const auto name = ring_name("view");
+    v4l2::SharedFrameRing ring({.name_ = name, .slots_ = 2, .slot_size_ = 1024});
+    v4l2::SharedFrameSubscriber subscriber(name);
+    assert(!subscriber.still_valid());
+
+    assert(ring.publish(as_frame(make_image(1, 1000), 1)));
+    auto const first = subscriber.next_view(std::chrono::milliseconds{100});
+    assert(first.has_value() && first->sequence == 1 && image_matches(*first));
+    assert(subscriber.still_valid());
+
+    // one more frame lands in the other slot, two more come round to ours
+    assert(ring.publish(as_frame(make_image(2, 1000), 2)));
+    assert(subscriber.still_valid());
+    assert(ring.publish(as_frame(make_image(3, 1000), 3)));
+    assert(!subscriber.still_valid());
+
+    // the view of the frame that took the slot over checks out again
+    auto const second = subscriber.next_view(std::chrono::milliseconds{100});
+    assert(second.has_value() && second->sequence == 2 && subscriber.still_valid() && image_matches(*second));
+    auto const third = subscriber.next_view(std::chrono::milliseconds{100});
+    assert(third.has_value() && third->sequence == 3 && subscriber.still_valid());
+    assert(third->image.data() == first->image.data() && image_matches(*third));
+}
+
+void test_other_process()
+{
+    const auto name = ring_name("fork");
+    v4l2::SharedFrameRing ring({.name_ = name, .slots_ = 8, .slot_size_ = 64 * 1024});
+    constexpr std::uint32_t frames = 2000;
+
+    // the child attaches first and then waits on the futex for every frame
+    int ready[2];
+    assert(pipe(ready) == 0);
+    const pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0)
+    {
+        close(ready[0]);
+        v4l2::SharedFrameSubscriber subscriber(name);
+        [[maybe_unused]] const auto written = write(ready[1], "x", 1);
+        std::uint32_t last = 0;
+        std::uint32_t received = 0;
+        while (last + 1 < frames)
+        {
+            auto const got = subscriber.next(std::chrono::seconds{5});
+            if (!got.has_value() || !image_matches(*got) || (received > 0 && got->sequence <= last))
+            {
+                _exit(1);
+            }
+            last = got->sequence;
+            ++received;
+        }
+        // a reader that keeps up sees most frames; torn or lapped ones are skipped, never delivered
+        _exit(received + subscriber.skipped() == frames ? 0 : 2);
+    }
+    close(ready[1]);
+    char byte{};
+    assert(read(ready[0], &byte, 1) == 1);
+    close(ready[0]);
+
+    for (std::uint32_t seq = 0; seq < frames; ++seq)
+    {
+        auto const image = make_image(seq, 1000 + (seq % 7) * 9000);
+        assert(ring.publish(as_frame(image, seq)));
+        if (seq % 64 == 0)
+        {
+            usleep(100); // let the reader go to sleep now and then
+        }
+    }
+    int status = 0;
+    assert(waitpid(child, &status, 0) == child);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+void test_name_taken()
+{
+    const auto name = ring_name("taken");
+    {
+        v4l2::SharedFrameRing ring({.name_ = name, .slots_ = 2, .slot_size_ = 256});
+        v4l2::SharedFrameSubscriber subscriber(name);
+        try
+        {
+            v4l2::SharedFrameRing second({.name_ = name, .slots_ = 2, .slot_size_ = 256});
+            assert(false && "should have thrown");
+        }
+        catch (const std::runtime_error &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+
+        // the running publisher kept its segment and its reader
+        assert(ring.publish(as_frame(make_image(1, 200), 1)));
+        auto const got = subscriber.next(std::chrono::milliseconds{100});
+        assert(got.has_value() && got->sequence == 1);
+    }
+
+    // left behind by a publisher that died: nobody holds the lock, so it is replaced
+    const int stale = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    assert(stale >= 0);
+    close(stale);
+    v4l2::SharedFrameRing ring({.name_ = name, .slots_ = 2, .slot_size_ = 256});
+    v4l2::SharedFrameSubscriber subscriber(name);
+    assert(ring.publish(as_frame(make_image(2, 200), 2)));
+    assert(subscriber.next(std::chrono::milliseconds{100}).has_value());
+}
+
+void test_errors()
+{
+    try
+    {
+        v4l2::SharedFrameSubscriber missing(ring_name("missing"));
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    try
+    {
+        v4l2::SharedFrameRing invalid({.name_ = ring_name("invalid"), .slots_ = 0, .slot_size_ = 16});
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+int main()
+{
+    fmt::print("Starting shared frame ring tests\n");
+    test_roundtrip();
+    test_separate_plane();
+    test_lapped_reader();
+    test_view_in_place();
+    test_other_process();
+    test_name_taken();
+    test_errors();
+    fmt::print("Success\n");
+    return 0;
+}
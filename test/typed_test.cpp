@@ -0,0 +1,188 @@
+#include "v4l2/typed.hpp"
+#include "replay_fixture.hpp"
+#include <array>      // For std::array
+#include <cassert>    // For assert
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <span>       // For std::span
+#include <stdexcept>  // For std::runtime_error
+#include <utility>    // For std::declval
+#include <vector>     // For std::vector
+
+// No camera needed: a replay:// recording stands in for a fixed-mode camera
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr std::uint32_t WIDTH = 64;
+    constexpr std::uint32_t HEIGHT = 48;
+
+    using Camera = v4l2::TypedCamera<v4l2::PixelFormat::YUYV, v4l2::to_dimension(WIDTH, HEIGHT)>;
+    using Mode = Camera::Mode;
+
+    static_assert(Mode::width == WIDTH && Mode::height == HEIGHT);
+    static_assert(Mode::stride == WIDTH * 2 && Mode::frame_size == std::size_t{WIDTH} * HEIGHT * 2);
+    static_assert(Camera::Frame::size() == Mode::frame_size);
+    static_assert(decltype(std::declval<Camera::Frame>().row(0))::extent == WIDTH / 2);
+    static_assert(decltype(std::declval<Camera::Frame>().macropixels())::extent == WIDTH / 2 * HEIGHT);
+    static_assert(v4l2::converted_size_v<v4l2::ConvertFormat::NV12, Mode> == std::size_t{WIDTH} * HEIGHT * 3 / 2);
+
+    using Mjpeg = v4l2::StaticMode<v4l2::PixelFormat::MJPG, v4l2::PixelDimension::DIM_FHD>;
+    static_assert(Mjpeg::width == 1920 && Mjpeg::height == 1080 && !Mjpeg::raw && Mjpeg::frame_size == 0);
+
+    // luma counts up along the row, chroma encodes the row: every byte says where it came from
+    void pattern(std::uint32_t seq, std::span<std::byte> image)
+    {
+        for (std::uint32_t y = 0; y < HEIGHT; ++y)
+        {
+            for (std::uint32_t x = 0; x < WIDTH; ++x)
+            {
+                auto *px = &image[(std::size_t{y} * WIDTH + x) * 2];
+                px[0] = static_cast<std::byte>((x + seq) & 0xFF);
+                px[1] = static_cast<std::byte>(x % 2 == 0 ? y : 255 - y);
+            }
+        }
+    }
+
+    v4l2::V4l2Config replay_config(const fs::path &recording)
+    {
+        // format_ and dimension_ left at their defaults, the typed camera sets them
+        return v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}?rate=max", recording.string()), .buffer_count_ = 4};
+    }
+} // namespace
+
+void test_typed_frames(const fs::path &recording)
+{
+    fmt::print("Testing typed frames\n");
+    Camera camera(replay_config(recording));
+    assert(camera.camera().config().format_ == v4l2::PixelFormat::YUYV);
+    camera.open_device();
+    camera.configure();
+    camera.start_streaming();
+
+    for (std::uint32_t i = 0; i < 4; ++i)
+    {
+        auto lease = camera.capture_frame();
+        auto const frame = lease.frame();
+        auto const seq = lease->sequence;
+        for (std::uint32_t y = 0; y < HEIGHT; ++y)
+        {
+            auto const row = frame.row(y);
+            for (std::size_t x = 0; x < row.size(); ++x)
+            {
+                assert(row[x].y0 == ((2 * x + seq) & 0xFF) && row[x].y1 == ((2 * x + 1 + seq) & 0xFF));
+                assert(row[x].u == y && row[x].v == 255 - y);
+            }
+        }
+        assert(frame.macropixels()[WIDTH / 2].u == 1); // the second row starts where the first ends
+        assert(frame.bytes().data() == lease->image.data());
+    }
+    camera.stop_streaming();
+}
+
+void test_typed_convert(const fs::path &recording)
+{
+    fmt::print("Testing typed conversion\n");
+    Camera camera(replay_config(recording));
+    camera.open_device();
+    camera.configure();
+    camera.start_streaming();
+
+    auto lease = camera.capture_frame();
+    std::array<std::byte, v4l2::converted_size_v<v4l2::ConvertFormat::GRAY8, Mode>> gray{};
+    v4l2::convert<v4l2::ConvertFormat::GRAY8>(lease.frame(), std::span(gray));
+    auto const macropixels = lease.frame().macropixels();
+    for (std::size_t i = 0; i < macropixels.size(); ++i)
+    {
+        assert(gray[2 * i] == std::byte{macropixels[i].y0} && gray[2 * i + 1] == std::byte{macropixels[i].y1});
+    }
+    lease.release();
+    camera.stop_streaming();
+}
+
+void test_wrong_mode(const fs::path &recording)
+{
+    fmt::print("Testing a mode the device does not run\n");
+    v4l2::TypedCamera<v4l2::PixelFormat::YUYV, v4l2::to_dimension(WIDTH / 2, HEIGHT / 2)> smaller(replay_config(recording));
+    smaller.open_device();
+    try
+    {
+        smaller.configure();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    v4l2::TypedCamera<v4l2::PixelFormat::MJPG, v4l2::to_dimension(WIDTH, HEIGHT)> mjpeg(replay_config(recording));
+    mjpeg.open_device();
+    try
+    {
+        mjpeg.configure();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+// A replayed frame is only as long as its record: a short one must not reach the fixed-extent spans
+void test_short_frame(const fs::path &dir)
+{
+    fmt::print("Testing a short replayed frame\n");
+    auto const path = dir / "short.v4lr";
+    {
+        v4l2::Recorder recorder({.path_ = path.string(), .queue_depth_ = 4});
+        std::vector<std::byte> image(Mode::frame_size, std::byte{0x80});
+        for (std::uint32_t seq = 0; seq < 2; ++seq)
+        {
+            // the second record lost its bottom half
+            recorder.record(v4l2::FrameView{.timestamp_monotonic_us = 1'000'000 + seq * 10'000ULL,
+                                            .image = std::span<const std::byte>(image).first(seq == 0 ? Mode::frame_size : Mode::frame_size / 2),
+                                            .width = WIDTH,
+                                            .height = HEIGHT,
+                                            .format = v4l2::PixelFormat::YUYV,
+                                            .bytes_per_line = WIDTH * 2,
+                                            .sequence = seq});
+        }
+        recorder.close();
+    }
+
+    Camera camera(replay_config(path));
+    camera.open_device();
+    camera.configure();
+    camera.start_streaming();
+    {
+        auto lease = camera.capture_frame();
+        assert(lease->sequence == 0 && lease.frame().bytes().size() == Mode::frame_size);
+    }
+    try
+    {
+        [[maybe_unused]] auto const lease = camera.capture_frame();
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    assert(camera.camera().outstanding_frames() == 0); // the refused frame went back to the driver
+    camera.stop_streaming();
+}
+
+int main()
+{
+    fmt::print("Starting typed camera tests\n");
+    const fixture::ScratchDir dir("typed");
+    auto const recording = fixture::make_recording(dir / "typed.v4lr", {.width = WIDTH, .height = HEIGHT, .frames = 4, .interval_us = 10'000, .fill = pattern});
+
+    test_typed_frames(recording);
+    test_typed_convert(recording);
+    test_wrong_mode(recording);
+    test_short_frame(dir.path());
+
+    fmt::print("Success\n");
+    return 0;
+}
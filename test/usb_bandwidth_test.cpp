@@ -0,0 +1,180 @@
+#include "v4l2/usb_bandwidth.hpp"
+#include <cassert>    // For assert
+#include <filesystem> // For std::filesystem
+#include <fmt/core.h> // For fmt::print
+#include <fstream>    // For std::ofstream
+#include <stdexcept>  // For std::runtime_error
+#include <unistd.h>   // For getpid
+#include <vector>     // For std::vector
+
+// No camera needed: topology comes from a fake sysfs tree, modes are made up
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    void write_file(const fs::path &path, const char *text)
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << text << '\n';
+    }
+
+    // /sys/devices/pci0000:00/0000:00:14.0/usb3/3-1/3-1.2/3-1.2:1.0/video4linux/video7, like uvcvideo
+    fs::path fake_sysfs(const fs::path &root)
+    {
+        auto const sys = root / "sys";
+        auto const controller = sys / "devices/pci0000:00/0000:00:14.0";
+        auto const hub = controller / "usb3";
+        auto const device = hub / "3-1" / "3-1.2";
+        write_file(hub / "busnum", "3");
+        write_file(hub / "speed", "480");
+        write_file(hub / "3-1" / "busnum", "3");
+        write_file(hub / "3-1" / "speed", "480");
+        write_file(device / "busnum", "3");
+        write_file(device / "speed", "480");
+        write_file(device / "serial", "SN0042");
+        auto const node = device / "3-1.2:1.0/video4linux/video7";
+        fs::create_directories(node);
+        fs::create_directory_symlink(device / "3-1.2:1.0", node / "device");
+        fs::create_directories(sys / "class/video4linux");
+        fs::create_directory_symlink(node, sys / "class/video4linux/video7");
+        write_file(root / "dev/video7", "");
+        return sys;
+    }
+
+    // a typical UVC camera: MJPG up to 1080p30, YUYV too
+    std::vector<v4l2::CaptureMode> uvc_modes()
+    {
+        std::vector<v4l2::CaptureMode> modes;
+        for (auto const format : {v4l2::PixelFormat::MJPG, v4l2::PixelFormat::YUYV})
+        {
+            modes.push_back({.format = format, .width = 1920, .height = 1080, .frame_rates = {{30, 1}, {15, 1}}});
+            modes.push_back({.format = format, .width = 1280, .height = 720, .frame_rates = {{30, 1}, {15, 1}}});
+            modes.push_back({.format = format, .width = 640, .height = 480, .frame_rates = {{30, 1}}});
+        }
+        return modes;
+    }
+
+    v4l2::BandwidthRequest request_on(std::uint32_t bus, v4l2::UsbSpeed speed)
+    {
+        return v4l2::BandwidthRequest{.config = {.device_path_ = fmt::format("/dev/video{}", bus),
+                                                 .dimension_ = v4l2::PixelDimension::DIM_FHD,
+                                                 .format_ = v4l2::PixelFormat::MJPG},
+                                      .modes = uvc_modes(),
+                                      .topology = v4l2::UsbTopology{.bus = bus, .port = "1", .controller = "0000:00:14.0", .speed = speed, .serial = {}}};
+    }
+} // namespace
+
+void test_topology()
+{
+    fmt::print("Testing topology\n");
+    auto const root = fs::current_path() / fmt::format("v4l2-usb-test-{}", getpid());
+    fs::remove_all(root);
+    auto const sys = fake_sysfs(root);
+
+    auto const topology = v4l2::usb_topology((root / "dev/video7").string(), {}, sys);
+    assert(topology && topology->bus == 3 && topology->port == "3-1.2");
+    assert(topology->controller == "0000:00:14.0" && topology->speed == v4l2::UsbSpeed::HIGH);
+    assert(topology->serial == "SN0042");
+
+    // no sysfs entry: bus_info still names controller and port
+    auto const fallback = v4l2::usb_topology("/dev/video99", "usb-0000:00:14.0-1.2", sys);
+    assert(fallback && fallback->controller == "0000:00:14.0" && fallback->port == "1.2");
+    assert(!v4l2::usb_topology("replay:///x.v4lr", "replay:", sys));
+    assert(!v4l2::usb_topology("/dev/video99", "platform:csi0", sys));
+    fs::remove_all(root);
+}
+
+void test_prediction()
+{
+    fmt::print("Testing bandwidth prediction\n");
+    const v4l2::UsbBandwidthModel exact{.overhead_ = 0.0};
+    assert(v4l2::predict_usb_bandwidth(v4l2::PixelFormat::YUYV, 640, 480, {30, 1}, exact) == 18'432'000);
+    assert(v4l2::predict_usb_bandwidth(v4l2::PixelFormat::MJPG, 640, 480, {30, 1}, exact) == 4'608'000);
+    assert(v4l2::predict_usb_bandwidth(v4l2::PixelFormat::YUYV, 640, 480, {30000, 1001}, exact) < 18'432'000);
+    assert(v4l2::usb_endpoint_limit(v4l2::UsbSpeed::HIGH) < v4l2::usb_periodic_budget(v4l2::UsbSpeed::HIGH));
+}
+
+void test_plan()
+{
+    fmt::print("Testing the planner\n");
+    // 🚌 five cameras on one USB 2 bus, one on SuperSpeed, one not on USB
+    std::vector<v4l2::BandwidthRequest> requests;
+    for (int i = 0; i < 5; ++i)
+    {
+        requests.push_back(request_on(3, v4l2::UsbSpeed::HIGH));
+    }
+    requests.push_back(request_on(4, v4l2::UsbSpeed::SUPER));
+    requests.push_back({.config = {.device_path_ = "/dev/video20"}, .modes = {}, .topology = std::nullopt});
+
+    const v4l2::UsbBandwidthModel model{};
+    auto const plans = v4l2::plan_usb_bandwidth(requests, model);
+    assert(plans.size() == requests.size());
+
+    std::uint64_t bus3 = 0;
+    bool lowered = false;
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+        bus3 += plans[i].bytes_per_second;
+        lowered = lowered || plans[i].downgraded;
+        auto const [w, h] = v4l2::dimensions_decompress(static_cast<std::uint32_t>(plans[i].config.dimension_));
+        fmt::print("  camera {}: {}x{} {:08X} {} fps, {:.1f} MB/s\n", i, w, h, static_cast<std::uint32_t>(plans[i].config.format_),
+                   static_cast<std::uint32_t>(plans[i].config.fps_num_), static_cast<double>(plans[i].bytes_per_second) / 1e6);
+    }
+    assert(lowered);
+    assert(static_cast<double>(bus3) <= static_cast<double>(v4l2::usb_periodic_budget(v4l2::UsbSpeed::HIGH)) * model.headroom_);
+
+    // SuperSpeed has room: the best mode within the request, 1080p30 MJPG
+    assert(!plans[5].downgraded && plans[5].config.dimension_ == v4l2::PixelDimension::DIM_FHD);
+    assert(plans[5].config.fps_num_ == v4l2::FPS::FPS_30 && plans[5].config.format_ == v4l2::PixelFormat::MJPG);
+    // off USB: untouched
+    assert(plans[6].bytes_per_second == 0 && plans[6].config.dimension_ == requests[6].config.dimension_);
+
+    // one camera alone on USB 2: 1080p30 MJPG is more than one endpoint, 1080p15 is the best that fits
+    auto const alone = v4l2::plan_usb_bandwidth({request_on(3, v4l2::UsbSpeed::HIGH)});
+    assert(!alone[0].downgraded && alone[0].config.dimension_ == v4l2::PixelDimension::DIM_FHD);
+    assert(alone[0].config.fps_num_ == v4l2::FPS::FPS_15);
+}
+
+void test_errors()
+{
+    // twenty cameras on a full-speed bus cannot fit at any mode
+    std::vector<v4l2::BandwidthRequest> crowded(20, request_on(1, v4l2::UsbSpeed::FULL));
+    for (auto &request : crowded)
+    {
+        request.modes = {{.format = v4l2::PixelFormat::MJPG, .width = 320, .height = 240, .frame_rates = {{5, 1}}}};
+    }
+    try
+    {
+        [[maybe_unused]] auto const plans = v4l2::plan_usb_bandwidth(crowded);
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+
+    // nothing within the request fits one endpoint
+    auto only_raw = request_on(3, v4l2::UsbSpeed::HIGH);
+    only_raw.modes = {{.format = v4l2::PixelFormat::YUYV, .width = 1920, .height = 1080, .frame_rates = {{30, 1}}}};
+    try
+    {
+        [[maybe_unused]] auto const plans = v4l2::plan_usb_bandwidth({only_raw});
+        assert(false && "should have thrown");
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+}
+
+int main()
+{
+    fmt::print("Starting USB bandwidth tests\n");
+    test_topology();
+    test_prediction();
+    test_plan();
+    test_errors();
+    fmt::print("Success\n");
+    return 0;
+}
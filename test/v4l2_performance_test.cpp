@@ -1,655 +1,761 @@
+#include "v4l2/camera_group.hpp"
+#include "v4l2/recorder.hpp"
 #include "v4l2/v4l2.hpp"
-#include <algorithm>     // For std::min/max_element
-#include <cassert>       // For assert
+#include <algorithm>     // For std::sort
+#include <atomic>        // For std::atomic
 #include <chrono>        // For std::chrono::*
+#include <cmath>         // For std::ceil
 #include <cstdint>       // For std::uint64_t
-#include <fmt/core.h>    // For fmt::format
-#include <fstream>       // For std::ifstream, std::ofstream
-#include <memory>        // For std::unique_ptr
-#include <numeric>       // For std::accumulate
-#include <sstream>       // For std::istringstream
-#include <stdexcept>     // For std::runtime_error
+#include <cstdio>        // For std::FILE, std::fopen
+#include <cstdlib>       // For std::system
+#include <filesystem>    // For std::filesystem
+#include <fmt/core.h>    // For fmt::format, fmt::print
+#include <optional>      // For std::optional
 #include <string>        // For std::string
+#include <string_view>   // For std::string_view
+#include <sys/resource.h> // For getrusage
+#include <sys/utsname.h> // For uname
+#include <thread>        // For std::this_thread, std::thread::hardware_concurrency
+#include <unistd.h>      // For getpid
 #include <unordered_set> // For std::unordered_set
 #include <vector>        // For std::vector
-#include <zlib.h>        // because even *your* hash logic shouldn't be trusted
+#include <zlib.h>        // For crc32, only with --hash
 
-// Structure defining the parameters for a camera test configuration
-struct TestCase
-{
-    std::string label;
-    v4l2::PixelDimension dimension;
-    v4l2::PixelFormat format;
-    v4l2::FPS fps;
-    std::uint32_t buffer_count;
-};
-
-// Structure holding the results of a performance test run
-struct TestResult
-{
-    TestCase test;                // The base configuration used for the test
-    int num_cameras;              // How many cameras were active in this test
-    double ms_per_capture_cycle;  // Avg time (ms) to capture one frame from *all* cameras
-    double cpu_usage_percent;     // Overall CPU usage during the test
-    double mbps;                  // Total data throughput (MB/s) across all cameras
-    bool kernel_warnings;         // Flag indicating potential USB issues in dmesg
-    std::size_t crc_unique_count; // Number of unique frame hashes observed
-    double jitter_min_ms;         // Min time delta (ms) between frames (based on cam 0)
-    double jitter_max_ms;         // Max time delta (ms) between frames (based on cam 0)
-    double jitter_avg_ms;         // Avg time delta (ms) between frames (based on cam 0)
-    double mem_usage_mb;          // Peak resident memory usage (MB) of the process
-    double v4l2_interval_ms_avg;  // Avg diff (ms) between V4L2 timestamp and monotonic clock
-};
-
-// Function to print the collected test results in a formatted table
-void print_results(const std::vector<TestResult> &results)
+/*
+ * Capture benchmark. Every case streams for --warmup seconds unmeasured, then --duration seconds in which the
+ * loop thread only stamps and counts: no hashing, no printing, sample vectors reserved up-front.
+ * Percentiles are exact (sorted samples), CPU is this process only (getrusage), so runs on one machine compare.
+ * Progress goes to stderr, results to stdout or --output as a table, JSON or CSV.
+ */
+
+namespace
 {
-    fmt::print("{:<15} {:>4} {:>11} {:>6s} {:>5} {:>4} {:>13} {:>10} {:>8} {:>10} {:>10} {:>20} {:>10}  {:>10}\n",
-               "Label", "NCam", "Resolution", "FPS", "Fmt", "Bufs", "Cycle Time", "CPU (%)", "Kernel", "MB/s", "CRC uniq", "Jitter (min/max/avg)", "RAM (MB)", "V4L2 Interval (ms)");
+    namespace fs = std::filesystem;
+    using Clock = std::chrono::steady_clock;
 
-    fmt::print("{:-<190}\n", ""); // Increased width for the new column
+    enum class OutputFormat
+    {
+        TABLE,
+        JSON,
+        CSV,
+    };
 
-    for (const auto &r : results)
+    struct Options
     {
-        auto [w, h] = v4l2::dimensions_decompress(static_cast<std::uint32_t>(r.test.dimension)); // Decompress dimensions
-        const char *fmt_str = r.test.format == v4l2::PixelFormat::MJPG ? "MJPG" : "YUYV";
-
-        fmt::print("{:<15} {:>4} {:>9} {:>6} {:>6s} {:>4} {:>13.3f} {:>10.1f} {:>8} {:>10.2f} {:>10} {:>6.2f}/{:>5.2f}/{:>5.2f} {:>10.2f}  {:>10.2f}\n",
-                   r.test.label,
-                   r.num_cameras,              // Print number of cameras
-                   fmt::format("{}x{}", w, h), // Format dimensions here
-                   static_cast<uint32_t>(r.test.fps),
-                   fmt_str,
-                   r.test.buffer_count,
-                   r.ms_per_capture_cycle, // Changed column name
-                   r.cpu_usage_percent,
-                   r.kernel_warnings ? "WARN" : "-",
-                   r.mbps,
-                   fmt::format("{}/{}", r.crc_unique_count, 100 * r.num_cameras), // Adjusted total expected frames for CRC
-                   r.jitter_min_ms,
-                   r.jitter_max_ms,
-                   r.jitter_avg_ms,
-                   r.mem_usage_mb,
-                   r.v4l2_interval_ms_avg);
-    }
-}
+        double warmup_s = 2.0;
+        double duration_s = 10.0;
+        OutputFormat format = OutputFormat::TABLE;
+        std::string output;                                            // empty: stdout
+        bool hash = false;                                             // CRC32 of hash_frames frames per camera after the timed run
+        std::size_t hash_frames = 100;
+        std::vector<std::string> devices{"/dev/video0", "/dev/video2"}; // single: the first, dual: two, multi: all (3+)
+        std::string replay;                                            // recording for the replay suite, empty: a synthetic one
+        std::vector<std::string> suites{"replay", "single", "dual", "multi"};
+    };
 
-// Consolidated function to measure capture performance for one or more cameras
-TestResult measure_capture_performance(const TestCase &base_test, const std::vector<std::string> &device_paths)
-{
-    assert(!device_paths.empty() && "Must provide at least one device path.");
+    struct BenchCase
+    {
+        std::string suite;
+        std::string label;
+        std::vector<std::string> devices;
+        v4l2::PixelDimension dimension;
+        v4l2::PixelFormat format;
+        v4l2::FPS fps;
+        std::uint32_t buffer_count;
+    };
 
-    std::vector<std::unique_ptr<v4l2::V4L2Camera>> cameras;
-    cameras.reserve(device_paths.size());
+    // Exact percentiles of one metric in microseconds
+    struct Percentiles
+    {
+        std::size_t count{};
+        std::uint64_t p50_us{};
+        std::uint64_t p99_us{};
+        std::uint64_t max_us{};
+    };
 
-    fmt::print("  Configuring {} camera(s) for test '{}':\n", device_paths.size(), base_test.label);
+    struct BenchResult
+    {
+        BenchCase bench;
+        std::string status = "ok"; // ok, skipped (could not open or start), failed (error while measuring)
+        std::string error;
+        double seconds{};          // measured wall time
+        std::uint64_t frames{};    // every camera, measured window only
+        double fps{};              // per camera
+        double mb_per_s{};         // every camera
+        Percentiles dqbuf;          // DQBUF return to the frame in the consumer's hands
+        Percentiles jitter;         // |frame interval - median interval|, driver timestamps
+        Percentiles driver_to_user; // driver timestamp to DQBUF return, monotonic driver clocks only
+        std::uint64_t interval_p50_us{};
+        double cpu_percent{};       // user + system of this process, 100 = one core
+        double user_s{};
+        double system_s{};
+        double max_rss_mb{};
+        std::uint64_t lost_frames{};
+        std::uint64_t errored_buffers{};
+        double lost_percent{};
+        std::optional<std::size_t> unique_hashes; // --hash only
+        std::size_t hashed_frames{};
+        bool kernel_warnings = false;
+    };
+
+    // Per camera, written by the loop thread only, read after stop()
+    struct CameraSamples
+    {
+        std::vector<std::uint64_t> dqbuf_us;
+        std::vector<std::uint64_t> driver_to_user_us;
+        std::vector<std::uint64_t> timestamps_us;
+        std::uint64_t frames{};
+        std::uint64_t bytes{};
+        std::unordered_set<std::uint32_t> hashes;
+        std::size_t hashed{};
+    };
+
+    enum class Phase : int
+    {
+        WARMUP,
+        MEASURE,
+        HASH,
+        DONE,
+    };
 
-    // --- Setup Cameras ---
-    try
+    [[nodiscard]] std::uint64_t monotonic_us() noexcept
     {
-        for (const auto &path : device_paths)
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1'000'000 + static_cast<std::uint64_t>(ts.tv_nsec) / 1000;
+    }
+
+    [[nodiscard]] Percentiles percentiles(std::vector<std::uint64_t> samples)
+    {
+        if (samples.empty())
         {
-            v4l2::V4l2Config config{};
-            config.device_path_ = path;
-            config.dimension_ = base_test.dimension;
-            config.format_ = base_test.format;
-            config.fps_num_ = base_test.fps;
-            config.buffer_count_ = base_test.buffer_count;
-
-            auto [w, h] = v4l2::dimensions_decompress(static_cast<std::uint32_t>(config.dimension_)); // Decompress here for logging
-
-            fmt::print("    - Device: {}, Res: {}, Fmt: {}, FPS: {}, Bufs: {}\n",
-                       path,
-                       fmt::format("{}x{}", w, h), // Format dimensions here
-                       config.format_ == v4l2::PixelFormat::MJPG ? "MJPG" : "YUYV",
-                       static_cast<uint32_t>(config.fps_num_),
-                       config.buffer_count_);
-
-            auto cam = std::make_unique<v4l2::V4L2Camera>(config);
-            cam->open_device();
-            cam->configure();
-            cam->start_streaming();
-            cameras.push_back(std::move(cam));
+            return {};
         }
+        std::sort(samples.begin(), samples.end());
+        auto const rank = [&](double p)
+        {
+            auto const index = static_cast<std::size_t>(std::ceil(p * static_cast<double>(samples.size())));
+            return samples[std::max<std::size_t>(index, 1) - 1];
+        };
+        return Percentiles{.count = samples.size(), .p50_us = rank(0.50), .p99_us = rank(0.99), .max_us = samples.back()};
     }
-    catch (const std::exception &e)
+
+    [[nodiscard]] double cpu_seconds(const timeval &tv) noexcept
     {
-        fmt::print(stderr, "ERROR: Failed to setup camera during configuration: {}\n", e.what());
-        // Cleanup already opened cameras before re-throwing
-        // Iterate by index to access device_path for potential error messages during cleanup
-        for (size_t i = 0; i < cameras.size(); ++i)
-        {
-            if (cameras[i])
-            { // Check if unique_ptr is not null
-                try
-                {
-                    // Attempt stop_streaming without checking is_streaming()
-                    cameras[i]->stop_streaming();
-                }
-                catch (const std::exception &cleanup_e)
-                {
-                    // Log cleanup error, using device_paths[i] for context
-                    fmt::print(stderr, "WARN: Error stopping already configured camera {} during cleanup: {}\n", device_paths[i], cleanup_e.what());
-                }
-                catch (...)
-                {
-                    fmt::print(stderr, "WARN: Unknown error stopping already configured camera {} during cleanup.\n", device_paths[i]);
-                }
-            }
-        }
-        throw; // Re-throw the original exception to signal failure
+        return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
     }
 
-    // --- Prepare Measurement Variables ---
-    auto cpu_stat_before = std::ifstream("/proc/stat");
-    std::string _; // Dummy string to read "cpu" label
-    long user1 = 0, nice1 = 0, system1 = 0, idle1 = 0;
-    if (!(cpu_stat_before >> _ >> user1 >> nice1 >> system1 >> idle1))
+    [[nodiscard]] const char *format_name(v4l2::PixelFormat format) noexcept
     {
-        fmt::print(stderr, "WARN: Could not read initial /proc/stat\n");
-        // Handle error or default values if needed
+        switch (format)
+        {
+        case v4l2::PixelFormat::MJPG:
+            return "MJPG";
+        case v4l2::PixelFormat::YUYV:
+            return "YUYV";
+        case v4l2::PixelFormat::NV12:
+            return "NV12";
+        case v4l2::PixelFormat::NV16:
+            return "NV16";
+        case v4l2::PixelFormat::NV12M:
+            return "NV12M";
+        case v4l2::PixelFormat::NV16M:
+            return "NV16M";
+        default:
+            return "?";
+        }
     }
 
-    constexpr int num_frames_per_camera = 100;
-    std::size_t total_bytes = 0;                // Use std::size_t, usually unsigned long long
-    std::vector<std::uint64_t> timestamps_cam0; // Timestamps from the *first* camera for jitter
-    timestamps_cam0.reserve(num_frames_per_camera);
-    std::unordered_set<std::uint32_t> crc_set;
-    crc_set.reserve(num_frames_per_camera * cameras.size());
-    std::vector<std::uint64_t> v4l2_intervals_us;
-    v4l2_intervals_us.reserve(num_frames_per_camera * cameras.size());
+    [[nodiscard]] std::string mode_name(const BenchCase &bench)
+    {
+        auto const [w, h] = v4l2::dimensions_decompress(static_cast<std::uint32_t>(bench.dimension));
+        return fmt::format("{}x{}", w, h);
+    }
 
-    fmt::print("  Starting capture loop ({} frames per camera)...\n", num_frames_per_camera);
-    const auto start = std::chrono::high_resolution_clock::now();
+    [[nodiscard]] bool is_replay(const BenchCase &bench) noexcept
+    {
+        return bench.devices.front().starts_with("replay://");
+    }
 
-    // --- Capture Loop ---
-    try
+    void run_case(const BenchCase &bench, const Options &options, BenchResult &result)
     {
-        for (int i = 0; i < num_frames_per_camera; ++i)
+        v4l2::CameraGroup group;
+        for (auto const &path : bench.devices)
         {
-            for (size_t cam_idx = 0; cam_idx < cameras.size(); ++cam_idx)
-            {
-                // Added check if camera pointer is valid, although setup should ensure this
-                if (!cameras[cam_idx])
-                    continue;
+            v4l2::V4l2Config config{};
+            config.device_path_ = path;
+            config.dimension_ = bench.dimension;
+            config.format_ = bench.format;
+            config.fps_num_ = bench.fps;
+            config.buffer_count_ = bench.buffer_count;
+            group.add_camera(config);
+        }
+        try
+        {
+            group.open_all();
+        }
+        catch (const std::exception &e)
+        {
+            result.status = "skipped";
+            result.error = e.what();
+            return;
+        }
 
-                auto const frame = cameras[cam_idx]->capture_frame();
-                cameras[cam_idx]->release_frame();
+        // 📏 room for twice the nominal rate, the timed region must not allocate: past it frames are counted, not sampled
+        auto const expected = std::max<std::size_t>(
+            static_cast<std::size_t>(2.0 * options.duration_s * static_cast<double>(bench.fps)), std::size_t{1} << 18);
+        std::vector<CameraSamples> samples(group.size());
+        for (auto &camera : samples)
+        {
+            camera.dqbuf_us.reserve(expected);
+            camera.driver_to_user_us.reserve(expected);
+            camera.timestamps_us.reserve(expected);
+        }
 
-                v4l2_intervals_us.push_back(frame.timestamp_monotonic_us - frame.v4l2_timestamp_us);
-                total_bytes += frame.image.size(); // Safe: size_t += size_t
+        std::atomic<Phase> phase{Phase::WARMUP};
+        std::atomic<std::size_t> hashed_cameras{0};
+        std::atomic<bool> failed{false};
+        std::string failure; // set once, before `failed`
 
-                // Record timestamp for jitter analysis (only from the first camera)
-                if (cam_idx == 0)
+        // Runs on the loop thread, frames in the order the cameras deliver them
+        auto on_frame = [&](std::size_t index, v4l2::FrameLease &&lease)
+        {
+            const std::uint64_t now_us = monotonic_us();
+            auto const &frame = lease.view();
+            auto &camera = samples[index];
+            switch (phase.load(std::memory_order_acquire))
+            {
+            case Phase::MEASURE:
+                ++camera.frames;
+                camera.bytes += frame.image.size();
+                if (camera.timestamps_us.size() == camera.timestamps_us.capacity())
                 {
-                    timestamps_cam0.push_back(frame.v4l2_timestamp_us);
+                    break;
                 }
-
-                // Calculate CRC32 hash
-                uLong crc = crc32(0L, Z_NULL, 0);
-                // Ensure frame.image.data() and frame.image.size() are valid before hashing
-                if (frame.image.data() != nullptr && frame.image.size() > 0)
+                camera.dqbuf_us.push_back(now_us - frame.timestamp_monotonic_us);
+                if ((frame.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC &&
+                    frame.timestamp_monotonic_us >= frame.v4l2_timestamp_us)
                 {
-                    uLong hash = crc32(crc, reinterpret_cast<const Bytef *>(frame.image.data()), static_cast<uInt>(frame.image.size()));
-                    crc_set.insert(static_cast<std::uint32_t>(hash));
+                    camera.driver_to_user_us.push_back(frame.timestamp_monotonic_us - frame.v4l2_timestamp_us);
                 }
-                else
+                camera.timestamps_us.push_back(frame.v4l2_timestamp_us);
+                break;
+            case Phase::HASH:
+                if (camera.hashed < options.hash_frames)
                 {
-                    fmt::print(stderr, "WARN: Skipping CRC calculation for empty or null frame from camera index {}.\n", cam_idx);
+                    auto const crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(frame.image.data()),
+                                           static_cast<uInt>(frame.image.size()));
+                    camera.hashes.insert(static_cast<std::uint32_t>(crc));
+                    if (++camera.hashed == options.hash_frames)
+                    {
+                        hashed_cameras.fetch_add(1, std::memory_order_release);
+                    }
                 }
+                break;
+            case Phase::WARMUP:
+            case Phase::DONE:
+                break;
             }
-        }
-    }
-    catch (const std::exception &e)
-    {
-        fmt::print(stderr, "ERROR: Failed during capture loop: {}\n", e.what());
-        // Fall through to stop streaming and calculate partial results if possible
-    }
-
-    const auto end = std::chrono::high_resolution_clock::now();
-    fmt::print("  Capture loop finished. Stopping streams...\n");
+        };
+        auto on_error = [&](std::size_t index, const std::exception &e)
+        {
+            if (!failed.load(std::memory_order_acquire))
+            {
+                failure = fmt::format("{}: {}", bench.devices[index], e.what());
+                failed.store(true, std::memory_order_release);
+            }
+        };
 
-    // --- Stop Streaming ---
-    // Iterate by index to use device_paths[i] in error messages
-    for (size_t i = 0; i < cameras.size(); ++i)
-    {
         try
         {
-            if (cameras[i])
-            { // Check if unique_ptr is valid
-                // Attempt stop_streaming without checking is_streaming()
-                cameras[i]->stop_streaming();
-            }
+            group.start(on_frame, on_error);
         }
         catch (const std::exception &e)
         {
-            // Use device_paths[i] for context in the error message
-            fmt::print(stderr, "WARN: Error stopping camera stream for {}: {}\n", device_paths[i], e.what());
+            result.status = "skipped";
+            result.error = e.what();
+            return;
         }
-        catch (...)
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup_s));
+
+        // ⏱ the timed region: the loop thread stamps and counts, this thread sleeps
+        std::vector<v4l2::CaptureStats> stats_before;
+        for (std::size_t i = 0; i < group.size(); ++i)
         {
-            fmt::print(stderr, "WARN: Unknown error stopping camera stream for {}.\n", device_paths[i]);
+            stats_before.push_back(group.camera(i).stats());
+        }
+        rusage usage_before{};
+        getrusage(RUSAGE_SELF, &usage_before);
+        const auto start = Clock::now();
+        phase.store(Phase::MEASURE, std::memory_order_release);
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.duration_s));
+
+        phase.store(options.hash ? Phase::HASH : Phase::DONE, std::memory_order_release);
+        const auto end = Clock::now();
+        rusage usage_after{};
+        getrusage(RUSAGE_SELF, &usage_after);
+        for (std::size_t i = 0; i < group.size(); ++i)
+        {
+            auto const stats = group.camera(i).stats();
+            result.lost_frames += stats.lost_frames - stats_before[i].lost_frames;
+            result.errored_buffers += stats.errored_buffers - stats_before[i].errored_buffers;
         }
-    }
-
-    // --- Calculate Results ---
-    fmt::print("  Calculating metrics...\n");
 
-    // CPU Usage
-    long user2 = 0, nice2 = 0, system2 = 0, idle2 = 0;
-    double cpu_usage_percent = 0.0;
-    auto cpu_stat_after = std::ifstream("/proc/stat");
-    if (cpu_stat_after >> _ >> user2 >> nice2 >> system2 >> idle2)
-    {
-        // Use long long for intermediate calculations to avoid overflow before converting to double
-        long long total1_ll = static_cast<long long>(user1) + nice1 + system1 + idle1;
-        long long total2_ll = static_cast<long long>(user2) + nice2 + system2 + idle2;
-        long long active1_ll = static_cast<long long>(user1) + nice1 + system1;
-        long long active2_ll = static_cast<long long>(user2) + nice2 + system2;
-
-        const double delta_total = static_cast<double>(total2_ll - total1_ll);
-        const double delta_active = static_cast<double>(active2_ll - active1_ll);
-
-        if (delta_total > 0)
-        { // Avoid division by zero
-            cpu_usage_percent = 100.0 * (delta_active / delta_total);
+        // #️⃣ untimed: are the frames really changing, or is a camera stuck on one image?
+        if (options.hash)
+        {
+            const auto deadline = Clock::now() + std::chrono::seconds(5) +
+                                  std::chrono::duration<double>(static_cast<double>(options.hash_frames) / static_cast<double>(bench.fps));
+            while (hashed_cameras.load(std::memory_order_acquire) < group.size() && Clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            phase.store(Phase::DONE, std::memory_order_release);
         }
-        else
+        group.stop(); // joins the loop thread, the samples are ours from here
+
+        if (failed.load(std::memory_order_acquire))
         {
-            fmt::print(stderr, "WARN: No change detected in /proc/stat, CPU usage calculation might be inaccurate.\n");
+            result.status = "failed";
+            result.error = failure;
         }
-    }
-    else
-    {
-        fmt::print(stderr, "WARN: Could not read final /proc/stat\n");
-    }
 
-    // Memory Usage (Peak Resident Set Size)
-    double mem_usage_mb = 0.0;
-    std::ifstream status("/proc/self/status");
-    std::string line;
-    while (std::getline(status, line))
-    {
-        if (line.rfind("VmRSS:", 0) == 0)
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        result.user_s = cpu_seconds(usage_after.ru_utime) - cpu_seconds(usage_before.ru_utime);
+        result.system_s = cpu_seconds(usage_after.ru_stime) - cpu_seconds(usage_before.ru_stime);
+        result.cpu_percent = result.seconds > 0 ? 100.0 * (result.user_s + result.system_s) / result.seconds : 0.0;
+        result.max_rss_mb = static_cast<double>(usage_after.ru_maxrss) / 1024.0;
+
+        std::vector<std::uint64_t> dqbuf;
+        std::vector<std::uint64_t> driver_to_user;
+        std::vector<std::uint64_t> intervals;
+        std::vector<std::uint64_t> jitter;
+        std::uint64_t bytes = 0;
+        for (auto &camera : samples)
         {
-            std::istringstream iss(line);
-            std::string key, unit;
-            long kb;
-            if (iss >> key >> kb >> unit && unit == "kB")
+            result.frames += camera.frames;
+            bytes += camera.bytes;
+            dqbuf.insert(dqbuf.end(), camera.dqbuf_us.begin(), camera.dqbuf_us.end());
+            driver_to_user.insert(driver_to_user.end(), camera.driver_to_user_us.begin(), camera.driver_to_user_us.end());
+
+            // 📈 jitter against each camera's own median interval, so it needs no nominal rate the driver may not hit
+            std::vector<std::uint64_t> camera_intervals;
+            for (std::size_t i = 1; i < camera.timestamps_us.size(); ++i)
             {
-                mem_usage_mb = static_cast<double>(kb) / 1024.0; // convert kB to MB
+                if (camera.timestamps_us[i] >= camera.timestamps_us[i - 1])
+                {
+                    camera_intervals.push_back(camera.timestamps_us[i] - camera.timestamps_us[i - 1]);
+                }
             }
-            else
+            auto const median = percentiles(camera_intervals).p50_us;
+            for (auto const interval : camera_intervals)
             {
-                fmt::print(stderr, "WARN: Could not parse VmRSS line: {}\n", line);
+                jitter.push_back(interval > median ? interval - median : median - interval);
             }
-            break;
-        }
-    }
-    if (mem_usage_mb == 0.0)
-    {
-        fmt::print(stderr, "WARN: Could not read memory usage from /proc/self/status\n");
-    }
+            intervals.insert(intervals.end(), camera_intervals.begin(), camera_intervals.end());
 
-    // Jitter (based on first camera's V4L2 timestamps)
-    std::vector<double> diffs_ms;
-    diffs_ms.reserve(timestamps_cam0.size() > 0 ? timestamps_cam0.size() - 1 : 0);
-    for (std::size_t i = 1; i < timestamps_cam0.size(); ++i)
-    {
-        // Check for timestamp wrap-around or non-monotonicity (can happen!)
-        if (timestamps_cam0[i] >= timestamps_cam0[i - 1])
+            if (options.hash)
+            {
+                result.unique_hashes = result.unique_hashes.value_or(0) + camera.hashes.size();
+                result.hashed_frames += camera.hashed;
+            }
+        }
+        result.dqbuf = percentiles(std::move(dqbuf));
+        result.driver_to_user = percentiles(std::move(driver_to_user));
+        result.jitter = percentiles(std::move(jitter));
+        result.interval_p50_us = percentiles(std::move(intervals)).p50_us;
+        if (result.seconds > 0)
         {
-            std::uint64_t delta_us = timestamps_cam0[i] - timestamps_cam0[i - 1];
-            diffs_ms.push_back(static_cast<double>(delta_us) / 1000.0); // convert us to ms
+            result.fps = static_cast<double>(result.frames) / result.seconds / static_cast<double>(group.size());
+            result.mb_per_s = static_cast<double>(bytes) / 1e6 / result.seconds;
         }
-        else
+        const auto seen = result.frames + result.lost_frames;
+        result.lost_percent = seen > 0 ? 100.0 * static_cast<double>(result.lost_frames) / static_cast<double>(seen) : 0.0;
+
+        if (!is_replay(bench))
         {
-            fmt::print(stderr, "WARN: Non-monotonic V4L2 timestamp detected for camera 0 ({} < {}). Skipping diff.\n", timestamps_cam0[i], timestamps_cam0[i - 1]);
+            result.kernel_warnings =
+                std::system("dmesg 2>/dev/null | tail -n 100 | grep -qE 'usb.*(reset|error|fail|xhci.*(died|halt))'") == 0;
         }
     }
 
-    double jitter_min = 0.0, jitter_max = 0.0, jitter_avg = 0.0;
-    if (!diffs_ms.empty())
+    // A mode for the replay suite: a short looped YUYV recording, or the first mode of --replay
+    [[nodiscard]] std::optional<BenchCase> replay_mode(const Options &options, const fs::path &dir)
     {
-        jitter_min = *std::min_element(diffs_ms.begin(), diffs_ms.end());
-        jitter_max = *std::max_element(diffs_ms.begin(), diffs_ms.end());
-        // Ensure diffs_ms.size() > 0 before division
-        jitter_avg = std::accumulate(diffs_ms.begin(), diffs_ms.end(), 0.0) / static_cast<double>(diffs_ms.size());
+        if (!options.replay.empty())
+        {
+            try
+            {
+                v4l2::V4L2Camera probe(v4l2::V4l2Config{.device_path_ = fmt::format("replay://{}", options.replay)});
+                probe.open_device();
+                auto const modes = probe.enumerate_modes();
+                if (modes.empty() || modes.front().frame_rates.empty())
+                {
+                    fmt::print(stderr, "WARN: {} has no mode to replay\n", options.replay);
+                    return std::nullopt;
+                }
+                auto const &mode = modes.front();
+                auto const &rate = mode.frame_rates.front();
+                return BenchCase{.suite = "replay",
+                                 .label = "REPLAY",
+                                 .devices = {options.replay},
+                                 .dimension = mode.dimension(),
+                                 .format = mode.format,
+                                 .fps = static_cast<v4l2::FPS>(rate.numerator / std::max(rate.denominator, 1u)),
+                                 .buffer_count = 4};
+            }
+            catch (const std::exception &e)
+            {
+                fmt::print(stderr, "WARN: cannot replay {}: {}\n", options.replay, e.what());
+                return std::nullopt;
+            }
+        }
+
+        constexpr std::uint32_t width = 1280;
+        constexpr std::uint32_t height = 720;
+        auto const path = dir / "bench-720p-yuyv.v4lr";
+        v4l2::Recorder recorder({.path_ = path.string(), .queue_depth_ = 4});
+        std::vector<std::byte> image(std::size_t{width} * height * 2);
+        for (std::uint32_t seq = 0; seq < 8; ++seq)
+        {
+            for (std::size_t i = 0; i < image.size(); ++i)
+            {
+                image[i] = static_cast<std::byte>((i + seq * 16) & 0xFF); // every frame different, --hash sees 8 of them
+            }
+            recorder.record(v4l2::FrameView{.timestamp_monotonic_us = 1'000'000 + std::uint64_t{seq} * 33'333,
+                                            .v4l2_timestamp_us = 1'000'000 + std::uint64_t{seq} * 33'333,
+                                            .image = image,
+                                            .width = width,
+                                            .height = height,
+                                            .format = v4l2::PixelFormat::YUYV,
+                                            .bytes_per_line = width * 2,
+                                            .sequence = seq});
+        }
+        recorder.close();
+        return BenchCase{.suite = "replay",
+                         .label = "REPLAY-HD-YUYV",
+                         .devices = {path.string()},
+                         .dimension = v4l2::PixelDimension::DIM_HD,
+                         .format = v4l2::PixelFormat::YUYV,
+                         .fps = v4l2::FPS::FPS_30,
+                         .buffer_count = 4};
     }
 
-    // Kernel Warnings
-    // Use std::system carefully, consider alternatives if security is paramount
-    bool kernel_warnings = system("dmesg | tail -n 100 | grep -qE 'usb.*(reset|error|fail|xhci.*(died|halt))'") == 0;
-    if (kernel_warnings)
+    [[nodiscard]] std::vector<BenchCase> build_cases(const Options &options, const fs::path &dir)
     {
-        fmt::print("  WARN: Potential USB issues detected in recent dmesg output.\n");
-    }
+        auto const wanted = [&](std::string_view suite)
+        { return std::find(options.suites.begin(), options.suites.end(), suite) != options.suites.end(); };
 
-    // Timing and Throughput
-    const auto total_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    const double ms_per_capture_cycle = (num_frames_per_camera > 0) ? static_cast<double>(total_duration_ms) / num_frames_per_camera : 0.0;
-    const double total_sec = static_cast<double>(total_duration_ms) / 1000.0;
-    const double mbps = (total_sec > 0) ? (static_cast<double>(total_bytes) / 1'000'000.0) / total_sec : 0.0;
+        std::vector<BenchCase> cases;
+        if (wanted("replay"))
+        {
+            if (auto const mode = replay_mode(options, dir))
+            {
+                auto const &file = mode->devices.front();
+                // 🎞 paced at the recorded rate: the whole capture path, no camera; max: what the library can move
+                auto paced = *mode;
+                paced.label = mode->label + "-paced";
+                paced.devices = {fmt::format("replay://{}?rate={}", file, static_cast<std::uint32_t>(mode->fps))};
+                cases.push_back(paced);
+
+                auto quad = paced;
+                quad.label = mode->label + "-paced-x4";
+                quad.devices.assign(4, paced.devices.front());
+                cases.push_back(quad);
+
+                auto max = *mode;
+                max.label = mode->label + "-max";
+                max.devices = {fmt::format("replay://{}?rate=max", file)};
+                cases.push_back(max);
+            }
+        }
 
-    // Average V4L2 Interval
-    double v4l2_interval_ms_avg = 0.0;
-    if (!v4l2_intervals_us.empty())
-    {
-        // Use double for sum to avoid potential overflow with uint64_t if many large intervals exist
-        double sum_us = 0.0;
-        for (std::uint64_t interval : v4l2_intervals_us)
+        const std::vector<BenchCase> modes = {
+            {"", "4K-MJPG-30", {}, v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
+            {"", "FHD-MJPG-30", {}, v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
+            {"", "FHD-MJPG-30", {}, v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
+            {"", "FHD-MJPG-60", {}, v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_60, 4},
+            {"", "HD-YUYV-30", {}, v4l2::PixelDimension::DIM_HD, v4l2::PixelFormat::YUYV, v4l2::FPS::FPS_30, 4},
+        };
+        auto const add_suite = [&](const char *suite, std::vector<std::string> devices)
+        {
+            for (auto bench : modes)
+            {
+                bench.suite = suite;
+                bench.devices = devices;
+                cases.push_back(std::move(bench));
+            }
+        };
+        if (wanted("single") && !options.devices.empty())
+        {
+            add_suite("single", {options.devices.front()});
+        }
+        if (wanted("dual") && options.devices.size() >= 2)
         {
-            sum_us += static_cast<double>(interval);
+            add_suite("dual", {options.devices.begin(), options.devices.begin() + 2});
         }
-        v4l2_interval_ms_avg = (sum_us / static_cast<double>(v4l2_intervals_us.size())) / 1000.0; // avg us -> ms
+        if (wanted("multi") && options.devices.size() >= 3)
+        {
+            add_suite("multi", options.devices);
+        }
+        return cases;
     }
 
-    fmt::print("  Finished test '{}'.\n", base_test.label);
-
-    return TestResult{
-        base_test,
-        static_cast<int>(cameras.size()), // Store number of cameras tested
-        ms_per_capture_cycle,
-        cpu_usage_percent,
-        mbps,
-        kernel_warnings,
-        crc_set.size(),
-        jitter_min,
-        jitter_max,
-        jitter_avg,
-        mem_usage_mb,
-        v4l2_interval_ms_avg};
-}
-
-// Function to run single-camera capture tests
-void test_single_camera() // Renamed for clarity
-{
-    fmt::print("Measuring single camera capture performance\n");
-    std::vector<TestCase> tests = {
-        {"4K-MJPG-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"4K-MJPG-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"4K-MJPG-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 6},
-        {"4K-MJPG-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 8},
-        {"4K-MJPG-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"4K-MJPG-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4},
-        {"4K-MJPG-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 6},
-        {"4K-MJPG-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 8},
-        {"FHD-MJPG-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"FHD-MJPG-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"FHD-MJPG-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 6},
-        {"FHD-MJPG-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 8},
-        {"FHD-MJPG-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"FHD-MJPG-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4},
-        {"FHD-MJPG-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 6},
-        {"FHD-MJPG-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 8}};
-
-    std::vector<TestResult> results;
-    results.reserve(tests.size());
-    for (const auto &test : tests)
+    [[nodiscard]] std::vector<std::string> split(std::string_view list)
     {
-        try
+        std::vector<std::string> parts;
+        while (!list.empty())
         {
-            // Run the measurement function with a single device path
-            results.push_back(measure_capture_performance(test, {"/dev/video0"}));
+            auto const comma = list.find(',');
+            if (auto const part = list.substr(0, comma); !part.empty())
+            {
+                parts.emplace_back(part);
+            }
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
         }
-        catch (const std::exception &e)
+        return parts;
+    }
+
+    [[nodiscard]] std::string json_string(std::string_view text)
+    {
+        std::string out = "\"";
+        for (const char c : text)
         {
-            fmt::print(stderr, "ERROR: Test '{}' failed: {}\n", test.label, e.what());
-            // Optionally add a 'failed' result or skip adding to results
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+            }
+            else
+            {
+                out += c;
+            }
         }
+        return out + "\"";
     }
 
-    print_results(results);
-    fmt::print("Single camera performance measurement done\n\n");
-}
-
-// Function to run dual-camera capture tests
-void test_dual_camera()
-{
-    fmt::print("Testing dual camera capture performance\n");
-    std::vector<TestCase> tests = {
-        {"DUAL-4k-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"DUAL-4k-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"DUAL-4k-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"DUAL-4k-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4},
-        {"DUAL-FHD-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"DUAL-FHD-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"DUAL-FHD-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"DUAL-FHD-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4}};
-
-    // Define the device paths for the dual cameras
-    // *** IMPORTANT: Change these to match your system setup ***
-    std::vector<std::string> dual_device_paths = {"/dev/video0", "/dev/video2"};
-    if (dual_device_paths.size() < 2)
-    { // Check if at least 2 paths are provided
-        fmt::print(stderr, "WARN: Expected at least 2 device paths for dual camera test, found {}. Check 'dual_device_paths' variable.\n", dual_device_paths.size());
-        // Decide how to proceed: skip, error out, or try with available paths?
-        // For now, let's proceed, measure_capture_performance will handle the actual count.
+    [[nodiscard]] std::string json_percentiles(const Percentiles &p)
+    {
+        return fmt::format(R"({{"count": {}, "p50": {}, "p99": {}, "max": {}}})", p.count, p.p50_us, p.p99_us, p.max_us);
     }
 
-    std::vector<TestResult> results;
-    results.reserve(tests.size());
-    for (const auto &test : tests)
+    void write_json(std::FILE *out, const Options &options, const std::vector<BenchResult> &results)
     {
-        try
-        {
-            // Run the measurement function with the specified dual device paths
-            results.push_back(measure_capture_performance(test, dual_device_paths));
-        }
-        catch (const std::exception &e)
+        utsname host{};
+        uname(&host);
+        fmt::print(out, "{{\n  \"kernel\": {},\n  \"cpus\": {},\n  \"warmup_s\": {},\n  \"duration_s\": {},\n  \"hash\": {},\n  \"results\": [",
+                   json_string(host.release), std::thread::hardware_concurrency(), options.warmup_s, options.duration_s,
+                   options.hash);
+        for (std::size_t i = 0; i < results.size(); ++i)
         {
-            fmt::print(stderr, "ERROR: Dual Test '{}' failed: {}\n", test.label, e.what());
+            auto const &r = results[i];
+            std::string devices;
+            for (auto const &device : r.bench.devices)
+            {
+                devices += (devices.empty() ? "" : ", ") + json_string(device);
+            }
+            fmt::print(out, "{}\n    {{\"suite\": {}, \"label\": {}, \"devices\": [{}], \"mode\": {}, \"format\": {}, "
+                            "\"nominal_fps\": {}, \"buffers\": {}, \"status\": {}, \"error\": {},\n"
+                            "     \"seconds\": {:.3f}, \"frames\": {}, \"fps\": {:.3f}, \"mb_per_s\": {:.3f}, \"interval_p50_us\": {},\n"
+                            "     \"dqbuf_us\": {}, \"jitter_us\": {}, \"driver_to_user_us\": {},\n"
+                            "     \"cpu_percent\": {:.2f}, \"user_s\": {:.3f}, \"system_s\": {:.3f}, \"max_rss_mb\": {:.1f},\n"
+                            "     \"lost_frames\": {}, \"lost_percent\": {:.3f}, \"errored_buffers\": {}, \"unique_hashes\": {}, "
+                            "\"hashed_frames\": {}, \"kernel_warnings\": {}}}",
+                       i == 0 ? "" : ",", json_string(r.bench.suite), json_string(r.bench.label), devices,
+                       json_string(mode_name(r.bench)), json_string(format_name(r.bench.format)),
+                       static_cast<std::uint32_t>(r.bench.fps), r.bench.buffer_count, json_string(r.status), json_string(r.error),
+                       r.seconds, r.frames, r.fps, r.mb_per_s, r.interval_p50_us,
+                       json_percentiles(r.dqbuf), json_percentiles(r.jitter), json_percentiles(r.driver_to_user),
+                       r.cpu_percent, r.user_s, r.system_s, r.max_rss_mb,
+                       r.lost_frames, r.lost_percent, r.errored_buffers,
+                       r.unique_hashes ? fmt::format("{}", *r.unique_hashes) : "null", r.hashed_frames, r.kernel_warnings);
         }
+        fmt::print(out, "\n  ]\n}}\n");
     }
 
-    print_results(results);
-    fmt::print("Testing dual camera capture done\n\n");
-}
-
-// Function to run single-camera tests, potentially targeting a USB3 capable camera/port
-void test_usb3_cam() // Could potentially use a different device path if needed
-{
-    fmt::print("Testing 'USB3' single camera performance (using /dev/video4)\n");
-    // *** IMPORTANT: Ensure /dev/video0 is connected via USB3 for these tests to be meaningful ***
-    std::vector<TestCase> tests = {
-        {"USB3-4K-60", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_60, 2},
-        {"USB3-4K-60", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_60, 4},
-        {"USB3-4K-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"USB3-4K-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"USB3-4K-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"USB3-4K-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4},
-        {"USB3-FHD-60", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_60, 2},
-        {"USB3-FHD-60", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_60, 4},
-        {"USB3-FHD-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"USB3-FHD-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"USB3-FHD-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"USB3-FHD-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4},
-    };
-
-    std::vector<TestResult> results;
-    results.reserve(tests.size());
-    for (const auto &test : tests)
+    void write_csv(std::FILE *out, const std::vector<BenchResult> &results)
     {
-        try
+        fmt::print(out, "suite,label,cameras,mode,format,nominal_fps,buffers,status,seconds,frames,fps,mb_per_s,interval_p50_us,"
+                        "dqbuf_p50_us,dqbuf_p99_us,dqbuf_max_us,jitter_p50_us,jitter_p99_us,jitter_max_us,"
+                        "driver_to_user_p50_us,driver_to_user_p99_us,driver_to_user_max_us,"
+                        "cpu_percent,user_s,system_s,max_rss_mb,lost_frames,lost_percent,errored_buffers,unique_hashes,kernel_warnings\n");
+        for (auto const &r : results)
         {
-            // Run using the consolidated function with a single device path
-            results.push_back(measure_capture_performance(test, {"/dev/video4"}));
+            fmt::print(out, "{},{},{},{},{},{},{},{},{:.3f},{},{:.3f},{:.3f},{},{},{},{},{},{},{},{},{},{},{:.2f},{:.3f},{:.3f},{:.1f},{},{:.3f},{},{},{}\n",
+                       r.bench.suite, r.bench.label, r.bench.devices.size(), mode_name(r.bench), format_name(r.bench.format),
+                       static_cast<std::uint32_t>(r.bench.fps), r.bench.buffer_count, r.status,
+                       r.seconds, r.frames, r.fps, r.mb_per_s, r.interval_p50_us,
+                       r.dqbuf.p50_us, r.dqbuf.p99_us, r.dqbuf.max_us, r.jitter.p50_us, r.jitter.p99_us, r.jitter.max_us,
+                       r.driver_to_user.p50_us, r.driver_to_user.p99_us, r.driver_to_user.max_us,
+                       r.cpu_percent, r.user_s, r.system_s, r.max_rss_mb, r.lost_frames, r.lost_percent, r.errored_buffers,
+                       r.unique_hashes ? fmt::format("{}", *r.unique_hashes) : "", r.kernel_warnings ? 1 : 0);
         }
-        catch (const std::exception &e)
+    }
+
+    void write_table(std::FILE *out, const std::vector<BenchResult> &results)
+    {
+        fmt::print(out, "{:<7} {:<22} {:>4} {:>9} {:>5} {:>4} {:>8} {:>8} {:>20} {:>20} {:>20} {:>7} {:>8} {:>6}\n",
+                   "Suite", "Label", "NCam", "Mode", "Fmt", "Bufs", "FPS", "MB/s", "DQBUF p50/p99/max", "Jitter p50/p99/max",
+                   "Drv->user p50/p99/max", "CPU %", "Lost %", "Hashes");
+        fmt::print(out, "{:-<170}\n", "");
+        auto const triple = [](const Percentiles &p)
+        { return fmt::format("{}/{}/{}", p.p50_us, p.p99_us, p.max_us); };
+        for (auto const &r : results)
         {
-            fmt::print(stderr, "ERROR: USB3 Test '{}' failed: {}\n", test.label, e.what());
+            if (r.status == "skipped")
+            {
+                fmt::print(out, "{:<7} {:<22} {:>4} skipped: {}\n", r.bench.suite, r.bench.label, r.bench.devices.size(), r.error);
+                continue;
+            }
+            fmt::print(out, "{:<7} {:<22} {:>4} {:>9} {:>5} {:>4} {:>8.2f} {:>8.2f} {:>20} {:>20} {:>20} {:>7.2f} {:>8.3f} {:>6}{}{}\n",
+                       r.bench.suite, r.bench.label, r.bench.devices.size(), mode_name(r.bench), format_name(r.bench.format),
+                       r.bench.buffer_count, r.fps, r.mb_per_s, triple(r.dqbuf), triple(r.jitter), triple(r.driver_to_user),
+                       r.cpu_percent, r.lost_percent, r.unique_hashes ? fmt::format("{}", *r.unique_hashes) : "-",
+                       r.kernel_warnings ? "  USB WARN" : "", r.status == "failed" ? fmt::format("  failed: {}", r.error) : "");
         }
+        fmt::print(out, "(microseconds; DQBUF: DQBUF return to the consumer, jitter: |interval - median interval|)\n");
     }
 
-    print_results(results);
-    fmt::print("Testing 'USB3' camera performance done\n\n");
-}
+    void usage(const char *program)
+    {
+        fmt::print(stderr,
+                   "usage: {} [--duration=S] [--warmup=S] [--format=table|json|csv] [--output=FILE] [--hash[=FRAMES]]\n"
+                   "          [--devices=/dev/video0,/dev/video2,...] [--replay=FILE.v4lr] [--suites=replay,single,dual,multi]\n",
+                   program);
+    }
 
-void test_usb3_dual_cam()
-{
-    fmt::print("Testing 'USB3' dual camera performance\n");
-    // *** IMPORTANT: Ensure /dev/video0 and /dev/video2 are connected via USB3 for these tests to be meaningful ***
-    std::vector<TestCase> tests = {
-        {"USB3-DUAL-4K-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"USB3-DUAL-4K-30", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"USB3-DUAL-4K-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"USB3-DUAL-4K-15", v4l2::PixelDimension::DIM_4K, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4},
-        {"USB3-DUAL-FHD-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 2},
-        {"USB3-DUAL-FHD-30", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_30, 4},
-        {"USB3-DUAL-FHD-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 2},
-        {"USB3-DUAL-FHD-15", v4l2::PixelDimension::DIM_FHD, v4l2::PixelFormat::MJPG, v4l2::FPS::FPS_15, 4}};
-
-    std::vector<std::string> dual_device_paths = {"/dev/video4", "/dev/video6"};
-    std::vector<TestResult> results;
-    results.reserve(tests.size());
-    for (const auto &test : tests)
+    [[nodiscard]] std::optional<Options> parse_options(int argc, char **argv)
     {
-        try
+        Options options;
+        for (int i = 1; i < argc; ++i)
         {
-            // Run using the consolidated function with the specified dual device paths
-            results.push_back(measure_capture_performance(test, dual_device_paths));
+            const std::string_view arg = argv[i];
+            auto const eq = arg.find('=');
+            auto const key = arg.substr(0, eq);
+            const std::string value(eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1));
+            try
+            {
+                if (key == "--duration")
+                {
+                    options.duration_s = std::stod(value);
+                }
+                else if (key == "--warmup")
+                {
+                    options.warmup_s = std::stod(value);
+                }
+                else if (key == "--format" && (value == "table" || value == "json" || value == "csv"))
+                {
+                    options.format = value == "json" ? OutputFormat::JSON : value == "csv" ? OutputFormat::CSV : OutputFormat::TABLE;
+                }
+                else if (key == "--output")
+                {
+                    options.output = value;
+                }
+                else if (key == "--hash")
+                {
+                    options.hash = true;
+                    if (!value.empty())
+                    {
+                        options.hash_frames = std::stoul(value);
+                    }
+                }
+                else if (key == "--devices")
+                {
+                    options.devices = split(value);
+                }
+                else if (key == "--replay")
+                {
+                    options.replay = value;
+                }
+                else if (key == "--suites")
+                {
+                    options.suites = split(value);
+                }
+                else
+                {
+                    return std::nullopt;
+                }
+            }
+            catch (const std::exception &)
+            {
+                return std::nullopt; // std::stod/stoul on something that is no number
+            }
         }
-        catch (const std::exception &e)
+        if (options.duration_s <= 0 || options.warmup_s < 0 || options.hash_frames == 0)
         {
-            fmt::print(stderr, "ERROR: USB3 Dual Test '{}' failed: {}\n", test.label, e.what());
+            return std::nullopt;
         }
+        return options;
     }
+} // namespace
 
-    print_results(results);
-    fmt::print("Testing 'USB3' dual camera performance done\n\n");
-}
-
-// Function to stress USB bandwidth with a single high-load camera configuration
-void stress_usb_bandwidth()
+int main(int argc, char **argv)
 {
-    fmt::print("Starting USB bandwidth stress test (using /dev/video0)\n");
-
-    // Define a high-bandwidth configuration for the stress test
-    v4l2::V4l2Config config{};
-    config.device_path_ = "/dev/video0";               // *** Ensure this camera is on the bus you want to stress ***
-    config.dimension_ = v4l2::PixelDimension::DIM_FHD; // Or DIM_4K if available/needed
-    config.format_ = v4l2::PixelFormat::MJPG;          // Or YUYV for higher raw bandwidth
-    config.fps_num_ = v4l2::FPS::FPS_30;               // Or FPS_60 if available
-    config.buffer_count_ = 8;                          // Use a higher buffer count
-
-    auto [w, h] = v4l2::dimensions_decompress(static_cast<std::uint32_t>(config.dimension_)); // Decompress for logging
-
-    fmt::print("  Using Config: Device: {}, Res: {}, Fmt: {}, FPS: {}, Bufs: {}\n",
-               config.device_path_,
-               fmt::format("{}x{}", w, h), // Format here
-               config.format_ == v4l2::PixelFormat::MJPG ? "MJPG" : "YUYV",
-               static_cast<uint32_t>(config.fps_num_),
-               config.buffer_count_);
-
-    std::unique_ptr<v4l2::V4L2Camera> cam;
-    try
-    {
-        cam = std::make_unique<v4l2::V4L2Camera>(config);
-        cam->open_device();
-        cam->configure();
-        cam->start_streaming();
-    }
-    catch (const std::exception &e)
+    auto const options = parse_options(argc, argv);
+    if (!options)
     {
-        fmt::print(stderr, "ERROR: Failed to set up camera for stress test: {}\n", e.what());
-        return; // Cannot proceed
+        usage(argv[0]);
+        return 2;
     }
 
-    constexpr auto duration_sec = 30;
-    const auto start_time = std::chrono::steady_clock::now();
-    int frame_count = 0;
-    // Use unsigned type matching std::vector::size() to avoid sign conversion issues
-    std::uint64_t total_bytes = 0; // Changed to unsigned 64-bit integer
+    auto const dir = fs::temp_directory_path() / fmt::format("v4l2-bench-{}", getpid());
+    fs::create_directories(dir);
+    auto const cases = build_cases(*options, dir);
+    fmt::print(stderr, "{} cases, {:.1f} s warmup + {:.1f} s measured each{}\n", cases.size(), options->warmup_s,
+               options->duration_s, options->hash ? ", then hashing" : "");
 
-    fmt::print("  Running stress test for {} seconds...\n", duration_sec);
-
-    while (std::chrono::steady_clock::now() - start_time < std::chrono::seconds(duration_sec))
+    std::vector<BenchResult> results;
+    results.reserve(cases.size());
+    for (auto const &bench : cases)
     {
+        fmt::print(stderr, "  {} {} on {} camera(s)... ", bench.suite, bench.label, bench.devices.size());
+        BenchResult result;
+        result.bench = bench;
         try
         {
-            auto const frame = cam->capture_frame();
-            cam->release_frame();
-            ++frame_count;
-            total_bytes += frame.image.size(); // Now adding size_t to uint64_t (safe)
+            run_case(bench, *options, result);
         }
         catch (const std::exception &e)
         {
-            fmt::print(stderr, "ERROR during stress capture: {}\n", e.what());
-            // Consider breaking or logging frequency of errors
-            break; // Stop test on error
+            result.status = "failed";
+            result.error = e.what();
         }
+        fmt::print(stderr, "{}{}\n", result.status, result.error.empty() ? "" : fmt::format(" ({})", result.error));
+        results.push_back(std::move(result));
     }
+    fs::remove_all(dir);
 
-    try
-    {
-        if (cam)
-        { // Check unique_ptr is valid
-            // Attempt stop_streaming without checking is_streaming()
-            cam->stop_streaming();
-        }
-    }
-    catch (const std::exception &e)
-    {
-        fmt::print(stderr, "WARN: Error stopping camera stream after stress test: {}\n", e.what());
-    }
-    catch (...)
+    std::FILE *out = options->output.empty() ? stdout : std::fopen(options->output.c_str(), "w");
+    if (!out)
     {
-        fmt::print(stderr, "WARN: Unknown error stopping camera stream after stress test.\n");
-    }
-
-    const auto end_time = std::chrono::steady_clock::now();
-    const double actual_duration_sec = std::chrono::duration<double>(end_time - start_time).count();
-    const double avg_fps = (actual_duration_sec > 0) ? static_cast<double>(frame_count) / actual_duration_sec : 0.0;
-    const double avg_mbps = (actual_duration_sec > 0) ? (static_cast<double>(total_bytes) / 1'000'000.0) / actual_duration_sec : 0.0;
-
-    fmt::print("  Stress Test Summary:\n");
-    fmt::print("    Captured {} frames in {:.2f} seconds.\n", frame_count, actual_duration_sec);
-    fmt::print("    Average FPS: {:.2f}\n", avg_fps);
-    fmt::print("    Average Bandwidth: {:.2f} MB/s\n", avg_mbps);
-
-    fmt::print("  Checking kernel logs for USB errors post-stress test...\n");
-    // Refined grep pattern for potentially more relevant errors
-    int ret = system("dmesg | tail -n 150 | grep -E --color=always 'usb.*(reset|error|fail|disconnect|xhci.*(died|halt|error|warn))'");
-    if (ret != 0) // system returns 0 if grep finds matches
-    {
-        fmt::print("    No significant USB errors found in recent kernel logs.\n");
-    }
-    else
-    {
-        fmt::print("    WARN: Potential USB issues detected in recent dmesg output (see highlighted messages above).\n");
-    }
-    fmt::print("USB bandwidth stress test done\n\n");
-}
-
-// Main function to orchestrate the tests
-int main()
-{
-    fmt::print("Starting V4L2 Camera Performance Tests.\n");
-    fmt::print("NOTE: Stress test and kernel log checks might require elevated privileges (e.g., run with sudo or as root, or use `docker run --privileged`).\n\n");
-
-    // Add placeholder definitions if rocx types are not fully defined
-    // Ensure PixelDimension, PixelFormat, FPS enums/types are properly defined or included
-    // Example: using v4l2::PixelDimension::DIM_FHD; etc.
-
-    try
-    {
-        test_single_camera();
-        test_dual_camera();     // Ensure /dev/video0 and /dev/video2 exist and are configured correctly
-        test_usb3_cam();        // Ensure /dev/video0 is connected via USB3 for meaningful results
-        test_usb3_dual_cam();   // Ensure /dev/video4 and /dev/video6 are connected via USB3 for meaningful results
-        stress_usb_bandwidth(); // Requires write access potentially implied by --privileged for dmesg checks depending on system config.
+        fmt::print(stderr, "cannot write {}\n", options->output);
+        return 1;
     }
-    catch (const std::exception &e)
+    switch (options->format)
     {
-        fmt::print(stderr, "FATAL ERROR during test execution: {}\n", e.what());
-        return 1;
+    case OutputFormat::JSON:
+        write_json(out, *options, results);
+        break;
+    case OutputFormat::CSV:
+        write_csv(out, results);
+        break;
+    case OutputFormat::TABLE:
+        write_table(out, results);
+        break;
     }
-    catch (...)
+    if (out != stdout)
     {
-        fmt::print(stderr, "FATAL UNKNOWN ERROR during test execution.\n");
-        return 1;
+        std::fclose(out);
     }
 
-    fmt::print("All tests finished successfully.\n");
-    return 0;
+    // a case that started and then broke is a regression, one without its camera is not
+    auto const failed = std::count_if(results.begin(), results.end(), [](auto const &r)
+                                      { return r.status == "failed"; });
+    return failed == 0 ? 0 : 1;
 }
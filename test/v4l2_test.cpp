@@ -1,6 +1,14 @@
+#include "v4l2/capture_thread.hpp"
+#include "v4l2/recorder.hpp"
 #include "v4l2/v4l2.hpp"
+#include <algorithm>  // For std::find_if
 #include <cassert>    // For assert
+#include <chrono>     // For std::chrono::seconds
+#include <filesystem> // For std::filesystem::remove
 #include <fmt/core.h> // For fmt::format
+#include <stdexcept>  // For std::runtime_error
+#include <unistd.h>   // For usleep
+#include <vector>     // For std::vector
 
 void create_destroy()
 {
@@ -12,8 +20,7 @@ void create_destroy()
     camera.configure();
     (void)camera.try_soe(); // nodiscard
     camera.start_streaming();
-    (void)camera.capture_frame();
-    camera.release_frame();
+    (void)camera.capture_frame(); // lease re-queues on destruction
     camera.stop_streaming();
     fmt::print("Create and destroy done\n");
 }
@@ -29,7 +36,6 @@ void multiple_lifecycles()
         (void)cam.try_soe();
         cam.start_streaming();
         (void)cam.capture_frame();
-        cam.release_frame();
         cam.stop_streaming();
     }
     fmt::print("Multiple lifecycles done\n");
@@ -58,11 +64,253 @@ void test_get_frame()
     cam.configure();
     cam.start_streaming();
 
+    {
+        auto const frame = cam.capture_frame();
+        assert(frame->image.size() > 0);
+        // the default config captures MJPG, every frame comes with its marker scan
+        assert(frame->jpeg.has_value());
+        fmt::print("JPEG scan: status {}, {}x{}, DHT {}\n", static_cast<std::uint32_t>(frame->jpeg->status),
+                   frame->jpeg->width, frame->jpeg->height, frame->jpeg->has_dht);
+    }
+
+    // one frame held and released: one sample per stage, the handoff only when marked
+    auto const latency = cam.latency();
+    assert(latency.dqbuf_to_qbuf.count == 1);
+    assert(latency.dqbuf_to_handoff.count == 0);
+    fmt::print("Latency: driver to DQBUF p50 {} us ({} frames), held {} us\n", latency.driver_to_dqbuf.p50_us,
+               latency.driver_to_dqbuf.count, latency.dqbuf_to_qbuf.max_us);
+
+    cam.stop_streaming();
+}
+
+void test_multiple_leases()
+{
+    fmt::print("Testing multiple leases\n");
+
+    v4l2::V4l2Config config{};
+    config.buffer_count_ = 4;
+
+    v4l2::V4L2Camera cam(config);
+    cam.open_device();
+    cam.configure();
+    cam.start_streaming();
+
+    {
+        std::vector<v4l2::FrameLease> leases;
+        for (std::uint32_t i = 0; i < config.buffer_count_; ++i)
+        {
+            leases.push_back(cam.capture_frame());
+        }
+        assert(cam.outstanding_frames() == config.buffer_count_);
+
+        try
+        {
+            (void)cam.capture_frame();
+            assert(false && "should have thrown, every buffer is leased");
+        }
+        catch (const std::exception &e)
+        {
+            fmt::print("Caught expected exception: {}\n", e.what());
+        }
+
+        // release out of order, each lease re-queues its own buffer
+        leases[2].release();
+        assert(cam.outstanding_frames() == config.buffer_count_ - 1);
+        auto const again = cam.capture_frame();
+        assert(again.index() == leases[2].index());
+    }
+    assert(cam.outstanding_frames() == 0);
+
+    cam.stop_streaming();
+    fmt::print("Multiple leases test done\n");
+}
+
+void test_latest_policy()
+{
+    fmt::print("Testing latest-frame policy\n");
+
+    v4l2::V4l2Config config{};
+    config.buffer_count_ = 4;
+    config.capture_policy_ = v4l2::CapturePolicy::LATEST;
+
+    v4l2::V4L2Camera cam(config);
+    cam.open_device();
+    cam.configure();
+    cam.start_streaming();
+
     (void)cam.capture_frame();
-    cam.release_frame();
-    assert(frame.image.size() > 0);
+    // let every buffer fill up, the next capture must skip the stale ones
+    usleep(200'000);
+    {
+        auto const frame = cam.capture_frame();
+        assert(frame->image.size() > 0);
+        assert(cam.outstanding_frames() == 1);
+    }
+    assert(cam.stats().dropped_frames > 0);
+    fmt::print("Dropped {} stale frames\n", cam.stats().dropped_frames);
+
+    cam.stop_streaming();
+    fmt::print("Latest-frame policy test done\n");
+}
+
+void test_capture_thread()
+{
+    fmt::print("Testing capture thread\n");
+
+    v4l2::V4l2Config config{};
+    config.buffer_count_ = 4;
+
+    v4l2::V4L2Camera cam(config);
+    cam.open_device();
+    cam.configure();
+    cam.start_streaming();
+
+    {
+        // realtime knobs left at their defaults so the test runs unprivileged
+        v4l2::CaptureThread capture(cam);
+        capture.start();
+
+        std::uint32_t last_sequence = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+            auto const frame = capture.pop(std::chrono::seconds(2));
+            assert(frame && (*frame)->image.size() > 0);
+            assert(i == 0 || (*frame)->sequence > last_sequence);
+            last_sequence = (*frame)->sequence;
+        }
+
+        // an idle consumer lets the ring fill up, the thread must wait instead of failing
+        usleep(300'000);
+        assert(cam.outstanding_frames() <= config.buffer_count_);
+        assert(capture.pop(std::chrono::seconds(2)));
+
+        capture.stop();
+        assert(cam.outstanding_frames() == 0);
+    }
 
     cam.stop_streaming();
+    fmt::print("Capture thread test done\n");
+}
+
+void test_recorder()
+{
+    fmt::print("Testing recorder\n");
+
+    v4l2::V4l2Config config{};
+    config.buffer_count_ = 4;
+
+    v4l2::V4L2Camera cam(config);
+    cam.open_device();
+    cam.configure();
+    cam.start_streaming();
+
+    const std::string path = "v4l2-test-recording.v4lr";
+    {
+        // the leases stay out until their write completes, fewer in flight than driver buffers
+        v4l2::Recorder recorder({.path_ = path, .queue_depth_ = 2});
+        for (int i = 0; i < 20; ++i)
+        {
+            recorder.record(cam.capture_frame());
+        }
+        recorder.close();
+        assert(recorder.stats().frames == 20);
+        assert(cam.outstanding_frames() == 0);
+    }
+
+    v4l2::RecordingReader reader(path);
+    assert(reader.complete() && reader.index().size() == 20 && reader.format() == config.format_);
+    assert(reader.read(19).data.size() == reader.index()[19].size);
+    std::filesystem::remove(path);
+
+    cam.stop_streaming();
+    fmt::print("Recorder test done\n");
+}
+
+void test_enumerate_modes()
+{
+    fmt::print("Testing mode enumeration\n");
+
+    v4l2::V4L2Camera probe(v4l2::V4l2Config{});
+    probe.open_device();
+    auto const modes = probe.enumerate_modes();
+    assert(!modes.empty());
+    for (auto const &mode : modes)
+    {
+        assert(mode.width > 0 && mode.height > 0);
+        fmt::print("  {:08X} {}x{} @ {} rate(s)\n", static_cast<std::uint32_t>(mode.format), mode.width, mode.height, mode.frame_rates.size());
+    }
+
+    // cached: a second camera on the same path gets the same list
+    v4l2::V4L2Camera again(v4l2::V4l2Config{});
+    again.open_device();
+    assert(again.enumerate_modes().size() == modes.size());
+
+    // whatever the device offers must configure as offered, named enum or not
+    auto const it = std::find_if(modes.begin(), modes.end(), [](const v4l2::CaptureMode &m)
+                                 { return (m.format == v4l2::PixelFormat::MJPG || m.format == v4l2::PixelFormat::YUYV) && !m.frame_rates.empty(); });
+    assert(it != modes.end());
+    v4l2::V4l2Config config{};
+    config.format_ = it->format;
+    config.dimension_ = it->dimension();
+    config.fps_num_ = static_cast<v4l2::FPS>(it->frame_rates.back().numerator);
+    config.fps_den_ = it->frame_rates.back().denominator;
+
+    v4l2::V4L2Camera cam(config);
+    cam.open_device();
+    cam.configure();
+    assert(cam.config().dimension_ == it->dimension());
+    cam.start_streaming();
+    {
+        auto const frame = cam.capture_frame();
+        assert(frame->width == it->width && frame->height == it->height);
+    }
+    cam.stop_streaming();
+    fmt::print("Mode enumeration test done\n");
+}
+
+void test_crop()
+{
+    fmt::print("Testing sensor crop\n");
+
+    // a 640 wide band across the middle of a VGA frame, delivered at native resolution
+    v4l2::V4l2Config config{};
+    config.format_ = v4l2::PixelFormat::YUYV;
+    config.dimension_ = v4l2::to_dimension(640, 240);
+    config.crop_ = v4l2::Rect{.left = 0, .top = 120, .width = 640, .height = 240};
+
+    v4l2::V4L2Camera cam(config);
+    cam.open_device();
+    try
+    {
+        cam.configure();
+    }
+    catch (const std::runtime_error &e)
+    {
+        fmt::print("  driver cannot crop, skipped: {}\n", e.what()); // uvcvideo has no crop support
+        return;
+    }
+    auto const crop = *cam.config().crop_;
+    assert(!crop.empty());
+    cam.start_streaming();
+    {
+        auto const frame = cam.capture_frame();
+        assert(frame->crop == crop);
+        fmt::print("  crop {}x{} at {},{}, frame {}x{}\n", crop.width, crop.height, crop.left, crop.top, frame->width, frame->height);
+    }
+    cam.stop_streaming();
+
+    v4l2::V4L2Camera empty(v4l2::V4l2Config{.crop_ = v4l2::Rect{}});
+    empty.open_device();
+    try
+    {
+        empty.configure();
+        assert(false && "should have thrown");
+    }
+    catch (const std::invalid_argument &e)
+    {
+        fmt::print("Caught expected exception: {}\n", e.what());
+    }
+    fmt::print("Sensor crop test done\n");
 }
 
 void test_timestamp_diff()
@@ -81,8 +329,8 @@ void test_timestamp_diff()
     constexpr int num_frames = 10;
     for (int i = 0; i < num_frames; ++i)
     {
-        auto const frame = cam.capture_frame();
-        cam.release_frame();
+        auto const lease = cam.capture_frame();
+        auto const &frame = lease.view();
 
         // driver-provided timestamp (from buffer metadata)
         double drv_sec = static_cast<double>(frame.v4l2_timestamp_us) / 1'000'000.0;
@@ -118,6 +366,12 @@ int main()
     create_destroy();
     multiple_lifecycles();
     test_get_frame();
+    test_multiple_leases();
+    test_latest_policy();
+    test_capture_thread();
+    test_recorder();
+    test_enumerate_modes();
+    test_crop();
     bad_device_path();
     fmt::print("Success\n");
     return 0;